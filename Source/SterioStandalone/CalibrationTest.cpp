@@ -0,0 +1,225 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+// Checks the calibration fit of SterioCalibrationSolver.h on synthetic samples: observations are drawn through the
+// kernel with known tuning terms, optionally with noise, and the fit has to recover the terms from a perturbed
+// start while the residual goes down. Also checks that splitting the sums over tasks, as the rig does, doesn't
+// change the fit. Exits non-zero if any check fails.
+
+#include "SterioCalibrationSolver.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	using namespace SterioProjection;
+
+	const char* GetKernelName(EKernel Kernel)
+	{
+		switch (Kernel)
+		{
+		case EKernel::AVX2: return "avx2";
+		case EKernel::SSE: return "sse";
+		default: return "scalar";
+		}
+	}
+
+	/** Uniform in [-1, 1), the same sequence on every build */
+	struct FRandom
+	{
+		uint32_t State = 12345u;
+
+		double Next()
+		{
+			State = State * 1664525u + 1013904223u;
+			return (State >> 8) * (2.0 / 16777216.0) - 1.0;
+		}
+	};
+
+	const double TrueTerms[SterioCalibration::NumTerms] = { 1.04, 0.96, 0.0015, -0.001 };
+	const double InitialTerms[SterioCalibration::NumTerms] = { 0.9, 1.1, -0.002, 0.002 };
+	const char* TermNames[SterioCalibration::NumTerms] = { "M00", "M11", "M03", "M13" };
+
+	/** 160x100 cm front screen and the same screen turned 30 degrees about the up axis, like a CAVE wall */
+	std::vector<FScreenBasis> MakeScreens()
+	{
+		std::vector<FScreenBasis> Screens;
+		Screens.push_back(MakeScreenBasis(MakeCenteredScreen(160.f, 100.f)));
+
+		const float Angle = 30.f * 3.14159265f / 180.f;
+		const FVec3 Right = MakeVec3(80.f * std::cos(Angle), 0.f, 80.f * std::sin(Angle));
+		FScreen Wall;
+		Wall.Pa = MakeVec3(-Right.X, -50.f, -Right.Z);
+		Wall.Pb = MakeVec3(Right.X, -50.f, Right.Z);
+		Wall.Pc = MakeVec3(-Right.X, 50.f, -Right.Z);
+		Screens.push_back(MakeScreenBasis(Wall));
+		return Screens;
+	}
+
+	/**
+	 * Draws targets on and behind every screen for a grid of eye positions through the kernel with TrueTerms, and
+	 * records where they land on the screen, moved by up to NoiseCm in each direction.
+	 */
+	std::vector<SterioCalibration::FSampleTerms> MakeSamples(const std::vector<FScreenBasis>& Screens, const FFrustumParams& Untuned, double NoiseCm, FRandom& Random)
+	{
+		const EFlavor Flavors[] = { EFlavor::Direct, EFlavor::TanFlipped };
+
+		FFrustumParams Tuned = Untuned;
+		Tuned.Tuning.M00 = (float)TrueTerms[0];
+		Tuned.Tuning.M11 = (float)TrueTerms[1];
+		Tuned.Tuning.M03 = (float)TrueTerms[2];
+		Tuned.Tuning.M13 = (float)TrueTerms[3];
+
+		std::vector<SterioCalibration::FSampleTerms> Samples;
+		for (const FScreenBasis& Basis : Screens)
+		{
+			const FVec3 Across = Sub(Basis.Pb, Basis.Pa);
+			const FVec3 Up = Sub(Basis.Pc, Basis.Pa);
+			for (int32_t EyeIndex = 0; EyeIndex < 9; ++EyeIndex)
+			{
+				const float Offset = (float)(EyeIndex % 3 - 1) * 20.f;
+				const float Height = (float)(EyeIndex / 3 - 1) * 10.f;
+				const FVec3 Eye = MakeVec3(Offset * Basis.Vr.X + 120.f * Basis.Vn.X, Height, Offset * Basis.Vr.Z + 120.f * Basis.Vn.Z);
+
+				for (int32_t Flavor = 0; Flavor < 2; ++Flavor)
+				{
+					const FMatrix44 Projection = ComputeProjection(Basis, Eye, Flavors[Flavor], Tuned);
+					for (int32_t Point = 0; Point < 25; ++Point)
+					{
+						const float U = 0.1f + 0.2f * (Point % 5);
+						const float V = 0.1f + 0.2f * (Point / 5);
+						const float Depth = (Point % 2) ? 50.f : 0.f;
+						const FVec3 Target = MakeVec3(
+							Basis.Pa.X + U * Across.X + V * Up.X - Depth * Basis.Vn.X,
+							Basis.Pa.Y + U * Across.Y + V * Up.Y - Depth * Basis.Vn.Y,
+							Basis.Pa.Z + U * Across.Z + V * Up.Z - Depth * Basis.Vn.Z);
+
+						// Where the tuned projection puts the target, in cm from the lower-left corner
+						const FVec3 ToTarget = Sub(Target, Eye);
+						const double ViewX = Dot(Basis.Vr, ToTarget);
+						const double ViewY = Dot(Basis.Vu, ToTarget);
+						const double ViewZ = -Dot(Basis.Vn, ToTarget);
+						const double ClipX = ViewX * Projection.M[0][0] + ViewZ * Projection.M[2][0];
+						const double ClipY = ViewY * Projection.M[1][1] + ViewZ * Projection.M[2][1];
+						const double ClipW = ViewX * Projection.M[0][3] + ViewY * Projection.M[1][3] + ViewZ * Projection.M[2][3];
+						const double HalfWidth = 0.5 * std::sqrt((double)Dot(Across, Across));
+						const double HalfHeight = 0.5 * std::sqrt((double)Dot(Up, Up));
+						const double ObservedX = (ClipX / ClipW + 1.0) * HalfWidth + NoiseCm * Random.Next();
+						const double ObservedY = (ClipY / ClipW + 1.0) * HalfHeight + NoiseCm * Random.Next();
+
+						SterioCalibration::FSampleTerms Sample;
+						if (SterioCalibration::MakeSampleTerms(Basis, Eye, Target, ObservedX, ObservedY, Flavors[Flavor], Untuned, Sample))
+						{
+							Samples.push_back(Sample);
+						}
+					}
+				}
+			}
+		}
+		return Samples;
+	}
+
+	/** Fits the samples, summing them in NumTasks consecutive ranges reduced in order as the rig's tasks are */
+	SterioCalibration::FResult FitSamples(const std::vector<SterioCalibration::FSampleTerms>& Samples, int32_t NumTasks)
+	{
+		const int32_t Num = (int32_t)Samples.size();
+		const int32_t PerTask = (Num + NumTasks - 1) / NumTasks;
+		return SterioCalibration::Fit(InitialTerms, [&](const double* T, bool bWithJacobian, SterioCalibration::FSums& OutSums)
+		{
+			OutSums.Reset();
+			for (int32_t Task = 0; Task < NumTasks; ++Task)
+			{
+				const int32_t First = Task * PerTask;
+				const int32_t Count = First < Num ? (First + PerTask <= Num ? PerTask : Num - First) : 0;
+				SterioCalibration::FSums TaskSums;
+				SterioCalibration::Accumulate(Samples.data() + First, Count, T, bWithJacobian, TaskSums);
+				OutSums.Add(TaskSums);
+			}
+		});
+	}
+
+	/** Fits the samples and checks every term is within Tolerance of TrueTerms and the residual ends below MaxRms */
+	bool CheckRecovery(const char* Kernel, const char* Case, const std::vector<SterioCalibration::FSampleTerms>& Samples, double Tolerance, double MaxRms)
+	{
+		const SterioCalibration::FResult Result = FitSamples(Samples, 1);
+		const double RmsBefore = std::sqrt(Result.SquaredErrorBefore / Samples.size());
+		const double RmsAfter = std::sqrt(Result.SquaredErrorAfter / Samples.size());
+
+		bool bPassed = true;
+		for (int32_t Term = 0; Term < SterioCalibration::NumTerms; ++Term)
+		{
+			const double Error = std::fabs(Result.Terms[Term] - TrueTerms[Term]);
+			if (!(Error <= Tolerance))
+			{
+				std::printf("FAILED %s %s: %s is %.6g, expected %.6g within %g\n", Kernel, Case, TermNames[Term], Result.Terms[Term], TrueTerms[Term], Tolerance);
+				bPassed = false;
+			}
+		}
+		if (!Result.bConverged || !(RmsAfter < RmsBefore) || !(RmsAfter <= MaxRms))
+		{
+			std::printf("FAILED %s %s: rms %.6g -> %.6g cm (at most %g), %s after %d iterations\n", Kernel, Case, RmsBefore, RmsAfter, MaxRms,
+				Result.bConverged ? "converged" : "not converged", Result.Iterations);
+			bPassed = false;
+		}
+		if (bPassed)
+		{
+			std::printf("%s %s: %zu samples, rms %.4g -> %.4g cm in %d iterations\n", Kernel, Case, Samples.size(), RmsBefore, RmsAfter, Result.Iterations);
+		}
+		return bPassed;
+	}
+
+	/** Splitting the sums over tasks only reorders additions, so the fit may move by rounding alone */
+	bool CheckTaskSplit(const char* Kernel, const std::vector<SterioCalibration::FSampleTerms>& Samples)
+	{
+		const SterioCalibration::FResult Single = FitSamples(Samples, 1);
+		const int32_t NumTasks = SterioCalibration::GetNumTasks((int32_t)Samples.size(), 7, 64);
+		const SterioCalibration::FResult Split = FitSamples(Samples, NumTasks);
+
+		bool bPassed = NumTasks > 1;
+		for (int32_t Term = 0; Term < SterioCalibration::NumTerms; ++Term)
+		{
+			bPassed = bPassed && std::fabs(Single.Terms[Term] - Split.Terms[Term]) <= 1.e-9;
+		}
+		std::printf("%s%s task split: %d tasks %s\n", bPassed ? "" : "FAILED ", Kernel, NumTasks, bPassed ? "agree" : "disagree");
+		return bPassed;
+	}
+
+	bool CheckTaskCounts()
+	{
+		struct FCase { int32_t Samples, Workers, Expected; };
+		const FCase Cases[] = { { 0, 8, 1 }, { 100, 8, 1 }, { 128, 8, 2 }, { 900, 8, 8 }, { 100000, 8, 8 }, { 100000, 1, 1 } };
+
+		bool bPassed = true;
+		for (const FCase& Case : Cases)
+		{
+			const int32_t NumTasks = SterioCalibration::GetNumTasks(Case.Samples, Case.Workers, 64);
+			if (NumTasks != Case.Expected)
+			{
+				std::printf("FAILED task count: %d samples on %d workers gave %d tasks, expected %d\n", Case.Samples, Case.Workers, NumTasks, Case.Expected);
+				bPassed = false;
+			}
+		}
+		return bPassed;
+	}
+}
+
+int main()
+{
+	const char* Kernel = GetKernelName(GetBestKernel());
+	const std::vector<FScreenBasis> Screens = MakeScreens();
+	const FFrustumParams Untuned = MakeFrustumParams(1.f);
+
+	FRandom Random;
+	const std::vector<SterioCalibration::FSampleTerms> Exact = MakeSamples(Screens, Untuned, 0.0, Random);
+	const std::vector<SterioCalibration::FSampleTerms> Noisy = MakeSamples(Screens, Untuned, 0.2, Random);
+
+	bool bPassed = CheckTaskCounts();
+	bPassed = CheckRecovery(Kernel, "exact", Exact, 1.e-4, 1.e-3) && bPassed;
+	// Uniform noise of +-0.2 cm per axis has an rms of 0.16 cm over both axes
+	bPassed = CheckRecovery(Kernel, "noisy", Noisy, 2.e-3, 0.18) && bPassed;
+	bPassed = CheckTaskSplit(Kernel, Noisy) && bPassed;
+
+	std::printf("%s\n", bPassed ? "passed" : "FAILED");
+	return bPassed ? 0 : 1;
+}
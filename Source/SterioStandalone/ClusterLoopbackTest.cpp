@@ -0,0 +1,296 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+// Runs SterioClusterProtocol.h's frame lock as a cluster of separate processes on the loopback interface and checks:
+//
+//   lockstep   every secondary renders every frame with the pose the primary sent and every barrier releases,
+//              while each node spends a random time on its frame
+//   two_rigs   the same with two rigs per process, each on its own lane of ports as FSterioClusterNode assigns them
+//   timeout    a secondary that dies makes the primary's barrier time out after the timeout and no later, and the
+//              remaining secondary keeps receiving frames
+//
+// Exits non-zero if any check fails.
+//
+//   ClusterLoopbackTest [BasePort]
+
+#include "SterioClusterProtocol.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+	double NowSeconds()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	sockaddr_in MakeLoopbackAddress(int32_t Port)
+	{
+		sockaddr_in Address = {};
+		Address.sin_family = AF_INET;
+		Address.sin_port = htons((uint16_t)Port);
+		Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		return Address;
+	}
+
+	/** The frame lock's transport over a non-blocking POSIX UDP socket, like FSterioClusterNode's over FSocket */
+	class FUdpTransport
+	{
+	public:
+		FUdpTransport()
+			: Socket(-1)
+		{
+		}
+
+		bool Open(int32_t BasePort, int32_t Lane, int32_t NumNodes, int32_t NodeIndex)
+		{
+			Socket = socket(AF_INET, SOCK_DGRAM, 0);
+			const sockaddr_in Address = MakeLoopbackAddress(SterioCluster::GetPort(BasePort, Lane, NumNodes, NodeIndex));
+			if (Socket < 0 || bind(Socket, (const sockaddr*)&Address, sizeof(Address)) != 0 || fcntl(Socket, F_SETFL, O_NONBLOCK) != 0)
+			{
+				return false;
+			}
+			for (int32_t Node = 0; Node < NumNodes; ++Node)
+			{
+				NodeAddresses.push_back(MakeLoopbackAddress(SterioCluster::GetPort(BasePort, Lane, NumNodes, Node)));
+			}
+			return true;
+		}
+
+		void Close()
+		{
+			if (Socket >= 0)
+			{
+				close(Socket);
+				Socket = -1;
+			}
+		}
+
+		void Send(const SterioCluster::FPacket& Packet, int32_t Node)
+		{
+			sendto(Socket, &Packet, sizeof(Packet), 0, (const sockaddr*)&NodeAddresses[Node], sizeof(sockaddr_in));
+		}
+
+		bool Receive(SterioCluster::FPacket& OutPacket, double Deadline)
+		{
+			for (;;)
+			{
+				if (recv(Socket, &OutPacket, sizeof(OutPacket), 0) == (ssize_t)sizeof(OutPacket))
+				{
+					return true;
+				}
+
+				const double Remaining = Deadline - Now();
+				if (Remaining <= 0.0)
+				{
+					return false;
+				}
+				pollfd Poll = { Socket, POLLIN, 0 };
+				poll(&Poll, 1, (int)(Remaining * 1000.0) + 1);
+			}
+		}
+
+		double Now() const { return NowSeconds(); }
+
+	private:
+		int Socket;
+		std::vector<sockaddr_in> NodeAddresses;
+	};
+
+	typedef SterioCluster::TFrameLock<FUdpTransport> FFrameLock;
+
+	struct FScenario
+	{
+		const char* Name;
+		int32_t NumNodes;
+		int32_t NumLanes;
+		int32_t NumFrames;
+		double TimeoutSeconds;
+		/** This node exits after rendering DyingNodeFrames frames; -1 for none */
+		int32_t DyingNode;
+		int32_t DyingNodeFrames;
+	};
+
+	/** The pose the primary sends for a frame of a lane; small integers, so exact in a float */
+	void MakePose(int32_t Lane, uint64_t Frame, float OutLeft[3], float OutRight[3])
+	{
+		const float F = (float)(Frame + 1000 * Lane);
+		OutLeft[0] = F;
+		OutLeft[1] = 0.5f * F;
+		OutLeft[2] = -F;
+		OutRight[0] = F + 6.5f;
+		OutRight[1] = 0.5f * F;
+		OutRight[2] = -F;
+	}
+
+	/** Renders the scenario's frames as one node, every lane once per frame like rigs of one world; returns the number of failed checks. */
+	int32_t RunNode(const FScenario& Scenario, int32_t NodeIndex, std::vector<FUdpTransport>& Transports)
+	{
+		std::vector<FFrameLock> Locks;
+		for (int32_t Lane = 0; Lane < Scenario.NumLanes; ++Lane)
+		{
+			Locks.push_back(FFrameLock(Transports[Lane], NodeIndex, Scenario.NumNodes, Scenario.TimeoutSeconds));
+		}
+
+		uint32_t Random = 7919u * (NodeIndex + 1);
+		int32_t Failures = 0;
+		int32_t LateFrames = 0;
+		int32_t TimedOutBarriers = 0;
+		int32_t EarlyOrLateTimeouts = 0;
+		for (int32_t Frame = 1; Frame <= Scenario.NumFrames; ++Frame)
+		{
+			if (NodeIndex == Scenario.DyingNode && Frame > Scenario.DyingNodeFrames)
+			{
+				break;
+			}
+
+			for (int32_t Lane = 0; Lane < Scenario.NumLanes; ++Lane)
+			{
+				float Left[3], Right[3], ExpectedLeft[3], ExpectedRight[3];
+				MakePose(Lane, Frame, ExpectedLeft, ExpectedRight);
+				if (Locks[Lane].IsPrimary())
+				{
+					Locks[Lane].BroadcastFrame(ExpectedLeft, ExpectedRight);
+				}
+				else if (!Locks[Lane].ReceiveFrame(Left, Right))
+				{
+					++LateFrames;
+				}
+				else
+				{
+					bool bPoseMatches = Locks[Lane].GetFrameNumber() == (uint64_t)Frame;
+					for (int32_t Axis = 0; Axis < 3; ++Axis)
+					{
+						bPoseMatches = bPoseMatches && Left[Axis] == ExpectedLeft[Axis] && Right[Axis] == ExpectedRight[Axis];
+					}
+					if (!bPoseMatches)
+					{
+						std::printf("FAILED %s node %d lane %d: frame %d arrived as frame %llu or with the wrong pose\n", Scenario.Name, NodeIndex, Lane, Frame,
+							(unsigned long long)Locks[Lane].GetFrameNumber());
+						++Failures;
+					}
+				}
+			}
+
+			// Rendering the frame
+			Random = Random * 1664525u + 1013904223u;
+			usleep((Random >> 8) % 2000);
+
+			for (int32_t Lane = 0; Lane < Scenario.NumLanes; ++Lane)
+			{
+				if (!Locks[Lane].IsBarrierArmed())
+				{
+					continue;
+				}
+
+				const double Start = NowSeconds();
+				if (!Locks[Lane].RunBarrier())
+				{
+					++TimedOutBarriers;
+					const double Waited = NowSeconds() - Start;
+					EarlyOrLateTimeouts += (Waited < Scenario.TimeoutSeconds || Waited > Scenario.TimeoutSeconds + 0.25) ? 1 : 0;
+				}
+			}
+		}
+
+		// Only the primary's barrier waits for the dying node; it has to give up on every frame after it, on time
+		const bool bOutlivesDyingNode = Scenario.DyingNode >= 0 && NodeIndex != Scenario.DyingNode;
+		const int32_t ExpectedTimeouts = (bOutlivesDyingNode && NodeIndex == 0) ? (Scenario.NumFrames - Scenario.DyingNodeFrames) * Scenario.NumLanes : 0;
+		if (LateFrames != 0 || (NodeIndex == 0 ? TimedOutBarriers != ExpectedTimeouts : (!bOutlivesDyingNode && TimedOutBarriers != 0)) || EarlyOrLateTimeouts != 0)
+		{
+			std::printf("FAILED %s node %d: %d frames late, %d barrier timeouts (%d expected), %d of them not after %.2f s\n", Scenario.Name, NodeIndex,
+				LateFrames, TimedOutBarriers, ExpectedTimeouts, EarlyOrLateTimeouts, Scenario.TimeoutSeconds);
+			++Failures;
+		}
+		else if (NodeIndex != Scenario.DyingNode)
+		{
+			std::printf("%s node %d: %d frames on %d lanes, %d barrier timeouts, all on time\n", Scenario.Name, NodeIndex, Scenario.NumFrames, Scenario.NumLanes, TimedOutBarriers);
+		}
+		return Failures;
+	}
+
+	/** Binds every node's sockets, so no packet goes to an unbound port, then runs each node in its own process. */
+	bool RunScenario(const FScenario& Scenario, int32_t BasePort)
+	{
+		std::vector<std::vector<FUdpTransport>> Transports(Scenario.NumNodes, std::vector<FUdpTransport>(Scenario.NumLanes));
+		for (int32_t Node = 0; Node < Scenario.NumNodes; ++Node)
+		{
+			for (int32_t Lane = 0; Lane < Scenario.NumLanes; ++Lane)
+			{
+				if (!Transports[Node][Lane].Open(BasePort, Lane, Scenario.NumNodes, Node))
+				{
+					std::printf("FAILED %s: could not bind port %d\n", Scenario.Name, SterioCluster::GetPort(BasePort, Lane, Scenario.NumNodes, Node));
+					return false;
+				}
+			}
+		}
+
+		std::fflush(stdout);
+		std::vector<pid_t> Children;
+		for (int32_t Node = 0; Node < Scenario.NumNodes; ++Node)
+		{
+			const pid_t Child = fork();
+			if (Child == 0)
+			{
+				for (int32_t Other = 0; Other < Scenario.NumNodes; ++Other)
+				{
+					for (int32_t Lane = 0; Other != Node && Lane < Scenario.NumLanes; ++Lane)
+					{
+						Transports[Other][Lane].Close();
+					}
+				}
+				const int32_t Failures = RunNode(Scenario, Node, Transports[Node]);
+				std::fflush(stdout);
+				_exit(Failures ? 1 : 0);
+			}
+			Children.push_back(Child);
+		}
+
+		bool bPassed = true;
+		for (pid_t Child : Children)
+		{
+			int Status = 0;
+			bPassed = Child > 0 && waitpid(Child, &Status, 0) == Child && WIFEXITED(Status) && WEXITSTATUS(Status) == 0 && bPassed;
+		}
+		for (std::vector<FUdpTransport>& NodeTransports : Transports)
+		{
+			for (FUdpTransport& Transport : NodeTransports)
+			{
+				Transport.Close();
+			}
+		}
+		return bPassed;
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	// Apart per process, so runs side by side don't share ports
+	const int32_t BasePort = Argc > 1 ? std::atoi(Argv[1]) : 42000 + (int32_t)(getpid() % 1000) * 16;
+
+	const FScenario Scenarios[] =
+	{
+		{ "lockstep", 4, 1, 300, 2.0, -1, 0 },
+		{ "two_rigs", 3, 2, 150, 2.0, -1, 0 },
+		{ "timeout", 3, 1, 30, 0.2, 2, 20 },
+	};
+
+	bool bPassed = true;
+	for (const FScenario& Scenario : Scenarios)
+	{
+		bPassed = RunScenario(Scenario, BasePort) && bPassed;
+	}
+
+	std::printf("%s\n", bPassed ? "passed" : "FAILED");
+	return bPassed ? 0 : 1;
+}
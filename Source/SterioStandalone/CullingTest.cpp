@@ -0,0 +1,199 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+// Checks SterioCulling.h without the engine: the hierarchy has to find exactly the boxes the brute-force
+// reference finds, before and after a refit, and the union frustum of a screen has to contain every eye's own
+// frustum between the near and far distances. Runs for an axis-aligned, a turned and a floor screen with two and
+// four eyes. Exits non-zero if any check fails.
+
+#include "SterioCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using namespace SterioCulling;
+	using SterioProjection::FScreen;
+
+	const char* GetKernelName(SterioProjection::EKernel Kernel)
+	{
+		switch (Kernel)
+		{
+		case SterioProjection::EKernel::AVX2: return "avx2";
+		case SterioProjection::EKernel::SSE: return "sse";
+		default: return "scalar";
+		}
+	}
+
+	const float Near = 10.f;
+	const float Far = 2000.f;
+
+	/** How far outside a plane a point may be and still count as contained, for rounding in the plane fit */
+	const float ContainmentTolerance = 1.e-2f;
+
+	struct FCase
+	{
+		const char* Name;
+		FScreen Screen;
+		/** Eyes are spread around this point, which is in front of the screen */
+		FVec3 EyeCenter;
+	};
+
+	std::vector<FCase> MakeCases()
+	{
+		std::vector<FCase> Cases;
+
+		FCase Front = { "axis_aligned", SterioProjection::MakeCenteredScreen(160.f, 100.f), MakeVec3(0.f, 0.f, 120.f) };
+		Cases.push_back(Front);
+
+		// The same screen turned 30 degrees about the up axis, like a CAVE wall
+		const float Angle = 30.f * 3.14159265f / 180.f;
+		FCase Wall = { "single_axis", FScreen(), MakeVec3(-120.f * std::sin(Angle), 0.f, 120.f * std::cos(Angle)) };
+		Wall.Screen.Pa = MakeVec3(-80.f * std::cos(Angle), -50.f, -80.f * std::sin(Angle));
+		Wall.Screen.Pb = MakeVec3(80.f * std::cos(Angle), -50.f, 80.f * std::sin(Angle));
+		Wall.Screen.Pc = MakeVec3(-80.f * std::cos(Angle), 50.f, -80.f * std::sin(Angle));
+		Cases.push_back(Wall);
+
+		// A floor seen from above
+		FCase Floor = { "floor", FScreen(), MakeVec3(0.f, 150.f, 0.f) };
+		Floor.Screen.Pa = MakeVec3(-100.f, 0.f, 100.f);
+		Floor.Screen.Pb = MakeVec3(100.f, 0.f, 100.f);
+		Floor.Screen.Pc = MakeVec3(-100.f, 0.f, -100.f);
+		Cases.push_back(Floor);
+		return Cases;
+	}
+
+	std::vector<FVec3> MakeEyes(const FVec3& Center, int32_t NumEyes, std::mt19937& Random)
+	{
+		std::uniform_real_distribution<float> Offset(-15.f, 15.f);
+		std::vector<FVec3> Eyes;
+		for (int32_t Eye = 0; Eye < NumEyes; ++Eye)
+		{
+			Eyes.push_back(MakeVec3(Center.X + Offset(Random), Center.Y + Offset(Random), Center.Z + Offset(Random)));
+		}
+		return Eyes;
+	}
+
+	std::vector<FAabb> MakeBoxes(int32_t NumBoxes, std::mt19937& Random)
+	{
+		std::uniform_real_distribution<float> Position(-2500.f, 2500.f);
+		std::uniform_real_distribution<float> Size(1.f, 200.f);
+		std::vector<FAabb> Boxes;
+		for (int32_t Index = 0; Index < NumBoxes; ++Index)
+		{
+			const FVec3 Min = MakeVec3(Position(Random), Position(Random), Position(Random));
+			const FAabb Box = { Min, MakeVec3(Min.X + Size(Random), Min.Y + Size(Random), Min.Z + Size(Random)) };
+			Boxes.push_back(Box);
+		}
+		return Boxes;
+	}
+
+	/** The hierarchy, sorted, against the brute-force reference; returns the number of failed checks. */
+	int32_t CheckHierarchy(const char* Kernel, const char* Case, const char* Stage, const FFrustum& Frustum, const FBvh& Bvh, const std::vector<FAabb>& Boxes)
+	{
+		std::vector<int32_t> Expected, Visible;
+		CullBruteForce(Frustum, Boxes.data(), (int32_t)Boxes.size(), Expected);
+		const int32_t NumTests = Bvh.Cull(Frustum, Boxes.data(), Visible);
+		std::sort(Visible.begin(), Visible.end());
+
+		if (Visible != Expected)
+		{
+			std::printf("FAILED %s %s %s: hierarchy found %zu boxes, brute force %zu\n", Kernel, Case, Stage, Visible.size(), Expected.size());
+			return 1;
+		}
+		std::printf("%s %s %s: %zu of %zu boxes visible, %d box tests, exact\n", Kernel, Case, Stage, Visible.size(), Boxes.size(), NumTests);
+		return 0;
+	}
+
+	/**
+	 * Points inside each eye's frustum between Near and Far, including the corners, have to be inside every
+	 * plane of the union. Returns the number of failed checks.
+	 */
+	int32_t CheckContainment(const char* Kernel, const char* Case, const FCase& Setup, const std::vector<FVec3>& Eyes, const FFrustum& Frustum, std::mt19937& Random)
+	{
+		const FScreen& Screen = Setup.Screen;
+		const FVec3 Across = Sub(Screen.Pb, Screen.Pa);
+		const FVec3 Up = Sub(Screen.Pc, Screen.Pa);
+		std::uniform_real_distribution<float> Unit(0.f, 1.f);
+
+		float WorstOutside = 0.f;
+		for (const FVec3& Eye : Eyes)
+		{
+			// Unit normal towards the scene, as MakeUnionFrustum measures distances
+			FVec3 ViewDir = Normalize(Cross(Across, Up));
+			if (Dot(ViewDir, Sub(Screen.Pa, Eye)) < 0.f)
+			{
+				ViewDir = MakeVec3(-ViewDir.X, -ViewDir.Y, -ViewDir.Z);
+			}
+			const float EyeToScreen = Dot(ViewDir, Sub(Screen.Pa, Eye));
+
+			for (int32_t Point = 0; Point < 2000; ++Point)
+			{
+				// The first eight are the corners of the near and far slices
+				const float U = Point < 8 ? (float)(Point & 1) : Unit(Random);
+				const float V = Point < 8 ? (float)((Point >> 1) & 1) : Unit(Random);
+				const float Distance = Point < 8 ? ((Point & 4) ? Far : Near) : Near + (Far - Near) * Unit(Random);
+
+				const FVec3 OnScreen = MakeVec3(Screen.Pa.X + U * Across.X + V * Up.X, Screen.Pa.Y + U * Across.Y + V * Up.Y, Screen.Pa.Z + U * Across.Z + V * Up.Z);
+				const float Scale = Distance / EyeToScreen;
+				const FVec3 Ray = Sub(OnScreen, Eye);
+				const FVec3 P = MakeVec3(Eye.X + Ray.X * Scale, Eye.Y + Ray.Y * Scale, Eye.Z + Ray.Z * Scale);
+
+				for (int32_t Plane = 0; Plane < Frustum.NumPlanes; ++Plane)
+				{
+					WorstOutside = std::max(WorstOutside, -(Dot(Frustum.Planes[Plane].Normal, P) + Frustum.Planes[Plane].D));
+				}
+			}
+		}
+
+		if (WorstOutside > ContainmentTolerance)
+		{
+			std::printf("FAILED %s %s containment: a point of an eye's frustum is %g outside the union\n", Kernel, Case, WorstOutside);
+			return 1;
+		}
+		std::printf("%s %s containment: every eye inside the union, worst %g\n", Kernel, Case, WorstOutside);
+		return 0;
+	}
+}
+
+int main()
+{
+	const char* Kernel = GetKernelName(SterioProjection::GetBestKernel());
+	std::mt19937 Random(20170616);
+
+	int32_t Failures = 0;
+	for (const FCase& Setup : MakeCases())
+	{
+		for (int32_t NumEyes : { 2, 4 })
+		{
+			char Case[64];
+			std::snprintf(Case, sizeof(Case), "%s_%d_eyes", Setup.Name, NumEyes);
+
+			const std::vector<FVec3> Eyes = MakeEyes(Setup.EyeCenter, NumEyes, Random);
+			const FFrustum Frustum = MakeUnionFrustum(Setup.Screen, Eyes.data(), NumEyes, Near, Far);
+			Failures += CheckContainment(Kernel, Case, Setup, Eyes, Frustum, Random);
+
+			std::vector<FAabb> Boxes = MakeBoxes(5000, Random);
+			FBvh Bvh;
+			Bvh.Build(Boxes.data(), (int32_t)Boxes.size());
+			Failures += CheckHierarchy(Kernel, Case, "built", Frustum, Bvh, Boxes);
+
+			// Move every box without changing the set, as Refit is meant for
+			std::uniform_real_distribution<float> Move(-100.f, 100.f);
+			for (FAabb& Box : Boxes)
+			{
+				const FVec3 Delta = MakeVec3(Move(Random), Move(Random), Move(Random));
+				Box.Min = MakeVec3(Box.Min.X + Delta.X, Box.Min.Y + Delta.Y, Box.Min.Z + Delta.Z);
+				Box.Max = MakeVec3(Box.Max.X + Delta.X, Box.Max.Y + Delta.Y, Box.Max.Z + Delta.Z);
+			}
+			Bvh.Refit(Boxes.data());
+			Failures += CheckHierarchy(Kernel, Case, "refitted", Frustum, Bvh, Boxes);
+		}
+	}
+
+	std::printf("%s\n", Failures ? "FAILED" : "passed");
+	return Failures ? 1 : 0;
+}
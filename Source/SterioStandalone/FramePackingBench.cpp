@@ -0,0 +1,106 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+// Times SterioFramePacking.h without the engine: every packing format per compiled-in kernel on a 1080p eye pair,
+// and the half-float conversion the shipped eye targets need before packing. The same pack_* cases as Sterio.Bench,
+// written as JSON; see StandaloneBench.h for the arguments.
+
+#include "SterioFramePacking.h"
+#include "StandaloneBench.h"
+
+#include <memory>
+#include <random>
+
+namespace
+{
+	using namespace SterioPacking;
+
+	const char* GetKernelName(EKernel Kernel)
+	{
+		switch (Kernel)
+		{
+		case EKernel::AVX2: return "avx2";
+		case EKernel::SSE: return "sse";
+		default: return "scalar";
+		}
+	}
+
+	const char* GetFormatName(EFormat Format)
+	{
+		switch (Format)
+		{
+		case EFormat::SideBySide: return "side_by_side";
+		case EFormat::TopBottom: return "top_bottom";
+		case EFormat::RowInterleaved: return "row_interleaved";
+		case EFormat::ColumnInterleaved: return "column_interleaved";
+		case EFormat::Checkerboard: return "checkerboard";
+		default: return "anaglyph";
+		}
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	SterioBench::FRun Run(Argc, Argv, 100000);
+
+	// One 1080p eye pair, the size of the eye targets on our walls
+	const int32_t Width = 1920;
+	const int32_t Height = 1080;
+	std::mt19937 Random(0x5731);
+	std::vector<uint32_t> Left(Width * Height), Right(Width * Height), Packed(Width * Height);
+	for (uint32_t& Pixel : Left)
+	{
+		Pixel = (uint32_t)Random();
+	}
+	for (uint32_t& Pixel : Right)
+	{
+		Pixel = (uint32_t)Random();
+	}
+
+	const FConstImage LeftImage = { Left.data(), Width, Height, Width };
+	const FConstImage RightImage = { Right.data(), Width, Height, Width };
+	const FImage PackedImage = { Packed.data(), Width, Height, Width };
+
+	// A frame is a couple of million pixels, so far fewer iterations than the per-matrix cases
+	const int FrameIterations = Run.GetIterations() / 10000 > 1 ? Run.GetIterations() / 10000 : 1;
+	const EFormat Formats[] = { EFormat::SideBySide, EFormat::TopBottom, EFormat::RowInterleaved, EFormat::ColumnInterleaved, EFormat::Checkerboard, EFormat::Anaglyph };
+	const EKernel Kernels[] = { EKernel::Scalar, EKernel::SSE, EKernel::AVX2 };
+	for (EFormat Format : Formats)
+	{
+		for (EKernel Kernel : Kernels)
+		{
+			if (!IsKernelAvailable(Kernel))
+			{
+				continue;
+			}
+
+			const std::string Name = std::string("pack_") + GetFormatName(Format) + "_" + GetKernelName(Kernel);
+			Run.Measure(Name, FrameIterations, (double)Width * Height, "pixel", [&](int Count)
+			{
+				for (int Index = 0; Index < Count; ++Index)
+				{
+					Pack(Format, LeftImage, RightImage, PackedImage, Kernel);
+					SterioBench::GSink = SterioBench::GSink + (float)(Packed[Index % Packed.size()] & 0xFF);
+				}
+			});
+		}
+	}
+
+	// Values a capture writes, in [0, 1]
+	std::vector<uint16_t> Half((size_t)Width * Height * 4);
+	for (uint16_t& Channel : Half)
+	{
+		Channel = (uint16_t)(Random() % 0x3C01);
+	}
+	const FConstHalfImage HalfImage = { Half.data(), Width, Height, Width };
+	const std::unique_ptr<FHalfToBGRA> ToSRGB(new FHalfToBGRA(true));
+	Run.Measure("convert_half_srgb", FrameIterations, (double)Width * Height, "pixel", [&](int Count)
+	{
+		for (int Index = 0; Index < Count; ++Index)
+		{
+			ToSRGB->Convert(HalfImage, PackedImage);
+			SterioBench::GSink = SterioBench::GSink + (float)(Packed[Index % Packed.size()] & 0xFF);
+		}
+	});
+
+	return Run.WriteJson(GetKernelName(GetBestKernel())) ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+// Checks every compiled-in kernel of SterioFramePacking.h against a per-pixel definition of each format, on
+// odd-sized random images, and the half-float conversion eye targets go through before packing, without the
+// engine. Exits non-zero if any packed or converted pixel is off.
+
+#include "SterioFramePacking.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using namespace SterioPacking;
+
+	const char* GetKernelName(EKernel Kernel)
+	{
+		switch (Kernel)
+		{
+		case EKernel::AVX2: return "avx2";
+		case EKernel::SSE: return "sse";
+		default: return "scalar";
+		}
+	}
+
+	const char* GetFormatName(EFormat Format)
+	{
+		switch (Format)
+		{
+		case EFormat::SideBySide: return "side_by_side";
+		case EFormat::TopBottom: return "top_bottom";
+		case EFormat::RowInterleaved: return "row_interleaved";
+		case EFormat::ColumnInterleaved: return "column_interleaved";
+		case EFormat::Checkerboard: return "checkerboard";
+		default: return "anaglyph";
+		}
+	}
+
+	/** Byte-wise rounded average, written out the long way. */
+	uint32_t AverageReference(uint32_t A, uint32_t B)
+	{
+		uint32_t Result = 0;
+		for (int32_t Shift = 0; Shift < 32; Shift += 8)
+		{
+			Result |= ((((A >> Shift) & 0xFF) + ((B >> Shift) & 0xFF) + 1) >> 1) << Shift;
+		}
+		return Result;
+	}
+
+	/** What each format promises for one output pixel; the same definition as Sterio.Bench's packing checks. */
+	uint32_t GetReferencePixel(EFormat Format, const std::vector<uint32_t>& Left, const std::vector<uint32_t>& Right, int32_t Width, int32_t Height, int32_t X, int32_t Y)
+	{
+		auto At = [Width, Height](const std::vector<uint32_t>& Image, int32_t PX, int32_t PY)
+		{
+			return Image[(PY < Height ? PY : Height - 1) * Width + (PX < Width ? PX : Width - 1)];
+		};
+
+		switch (Format)
+		{
+		case EFormat::SideBySide:
+			return (X < Width / 2) ? AverageReference(At(Left, 2 * X, Y), At(Left, 2 * X + 1, Y)) : AverageReference(At(Right, 2 * (X - Width / 2), Y), At(Right, 2 * (X - Width / 2) + 1, Y));
+		case EFormat::TopBottom:
+			return (Y < Height / 2) ? AverageReference(At(Left, X, 2 * Y), At(Left, X, 2 * Y + 1)) : AverageReference(At(Right, X, 2 * (Y - Height / 2)), At(Right, X, 2 * (Y - Height / 2) + 1));
+		case EFormat::RowInterleaved:
+			return (Y & 1) ? At(Right, X, Y) : At(Left, X, Y);
+		case EFormat::ColumnInterleaved:
+			return (X & 1) ? At(Right, X, Y) : At(Left, X, Y);
+		case EFormat::Checkerboard:
+			return ((X + Y) & 1) ? At(Right, X, Y) : At(Left, X, Y);
+		default:
+			return (At(Left, X, Y) & RedCyanMask) | (At(Right, X, Y) & ~RedCyanMask);
+		}
+	}
+
+	/** Half to float by the definition rather than by moving bits around. */
+	float ReferenceHalfToFloat(uint16_t Half)
+	{
+		const int32_t Exponent = (Half >> 10) & 0x1F;
+		const int32_t Mantissa = Half & 0x3FF;
+		const float Magnitude = (Exponent == 0) ? std::ldexp((float)Mantissa, -24)
+			: (Exponent == 31) ? (Mantissa ? NAN : INFINITY)
+			: std::ldexp((float)(1024 + Mantissa), Exponent - 25);
+		return (Half & 0x8000) ? -Magnitude : Magnitude;
+	}
+
+	/** FLinearColor::ToFColor(true) for one channel */
+	uint32_t ReferenceUnorm(float Value, bool bGamma)
+	{
+		float Clamped = std::isnan(Value) ? 1.f : std::fmin(std::fmax(Value, 0.f), 1.f);
+		if (bGamma)
+		{
+			Clamped = Clamped <= 0.0031308f ? Clamped * 12.92f : std::pow(Clamped, 1.f / 2.4f) * 1.055f - 0.055f;
+		}
+		return (uint32_t)std::floor(Clamped * 255.999f);
+	}
+
+	/** Converts an odd-sized, padded half-float image and checks every pixel; returns the number of failed checks. */
+	int32_t CheckHalfConversion(std::mt19937& Random)
+	{
+		int32_t Failures = 0;
+		for (uint32_t Bits = 0; Bits < 65536; ++Bits)
+		{
+			const float Value = HalfToFloat((uint16_t)Bits);
+			const float Reference = ReferenceHalfToFloat((uint16_t)Bits);
+			if (!(Value == Reference || (std::isnan(Value) && std::isnan(Reference))))
+			{
+				std::printf("FAILED half 0x%04x: %g, expected %g\n", Bits, Value, Reference);
+				++Failures;
+			}
+		}
+
+		// 1.0, 0.5, 0 and -1: white, sRGB mid grey, black and clamped away, with alpha 0.5 kept linear
+		const FHalfToBGRA ToSRGB(true);
+		const uint16_t Known[] = { 0x3C00, 0x3800, 0x0000, 0x3800 };
+		const uint32_t KnownExpected = (127u << 24) | (255u << 16) | (188u << 8) | 0u;
+		if (ToSRGB.ConvertPixel(Known) != KnownExpected)
+		{
+			std::printf("FAILED half pixel: 0x%08x, expected 0x%08x\n", ToSRGB.ConvertPixel(Known), KnownExpected);
+			++Failures;
+		}
+
+		// Mostly [0, 1], which a capture writes, and every special value now and then
+		const int32_t Width = 333, Height = 197, Stride = Width + 3;
+		std::vector<uint16_t> Half((size_t)Stride * Height * 4);
+		for (uint16_t& Channel : Half)
+		{
+			Channel = (Random() % 8) ? (uint16_t)(Random() % 0x3C01) : (uint16_t)Random();
+		}
+
+		std::vector<uint32_t> Converted((size_t)Width * Height);
+		const FConstHalfImage Source = { Half.data(), Width, Height, Stride };
+		const FImage Out = { Converted.data(), Width, Height, Width };
+		for (bool bSRGB : { false, true })
+		{
+			const FHalfToBGRA Converter(bSRGB);
+			if (!Converter.Convert(Source, Out))
+			{
+				std::printf("FAILED: half conversion rejected same-sized images\n");
+				++Failures;
+				continue;
+			}
+
+			int32_t Mismatches = 0;
+			for (int32_t Y = 0; Y < Height; ++Y)
+			{
+				for (int32_t X = 0; X < Width; ++X)
+				{
+					const uint16_t* Pixel = &Half[((size_t)Y * Stride + X) * 4];
+					const uint32_t Expected = (ReferenceUnorm(ReferenceHalfToFloat(Pixel[3]), false) << 24) | (ReferenceUnorm(ReferenceHalfToFloat(Pixel[0]), bSRGB) << 16)
+						| (ReferenceUnorm(ReferenceHalfToFloat(Pixel[1]), bSRGB) << 8) | ReferenceUnorm(ReferenceHalfToFloat(Pixel[2]), bSRGB);
+					Mismatches += (Converted[(size_t)Y * Width + X] != Expected) ? 1 : 0;
+				}
+			}
+
+			if (Mismatches > 0)
+			{
+				std::printf("FAILED half to %s: %d of %d pixels differ from the reference\n", bSRGB ? "sRGB" : "linear", Mismatches, Width * Height);
+				++Failures;
+			}
+			else
+			{
+				std::printf("half to %s: %dx%d exact\n", bSRGB ? "sRGB" : "linear", Width, Height);
+			}
+		}
+		return Failures;
+	}
+}
+
+int main()
+{
+	// Odd sizes, so the scalar tails and the odd pixel of the squeezed formats are covered too
+	const int32_t Width = 333;
+	const int32_t Height = 197;
+
+	std::mt19937 Random(0x5731);
+	std::vector<uint32_t> Left(Width * Height), Right(Width * Height), Packed(Width * Height);
+	for (uint32_t& Pixel : Left)
+	{
+		Pixel = (uint32_t)Random();
+	}
+	for (uint32_t& Pixel : Right)
+	{
+		Pixel = (uint32_t)Random();
+	}
+
+	const FConstImage LeftImage = { Left.data(), Width, Height, Width };
+	const FConstImage RightImage = { Right.data(), Width, Height, Width };
+	const FImage PackedImage = { Packed.data(), Width, Height, Width };
+
+	const EFormat Formats[] = { EFormat::SideBySide, EFormat::TopBottom, EFormat::RowInterleaved, EFormat::ColumnInterleaved, EFormat::Checkerboard, EFormat::Anaglyph };
+	const EKernel Kernels[] = { EKernel::Scalar, EKernel::SSE, EKernel::AVX2 };
+
+	int32_t Failures = 0;
+	int32_t Checked = 0;
+	for (EKernel Kernel : Kernels)
+	{
+		if (!IsKernelAvailable(Kernel))
+		{
+			std::printf("skipped %s: not compiled in\n", GetKernelName(Kernel));
+			continue;
+		}
+
+		for (EFormat Format : Formats)
+		{
+			if (!Pack(Format, LeftImage, RightImage, PackedImage, Kernel))
+			{
+				std::printf("FAILED %s [%s]: rejected same-sized images\n", GetFormatName(Format), GetKernelName(Kernel));
+				++Failures;
+				continue;
+			}
+
+			int32_t Mismatches = 0;
+			for (int32_t Y = 0; Y < Height; ++Y)
+			{
+				for (int32_t X = 0; X < Width; ++X)
+				{
+					Mismatches += (Packed[Y * Width + X] != GetReferencePixel(Format, Left, Right, Width, Height, X, Y)) ? 1 : 0;
+				}
+			}
+
+			if (Mismatches > 0)
+			{
+				std::printf("FAILED %s [%s]: %d of %d pixels differ from the reference\n", GetFormatName(Format), GetKernelName(Kernel), Mismatches, Width * Height);
+				++Failures;
+			}
+			else
+			{
+				std::printf("%s %s: %dx%d exact\n", GetKernelName(Kernel), GetFormatName(Format), Width, Height);
+			}
+			++Checked;
+		}
+	}
+
+	Failures += CheckHalfConversion(Random);
+
+	// Mismatched sizes have to be refused rather than read out of bounds
+	const FImage Smaller = { Packed.data(), Width - 1, Height, Width };
+	if (Pack(EFormat::SideBySide, LeftImage, RightImage, Smaller))
+	{
+		std::printf("FAILED: packed images of different sizes\n");
+		++Failures;
+	}
+
+	if (Checked == 0)
+	{
+		std::printf("FAILED: no kernel was checked\n");
+		return 1;
+	}
+	if (Failures > 0)
+	{
+		std::printf("FAILED: %d checks\n", Failures);
+		return 1;
+	}
+	std::printf("passed\n");
+	return 0;
+}
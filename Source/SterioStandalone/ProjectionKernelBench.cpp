@@ -0,0 +1,136 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+// Times SterioProjectionKernel.h without the engine: one eye pair at a time as the rig used to, and batched
+// per compiled-in kernel for every screen shape, the multi-viewer case the batched kernel is meant for.
+// The same cases as Sterio.Bench's kernel_* results, written as JSON; see StandaloneBench.h for the arguments.
+
+#include "SterioProjectionKernel.h"
+#include "StandaloneBench.h"
+
+namespace
+{
+	using namespace SterioProjection;
+
+	const char* GetKernelName(EKernel Kernel)
+	{
+		switch (Kernel)
+		{
+		case EKernel::AVX2: return "avx2";
+		case EKernel::SSE: return "sse";
+		default: return "scalar";
+		}
+	}
+
+	const char* GetShapeName(EScreenShape Shape)
+	{
+		switch (Shape)
+		{
+		case EScreenShape::AxisAligned: return "axis_aligned";
+		case EScreenShape::SingleAxis: return "single_axis";
+		default: return "general";
+		}
+	}
+
+	/** The eye positions Sterio.Bench uses */
+	FVec3 MakeBenchmarkEye(int Index)
+	{
+		return MakeVec3(-40.f + (Index % 17) * 5.f, -30.f + (Index % 13) * 5.f, 60.f + (Index % 23) * 10.f);
+	}
+
+	void AccumulateSink(const FMatrix44& M)
+	{
+		SterioBench::GSink = SterioBench::GSink + M.M[0][0] + M.M[2][0];
+	}
+
+	/** A wall of the given shape, its corners in the same place relative to the eyes whatever the shape */
+	FScreenBasis MakeShapedScreen(EScreenShape Shape, float Width, float Height, float ZOffset)
+	{
+		FScreen Screen = MakeCenteredScreen(Width, Height, ZOffset);
+		if (Shape == EScreenShape::SingleAxis)
+		{
+			// Turned 30 degrees about the vertical axis, like the side walls of a CAVE
+			const float C = 0.8660254f, S = 0.5f;
+			for (FVec3* Corner : { &Screen.Pa, &Screen.Pb, &Screen.Pc })
+			{
+				*Corner = MakeVec3(C * Corner->X + S * Corner->Z, Corner->Y, -S * Corner->X + C * Corner->Z);
+			}
+		}
+
+		FScreenBasis Basis = MakeScreenBasis(Screen);
+		if (Shape == EScreenShape::General)
+		{
+			Basis.Shape = EScreenShape::General;
+		}
+		return Basis;
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	SterioBench::FRun Run(Argc, Argv, 100000);
+	const int Iterations = Run.GetIterations();
+
+	const float Width = 160.f, Height = 100.f;
+	FFrustumParams Params = MakeFrustumParams(1.f);
+	Params.Tuning.M00 = 1.05f;
+	Params.Tuning.M11 = 0.95f;
+
+	// What the rig did per Tick: one direct and one tan-flipped eye
+	const FScreenBasis Screen = MakeScreenBasis(MakeCenteredScreen(Width, Height));
+	Run.Measure("kernel_single_eye_pair", Iterations, 2.0, "frustum", [&](int Count)
+	{
+		for (int Index = 0; Index < Count; ++Index)
+		{
+			const FVec3 Eye = MakeBenchmarkEye(Index);
+			AccumulateSink(ComputeProjection(Screen, Eye, EFlavor::Direct, Params));
+			AccumulateSink(ComputeProjection(Screen, Eye, EFlavor::TanFlipped, Params));
+		}
+	});
+
+	// Many viewers across a few walls
+	const int NumScreens = 4;
+	const int NumEyes = 128;
+	std::vector<float> EyeX, EyeY, EyeZ;
+	for (int Index = 0; Index < NumEyes; ++Index)
+	{
+		const FVec3 Eye = MakeBenchmarkEye(Index);
+		EyeX.push_back(Eye.X);
+		EyeY.push_back(Eye.Y);
+		EyeZ.push_back(Eye.Z);
+	}
+	const FEyesSoA Eyes = { EyeX.data(), EyeY.data(), EyeZ.data(), nullptr, NumEyes };
+	std::vector<FMatrix44> Out(NumScreens * NumEyes);
+
+	// Keep the batched cases comparable to the per-pair one by scaling the iteration count down
+	const int BatchIterations = Iterations / NumEyes > 1 ? Iterations / NumEyes : 1;
+	const EKernel Kernels[] = { EKernel::Scalar, EKernel::SSE, EKernel::AVX2 };
+	const EScreenShape Shapes[] = { EScreenShape::AxisAligned, EScreenShape::SingleAxis, EScreenShape::General };
+	for (EScreenShape Shape : Shapes)
+	{
+		std::vector<FScreenBasis> Screens;
+		for (int Index = 0; Index < NumScreens; ++Index)
+		{
+			Screens.push_back(MakeShapedScreen(Shape, Width, Height, Index * 10.f));
+		}
+
+		for (EKernel Kernel : Kernels)
+		{
+			if (!IsKernelAvailable(Kernel))
+			{
+				continue;
+			}
+
+			const std::string Name = std::string("kernel_batched_") + std::to_string(NumScreens) + "x" + std::to_string(NumEyes) + "_" + GetShapeName(Shape) + "_" + GetKernelName(Kernel);
+			Run.Measure(Name, BatchIterations, NumScreens * NumEyes, "frustum", [&](int Count)
+			{
+				for (int Index = 0; Index < Count; ++Index)
+				{
+					ComputeProjections(Screens.data(), NumScreens, Eyes, Params, Out.data(), Kernel);
+					AccumulateSink(Out[Index % Out.size()]);
+				}
+			});
+		}
+	}
+
+	return Run.WriteJson(GetKernelName(GetBestKernel())) ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+// Checks every compiled-in kernel of SterioProjectionKernel.h against the rig's original projection builders,
+// in every depth mode, without the engine. A screen turned about the up axis has no legacy counterpart; its
+// specialised path is checked against the single-eye reference on the general path instead. Exits non-zero if any
+// check fails.
+
+#include "SterioProjectionKernel.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	using namespace SterioProjection;
+
+	/** FSterioLegacyProjection's builders with FVector/FMatrix swapped for FVec3/FMatrix44; the engine's Normalize is exact here. */
+	struct FLegacyRig
+	{
+		float Width = 160.f;
+		float Height = 100.f;
+		float NearClipPlane = 1.f;
+		float M_0_0 = 1.05f;
+		float M_0_3 = 0.001f;
+		float M_1_1 = 0.95f;
+		float M_1_3 = -0.002f;
+
+		FMatrix44 Build(const FVec3& Pe, bool bTanFlipped) const
+		{
+			const FVec3 Pa = MakeVec3(-Width / 2.0f, -Height / 2.0f, 0.f);
+			const FVec3 Pb = MakeVec3(Width / 2.0f, -Height / 2.0f, 0.f);
+			const FVec3 Pc = MakeVec3(-Width / 2.0f, Height / 2.0f, 0.f);
+
+			const FVec3 Vr = Normalize(Sub(Pb, Pa));
+			const FVec3 Vu = Normalize(Sub(Pc, Pa));
+			const FVec3 Vn = Normalize(Cross(Vr, Vu));
+
+			const FVec3 Va = Sub(Pa, Pe);
+			const FVec3 Vb = Sub(Pb, Pe);
+			const FVec3 Vc = Sub(Pc, Pe);
+			const float EyeDistance = -Dot(Va, Vn);
+
+			float Left = (Dot(Vr, Va) * NearClipPlane) / EyeDistance;
+			float Right = (Dot(Vr, Vb) * NearClipPlane) / EyeDistance;
+			float Bottom = (Dot(Vu, Va) * NearClipPlane) / EyeDistance;
+			float Top = (Dot(Vu, Vc) * NearClipPlane) / EyeDistance;
+			if (bTanFlipped)
+			{
+				const float L = Left, R = Right, B = Bottom, T = Top;
+				Right = -std::tan(L);
+				Left = -std::tan(R);
+				Bottom = -std::tan(T);
+				Top = -std::tan(B);
+			}
+
+			const float InvRL = 1.0f / (Right - Left);
+			const float InvTB = 1.0f / (Top - Bottom);
+
+			FMatrix44 M = {};
+			M.M[0][0] = 2.f * NearClipPlane * InvRL * M_0_0;
+			M.M[0][3] = M_0_3;
+			M.M[1][1] = 2.f * NearClipPlane * InvTB * M_1_1;
+			M.M[1][3] = M_1_3;
+			M.M[2][0] = (Right + Left) * InvRL;
+			M.M[2][1] = (Top + Bottom) * InvTB;
+			M.M[2][3] = 1.0f;
+			M.M[3][2] = NearClipPlane;
+			return M;
+		}
+	};
+
+	const char* GetKernelName(EKernel Kernel)
+	{
+		switch (Kernel)
+		{
+		case EKernel::AVX2: return "avx2";
+		case EKernel::SSE: return "sse";
+		default: return "scalar";
+		}
+	}
+
+	const char* GetDepthModeName(EDepthMode DepthMode)
+	{
+		switch (DepthMode)
+		{
+		case EDepthMode::Finite: return "finite";
+		case EDepthMode::ReversedFinite: return "reversed_finite";
+		default: return "infinite";
+		}
+	}
+
+	float RelDiff(float Reference, float Actual)
+	{
+		const float Scale = std::fabs(Reference) > 1.f ? std::fabs(Reference) : 1.f;
+		return std::fabs(Reference - Actual) / Scale;
+	}
+
+	/** NDC depth of a point View cm in front of the eye, with the row-vector convention of FMatrix */
+	float GetNdcDepth(const FMatrix44& M, float View)
+	{
+		return (View * M.M[2][2] + M.M[3][2]) / (View * M.M[2][3]);
+	}
+
+	int GFailures = 0;
+
+	void Expect(bool bCondition, const char* Check, const char* Kernel, const char* DepthMode, float Value)
+	{
+		if (!bCondition)
+		{
+			std::printf("FAILED %s [%s, %s]: %g\n", Check, Kernel, DepthMode, Value);
+			++GFailures;
+		}
+	}
+}
+
+int main()
+{
+	const FLegacyRig Rig;
+	// The legacy screen takes the axis-aligned path; the same screen forced onto the general one covers the rest
+	FScreenBasis Screens[4];
+	Screens[0] = MakeScreenBasis(MakeCenteredScreen(Rig.Width, Rig.Height));
+	Screens[1] = Screens[0];
+	Screens[1].Shape = EScreenShape::General;
+	const int NumLegacyScreens = 2;
+
+	// The legacy screen turned 30 degrees about the up axis, like the side walls of a CAVE, on both paths as well
+	FScreen Wall = MakeCenteredScreen(Rig.Width, Rig.Height);
+	const float C = 0.8660254f, S = 0.5f;
+	for (FVec3* Corner : { &Wall.Pa, &Wall.Pb, &Wall.Pc })
+	{
+		*Corner = MakeVec3(C * Corner->X + S * Corner->Z, Corner->Y, -S * Corner->X + C * Corner->Z);
+	}
+	Screens[2] = MakeScreenBasis(Wall);
+	Screens[3] = Screens[2];
+	Screens[3].Shape = EScreenShape::General;
+	const int NumScreens = 4;
+	if (Screens[2].Shape != EScreenShape::SingleAxis)
+	{
+		std::printf("FAILED: the turned screen is not classified as single_axis\n");
+		return 1;
+	}
+	const float Far = 10000.f;
+
+	// An odd count, so the vector kernels also leave a scalar tail
+	const int NumEyes = 37;
+	std::vector<float> EyeX, EyeY, EyeZ;
+	std::vector<EFlavor> Flavors;
+	for (int Index = 0; Index < NumEyes; ++Index)
+	{
+		EyeX.push_back(-40.f + (Index % 17) * 5.f);
+		EyeY.push_back(-30.f + (Index % 13) * 5.f);
+		EyeZ.push_back(60.f + (Index % 23) * 10.f);
+		Flavors.push_back((Index & 1) ? EFlavor::TanFlipped : EFlavor::Direct);
+	}
+	const FEyesSoA Eyes = { EyeX.data(), EyeY.data(), EyeZ.data(), Flavors.data(), NumEyes };
+
+	const EKernel Kernels[] = { EKernel::Scalar, EKernel::SSE, EKernel::AVX2 };
+	const EDepthMode DepthModes[] = { EDepthMode::Infinite, EDepthMode::Finite, EDepthMode::ReversedFinite };
+	int NumChecked = 0;
+	for (EKernel Kernel : Kernels)
+	{
+		if (!IsKernelAvailable(Kernel))
+		{
+			std::printf("skipped %s: not compiled in\n", GetKernelName(Kernel));
+			continue;
+		}
+
+		for (EDepthMode DepthMode : DepthModes)
+		{
+			FFrustumParams Params = MakeFrustumParams(Rig.NearClipPlane, DepthMode, Far);
+			Params.Tuning.M00 = Rig.M_0_0;
+			Params.Tuning.M11 = Rig.M_1_1;
+			Params.Tuning.M03 = Rig.M_0_3;
+			Params.Tuning.M13 = Rig.M_1_3;
+
+			std::vector<FMatrix44> Out(NumScreens * NumEyes);
+			ComputeProjections(Screens, NumScreens, Eyes, Params, Out.data(), Kernel);
+
+			float MaxRelDiff = 0.f;
+			float MaxShapeDiff = 0.f;
+			for (int Slot = 0; Slot < NumScreens * NumEyes; ++Slot)
+			{
+				const int Index = Slot % NumEyes;
+				const FVec3 Eye = MakeVec3(EyeX[Index], EyeY[Index], EyeZ[Index]);
+				if (Slot < NumLegacyScreens * NumEyes)
+				{
+					const FMatrix44 Reference = Rig.Build(Eye, Flavors[Index] == EFlavor::TanFlipped);
+					for (int Row = 0; Row < 4; ++Row)
+					{
+						for (int Col = 0; Col < 4; ++Col)
+						{
+							// Depth terms are checked by where they put the clip planes; the legacy builders only know Infinite
+							const bool bDepthTerm = (Row == 2 || Row == 3) && Col == 2;
+							if (!bDepthTerm || DepthMode == EDepthMode::Infinite)
+							{
+								MaxRelDiff = std::fmax(MaxRelDiff, RelDiff(Reference.M[Row][Col], Out[Slot].M[Row][Col]));
+							}
+						}
+					}
+				}
+				else
+				{
+					const FMatrix44 Reference = ComputeProjection(Screens[3], Eye, Flavors[Index], Params);
+					for (int Row = 0; Row < 4; ++Row)
+					{
+						for (int Col = 0; Col < 4; ++Col)
+						{
+							MaxShapeDiff = std::fmax(MaxShapeDiff, RelDiff(Reference.M[Row][Col], Out[Slot].M[Row][Col]));
+						}
+					}
+				}
+
+				const float NearDepth = GetNdcDepth(Out[Slot], Rig.NearClipPlane);
+				const float FarDepth = GetNdcDepth(Out[Slot], Far);
+				const float ExpectedNear = (DepthMode == EDepthMode::Finite) ? 0.f : 1.f;
+				const float ExpectedFar = (DepthMode == EDepthMode::Finite) ? 1.f : (DepthMode == EDepthMode::ReversedFinite) ? 0.f : Rig.NearClipPlane / Far;
+				Expect(std::fabs(NearDepth - ExpectedNear) <= 1.e-5f, "near plane depth", GetKernelName(Kernel), GetDepthModeName(DepthMode), NearDepth);
+				Expect(std::fabs(FarDepth - ExpectedFar) <= 1.e-5f, "far plane depth", GetKernelName(Kernel), GetDepthModeName(DepthMode), FarDepth);
+			}
+
+			Expect(MaxRelDiff <= 1.e-4f, "max relative difference to the legacy builders", GetKernelName(Kernel), GetDepthModeName(DepthMode), MaxRelDiff);
+			Expect(MaxShapeDiff <= ShapeAgreementTolerance, "max relative difference of the turned screen to the general path", GetKernelName(Kernel), GetDepthModeName(DepthMode), MaxShapeDiff);
+			std::printf("%s %s: %d screens x %d eyes, max rel diff %g, turned screen %g\n", GetKernelName(Kernel), GetDepthModeName(DepthMode), NumScreens, NumEyes, MaxRelDiff, MaxShapeDiff);
+			++NumChecked;
+		}
+	}
+
+	if (NumChecked == 0)
+	{
+		std::printf("FAILED: no kernel was checked\n");
+		return 1;
+	}
+	if (GFailures > 0)
+	{
+		std::printf("FAILED: %d checks\n", GFailures);
+		return 1;
+	}
+	std::printf("passed\n");
+	return 0;
+}
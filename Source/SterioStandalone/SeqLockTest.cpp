@@ -0,0 +1,77 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+// Hammers a SterioSeqLock::TPublication with one writer and two readers and checks that no reader ever copies a
+// value mixed from two writes or goes back in time. Exits non-zero if one does.
+
+#include "SterioSeqLock.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+	/** Large enough that a copy spans several cache lines, so a torn one would show */
+	struct FPayload
+	{
+		uint64_t Words[64];
+	};
+
+	const uint64_t NumWrites = 2000000;
+}
+
+int main()
+{
+	SterioSeqLock::TPublication<FPayload> Publication;
+	std::atomic<bool> bDone(false);
+	std::atomic<uint64_t> Failures(0);
+	std::atomic<uint64_t> Reads(0);
+
+	auto Reader = [&]()
+	{
+		uint64_t LastSequence = 0;
+		while (!bDone.load(std::memory_order_acquire))
+		{
+			FPayload Payload;
+			uint64_t Sequence = 0;
+			if (!Publication.Read(Payload, Sequence))
+			{
+				continue;
+			}
+
+			// Write N fills every word with N
+			bool bIntact = Sequence >= LastSequence;
+			for (uint64_t Word : Payload.Words)
+			{
+				bIntact = bIntact && Word == Sequence;
+			}
+			Failures.fetch_add(bIntact ? 0 : 1, std::memory_order_relaxed);
+			Reads.fetch_add(1, std::memory_order_relaxed);
+			LastSequence = Sequence;
+		}
+	};
+
+	std::thread Readers[] = { std::thread(Reader), std::thread(Reader) };
+	for (uint64_t Write = 1; Write <= NumWrites; ++Write)
+	{
+		FPayload& Payload = Publication.BeginWrite();
+		for (uint64_t& Word : Payload.Words)
+		{
+			Word = Write;
+		}
+		if (Publication.EndWrite() != Write)
+		{
+			Failures.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	bDone.store(true, std::memory_order_release);
+	for (std::thread& Thread : Readers)
+	{
+		Thread.join();
+	}
+
+	const bool bPassed = Failures.load() == 0 && Publication.GetPublishedCount() == NumWrites;
+	std::printf("%s: %llu writes, %llu reads, %llu retries, %llu bad reads\n", bPassed ? "passed" : "FAILED",
+		(unsigned long long)NumWrites, (unsigned long long)Reads.load(), (unsigned long long)Publication.GetRetryCount(), (unsigned long long)Failures.load());
+	return bPassed ? 0 : 1;
+}
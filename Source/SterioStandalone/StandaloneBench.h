@@ -0,0 +1,114 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+// Timing and JSON output shared by the standalone benchmarks. The JSON has the layout Sterio.Bench writes, so
+// results from a game build and from these programs can be compared with the same tooling.
+//
+//   <Program> [Iterations] [OutputPath]
+//
+// Results go to OutputPath, or to stdout without one; progress goes to stderr.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace SterioBench
+{
+	/** Keeps the optimizer from discarding benchmark bodies; each program is one translation unit. */
+	static volatile float GSink = 0.f;
+
+	struct FResult
+	{
+		std::string Name;
+		int Iterations;
+		/** Operations performed per iteration (frusta, pixels...), see Unit. */
+		double OpsPerIteration;
+		std::string Unit;
+		double TotalSeconds;
+
+		double GetNanosecondsPerOp() const
+		{
+			const double Ops = Iterations * OpsPerIteration;
+			return Ops > 0.0 ? TotalSeconds * 1.e9 / Ops : 0.0;
+		}
+	};
+
+	class FRun
+	{
+	public:
+		FRun(int Argc, char** Argv, int DefaultIterations)
+			: Program(Argv[0])
+			, Iterations(Argc > 1 ? std::atoi(Argv[1]) : DefaultIterations)
+			, OutputPath(Argc > 2 ? Argv[2] : "")
+		{
+			const size_t Slash = Program.find_last_of("/\\");
+			Program = (Slash == std::string::npos) ? Program : Program.substr(Slash + 1);
+			Iterations = Iterations > 0 ? Iterations : 1;
+		}
+
+		int GetIterations() const { return Iterations; }
+
+		/** Times Body(Count) after a short warm-up; Body is expected to loop Count times itself. */
+		template <typename BodyType>
+		void Measure(const std::string& Name, int Count, double OpsPerIteration, const char* Unit, BodyType Body)
+		{
+			Body(Count / 10 > 1 ? Count / 10 : 1);
+
+			const std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+			Body(Count);
+			const std::chrono::steady_clock::time_point End = std::chrono::steady_clock::now();
+
+			const FResult Result = { Name, Count, OpsPerIteration, Unit, std::chrono::duration<double>(End - Start).count() };
+			Results.push_back(Result);
+			std::fprintf(stderr, "%-32s %10.2f ns/%s\n", Name.c_str(), Result.GetNanosecondsPerOp(), Unit);
+		}
+
+		/** Writes every result; returns false if the output could not be written. */
+		bool WriteJson(const char* BestKernel) const
+		{
+			FILE* File = OutputPath.empty() ? stdout : std::fopen(OutputPath.c_str(), "w");
+			if (!File)
+			{
+				std::fprintf(stderr, "Could not write benchmark results to %s\n", OutputPath.c_str());
+				return false;
+			}
+
+			char Timestamp[32];
+			const std::time_t Now = std::time(nullptr);
+			std::strftime(Timestamp, sizeof(Timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&Now));
+
+			std::fprintf(File, "{\n\t\"label\": \"%s\",\n\t\"timestamp\": \"%s\",\n\t\"engine\": \"standalone\",\n", Program.c_str(), Timestamp);
+			std::fprintf(File, "\t\"configuration\": \"%s\",\n\t\"best_kernel\": \"%s\",\n\t\"results\": [", Program.c_str(), BestKernel);
+			for (size_t Index = 0; Index < Results.size(); ++Index)
+			{
+				const FResult& Result = Results[Index];
+				std::fprintf(File, "%s\n\t\t{\n\t\t\t\"name\": \"%s\",\n\t\t\t\"iterations\": %d,\n\t\t\t\"ops_per_iteration\": %.17g,\n\t\t\t\"unit\": \"%s\",\n",
+					Index ? "," : "", Result.Name.c_str(), Result.Iterations, Result.OpsPerIteration, Result.Unit.c_str());
+				std::fprintf(File, "\t\t\t\"total_ms\": %.17g,\n\t\t\t\"ns_per_op\": %.17g", Result.TotalSeconds * 1000.0, Result.GetNanosecondsPerOp());
+				if (Result.Unit == "pixel" && Result.GetNanosecondsPerOp() > 0.0)
+				{
+					std::fprintf(File, ",\n\t\t\t\"mpx_per_s\": %.17g", 1000.0 / Result.GetNanosecondsPerOp());
+				}
+				std::fprintf(File, "\n\t\t}");
+			}
+			std::fprintf(File, "\n\t],\n\t\"equivalence\": []\n}\n");
+
+			const bool bWritten = !std::ferror(File);
+			if (File != stdout)
+			{
+				std::fclose(File);
+			}
+			return bWritten;
+		}
+
+	private:
+		std::string Program;
+		int Iterations;
+		std::string OutputPath;
+		std::vector<FResult> Results;
+	};
+}
@@ -0,0 +1,185 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+// Reference consumer of a SterioFrameTransport.h ring, built against the header exactly as a compositor would be.
+// Attaches to a ring by name, reads the newest frame in place as fast as frames arrive, and reports how many frames
+// it received, dropped and saw torn, and how long each frame took from EndWrite to being read.
+//
+//   SterioTransportConsumer /sterio_frames [--seconds S] [--last-frame N] [--check-pattern] [--max-drop-fraction F]
+//
+// --check-pattern expects every pixel of a frame to hold its frame number, as TransportRateTest writes them, and
+// fails on any frame whose rows read back otherwise without having been overwritten. The exit code is non-zero if no
+// frame was received, a frame was corrupt or more than F of the frames published since attaching were dropped.
+
+#include "SterioFrameTransport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct FOptions
+	{
+		const char* Name = nullptr;
+		double Seconds = 10.0;
+		/** Stop once this frame was read; negative to run for Seconds */
+		int64_t LastFrame = -1;
+		bool bCheckPattern = false;
+		double MaxDropFraction = 1.0;
+	};
+
+	bool ParseOptions(int Argc, char** Argv, FOptions& Out)
+	{
+		for (int Index = 1; Index < Argc; ++Index)
+		{
+			const char* Arg = Argv[Index];
+			const bool bHasValue = Index + 1 < Argc;
+			if (std::strcmp(Arg, "--seconds") == 0 && bHasValue)
+			{
+				Out.Seconds = std::atof(Argv[++Index]);
+			}
+			else if (std::strcmp(Arg, "--last-frame") == 0 && bHasValue)
+			{
+				Out.LastFrame = std::atoll(Argv[++Index]);
+			}
+			else if (std::strcmp(Arg, "--max-drop-fraction") == 0 && bHasValue)
+			{
+				Out.MaxDropFraction = std::atof(Argv[++Index]);
+			}
+			else if (std::strcmp(Arg, "--check-pattern") == 0)
+			{
+				Out.bCheckPattern = true;
+			}
+			else if (Arg[0] != '-' && !Out.Name)
+			{
+				Out.Name = Arg;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return Out.Name != nullptr;
+	}
+
+	/** Samples the first and last pixel of every row; a producer overtaking the read shows up as rows of another frame. */
+	bool HoldsFrameNumber(const SterioTransport::FFrameView& Frame)
+	{
+		const uint32_t Expected = (uint32_t)Frame.FrameNumber;
+		for (uint32_t Y = 0; Y < Frame.Height; ++Y)
+		{
+			const uint32_t* Row = Frame.Pixels + (size_t)Y * Frame.Width;
+			if (Row[0] != Expected || Row[Frame.Width - 1] != Expected)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	double GetPercentile(const std::vector<double>& Sorted, double Fraction)
+	{
+		return Sorted.empty() ? 0.0 : Sorted[std::min(Sorted.size() - 1, (size_t)(Sorted.size() * Fraction))];
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	FOptions Options;
+	if (!ParseOptions(Argc, Argv, Options))
+	{
+		std::fprintf(stderr, "Usage: %s Name [--seconds S] [--last-frame N] [--check-pattern] [--max-drop-fraction F]\n", Argv[0]);
+		return 2;
+	}
+
+	using FClock = std::chrono::steady_clock;
+	const FClock::time_point Deadline = FClock::now() + std::chrono::duration_cast<FClock::duration>(std::chrono::duration<double>(Options.Seconds));
+
+	// The producer may not have created the ring yet
+	SterioTransport::FConsumer Consumer;
+	while (!Consumer.Open(Options.Name))
+	{
+		if (FClock::now() >= Deadline)
+		{
+			std::printf("FAILED: could not attach to %s\n", Options.Name);
+			return 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	uint64_t Received = 0;
+	uint64_t Corrupted = 0;
+	uint64_t FirstFrame = 0;
+	uint64_t NewestFrame = 0;
+	std::vector<double> LatencyMicroseconds;
+	LatencyMicroseconds.reserve(1 << 16);
+
+	while (FClock::now() < Deadline)
+	{
+		SterioTransport::FFrameView Frame;
+		if (!Consumer.AcquireLatest(Frame))
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			continue;
+		}
+
+		// A compositor would warp the frame here, reading shared memory in place
+		const int64_t ReadTimeNs = SterioTransport::NowNanoseconds();
+		const bool bIntact = !Options.bCheckPattern || HoldsFrameNumber(Frame);
+		if (!Consumer.IsStillValid(Frame))
+		{
+			continue;
+		}
+
+		FirstFrame = (Received == 0) ? Frame.FrameNumber : FirstFrame;
+		NewestFrame = Frame.FrameNumber;
+		++Received;
+		Corrupted += bIntact ? 0 : 1;
+		LatencyMicroseconds.push_back((ReadTimeNs - Frame.PublishTimeNs) / 1000.0);
+
+		if (Options.LastFrame >= 0 && Frame.FrameNumber >= (uint64_t)Options.LastFrame)
+		{
+			break;
+		}
+	}
+
+	std::sort(LatencyMicroseconds.begin(), LatencyMicroseconds.end());
+
+	// Frames published while this consumer was attached, whether it got them or not
+	const uint64_t Dropped = Consumer.GetDroppedCount();
+	const uint64_t Torn = Consumer.GetTornCount();
+	const double Seen = (double)(Received + Dropped + Torn);
+	const double DropFraction = Seen > 0.0 ? (Dropped + Torn) / Seen : 0.0;
+
+	std::printf("%s: frames %llu..%llu, %llu received, %llu dropped, %llu torn (%.2f%% lost), %llu corrupted; latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+		Options.Name, (unsigned long long)FirstFrame, (unsigned long long)NewestFrame, (unsigned long long)Received, (unsigned long long)Dropped,
+		(unsigned long long)Torn, DropFraction * 100.0, (unsigned long long)Corrupted,
+		GetPercentile(LatencyMicroseconds, 0.5), GetPercentile(LatencyMicroseconds, 0.99), GetPercentile(LatencyMicroseconds, 1.0));
+
+	if (Received == 0)
+	{
+		std::printf("FAILED: no frame received\n");
+		return 1;
+	}
+	if (Options.LastFrame >= 0 && NewestFrame < (uint64_t)Options.LastFrame)
+	{
+		std::printf("FAILED: frame %lld never arrived\n", (long long)Options.LastFrame);
+		return 1;
+	}
+	if (Corrupted > 0)
+	{
+		std::printf("FAILED: %llu frames read back wrong\n", (unsigned long long)Corrupted);
+		return 1;
+	}
+	if (DropFraction > Options.MaxDropFraction)
+	{
+		std::printf("FAILED: lost %.2f%% of the frames, more than %.2f%%\n", DropFraction * 100.0, Options.MaxDropFraction * 100.0);
+		return 1;
+	}
+	std::printf("passed\n");
+	return 0;
+}
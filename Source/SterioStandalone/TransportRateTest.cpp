@@ -0,0 +1,87 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+// Publishes synthetic frames through a SterioFrameTransport.h ring at a fixed rate while SterioTransportConsumer
+// reads them from a separate process, and passes if the consumer does: every frame it read intact and no more
+// than 1% of them lost.
+//
+//   TransportRateTest ConsumerPath [Seconds] [Hz] [Width] [Height]
+
+#include "SterioFrameTransport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+int main(int Argc, char** Argv)
+{
+	if (Argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s ConsumerPath [Seconds] [Hz] [Width] [Height]\n", Argv[0]);
+		return 2;
+	}
+
+	const char* ConsumerPath = Argv[1];
+	const double Seconds = Argc > 2 ? std::atof(Argv[2]) : 5.0;
+	const double Hz = Argc > 3 ? std::atof(Argv[3]) : 120.0;
+	const uint32_t Width = Argc > 4 ? (uint32_t)std::atoi(Argv[4]) : 1920;
+	const uint32_t Height = Argc > 5 ? (uint32_t)std::atoi(Argv[5]) : 1080;
+	const int64_t NumFrames = Seconds * Hz > 1.0 ? (int64_t)(Seconds * Hz) : 1;
+
+	// One ring per run, so tests running side by side don't share one
+	const std::string Name = "/sterio_transport_test_" + std::to_string(getpid());
+	SterioTransport::FProducer Producer;
+	if (!Producer.Create(Name.c_str(), 3, Width, Height))
+	{
+		std::printf("FAILED: could not create %s\n", Name.c_str());
+		return 1;
+	}
+
+	const std::string LastFrame = std::to_string(NumFrames - 1);
+	const std::string Timeout = std::to_string(Seconds + 5.0);
+	const char* ConsumerArgs[] = { ConsumerPath, Name.c_str(), "--check-pattern", "--last-frame", LastFrame.c_str(), "--seconds", Timeout.c_str(), "--max-drop-fraction", "0.01", nullptr };
+	pid_t Consumer = 0;
+	if (posix_spawn(&Consumer, ConsumerPath, nullptr, nullptr, const_cast<char* const*>(ConsumerArgs), environ) != 0)
+	{
+		std::printf("FAILED: could not start %s\n", ConsumerPath);
+		return 1;
+	}
+
+	// Frames published before the consumer attaches are neither received nor dropped, so give it time to attach
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+	using FClock = std::chrono::steady_clock;
+	const FClock::duration Period = std::chrono::duration_cast<FClock::duration>(std::chrono::duration<double>(1.0 / Hz));
+	FClock::time_point NextDue = FClock::now();
+	for (int64_t Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		std::this_thread::sleep_until(NextDue);
+		NextDue += Period;
+
+		// Every pixel holds the frame number, so the consumer can tell a frame it read half-overwritten
+		uint32_t* Pixels = Producer.BeginWrite(Width, Height, 0);
+		std::fill(Pixels, Pixels + (size_t)Width * Height, (uint32_t)Frame);
+		Producer.EndWrite((uint64_t)Frame);
+	}
+
+	int Status = 0;
+	if (waitpid(Consumer, &Status, 0) != Consumer)
+	{
+		kill(Consumer, SIGKILL);
+		std::printf("FAILED: lost track of the consumer\n");
+		return 1;
+	}
+
+	const bool bPassed = WIFEXITED(Status) && WEXITSTATUS(Status) == 0;
+	std::printf("%s: %lld frames of %ux%u at %.0f Hz through %s\n", bPassed ? "passed" : "FAILED", (long long)NumFrames, Width, Height, Hz, Name.c_str());
+	return bPassed ? 0 : 1;
+}
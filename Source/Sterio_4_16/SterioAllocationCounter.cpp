@@ -0,0 +1,88 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioAllocationCounter.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioAllocationCounter, Log, All);
+
+namespace
+{
+	/** Forwards to the allocator it wraps and counts what the game thread allocates. Never destroyed. */
+	class FSterioCountingMalloc : public FMalloc
+	{
+	public:
+		explicit FSterioCountingMalloc(FMalloc* InInner)
+			: Inner(InInner)
+			, Allocations(0)
+		{
+		}
+
+		int64 GetAllocations() const { return Allocations; }
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim() override { Inner->Trim(); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void UpdateStats() override { Inner->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return TEXT("SterioCountingMalloc"); }
+
+	private:
+		void CountAllocation()
+		{
+			// Only the game thread writes the count, so it needs no atomics
+			if (FPlatformTLS::GetCurrentThreadId() == GGameThreadId)
+			{
+				++Allocations;
+			}
+		}
+
+		FMalloc* const Inner;
+		int64 Allocations;
+	};
+
+	FSterioCountingMalloc* GSterioCountingMalloc = nullptr;
+}
+
+void FSterioAllocationCounter::InstallFromCommandLine()
+{
+	check(IsInGameThread());
+	if (GSterioCountingMalloc || !FParse::Param(FCommandLine::Get(), TEXT("SterioCountAllocs")))
+	{
+		return;
+	}
+
+	// Threads that still read the old GMalloc keep using the allocator underneath, which stays valid
+	GSterioCountingMalloc = new FSterioCountingMalloc(GMalloc);
+	FPlatformMisc::MemoryBarrier();
+	GMalloc = GSterioCountingMalloc;
+	UE_LOG(LogSterioAllocationCounter, Log, TEXT("Counting game thread allocations"));
+}
+
+bool FSterioAllocationCounter::IsInstalled()
+{
+	return GSterioCountingMalloc != nullptr;
+}
+
+int64 FSterioAllocationCounter::GetGameThreadAllocations()
+{
+	return GSterioCountingMalloc ? GSterioCountingMalloc->GetAllocations() : 0;
+}
@@ -0,0 +1,24 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Counts the allocations made on the game thread.
+ *
+ * The counting allocator wraps GMalloc once, at module startup, and stays installed for the rest of the process:
+ * swapping the global allocator while other threads allocate is only safe if neither allocator ever goes away.
+ * It is therefore opt-in, with -SterioCountAllocs on the command line.
+ */
+class FSterioAllocationCounter
+{
+public:
+	/** Wraps GMalloc if the command line asks for it. Call once, on the game thread, at startup. */
+	static void InstallFromCommandLine();
+
+	static bool IsInstalled();
+
+	/** Game thread allocations and reallocations since the counter was installed; 0 if it wasn't. Game thread only. */
+	static int64 GetGameThreadAllocations();
+};
@@ -0,0 +1,1065 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioBenchmark.h"
+#include "SterioCulling.h"
+#include "SterioFramePacking.h"
+#include "SterioLegacyProjection.h"
+#include "SterioProjectionKernel.h"
+#include "SterioRigManager.h"
+#include "Sterio_4_16Character.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "RenderingThread.h"
+#include "RHI.h"
+#include "Misc/App.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+
+#include <iterator>
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioBenchmark, Log, All);
+
+namespace
+{
+	/** Keeps the optimizer from discarding benchmark bodies. */
+	volatile float GBenchmarkSink = 0.f;
+
+	const TCHAR* GetProjectionKernelName(SterioProjection::EKernel Kernel)
+	{
+		switch (Kernel)
+		{
+		case SterioProjection::EKernel::AVX2: return TEXT("avx2");
+		case SterioProjection::EKernel::SSE: return TEXT("sse");
+		default: return TEXT("scalar");
+		}
+	}
+
+	/** The rig's default screen and slightly detuned M_x_y terms, so the tuning terms are exercised too. */
+	FSterioLegacyProjection MakeReferenceRig()
+	{
+		FSterioLegacyProjection Rig;
+		Rig.M_0_0 = 1.05f;
+		Rig.M_1_1 = 0.95f;
+		Rig.M_0_3 = 0.001f;
+		Rig.M_1_3 = -0.002f;
+		return Rig;
+	}
+
+	SterioProjection::FFrustumParams MakeBenchmarkParams(const FSterioLegacyProjection& Rig)
+	{
+		SterioProjection::FFrustumParams Params = SterioProjection::MakeFrustumParams(Rig.NearClipPlane);
+		Params.Tuning.M00 = Rig.M_0_0;
+		Params.Tuning.M11 = Rig.M_1_1;
+		Params.Tuning.M03 = Rig.M_0_3;
+		Params.Tuning.M13 = Rig.M_1_3;
+		return Params;
+	}
+
+	/** Deterministic spread of viewer positions in front of the screen. */
+	FVector MakeBenchmarkEye(int32 Index)
+	{
+		return FVector(-40.f + (Index % 17) * 5.f, -30.f + (Index % 13) * 5.f, 60.f + (Index % 23) * 10.f);
+	}
+
+	/** Deterministic scatter of actor-sized boxes around the space behind the default screen. */
+	void MakeBenchmarkBoxes(int32 NumBoxes, std::vector<SterioCulling::FAabb>& OutBoxes)
+	{
+		FRandomStream Random(0x5731);
+		OutBoxes.resize(NumBoxes);
+		for (SterioCulling::FAabb& Box : OutBoxes)
+		{
+			const FVector Center(Random.FRandRange(-20000.f, 20000.f), Random.FRandRange(-20000.f, 20000.f), Random.FRandRange(-40000.f, 0.f));
+			const float Extent = Random.FRandRange(10.f, 500.f);
+			Box.Min = SterioCulling::MakeVec3(Center.X - Extent, Center.Y - Extent, Center.Z - Extent);
+			Box.Max = SterioCulling::MakeVec3(Center.X + Extent, Center.Y + Extent, Center.Z + Extent);
+		}
+	}
+
+	const TCHAR* GetPackingFormatName(SterioPacking::EFormat Format)
+	{
+		switch (Format)
+		{
+		case SterioPacking::EFormat::SideBySide: return TEXT("side_by_side");
+		case SterioPacking::EFormat::TopBottom: return TEXT("top_bottom");
+		case SterioPacking::EFormat::RowInterleaved: return TEXT("row_interleaved");
+		case SterioPacking::EFormat::ColumnInterleaved: return TEXT("column_interleaved");
+		case SterioPacking::EFormat::Checkerboard: return TEXT("checkerboard");
+		default: return TEXT("anaglyph");
+		}
+	}
+
+	const SterioPacking::EFormat GPackingFormats[] =
+	{
+		SterioPacking::EFormat::SideBySide,
+		SterioPacking::EFormat::TopBottom,
+		SterioPacking::EFormat::RowInterleaved,
+		SterioPacking::EFormat::ColumnInterleaved,
+		SterioPacking::EFormat::Checkerboard,
+		SterioPacking::EFormat::Anaglyph,
+	};
+
+	/** Random pixels, so any channel or pixel landing in the wrong place shows. */
+	void MakeBenchmarkImage(int32 Width, int32 Height, int32 Seed, TArray<uint32>& OutPixels)
+	{
+		FRandomStream Random(Seed);
+		OutPixels.SetNumUninitialized(Width * Height);
+		for (uint32& Pixel : OutPixels)
+		{
+			Pixel = (uint32)Random.GetUnsignedInt();
+		}
+	}
+
+	/** Byte-wise rounded average, written out the long way. */
+	uint32 AverageReferencePixels(uint32 A, uint32 B)
+	{
+		uint32 Result = 0;
+		for (int32 Shift = 0; Shift < 32; Shift += 8)
+		{
+			Result |= ((((A >> Shift) & 0xFF) + ((B >> Shift) & 0xFF) + 1) >> 1) << Shift;
+		}
+		return Result;
+	}
+
+	/** What each format promises for one output pixel, independent of how the kernels get there. */
+	uint32 GetReferencePackedPixel(SterioPacking::EFormat Format, const TArray<uint32>& Left, const TArray<uint32>& Right, int32 Width, int32 Height, int32 X, int32 Y)
+	{
+		auto L = [&](int32 PX, int32 PY) { return Left[FMath::Min(PY, Height - 1) * Width + FMath::Min(PX, Width - 1)]; };
+		auto R = [&](int32 PX, int32 PY) { return Right[FMath::Min(PY, Height - 1) * Width + FMath::Min(PX, Width - 1)]; };
+
+		switch (Format)
+		{
+		case SterioPacking::EFormat::SideBySide:
+			return (X < Width / 2) ? AverageReferencePixels(L(2 * X, Y), L(2 * X + 1, Y)) : AverageReferencePixels(R(2 * (X - Width / 2), Y), R(2 * (X - Width / 2) + 1, Y));
+		case SterioPacking::EFormat::TopBottom:
+			return (Y < Height / 2) ? AverageReferencePixels(L(X, 2 * Y), L(X, 2 * Y + 1)) : AverageReferencePixels(R(X, 2 * (Y - Height / 2)), R(X, 2 * (Y - Height / 2) + 1));
+		case SterioPacking::EFormat::RowInterleaved:
+			return (Y & 1) ? R(X, Y) : L(X, Y);
+		case SterioPacking::EFormat::ColumnInterleaved:
+			return (X & 1) ? R(X, Y) : L(X, Y);
+		case SterioPacking::EFormat::Checkerboard:
+			return ((X + Y) & 1) ? R(X, Y) : L(X, Y);
+		default:
+			return (L(X, Y) & SterioPacking::RedCyanMask) | (R(X, Y) & ~SterioPacking::RedCyanMask);
+		}
+	}
+
+	void AccumulateBenchmarkSink(const FMatrix& M)
+	{
+		GBenchmarkSink = GBenchmarkSink + M.M[0][0] + M.M[2][0];
+	}
+
+	const TCHAR* GetScreenShapeName(SterioProjection::EScreenShape Shape)
+	{
+		switch (Shape)
+		{
+		case SterioProjection::EScreenShape::AxisAligned: return TEXT("axis_aligned");
+		case SterioProjection::EScreenShape::SingleAxis: return TEXT("single_axis");
+		default: return TEXT("general");
+		}
+	}
+
+	const SterioProjection::EScreenShape GScreenShapes[] =
+	{
+		SterioProjection::EScreenShape::AxisAligned,
+		SterioProjection::EScreenShape::SingleAxis,
+		SterioProjection::EScreenShape::General,
+	};
+
+	/** The default screen, turned 25 degrees about its up axis for SingleAxis and also tilted 15 degrees back for General. */
+	SterioProjection::FScreenBasis MakeShapeBenchmarkScreen(const FSterioLegacyProjection& Rig, SterioProjection::EScreenShape Shape)
+	{
+		const float Yaw = (Shape == SterioProjection::EScreenShape::AxisAligned) ? 0.f : FMath::DegreesToRadians(25.f);
+		const float Pitch = (Shape == SterioProjection::EScreenShape::General) ? FMath::DegreesToRadians(15.f) : 0.f;
+
+		SterioProjection::FScreen Screen = SterioProjection::MakeCenteredScreen(Rig.width, Rig.height);
+		SterioProjection::FVec3* Corners[] = { &Screen.Pa, &Screen.Pb, &Screen.Pc };
+		for (SterioProjection::FVec3* Corner : Corners)
+		{
+			const float Y = Corner->Y * FMath::Cos(Pitch) - Corner->Z * FMath::Sin(Pitch);
+			const float Z = Corner->Y * FMath::Sin(Pitch) + Corner->Z * FMath::Cos(Pitch);
+			*Corner = SterioProjection::MakeVec3(Corner->X * FMath::Cos(Yaw) + Z * FMath::Sin(Yaw), Y, Z * FMath::Cos(Yaw) - Corner->X * FMath::Sin(Yaw));
+		}
+		return SterioProjection::MakeScreenBasis(Screen);
+	}
+
+	void AccumulateBenchmarkSink(const SterioProjection::FMatrix44& M)
+	{
+		GBenchmarkSink = GBenchmarkSink + M.M[0][0] + M.M[2][0];
+	}
+}
+
+FSterioBenchmark::FSterioBenchmark(UWorld* InWorld, int32 InIterations, bool bInEmitLog)
+	: World(InWorld)
+	, Iterations(FMath::Max(1, InIterations))
+	, bEmitLog(bInEmitLog)
+{
+}
+
+template <typename BodyType>
+void FSterioBenchmark::Measure(const TCHAR* Name, int32 Count, double OpsPerIteration, const TCHAR* Unit, BodyType Body)
+{
+	// Warm caches and lazily initialised state outside the timed region
+	Body(FMath::Max(1, Count / 10));
+
+	const double Start = FPlatformTime::Seconds();
+	Body(Count);
+	const double End = FPlatformTime::Seconds();
+
+	FSterioBenchmarkResult Result;
+	Result.Name = Name;
+	Result.Iterations = Count;
+	Result.OpsPerIteration = OpsPerIteration;
+	Result.Unit = Unit;
+	Result.TotalSeconds = End - Start;
+	Results.Add(Result);
+
+	UE_LOG(LogSterioBenchmark, Log, TEXT("%-32s %10.2f ns/%s"), Name, Result.GetNanosecondsPerOp(), Unit);
+}
+
+bool FSterioBenchmark::Run()
+{
+	Results.Reset();
+	Equivalence.Reset();
+
+	RunProjectionCases();
+	RunUploadCases();
+	RunLoggingCases();
+	RunCullingCases();
+	RunCaptureCullingCases();
+	RunRigManagerCases();
+	RunEquivalenceChecks();
+	RunDepthChecks();
+	RunShapeCases();
+	RunShapeChecks();
+	RunPackingCases();
+	RunPackingChecks();
+
+	bool bPassed = true;
+	for (const FSterioEquivalenceResult& Check : Equivalence)
+	{
+		if (!Check.Passed())
+		{
+			UE_LOG(LogSterioBenchmark, Error, TEXT("Equivalence check %s failed: max relative difference %g exceeds %g"), *Check.Name, Check.MaxRelDiff, Check.Tolerance);
+			bPassed = false;
+		}
+	}
+	return bPassed;
+}
+
+void FSterioBenchmark::RunProjectionCases()
+{
+	const FSterioLegacyProjection Rig = MakeReferenceRig();
+	const SterioProjection::FFrustumParams Params = MakeBenchmarkParams(Rig);
+	const SterioProjection::FScreenBasis Screen = SterioProjection::MakeScreenBasis(SterioProjection::MakeCenteredScreen(Rig.width, Rig.height));
+
+	// What the rig did per Tick before the kernel: one direct and one tan-flipped eye
+	Measure(TEXT("legacy_single_eye_pair"), Iterations, 2.0, TEXT("frustum"), [&Rig](int32 Count)
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const FVector Eye = MakeBenchmarkEye(Index);
+			AccumulateBenchmarkSink(Rig.GeneralizedPerspectiveProjection(Eye));
+			AccumulateBenchmarkSink(Rig.GeneralizedPerspectiveProjection1(Eye));
+		}
+	});
+
+	Measure(TEXT("kernel_single_eye_pair"), Iterations, 2.0, TEXT("frustum"), [&Screen, &Params](int32 Count)
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const FVector Eye = MakeBenchmarkEye(Index);
+			const SterioProjection::FVec3 Pe = SterioProjection::MakeVec3(Eye.X, Eye.Y, Eye.Z);
+			AccumulateBenchmarkSink(SterioProjection::ComputeProjection(Screen, Pe, SterioProjection::EFlavor::Direct, Params));
+			AccumulateBenchmarkSink(SterioProjection::ComputeProjection(Screen, Pe, SterioProjection::EFlavor::TanFlipped, Params));
+		}
+	});
+
+	// Many viewers across a few walls, the multi-viewer case the batched kernel is meant for
+	const int32 NumScreens = 4;
+	const int32 NumEyes = 128;
+
+	TArray<SterioProjection::FScreenBasis> Screens;
+	for (int32 ScreenIndex = 0; ScreenIndex < NumScreens; ++ScreenIndex)
+	{
+		Screens.Add(SterioProjection::MakeScreenBasis(SterioProjection::MakeCenteredScreen(Rig.width, Rig.height, ScreenIndex * 10.f)));
+	}
+
+	TArray<float> EyeX, EyeY, EyeZ;
+	for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+	{
+		const FVector Eye = MakeBenchmarkEye(EyeIndex);
+		EyeX.Add(Eye.X);
+		EyeY.Add(Eye.Y);
+		EyeZ.Add(Eye.Z);
+	}
+	const SterioProjection::FEyesSoA Eyes = { EyeX.GetData(), EyeY.GetData(), EyeZ.GetData(), nullptr, NumEyes };
+
+	TArray<SterioProjection::FMatrix44> Out;
+	Out.SetNumUninitialized(NumScreens * NumEyes);
+
+	// Keep the batched cases comparable to the per-pair ones by scaling the iteration count down
+	const int32 BatchIterations = FMath::Max(1, Iterations / NumEyes);
+	const SterioProjection::EKernel Kernels[] = { SterioProjection::EKernel::Scalar, SterioProjection::EKernel::SSE, SterioProjection::EKernel::AVX2 };
+	for (SterioProjection::EKernel Kernel : Kernels)
+	{
+		if (!SterioProjection::IsKernelAvailable(Kernel))
+		{
+			continue;
+		}
+
+		const FString Name = FString::Printf(TEXT("kernel_batched_%dx%d_%s"), NumScreens, NumEyes, GetProjectionKernelName(Kernel));
+		Measure(*Name, BatchIterations, NumScreens * NumEyes, TEXT("frustum"), [&](int32 Count)
+		{
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				SterioProjection::ComputeProjections(Screens.GetData(), NumScreens, Eyes, Params, Out.GetData(), Kernel);
+				AccumulateBenchmarkSink(Out[Index % Out.Num()]);
+			}
+		});
+	}
+}
+
+void FSterioBenchmark::RunUploadCases()
+{
+	// Prefer a live rig so the numbers include attachment and render-state updates
+	ASterio_4_16Character* Rig = nullptr;
+	if (World)
+	{
+		for (TActorIterator<ASterio_4_16Character> It(World); It; ++It)
+		{
+			Rig = *It;
+			break;
+		}
+	}
+
+	USceneCaptureComponent2D* Cam = Rig ? Rig->GetLeftCam() : NewObject<USceneCaptureComponent2D>(GetTransientPackage());
+	const FMatrix Projection = MakeReferenceRig().GeneralizedPerspectiveProjection(MakeBenchmarkEye(0));
+
+	const TCHAR* Name = Rig ? TEXT("upload_eye_capture_rig") : TEXT("upload_eye_capture_transient");
+	Measure(Name, Iterations, 1.0, TEXT("eye"), [Cam, &Projection](int32 Count)
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const FVector Eye = MakeBenchmarkEye(Index);
+			Cam->SetRelativeLocation(FVector(-Eye.Z, Eye.X, Eye.Y));
+			Cam->CustomProjectionMatrix = Projection;
+		}
+	});
+
+	if (Rig)
+	{
+		// Put the capture back where the rig wants it
+		Rig->InvalidateProjectionCache();
+	}
+}
+
+void FSterioBenchmark::RunLoggingCases()
+{
+	const FSterioLegacyProjection Rig = MakeReferenceRig();
+	const FMatrix Left = Rig.GeneralizedPerspectiveProjection(MakeBenchmarkEye(0));
+	const FMatrix Right = Rig.GeneralizedPerspectiveProjection1(MakeBenchmarkEye(1));
+
+	// The formatting half of the per-frame matrix dump
+	Measure(TEXT("log_format_matrix_pair"), Iterations, 2.0, TEXT("line"), [&Left, &Right](int32 Count)
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const FString LeftLine = FString::Printf(TEXT("GeneralizedPerspectiveProjection(RightEye) %s"), *Left.ToString());
+			const FString RightLine = FString::Printf(TEXT("GeneralizedPerspectiveProjection1(RightEye) %s"), *Right.ToString());
+			GBenchmarkSink = GBenchmarkSink + LeftLine.Len() + RightLine.Len();
+		}
+	});
+
+	if (bEmitLog)
+	{
+		// Actually emitting lines floods the log, so this is opt-in and capped
+		Measure(TEXT("log_emit_matrix_pair"), FMath::Min(Iterations, 1000), 2.0, TEXT("line"), [&Left, &Right](int32 Count)
+		{
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				UE_LOG(LogSterioBenchmark, Log, TEXT("GeneralizedPerspectiveProjection(RightEye) %s"), *Left.ToString());
+				UE_LOG(LogSterioBenchmark, Log, TEXT("GeneralizedPerspectiveProjection1(RightEye) %s"), *Right.ToString());
+			}
+		});
+	}
+}
+
+void FSterioBenchmark::RunCullingCases()
+{
+	const FSterioLegacyProjection Rig = MakeReferenceRig();
+	const SterioProjection::FScreen Screen = SterioProjection::MakeCenteredScreen(Rig.width, Rig.height);
+	const float Far = 50000.f;
+
+	const int32 NumBoxes = 20000;
+	std::vector<SterioCulling::FAabb> Boxes;
+	MakeBenchmarkBoxes(NumBoxes, Boxes);
+
+	SterioCulling::FBvh Bvh;
+	Bvh.Build(Boxes.data(), NumBoxes);
+
+	const int32 CullIterations = FMath::Max(1, Iterations / 1000);
+	std::vector<int32_t> Visible;
+
+	// A stand-in for each capture culling on its own: every box against each eye's own frustum
+	Measure(TEXT("cull_brute_force_per_eye"), CullIterations, 2.0 * NumBoxes, TEXT("box"), [&](int32 Count)
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const FVector LeftEye = MakeBenchmarkEye(2 * Index);
+			const FVector RightEye = MakeBenchmarkEye(2 * Index + 1);
+			const SterioCulling::FVec3 Eyes[] = { SterioCulling::MakeVec3(LeftEye.X, LeftEye.Y, LeftEye.Z), SterioCulling::MakeVec3(RightEye.X, RightEye.Y, RightEye.Z) };
+			for (const SterioCulling::FVec3& Eye : Eyes)
+			{
+				SterioCulling::CullBruteForce(SterioCulling::MakeUnionFrustum(Screen, &Eye, 1, Rig.NearClipPlane, Far), Boxes.data(), NumBoxes, Visible);
+				GBenchmarkSink = GBenchmarkSink + Visible.size();
+			}
+		}
+	});
+
+	// What the rig does with shared visibility: the hierarchy once against the union of both eyes
+	Measure(TEXT("cull_bvh_union_eye_pair"), CullIterations, 2.0 * NumBoxes, TEXT("box"), [&](int32 Count)
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const FVector LeftEye = MakeBenchmarkEye(2 * Index);
+			const FVector RightEye = MakeBenchmarkEye(2 * Index + 1);
+			const SterioCulling::FVec3 Eyes[] = { SterioCulling::MakeVec3(LeftEye.X, LeftEye.Y, LeftEye.Z), SterioCulling::MakeVec3(RightEye.X, RightEye.Y, RightEye.Z) };
+			Bvh.Cull(SterioCulling::MakeUnionFrustum(Screen, Eyes, 2, Rig.NearClipPlane, Far), Boxes.data(), Visible);
+			GBenchmarkSink = GBenchmarkSink + Visible.size();
+		}
+	});
+
+	Measure(TEXT("cull_bvh_refit"), CullIterations, NumBoxes, TEXT("box"), [&](int32 Count)
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			Bvh.Refit(Boxes.data());
+		}
+	});
+
+	// The hierarchy must find exactly what brute force finds, and the union everything either eye sees
+	FSterioEquivalenceResult BvhCheck;
+	BvhCheck.Name = TEXT("cull_bvh_vs_brute_force");
+	BvhCheck.Samples = 0;
+	BvhCheck.MaxAbsDiff = 0.f;
+	BvhCheck.MaxRelDiff = 0.f;
+	BvhCheck.Tolerance = 0.f;
+
+	FSterioEquivalenceResult UnionCheck = BvhCheck;
+	UnionCheck.Name = TEXT("cull_union_contains_eyes");
+
+	std::vector<int32_t> Reference;
+	TBitArray<> InUnion;
+	for (int32 Index = 0; Index < 64; ++Index)
+	{
+		const FVector LeftEye = MakeBenchmarkEye(2 * Index);
+		const FVector RightEye = MakeBenchmarkEye(2 * Index + 1);
+		const SterioCulling::FVec3 Eyes[] = { SterioCulling::MakeVec3(LeftEye.X, LeftEye.Y, LeftEye.Z), SterioCulling::MakeVec3(RightEye.X, RightEye.Y, RightEye.Z) };
+		const SterioCulling::FFrustum Union = SterioCulling::MakeUnionFrustum(Screen, Eyes, 2, Rig.NearClipPlane, Far);
+
+		SterioCulling::CullBruteForce(Union, Boxes.data(), NumBoxes, Reference);
+		Bvh.Cull(Union, Boxes.data(), Visible);
+		std::sort(Visible.begin(), Visible.end());
+		std::vector<int32_t> Difference;
+		std::set_symmetric_difference(Visible.begin(), Visible.end(), Reference.begin(), Reference.end(), std::back_inserter(Difference));
+		const float Mismatches = (float)Difference.size();
+		BvhCheck.Samples += NumBoxes;
+		BvhCheck.MaxAbsDiff = FMath::Max(BvhCheck.MaxAbsDiff, Mismatches);
+		BvhCheck.MaxRelDiff = FMath::Max(BvhCheck.MaxRelDiff, Mismatches / NumBoxes);
+
+		InUnion.Init(false, NumBoxes);
+		for (int32_t Item : Reference)
+		{
+			InUnion[Item] = true;
+		}
+		for (const SterioCulling::FVec3& Eye : Eyes)
+		{
+			SterioCulling::CullBruteForce(SterioCulling::MakeUnionFrustum(Screen, &Eye, 1, Rig.NearClipPlane, Far), Boxes.data(), NumBoxes, Visible);
+			int32 Missing = 0;
+			for (int32_t Item : Visible)
+			{
+				Missing += InUnion[Item] ? 0 : 1;
+			}
+			UnionCheck.Samples += NumBoxes;
+			UnionCheck.MaxAbsDiff = FMath::Max(UnionCheck.MaxAbsDiff, (float)Missing);
+			UnionCheck.MaxRelDiff = FMath::Max(UnionCheck.MaxRelDiff, (float)Missing / NumBoxes);
+		}
+	}
+
+	Equivalence.Add(BvhCheck);
+	Equivalence.Add(UnionCheck);
+}
+
+void FSterioBenchmark::RunCaptureCullingCases()
+{
+	// Only a live rig in a rendering world has a scene and targets to capture
+	ASterio_4_16Character* Rig = nullptr;
+	if (World && World->Scene && !GUsingNullRHI)
+	{
+		for (TActorIterator<ASterio_4_16Character> It(World); It; ++It)
+		{
+			if (It->GetEyeCapture(0, 0) && It->GetEyeCapture(0, 0)->TextureTarget && It->GetEyeCapture(0, 1) && It->GetEyeCapture(0, 1)->TextureTarget)
+			{
+				Rig = *It;
+				break;
+			}
+		}
+	}
+	if (!Rig)
+	{
+		UE_LOG(LogSterioBenchmark, Log, TEXT("No rendering rig in the world; skipping the capture_pair cases"));
+		return;
+	}
+
+	USceneCaptureComponent2D* Captures[] = { Rig->GetEyeCapture(0, 0), Rig->GetEyeCapture(0, 1) };
+	const bool bWasEnabled = Rig->SharedVisibility.bEnabled;
+	const int32 CaptureIterations = FMath::Clamp(Iterations / 1000, 4, 100);
+
+	// Renders screen 0's eye pair and waits for the render thread, which is where the engine culls each capture
+	auto CapturePair = [&Captures]()
+	{
+		for (USceneCaptureComponent2D* Capture : Captures)
+		{
+			Capture->CaptureScene();
+		}
+		FlushRenderingCommands();
+	};
+
+	Rig->SharedVisibility.bEnabled = false;
+	Rig->UpdateSharedVisibility();
+	Measure(TEXT("capture_pair_per_eye_culling"), CaptureIterations, 2.0, TEXT("capture"), [&CapturePair](int32 Count)
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			CapturePair();
+		}
+	});
+
+	// The rig's own pass is part of the price, so it runs every iteration
+	Rig->SharedVisibility.bEnabled = true;
+	Measure(TEXT("capture_pair_shared_visibility"), CaptureIterations, 2.0, TEXT("capture"), [Rig, &CapturePair](int32 Count)
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			Rig->UpdateSharedVisibility();
+			CapturePair();
+		}
+	});
+
+	const double PerEye = Results[Results.Num() - 2].GetNanosecondsPerOp();
+	const double Shared = Results[Results.Num() - 1].GetNanosecondsPerOp();
+	UE_LOG(LogSterioBenchmark, Log, TEXT("Shared visibility of %s hides %d actors over its screens (%d tracked); capture pair at %.1f%% of its per-eye cost"),
+		*Rig->GetName(), Rig->LastHiddenActors, Rig->Visibility.GetNumActors(), PerEye > 0.0 ? 100.0 * Shared / PerEye : 0.0);
+
+	Rig->SharedVisibility.bEnabled = bWasEnabled;
+	Rig->UpdateSharedVisibility();
+}
+
+void FSterioBenchmark::RunRigManagerCases()
+{
+	if (!World || !World->HasBegunPlay())
+	{
+		UE_LOG(LogSterioBenchmark, Log, TEXT("No world that has begun play; skipping the rig_manager cases"));
+		return;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	TArray<ASterio_4_16Character*> Spawned;
+	const int32 RigCounts[] = { 1, 8, 32, 64 };
+	const int32 ManagerIterations = FMath::Clamp(Iterations / 1000, 10, 1000);
+	double SingleRigSeconds = 0.0;
+
+	for (int32 NumRigs : RigCounts)
+	{
+		while (Spawned.Num() < NumRigs)
+		{
+			// Far from the level, like the soak rig
+			ASterio_4_16Character* Rig = World->SpawnActor<ASterio_4_16Character>(FVector(Spawned.Num() * 1000.f, 0.f, 100000.f), FRotator::ZeroRotator, SpawnParameters);
+			if (!Rig)
+			{
+				break;
+			}
+			Spawned.Add(Rig);
+		}
+
+		FSterioRigManager* Manager = FSterioRigManager::Find(World);
+		if (Spawned.Num() < NumRigs || !Manager)
+		{
+			UE_LOG(LogSterioBenchmark, Log, TEXT("Could not put %d rigs under a rig manager (Sterio.RigManager 0?); skipping the rest of the rig_manager cases"), NumRigs);
+			break;
+		}
+
+		// Every rig's eyes move every frame, so each update rebuilds all of them in one batch
+		const FString Name = FString::Printf(TEXT("rig_manager_batch_%d"), NumRigs);
+		Measure(*Name, ManagerIterations, Manager->GetNumRigs(), TEXT("rig"), [&Spawned, Manager](int32 Count)
+		{
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				for (ASterio_4_16Character* Rig : Spawned)
+				{
+					Rig->SetEyePositions(MakeBenchmarkEye(2 * Index), MakeBenchmarkEye(2 * Index + 1));
+				}
+				Manager->Update();
+			}
+		});
+
+		// Per-frame cost against the single rig case; linear scaling would be NumRigs times
+		const FSterioBenchmarkResult& Result = Results.Last();
+		const double FrameSeconds = Result.TotalSeconds / Result.Iterations;
+		SingleRigSeconds = (NumRigs == 1) ? FrameSeconds : SingleRigSeconds;
+		UE_LOG(LogSterioBenchmark, Log, TEXT("%d rigs (%d managed): %.1f us per batch, %.2fx the single rig batch"),
+			NumRigs, Manager->GetNumRigs(), FrameSeconds * 1.e6, SingleRigSeconds > 0.0 ? FrameSeconds / SingleRigSeconds : 0.0);
+	}
+
+	for (ASterio_4_16Character* Rig : Spawned)
+	{
+		Rig->Destroy();
+	}
+}
+
+void FSterioBenchmark::RunEquivalenceChecks()
+{
+	const FSterioLegacyProjection Rig = MakeReferenceRig();
+	const SterioProjection::FFrustumParams Params = MakeBenchmarkParams(Rig);
+	const SterioProjection::FScreenBasis Screen = SterioProjection::MakeScreenBasis(SterioProjection::MakeCenteredScreen(Rig.width, Rig.height));
+
+	const int32 NumEyes = 1024;
+	TArray<float> EyeX, EyeY, EyeZ;
+	TArray<SterioProjection::EFlavor> Flavors;
+	for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+	{
+		const FVector Eye = MakeBenchmarkEye(EyeIndex);
+		EyeX.Add(Eye.X);
+		EyeY.Add(Eye.Y);
+		EyeZ.Add(Eye.Z);
+		Flavors.Add((EyeIndex & 1) ? SterioProjection::EFlavor::TanFlipped : SterioProjection::EFlavor::Direct);
+	}
+	const SterioProjection::FEyesSoA Eyes = { EyeX.GetData(), EyeY.GetData(), EyeZ.GetData(), Flavors.GetData(), NumEyes };
+
+	TArray<SterioProjection::FMatrix44> Out;
+	Out.SetNumUninitialized(NumEyes);
+
+	const SterioProjection::EKernel Kernels[] = { SterioProjection::EKernel::Scalar, SterioProjection::EKernel::SSE, SterioProjection::EKernel::AVX2 };
+	for (SterioProjection::EKernel Kernel : Kernels)
+	{
+		if (!SterioProjection::IsKernelAvailable(Kernel))
+		{
+			continue;
+		}
+
+		SterioProjection::ComputeProjections(&Screen, 1, Eyes, Params, Out.GetData(), Kernel);
+
+		FSterioEquivalenceResult Check;
+		Check.Name = FString::Printf(TEXT("kernel_%s_vs_legacy"), GetProjectionKernelName(Kernel));
+		Check.Samples = NumEyes;
+		Check.MaxAbsDiff = 0.f;
+		Check.MaxRelDiff = 0.f;
+		// The legacy path normalises with the engine's approximate InvSqrt, so exact equality is not expected
+		Check.Tolerance = 1.e-4f;
+
+		for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+		{
+			const FVector Eye = MakeBenchmarkEye(EyeIndex);
+			const FMatrix Reference = (EyeIndex & 1) ? Rig.GeneralizedPerspectiveProjection1(Eye) : Rig.GeneralizedPerspectiveProjection(Eye);
+			for (int32 Row = 0; Row < 4; ++Row)
+			{
+				for (int32 Col = 0; Col < 4; ++Col)
+				{
+					const float AbsDiff = FMath::Abs(Reference.M[Row][Col] - Out[EyeIndex].M[Row][Col]);
+					Check.MaxAbsDiff = FMath::Max(Check.MaxAbsDiff, AbsDiff);
+					Check.MaxRelDiff = FMath::Max(Check.MaxRelDiff, AbsDiff / FMath::Max(1.f, FMath::Abs(Reference.M[Row][Col])));
+				}
+			}
+		}
+
+		Equivalence.Add(Check);
+	}
+}
+
+void FSterioBenchmark::RunDepthChecks()
+{
+	const FSterioLegacyProjection Rig = MakeReferenceRig();
+	const SterioProjection::FScreenBasis Screen = SterioProjection::MakeScreenBasis(SterioProjection::MakeCenteredScreen(Rig.width, Rig.height));
+	const float Near = Rig.NearClipPlane;
+	const float Far = 10000.f;
+
+	const int32 NumEyes = 64;
+	TArray<float> EyeX, EyeY, EyeZ;
+	TArray<SterioProjection::EFlavor> Flavors;
+	for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+	{
+		const FVector Eye = MakeBenchmarkEye(EyeIndex);
+		EyeX.Add(Eye.X);
+		EyeY.Add(Eye.Y);
+		EyeZ.Add(Eye.Z);
+		Flavors.Add((EyeIndex & 1) ? SterioProjection::EFlavor::TanFlipped : SterioProjection::EFlavor::Direct);
+	}
+	const SterioProjection::FEyesSoA Eyes = { EyeX.GetData(), EyeY.GetData(), EyeZ.GetData(), Flavors.GetData(), NumEyes };
+
+	TArray<SterioProjection::FMatrix44> Out;
+	Out.SetNumUninitialized(NumEyes);
+
+	struct FDepthCase
+	{
+		const TCHAR* Name;
+		SterioProjection::EDepthMode Mode;
+		float ExpectedNear;
+		float ExpectedFar;
+	};
+	const FDepthCase Cases[] =
+	{
+		{ TEXT("depth_infinite_ndc"), SterioProjection::EDepthMode::Infinite, 1.f, Near / Far },
+		{ TEXT("depth_finite_ndc"), SterioProjection::EDepthMode::Finite, 0.f, 1.f },
+		{ TEXT("depth_reversed_finite_ndc"), SterioProjection::EDepthMode::ReversedFinite, 1.f, 0.f },
+	};
+
+	for (const FDepthCase& Case : Cases)
+	{
+		SterioProjection::FFrustumParams Params = MakeBenchmarkParams(Rig);
+		Params.DepthMode = Case.Mode;
+		Params.Far = Far;
+		SterioProjection::ComputeProjections(&Screen, 1, Eyes, Params, Out.GetData());
+
+		FSterioEquivalenceResult Check;
+		Check.Name = Case.Name;
+		Check.Samples = NumEyes * 2;
+		Check.MaxAbsDiff = 0.f;
+		Check.MaxRelDiff = 0.f;
+		Check.Tolerance = 1.e-5f;
+
+		for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+		{
+			const SterioProjection::FMatrix44& M = Out[EyeIndex];
+			const float Depths[] = { Near, Far };
+			const float Expected[] = { Case.ExpectedNear, Case.ExpectedFar };
+			for (int32 Index = 0; Index < 2; ++Index)
+			{
+				// Row vector (x, y, Depth, 1): only the z and w columns matter for NDC depth
+				const float ClipZ = Depths[Index] * M.M[2][2] + M.M[3][2];
+				const float ClipW = Depths[Index] * M.M[2][3] + M.M[3][3];
+				const float AbsDiff = FMath::Abs(ClipZ / ClipW - Expected[Index]);
+				Check.MaxAbsDiff = FMath::Max(Check.MaxAbsDiff, AbsDiff);
+				Check.MaxRelDiff = FMath::Max(Check.MaxRelDiff, AbsDiff);
+			}
+		}
+
+		Equivalence.Add(Check);
+	}
+}
+
+void FSterioBenchmark::RunShapeCases()
+{
+	const FSterioLegacyProjection Rig = MakeReferenceRig();
+	const SterioProjection::FFrustumParams Params = MakeBenchmarkParams(Rig);
+
+	// Direct eyes only, so the tan() of the flipped flavor doesn't hide the difference
+	const int32 NumEyes = 128;
+	TArray<float> EyeX, EyeY, EyeZ;
+	for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+	{
+		const FVector Eye = MakeBenchmarkEye(EyeIndex);
+		EyeX.Add(Eye.X);
+		EyeY.Add(Eye.Y);
+		EyeZ.Add(Eye.Z);
+	}
+	const SterioProjection::FEyesSoA Eyes = { EyeX.GetData(), EyeY.GetData(), EyeZ.GetData(), nullptr, NumEyes };
+
+	TArray<SterioProjection::FMatrix44> Out;
+	Out.SetNumUninitialized(NumEyes);
+
+	const int32 BatchIterations = FMath::Max(1, Iterations / NumEyes);
+	const SterioProjection::EKernel Kernels[] = { SterioProjection::EKernel::Scalar, SterioProjection::EKernel::SSE, SterioProjection::EKernel::AVX2 };
+	for (SterioProjection::EScreenShape Shape : GScreenShapes)
+	{
+		const SterioProjection::FScreenBasis Screen = MakeShapeBenchmarkScreen(Rig, Shape);
+		SterioProjection::FScreenBasis GeneralScreen = Screen;
+		GeneralScreen.Shape = SterioProjection::EScreenShape::General;
+
+		for (SterioProjection::EKernel Kernel : Kernels)
+		{
+			if (!SterioProjection::IsKernelAvailable(Kernel))
+			{
+				continue;
+			}
+
+			// The screen's own path, then the same screen through the general one as the baseline
+			const FString Name = FString::Printf(TEXT("shape_%s_%s"), GetScreenShapeName(Shape), GetProjectionKernelName(Kernel));
+			Measure(*Name, BatchIterations, NumEyes, TEXT("frustum"), [&](int32 Count)
+			{
+				for (int32 Index = 0; Index < Count; ++Index)
+				{
+					SterioProjection::ComputeProjections(&Screen, 1, Eyes, Params, Out.GetData(), Kernel);
+					AccumulateBenchmarkSink(Out[Index % Out.Num()]);
+				}
+			});
+
+			if (Shape != SterioProjection::EScreenShape::General)
+			{
+				const FString GeneralName = FString::Printf(TEXT("shape_%s_as_general_%s"), GetScreenShapeName(Shape), GetProjectionKernelName(Kernel));
+				Measure(*GeneralName, BatchIterations, NumEyes, TEXT("frustum"), [&](int32 Count)
+				{
+					for (int32 Index = 0; Index < Count; ++Index)
+					{
+						SterioProjection::ComputeProjections(&GeneralScreen, 1, Eyes, Params, Out.GetData(), Kernel);
+						AccumulateBenchmarkSink(Out[Index % Out.Num()]);
+					}
+				});
+			}
+		}
+	}
+}
+
+void FSterioBenchmark::RunShapeChecks()
+{
+	const FSterioLegacyProjection Rig = MakeReferenceRig();
+	const SterioProjection::FFrustumParams Params = MakeBenchmarkParams(Rig);
+
+	const int32 NumEyes = 1024;
+	TArray<float> EyeX, EyeY, EyeZ;
+	TArray<SterioProjection::EFlavor> Flavors;
+	for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+	{
+		const FVector Eye = MakeBenchmarkEye(EyeIndex);
+		EyeX.Add(Eye.X);
+		EyeY.Add(Eye.Y);
+		EyeZ.Add(Eye.Z);
+		Flavors.Add((EyeIndex & 1) ? SterioProjection::EFlavor::TanFlipped : SterioProjection::EFlavor::Direct);
+	}
+	const SterioProjection::FEyesSoA Eyes = { EyeX.GetData(), EyeY.GetData(), EyeZ.GetData(), Flavors.GetData(), NumEyes };
+
+	TArray<SterioProjection::FMatrix44> Out, Reference;
+	Out.SetNumUninitialized(NumEyes);
+	Reference.SetNumUninitialized(NumEyes);
+
+	const SterioProjection::EKernel Kernels[] = { SterioProjection::EKernel::Scalar, SterioProjection::EKernel::SSE, SterioProjection::EKernel::AVX2 };
+	for (SterioProjection::EScreenShape Shape : GScreenShapes)
+	{
+		const SterioProjection::FScreenBasis Screen = MakeShapeBenchmarkScreen(Rig, Shape);
+		SterioProjection::FScreenBasis GeneralScreen = Screen;
+		GeneralScreen.Shape = SterioProjection::EScreenShape::General;
+
+		for (SterioProjection::EKernel Kernel : Kernels)
+		{
+			if (!SterioProjection::IsKernelAvailable(Kernel))
+			{
+				continue;
+			}
+
+			SterioProjection::ComputeProjections(&Screen, 1, Eyes, Params, Out.GetData(), Kernel);
+			SterioProjection::ComputeProjections(&GeneralScreen, 1, Eyes, Params, Reference.GetData(), Kernel);
+
+			// The classification is part of what is checked: each test screen must take the path it was built for
+			FSterioEquivalenceResult Check;
+			Check.Name = FString::Printf(TEXT("shape_%s_%s_vs_general"), GetScreenShapeName(Shape), GetProjectionKernelName(Kernel));
+			Check.Samples = NumEyes;
+			Check.MaxAbsDiff = 0.f;
+			Check.MaxRelDiff = (Screen.Shape == Shape) ? 0.f : 1.f;
+			Check.Tolerance = SterioProjection::ShapeAgreementTolerance;
+
+			for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+			{
+				for (int32 Row = 0; Row < 4; ++Row)
+				{
+					for (int32 Col = 0; Col < 4; ++Col)
+					{
+						const float Expected = Reference[EyeIndex].M[Row][Col];
+						const float AbsDiff = FMath::Abs(Expected - Out[EyeIndex].M[Row][Col]);
+						Check.MaxAbsDiff = FMath::Max(Check.MaxAbsDiff, AbsDiff);
+						Check.MaxRelDiff = FMath::Max(Check.MaxRelDiff, AbsDiff / FMath::Max(1.f, FMath::Abs(Expected)));
+					}
+				}
+			}
+
+			Equivalence.Add(Check);
+		}
+	}
+}
+
+void FSterioBenchmark::RunPackingCases()
+{
+	// One 1080p eye pair, the size of the eye targets on our walls
+	const int32 Width = 1920;
+	const int32 Height = 1080;
+	TArray<uint32> Left, Right, Packed;
+	MakeBenchmarkImage(Width, Height, 1, Left);
+	MakeBenchmarkImage(Width, Height, 2, Right);
+	Packed.SetNumUninitialized(Width * Height);
+
+	const SterioPacking::FConstImage LeftImage = { Left.GetData(), Width, Height, Width };
+	const SterioPacking::FConstImage RightImage = { Right.GetData(), Width, Height, Width };
+	const SterioPacking::FImage PackedImage = { Packed.GetData(), Width, Height, Width };
+
+	// A frame is a couple of million pixels, so far fewer iterations than the per-matrix cases
+	const int32 FrameIterations = FMath::Max(1, Iterations / 10000);
+	const SterioProjection::EKernel Kernels[] = { SterioProjection::EKernel::Scalar, SterioProjection::EKernel::SSE, SterioProjection::EKernel::AVX2 };
+	for (SterioPacking::EFormat Format : GPackingFormats)
+	{
+		for (SterioProjection::EKernel Kernel : Kernels)
+		{
+			if (!SterioPacking::IsKernelAvailable(Kernel))
+			{
+				continue;
+			}
+
+			const FString Name = FString::Printf(TEXT("pack_%s_%s"), GetPackingFormatName(Format), GetProjectionKernelName(Kernel));
+			Measure(*Name, FrameIterations, (double)Width * Height, TEXT("pixel"), [&](int32 Count)
+			{
+				for (int32 Index = 0; Index < Count; ++Index)
+				{
+					SterioPacking::Pack(Format, LeftImage, RightImage, PackedImage, Kernel);
+					GBenchmarkSink = GBenchmarkSink + (float)(Packed[Index % Packed.Num()] & 0xFF);
+				}
+			});
+		}
+	}
+}
+
+void FSterioBenchmark::RunPackingChecks()
+{
+	// Odd sizes, so the scalar tails and the odd pixel of the squeezed formats are covered too
+	const int32 Width = 333;
+	const int32 Height = 197;
+	TArray<uint32> Left, Right, Packed;
+	MakeBenchmarkImage(Width, Height, 3, Left);
+	MakeBenchmarkImage(Width, Height, 4, Right);
+	Packed.SetNumUninitialized(Width * Height);
+
+	const SterioPacking::FConstImage LeftImage = { Left.GetData(), Width, Height, Width };
+	const SterioPacking::FConstImage RightImage = { Right.GetData(), Width, Height, Width };
+	const SterioPacking::FImage PackedImage = { Packed.GetData(), Width, Height, Width };
+
+	const SterioProjection::EKernel Kernels[] = { SterioProjection::EKernel::Scalar, SterioProjection::EKernel::SSE, SterioProjection::EKernel::AVX2 };
+	for (SterioPacking::EFormat Format : GPackingFormats)
+	{
+		for (SterioProjection::EKernel Kernel : Kernels)
+		{
+			if (!SterioPacking::IsKernelAvailable(Kernel))
+			{
+				continue;
+			}
+
+			SterioPacking::Pack(Format, LeftImage, RightImage, PackedImage, Kernel);
+
+			// Largest per-channel difference, out of 255; every kernel must be exact
+			FSterioEquivalenceResult Check;
+			Check.Name = FString::Printf(TEXT("pack_%s_%s_vs_reference"), GetPackingFormatName(Format), GetProjectionKernelName(Kernel));
+			Check.Samples = Width * Height;
+			Check.MaxAbsDiff = 0.f;
+			Check.Tolerance = 0.f;
+
+			for (int32 Y = 0; Y < Height; ++Y)
+			{
+				for (int32 X = 0; X < Width; ++X)
+				{
+					const uint32 Expected = GetReferencePackedPixel(Format, Left, Right, Width, Height, X, Y);
+					const uint32 Actual = Packed[Y * Width + X];
+					for (int32 Shift = 0; Shift < 32; Shift += 8)
+					{
+						const int32 Diff = FMath::Abs((int32)((Expected >> Shift) & 0xFF) - (int32)((Actual >> Shift) & 0xFF));
+						Check.MaxAbsDiff = FMath::Max(Check.MaxAbsDiff, (float)Diff);
+					}
+				}
+			}
+			Check.MaxRelDiff = Check.MaxAbsDiff / 255.f;
+
+			Equivalence.Add(Check);
+		}
+	}
+}
+
+FString FSterioBenchmark::ToJson(const FString& Label) const
+{
+	FString Json;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Json);
+
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("label"), Label);
+	Writer->WriteValue(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+	Writer->WriteValue(TEXT("engine"), FEngineVersion::Current().ToString());
+	Writer->WriteValue(TEXT("configuration"), FString(EBuildConfigurations::ToString(FApp::GetBuildConfiguration())));
+	Writer->WriteValue(TEXT("best_kernel"), FString(GetProjectionKernelName(SterioProjection::GetBestKernel())));
+
+	Writer->WriteArrayStart(TEXT("results"));
+	for (const FSterioBenchmarkResult& Result : Results)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("name"), Result.Name);
+		Writer->WriteValue(TEXT("iterations"), Result.Iterations);
+		Writer->WriteValue(TEXT("ops_per_iteration"), Result.OpsPerIteration);
+		Writer->WriteValue(TEXT("unit"), Result.Unit);
+		Writer->WriteValue(TEXT("total_ms"), Result.TotalSeconds * 1000.0);
+		Writer->WriteValue(TEXT("ns_per_op"), Result.GetNanosecondsPerOp());
+		if (Result.Unit == TEXT("pixel") && Result.GetNanosecondsPerOp() > 0.0)
+		{
+			Writer->WriteValue(TEXT("mpx_per_s"), 1000.0 / Result.GetNanosecondsPerOp());
+		}
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	Writer->WriteArrayStart(TEXT("equivalence"));
+	for (const FSterioEquivalenceResult& Check : Equivalence)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("name"), Check.Name);
+		Writer->WriteValue(TEXT("samples"), Check.Samples);
+		Writer->WriteValue(TEXT("max_abs_diff"), Check.MaxAbsDiff);
+		Writer->WriteValue(TEXT("max_rel_diff"), Check.MaxRelDiff);
+		Writer->WriteValue(TEXT("tolerance"), Check.Tolerance);
+		Writer->WriteValue(TEXT("passed"), Check.Passed());
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	return Json;
+}
+
+static void RunBenchmarkCommand(const TArray<FString>& Args, UWorld* World)
+{
+	int32 Iterations = 100000;
+	FString Label = FDateTime::Now().ToString();
+	bool bEmitLog = false;
+
+	int32 Positional = 0;
+	for (const FString& Arg : Args)
+	{
+		if (Arg == TEXT("-log"))
+		{
+			bEmitLog = true;
+		}
+		else if (Positional++ == 0)
+		{
+			Iterations = FCString::Atoi(*Arg);
+		}
+		else
+		{
+			Label = Arg;
+		}
+	}
+
+	FSterioBenchmark Benchmark(World, Iterations, bEmitLog);
+	const bool bPassed = Benchmark.Run();
+
+	const FString Path = FPaths::GameSavedDir() / TEXT("Sterio") / TEXT("Benchmarks") / (Label + TEXT(".json"));
+	if (FFileHelper::SaveStringToFile(Benchmark.ToJson(Label), *Path))
+	{
+		UE_LOG(LogSterioBenchmark, Display, TEXT("Benchmark %s written to %s"), bPassed ? TEXT("passed") : TEXT("FAILED"), *Path);
+	}
+	else
+	{
+		UE_LOG(LogSterioBenchmark, Error, TEXT("Could not write benchmark results to %s"), *Path);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SterioBenchCommand(
+	TEXT("Sterio.Bench"),
+	TEXT("Runs the stereo rig microbenchmarks. Usage: Sterio.Bench [Iterations] [Label] [-log]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunBenchmarkCommand));
@@ -0,0 +1,95 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+/** Timing of one benchmark case. */
+struct FSterioBenchmarkResult
+{
+	FString Name;
+	int32 Iterations;
+	/** Operations performed per iteration (frusta, matrices, lines...), see Unit. */
+	double OpsPerIteration;
+	FString Unit;
+	double TotalSeconds;
+
+	double GetNanosecondsPerOp() const
+	{
+		const double Ops = Iterations * OpsPerIteration;
+		return Ops > 0.0 ? TotalSeconds * 1.e9 / Ops : 0.0;
+	}
+};
+
+/** Worst deviation found when comparing an optimised path against its reference. */
+struct FSterioEquivalenceResult
+{
+	FString Name;
+	int32 Samples;
+	float MaxAbsDiff;
+	float MaxRelDiff;
+	float Tolerance;
+
+	bool Passed() const { return MaxRelDiff <= Tolerance; }
+};
+
+/**
+ * Microbenchmarks for the stereo projection and rig update path.
+ *
+ * Runs from the console (Sterio.Bench [Iterations] [Label] [-log]) so it works in a plain game build,
+ * including headless with -nullrhi -ExecCmds. Results are written as JSON to Saved/Sterio/Benchmarks.
+ */
+class FSterioBenchmark
+{
+public:
+	FSterioBenchmark(UWorld* InWorld, int32 InIterations, bool bInEmitLog);
+
+	/** Runs every case and the equivalence checks. Returns false if any check failed. */
+	bool Run();
+
+	/** Serializes the last run, tagged with Label. */
+	FString ToJson(const FString& Label) const;
+
+	const TArray<FSterioBenchmarkResult>& GetResults() const { return Results; }
+	const TArray<FSterioEquivalenceResult>& GetEquivalence() const { return Equivalence; }
+
+private:
+	void RunProjectionCases();
+	void RunUploadCases();
+	void RunLoggingCases();
+	void RunCullingCases();
+
+	/** Renders a live rig's first eye pair with and without its shared visibility pass, skipped without one. */
+	void RunCaptureCullingCases();
+
+	/** Times the world's rig manager updating 1 to 64 spawned rigs, skipped without a world that has begun play. */
+	void RunRigManagerCases();
+	void RunEquivalenceChecks();
+
+	/** Near and far must land on the NDC depth each depth mode promises. */
+	void RunDepthChecks();
+
+	/** Each screen shape through its specialised path and through the general one. */
+	void RunShapeCases();
+
+	/** Specialised shape paths against the general path, within SterioProjection::ShapeAgreementTolerance. */
+	void RunShapeChecks();
+
+	void RunPackingCases();
+
+	/** Every packing kernel against a per-pixel definition of each format, on odd-sized synthetic images. */
+	void RunPackingChecks();
+
+	/** Times Body(Count) after a short warm-up; Body is expected to loop Count times itself. */
+	template <typename BodyType>
+	void Measure(const TCHAR* Name, int32 Count, double OpsPerIteration, const TCHAR* Unit, BodyType Body);
+
+	UWorld* World;
+	int32 Iterations;
+	bool bEmitLog;
+
+	TArray<FSterioBenchmarkResult> Results;
+	TArray<FSterioEquivalenceResult> Equivalence;
+};
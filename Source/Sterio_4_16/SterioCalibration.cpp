@@ -0,0 +1,255 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioCalibration.h"
+#include "SterioCalibrationSolver.h"
+#include "Sterio_4_16Character.h"
+#include "Async/ParallelFor.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioCalibration, Log, All);
+
+namespace
+{
+	/**
+	 * Fewest samples a ParallelFor task sums; below this the task costs more to hand out than its sums. Above it
+	 * the samples are split over every worker.
+	 */
+	const int32 CalibrationMinSamplesPerTask = 64;
+
+	/** Splits the samples over tasks and reduces their sums in task order, so the result doesn't depend on scheduling. */
+	void AccumulateCalibrationParallel(const TArray<SterioCalibration::FSampleTerms>& Samples, const double T[SterioCalibration::NumTerms], bool bWithJacobian,
+		TArray<SterioCalibration::FSums>& TaskSums, SterioCalibration::FSums& OutSums)
+	{
+		// The calling thread takes a task too
+		const int32 NumWorkers = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+		const int32 NumTasks = SterioCalibration::GetNumTasks(Samples.Num(), NumWorkers, CalibrationMinSamplesPerTask);
+		const int32 SamplesPerTask = FMath::DivideAndRoundUp(Samples.Num(), NumTasks);
+		TaskSums.SetNumUninitialized(NumTasks);
+		ParallelFor(NumTasks, [&](int32 Task)
+		{
+			const int32 First = Task * SamplesPerTask;
+			const int32 Count = FMath::Min(SamplesPerTask, Samples.Num() - First);
+			SterioCalibration::Accumulate(Samples.GetData() + First, FMath::Max(0, Count), T, bWithJacobian, TaskSums[Task]);
+		}, NumTasks == 1);
+
+		OutSums.Reset();
+		for (const SterioCalibration::FSums& Sums : TaskSums)
+		{
+			OutSums.Add(Sums);
+		}
+	}
+}
+
+FString FSterioCalibrationProfile::GetPath(const FString& Name)
+{
+	if (Name.Contains(TEXT("/")) || Name.Contains(TEXT("\\")))
+	{
+		return Name;
+	}
+	return FPaths::GameSavedDir() / TEXT("Sterio") / TEXT("Calibration") / (Name + TEXT(".stcal"));
+}
+
+bool FSterioCalibrationProfile::Save(const FString& Name) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+
+	uint32 FileMagic = Magic;
+	uint32 FileVersion = Version;
+	float Terms[] = { M00, M11, M03, M13 };
+	float Rms = RmsAfter;
+	int32 Samples = NumSamples;
+	int64 Ticks = Created.GetTicks();
+	Writer << FileMagic << FileVersion;
+	for (float& Term : Terms)
+	{
+		Writer << Term;
+	}
+	Writer << Rms << Samples << Ticks;
+
+	const FString Path = GetPath(Name);
+	if (!FFileHelper::SaveArrayToFile(Bytes, *Path))
+	{
+		UE_LOG(LogSterioCalibration, Error, TEXT("Could not write calibration profile %s"), *Path);
+		return false;
+	}
+	return true;
+}
+
+bool FSterioCalibrationProfile::Load(const FString& Name)
+{
+	const FString Path = GetPath(Name);
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path))
+	{
+		UE_LOG(LogSterioCalibration, Warning, TEXT("Calibration profile %s not found"), *Path);
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+	Reader << FileMagic << FileVersion;
+	if (FileMagic != Magic || FileVersion != Version)
+	{
+		UE_LOG(LogSterioCalibration, Error, TEXT("%s is not a version %d calibration profile"), *Path, (int32)Version);
+		return false;
+	}
+
+	int64 Ticks = 0;
+	Reader << M00 << M11 << M03 << M13 << RmsAfter << NumSamples << Ticks;
+	if (Reader.IsError())
+	{
+		UE_LOG(LogSterioCalibration, Error, TEXT("Calibration profile %s is truncated"), *Path);
+		return false;
+	}
+	Created = FDateTime(Ticks);
+	return true;
+}
+
+bool FSterioCalibration::LoadSamples(const FString& Path, TArray<FSterioCalibrationSample>& OutSamples, FString& OutError)
+{
+	OutSamples.Reset();
+
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadANSITextFileToStrings(*Path, nullptr, Lines))
+	{
+		OutError = FString::Printf(TEXT("could not read %s"), *Path);
+		return false;
+	}
+
+	for (int32 LineIndex = 0; LineIndex < Lines.Num(); ++LineIndex)
+	{
+		const FString Line = Lines[LineIndex].Trim().TrimTrailing();
+		if (Line.IsEmpty() || Line.StartsWith(TEXT("#")))
+		{
+			continue;
+		}
+
+		TArray<FString> Fields;
+		Line.ParseIntoArray(Fields, TEXT(","), false);
+		if (Fields.Num() != 10)
+		{
+			OutError = FString::Printf(TEXT("%s:%d: expected 10 fields, found %d"), *Path, LineIndex + 1, Fields.Num());
+			return false;
+		}
+
+		float Values[10];
+		for (int32 Field = 0; Field < 10; ++Field)
+		{
+			const FString Value = Fields[Field].Trim().TrimTrailing();
+			if (!Value.IsNumeric())
+			{
+				OutError = FString::Printf(TEXT("%s:%d: '%s' is not a number"), *Path, LineIndex + 1, *Value);
+				return false;
+			}
+			Values[Field] = FCString::Atof(*Value);
+		}
+
+		FSterioCalibrationSample Sample;
+		Sample.Screen = (int32)Values[0];
+		Sample.Eye = (int32)Values[1];
+		Sample.EyePosition = FVector(Values[2], Values[3], Values[4]);
+		Sample.Target = FVector(Values[5], Values[6], Values[7]);
+		Sample.Observed = FVector2D(Values[8], Values[9]);
+		OutSamples.Add(Sample);
+	}
+
+	if (OutSamples.Num() == 0)
+	{
+		OutError = FString::Printf(TEXT("%s holds no samples"), *Path);
+		return false;
+	}
+	return true;
+}
+
+FSterioCalibrationFit FSterioCalibration::Solve(const TArray<SterioProjection::FScreenBasis>& Bases, const SterioProjection::FFrustumParams& Params,
+	const SterioProjection::EFlavor EyeFlavors[2], const TArray<FSterioCalibrationSample>& Samples)
+{
+	TArray<SterioCalibration::FSampleTerms> Terms;
+	Terms.Reserve(Samples.Num());
+	for (const FSterioCalibrationSample& Sample : Samples)
+	{
+		if (!Bases.IsValidIndex(Sample.Screen) || Sample.Eye < 0 || Sample.Eye > 1)
+		{
+			continue;
+		}
+
+		SterioCalibration::FSampleTerms S;
+		if (SterioCalibration::MakeSampleTerms(Bases[Sample.Screen], SterioProjection::MakeVec3(Sample.EyePosition.X, Sample.EyePosition.Y, Sample.EyePosition.Z),
+			SterioProjection::MakeVec3(Sample.Target.X, Sample.Target.Y, Sample.Target.Z), Sample.Observed.X, Sample.Observed.Y, EyeFlavors[Sample.Eye], Params, S))
+		{
+			Terms.Add(S);
+		}
+	}
+
+	FSterioCalibrationFit Fit;
+	Fit.M00 = Params.Tuning.M00;
+	Fit.M11 = Params.Tuning.M11;
+	Fit.M03 = Params.Tuning.M03;
+	Fit.M13 = Params.Tuning.M13;
+	Fit.NumSamples = Terms.Num();
+	Fit.Iterations = 0;
+	Fit.bConverged = false;
+	Fit.RmsBefore = Fit.RmsAfter = 0.f;
+	if (Terms.Num() == 0)
+	{
+		return Fit;
+	}
+
+	const double Initial[SterioCalibration::NumTerms] = { Fit.M00, Fit.M11, Fit.M03, Fit.M13 };
+	TArray<SterioCalibration::FSums> TaskSums;
+	const SterioCalibration::FResult Result = SterioCalibration::Fit(Initial, [&](const double* T, bool bWithJacobian, SterioCalibration::FSums& OutSums)
+	{
+		AccumulateCalibrationParallel(Terms, T, bWithJacobian, TaskSums, OutSums);
+	});
+
+	Fit.M00 = (float)Result.Terms[0];
+	Fit.M11 = (float)Result.Terms[1];
+	Fit.M03 = (float)Result.Terms[2];
+	Fit.M13 = (float)Result.Terms[3];
+	Fit.Iterations = Result.Iterations;
+	Fit.bConverged = Result.bConverged;
+	Fit.RmsBefore = (float)FMath::Sqrt(Result.SquaredErrorBefore / Terms.Num());
+	Fit.RmsAfter = (float)FMath::Sqrt(Result.SquaredErrorAfter / Terms.Num());
+	return Fit;
+}
+
+static void RunCalibrateCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (Args.Num() < 1)
+	{
+		UE_LOG(LogSterioCalibration, Error, TEXT("Usage: Sterio.Calibrate SamplesFile [ProfileName]"));
+		return;
+	}
+
+	ASterio_4_16Character* Rig = nullptr;
+	if (World)
+	{
+		for (TActorIterator<ASterio_4_16Character> It(World); It; ++It)
+		{
+			Rig = *It;
+			break;
+		}
+	}
+	if (!Rig)
+	{
+		UE_LOG(LogSterioCalibration, Error, TEXT("Sterio.Calibrate needs a stereo rig in the world"));
+		return;
+	}
+
+	const FString ProfileName = Args.Num() > 1 ? Args[1] : FPaths::GetBaseFilename(Args[0]);
+	float RmsBefore = 0.f;
+	float RmsAfter = 0.f;
+	Rig->CalibrateFromFile(Args[0], ProfileName, RmsBefore, RmsAfter);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SterioCalibrateCommand(
+	TEXT("Sterio.Calibrate"),
+	TEXT("Fits the projection tuning of the rig to measured correspondences, applies it and saves it as a calibration profile. Usage: Sterio.Calibrate SamplesFile [ProfileName]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunCalibrateCommand));
@@ -0,0 +1,87 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SterioProjectionKernel.h"
+
+/**
+ * One measured correspondence: with the viewer's eye at EyePosition, the rig drew Target on the given screen
+ * and the image was observed at Observed. Positions are in screen space, in the rig's LeftEye/RightEye convention;
+ * Observed is in cm from the screen's lower-left corner, along its bottom and left edges.
+ */
+struct FSterioCalibrationSample
+{
+	int32 Screen;
+	/** 0 left, 1 right: which eye's projection drew the target */
+	int32 Eye;
+	FVector EyePosition;
+	FVector Target;
+	FVector2D Observed;
+};
+
+/** Tuning terms fitted to a set of samples, and how well the images line up before and after. */
+struct FSterioCalibrationFit
+{
+	float M00;
+	float M11;
+	float M03;
+	float M13;
+
+	/** Root mean square distance on the screen between drawn and observed points, in cm */
+	float RmsBefore;
+	float RmsAfter;
+
+	int32 NumSamples;
+	int32 Iterations;
+	bool bConverged;
+};
+
+/**
+ * Per-installation calibration, as stored on disk and loaded by the rig on BeginPlay.
+ * A few dozen bytes: the fitted terms and enough context to tell which fit produced them.
+ */
+struct FSterioCalibrationProfile
+{
+	enum { Magic = 0x4C414353, Version = 1 };
+
+	float M00 = 1.f;
+	float M11 = 1.f;
+	float M03 = 0.f;
+	float M13 = 0.f;
+	float RmsAfter = 0.f;
+	int32 NumSamples = 0;
+	FDateTime Created;
+
+	/** Saved/Sterio/Calibration/<Name>.stcal, unless Name already is a path. */
+	static FString GetPath(const FString& Name);
+
+	bool Save(const FString& Name) const;
+	bool Load(const FString& Name);
+};
+
+/**
+ * Fits the M_x_y tuning terms of a rig to measured correspondences.
+ *
+ * The model is the rig's own projection: every sample is projected through the kernel with the eye's flavor
+ * and the candidate terms, and the distance to the observed point is minimised with Levenberg-Marquardt.
+ * The normal equations are accumulated over the samples with ParallelFor; the fit itself is in
+ * SterioCalibrationSolver.h, which the standalone CalibrationTest checks against synthetic samples.
+ */
+class FSterioCalibration
+{
+public:
+	/**
+	 * Reads samples from a CSV file with one sample per line:
+	 *   screen, eye, eye_x, eye_y, eye_z, target_x, target_y, target_z, observed_x, observed_y
+	 * Empty lines and lines starting with # are skipped.
+	 */
+	static bool LoadSamples(const FString& Path, TArray<FSterioCalibrationSample>& OutSamples, FString& OutError);
+
+	/**
+	 * Fits the terms, starting from the ones in Params. Samples on screens beyond Bases, or whose target is
+	 * not in front of the eye, are ignored.
+	 */
+	static FSterioCalibrationFit Solve(const TArray<SterioProjection::FScreenBasis>& Bases, const SterioProjection::FFrustumParams& Params,
+		const SterioProjection::EFlavor EyeFlavors[2], const TArray<FSterioCalibrationSample>& Samples);
+};
@@ -0,0 +1,289 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+// The Levenberg-Marquardt fit behind FSterioCalibration::Solve.
+//
+// Like SterioProjectionKernel.h this header has no engine dependency, so the fit can be checked against synthetic
+// samples outside the engine. How the sums over the samples are accumulated is up to the caller: the rig spreads
+// them over ParallelFor tasks, the standalone test adds them up in one go.
+
+#include "SterioProjectionKernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace SterioCalibration
+{
+	/** The fitted terms, in the order of the normal equations: M00, M11, M03, M13 */
+	enum { NumTerms = 4 };
+
+	/**
+	 * Everything about a sample that doesn't depend on the fitted terms. With the terms T, the rig draws the target at
+	 *   ClipX = ViewX * ScaleX * T.M00 + ViewZ * OffsetX
+	 *   ClipY = ViewY * ScaleY * T.M11 + ViewZ * OffsetY
+	 *   ClipW = ViewZ + ViewX * T.M03 + ViewY * T.M13
+	 * in NDC, which maps to the screen through HalfWidth and HalfHeight.
+	 */
+	struct FSampleTerms
+	{
+		double ViewX, ViewY, ViewZ;
+		double ScaleX, ScaleY, OffsetX, OffsetY;
+		double HalfWidth, HalfHeight;
+		double ObservedX, ObservedY;
+	};
+
+	/**
+	 * Prepares one sample: the target drawn for Eye through the screen, observed at ObservedX, ObservedY cm from the
+	 * screen's lower-left corner. Returns false if the target is not in front of the eye. Params' tuning is ignored.
+	 */
+	inline bool MakeSampleTerms(const SterioProjection::FScreenBasis& Basis, const SterioProjection::FVec3& Eye, const SterioProjection::FVec3& Target,
+		double ObservedX, double ObservedY, SterioProjection::EFlavor Flavor, const SterioProjection::FFrustumParams& Params, FSampleTerms& Out)
+	{
+		using namespace SterioProjection;
+
+		const FVec3 ToTarget = Sub(Target, Eye);
+		Out.ViewX = Dot(Basis.Vr, ToTarget);
+		Out.ViewY = Dot(Basis.Vu, ToTarget);
+		Out.ViewZ = -Dot(Basis.Vn, ToTarget);
+		if (Out.ViewZ <= 0.0)
+		{
+			return false;
+		}
+
+		// Projection without tuning gives the term-independent part
+		FFrustumParams Untuned = Params;
+		Untuned.Tuning.M00 = 1.f;
+		Untuned.Tuning.M11 = 1.f;
+		Untuned.Tuning.M03 = 0.f;
+		Untuned.Tuning.M13 = 0.f;
+		const FMatrix44 Projection = ComputeProjection(Basis, Eye, Flavor, Untuned);
+		Out.ScaleX = Projection.M[0][0];
+		Out.ScaleY = Projection.M[1][1];
+		Out.OffsetX = Projection.M[2][0];
+		Out.OffsetY = Projection.M[2][1];
+
+		const FVec3 Bottom = Sub(Basis.Pb, Basis.Pa);
+		const FVec3 Left = Sub(Basis.Pc, Basis.Pa);
+		Out.HalfWidth = 0.5 * std::sqrt((double)Dot(Bottom, Bottom));
+		Out.HalfHeight = 0.5 * std::sqrt((double)Dot(Left, Left));
+		Out.ObservedX = ObservedX / Out.HalfWidth - 1.0;
+		Out.ObservedY = ObservedY / Out.HalfHeight - 1.0;
+		return true;
+	}
+
+	/** Normal equations and squared error summed over a range of samples */
+	struct FSums
+	{
+		double JtJ[NumTerms][NumTerms];
+		double JtR[NumTerms];
+		double SquaredError;
+
+		void Reset()
+		{
+			std::memset(this, 0, sizeof(*this));
+		}
+
+		void Add(const FSums& Other)
+		{
+			for (int32_t Row = 0; Row < NumTerms; ++Row)
+			{
+				for (int32_t Col = 0; Col < NumTerms; ++Col)
+				{
+					JtJ[Row][Col] += Other.JtJ[Row][Col];
+				}
+				JtR[Row] += Other.JtR[Row];
+			}
+			SquaredError += Other.SquaredError;
+		}
+	};
+
+	inline void Accumulate(const FSampleTerms* Samples, int32_t Count, const double T[NumTerms], bool bWithJacobian, FSums& Sums)
+	{
+		Sums.Reset();
+		for (int32_t Index = 0; Index < Count; ++Index)
+		{
+			const FSampleTerms& S = Samples[Index];
+			const double ClipX = S.ViewX * S.ScaleX * T[0] + S.ViewZ * S.OffsetX;
+			const double ClipY = S.ViewY * S.ScaleY * T[1] + S.ViewZ * S.OffsetY;
+			const double ClipW = S.ViewZ + S.ViewX * T[2] + S.ViewY * T[3];
+			const double InvW = 1.0 / ClipW;
+
+			// Residuals in cm on the screen
+			const double ResidualX = (ClipX * InvW - S.ObservedX) * S.HalfWidth;
+			const double ResidualY = (ClipY * InvW - S.ObservedY) * S.HalfHeight;
+			Sums.SquaredError += ResidualX * ResidualX + ResidualY * ResidualY;
+
+			if (bWithJacobian)
+			{
+				const double InvW2 = InvW * InvW;
+				const double Jx[NumTerms] =
+				{
+					S.ViewX * S.ScaleX * InvW * S.HalfWidth,
+					0.0,
+					-ClipX * S.ViewX * InvW2 * S.HalfWidth,
+					-ClipX * S.ViewY * InvW2 * S.HalfWidth,
+				};
+				const double Jy[NumTerms] =
+				{
+					0.0,
+					S.ViewY * S.ScaleY * InvW * S.HalfHeight,
+					-ClipY * S.ViewX * InvW2 * S.HalfHeight,
+					-ClipY * S.ViewY * InvW2 * S.HalfHeight,
+				};
+				for (int32_t Row = 0; Row < NumTerms; ++Row)
+				{
+					for (int32_t Col = 0; Col < NumTerms; ++Col)
+					{
+						Sums.JtJ[Row][Col] += Jx[Row] * Jx[Col] + Jy[Row] * Jy[Col];
+					}
+					Sums.JtR[Row] += Jx[Row] * ResidualX + Jy[Row] * ResidualY;
+				}
+			}
+		}
+	}
+
+	/**
+	 * How many tasks to split NumSamples over: one per worker, but none with fewer than MinSamplesPerTask samples,
+	 * below which handing the task out costs more than the sums.
+	 */
+	inline int32_t GetNumTasks(int32_t NumSamples, int32_t NumWorkers, int32_t MinSamplesPerTask)
+	{
+		const int32_t BySamples = NumSamples / std::max(MinSamplesPerTask, 1);
+		return std::max(1, std::min(BySamples, NumWorkers));
+	}
+
+	/** Solves A x = B by Gaussian elimination with partial pivoting. Returns false if A is singular. */
+	inline bool SolveSystem(double A[NumTerms][NumTerms], double B[NumTerms], double X[NumTerms])
+	{
+		for (int32_t Col = 0; Col < NumTerms; ++Col)
+		{
+			int32_t Pivot = Col;
+			for (int32_t Row = Col + 1; Row < NumTerms; ++Row)
+			{
+				if (std::fabs(A[Row][Col]) > std::fabs(A[Pivot][Col]))
+				{
+					Pivot = Row;
+				}
+			}
+			if (std::fabs(A[Pivot][Col]) < 1.e-30)
+			{
+				return false;
+			}
+			if (Pivot != Col)
+			{
+				for (int32_t Index = 0; Index < NumTerms; ++Index)
+				{
+					std::swap(A[Col][Index], A[Pivot][Index]);
+				}
+				std::swap(B[Col], B[Pivot]);
+			}
+
+			for (int32_t Row = 0; Row < NumTerms; ++Row)
+			{
+				if (Row != Col)
+				{
+					const double Factor = A[Row][Col] / A[Col][Col];
+					for (int32_t Index = Col; Index < NumTerms; ++Index)
+					{
+						A[Row][Index] -= Factor * A[Col][Index];
+					}
+					B[Row] -= Factor * B[Col];
+				}
+			}
+		}
+
+		for (int32_t Row = 0; Row < NumTerms; ++Row)
+		{
+			X[Row] = B[Row] / A[Row][Row];
+		}
+		return true;
+	}
+
+	struct FResult
+	{
+		double Terms[NumTerms];
+		/** Summed squared distances on the screen, in cm², with the initial and the fitted terms */
+		double SquaredErrorBefore;
+		double SquaredErrorAfter;
+		int32_t Iterations;
+		bool bConverged;
+	};
+
+	/**
+	 * Fits the terms starting from Initial. AccumulateAll(T, bWithJacobian, Sums) fills Sums over every sample
+	 * for the terms T, see Accumulate; it has to sum in the same order every time for the fit to be repeatable.
+	 */
+	template<typename AccumulateType>
+	FResult Fit(const double Initial[NumTerms], AccumulateType AccumulateAll, int32_t MaxIterations = 100)
+	{
+		FResult Result;
+		std::memcpy(Result.Terms, Initial, sizeof(Result.Terms));
+		Result.Iterations = 0;
+		Result.bConverged = false;
+
+		double* T = Result.Terms;
+		FSums Sums, Trial;
+		AccumulateAll(T, true, Sums);
+		Result.SquaredErrorBefore = Sums.SquaredError;
+
+		// Gauss-Newton steps, damped towards gradient descent while they don't pay off
+		double Lambda = 1.e-3;
+		for (; Result.Iterations < MaxIterations; ++Result.Iterations)
+		{
+			double A[NumTerms][NumTerms];
+			double B[NumTerms];
+			double Step[NumTerms];
+			for (int32_t Row = 0; Row < NumTerms; ++Row)
+			{
+				for (int32_t Col = 0; Col < NumTerms; ++Col)
+				{
+					A[Row][Col] = Sums.JtJ[Row][Col];
+				}
+				// The small constant keeps terms the samples don't constrain (e.g. M11 with no vertical spread) where they are
+				A[Row][Row] += Lambda * Sums.JtJ[Row][Row] + 1.e-12;
+				B[Row] = -Sums.JtR[Row];
+			}
+			if (!SolveSystem(A, B, Step))
+			{
+				break;
+			}
+
+			double Candidate[NumTerms];
+			double StepNorm = 0.0;
+			for (int32_t Term = 0; Term < NumTerms; ++Term)
+			{
+				Candidate[Term] = T[Term] + Step[Term];
+				StepNorm += Step[Term] * Step[Term];
+			}
+
+			AccumulateAll(Candidate, false, Trial);
+			if (Trial.SquaredError < Sums.SquaredError)
+			{
+				std::memcpy(T, Candidate, sizeof(Candidate));
+				Lambda = std::max(Lambda * 0.1, 1.e-9);
+				AccumulateAll(T, true, Sums);
+				if (std::sqrt(StepNorm) < 1.e-9)
+				{
+					Result.bConverged = true;
+					break;
+				}
+			}
+			else
+			{
+				Lambda *= 10.0;
+				if (Lambda > 1.e9)
+				{
+					// No step improves on the current terms any more
+					Result.bConverged = true;
+					break;
+				}
+			}
+		}
+
+		Result.SquaredErrorAfter = Sums.SquaredError;
+		return Result;
+	}
+}
@@ -0,0 +1,422 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioCaptureQuality.h"
+#include "Sterio_4_16Character.h"
+#include "SterioDynamicResolution.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RHI.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioCaptureQuality, Log, All);
+
+namespace
+{
+	/** Savings below this are within the noise of the frame timings and never make it into a recommendation */
+	const float CaptureQualityNoiseMs = 0.05f;
+
+	float CaptureQualityMedian(TArray<float>& Samples)
+	{
+		if (Samples.Num() == 0)
+		{
+			return 0.f;
+		}
+		Samples.Sort();
+		return Samples[Samples.Num() / 2];
+	}
+
+	FSterioCaptureQualityProfile MakeBuiltInCaptureQuality(const TCHAR* Name, const TCHAR* const* Flags, int32 NumFlags, float LODDistanceFactor)
+	{
+		FSterioCaptureQualityProfile Profile;
+		Profile.Name = Name;
+		for (int32 Index = 0; Index < NumFlags; ++Index)
+		{
+			Profile.DisabledShowFlags.Add(Flags[Index]);
+		}
+		Profile.LODDistanceFactor = LODDistanceFactor;
+		return Profile;
+	}
+}
+
+const TArray<FSterioCaptureQualityProfile>& FSterioCaptureQuality::GetBuiltInProfiles()
+{
+	static TArray<FSterioCaptureQualityProfile> Profiles;
+	if (Profiles.Num() == 0)
+	{
+		// Camera effects that only make sense for a lens, not for a projected image
+		static const TCHAR* const ProjectorFlags[] =
+		{
+			TEXT("MotionBlur"), TEXT("LensFlares"), TEXT("Bloom"), TEXT("EyeAdaptation"), TEXT("DepthOfField"),
+			TEXT("Vignette"), TEXT("Grain"), TEXT("ScreenSpaceReflections"), TEXT("AmbientOcclusion"),
+		};
+		static const TCHAR* const MinimalFlags[] =
+		{
+			TEXT("MotionBlur"), TEXT("LensFlares"), TEXT("Bloom"), TEXT("EyeAdaptation"), TEXT("DepthOfField"),
+			TEXT("Vignette"), TEXT("Grain"), TEXT("ScreenSpaceReflections"), TEXT("AmbientOcclusion"),
+			TEXT("DynamicShadows"), TEXT("DistanceFieldAO"), TEXT("Fog"), TEXT("AtmosphericFog"), TEXT("VolumetricFog"),
+			TEXT("Particles"), TEXT("Decals"),
+		};
+
+		Profiles.Add(MakeBuiltInCaptureQuality(TEXT("Full"), nullptr, 0, 1.f));
+		Profiles.Add(MakeBuiltInCaptureQuality(TEXT("Projector"), ProjectorFlags, ARRAY_COUNT(ProjectorFlags), 1.f));
+		Profiles.Add(MakeBuiltInCaptureQuality(TEXT("Minimal"), MinimalFlags, ARRAY_COUNT(MinimalFlags), 2.f));
+	}
+	return Profiles;
+}
+
+const FSterioCaptureQualityProfile* FSterioCaptureQuality::FindProfile(FName Name, const TArray<FSterioCaptureQualityProfile>& Profiles)
+{
+	for (const FSterioCaptureQualityProfile& Profile : Profiles)
+	{
+		if (Profile.Name == Name)
+		{
+			return &Profile;
+		}
+	}
+	for (const FSterioCaptureQualityProfile& Profile : GetBuiltInProfiles())
+	{
+		if (Profile.Name == Name)
+		{
+			return &Profile;
+		}
+	}
+	return nullptr;
+}
+
+int32 FSterioCaptureQuality::FindShowFlag(const FString& Name)
+{
+	return FEngineShowFlags::FindIndexByName(*Name);
+}
+
+void FSterioCaptureQuality::Apply(const FSterioCaptureQualityProfile& Profile, const TArray<USceneCaptureComponent2D*>& Captures)
+{
+	TArray<int32, TInlineAllocator<32>> FlagIndices;
+	for (const FString& Flag : Profile.DisabledShowFlags)
+	{
+		const int32 Index = FindShowFlag(Flag);
+		if (Index == INDEX_NONE)
+		{
+			UE_LOG(LogSterioCaptureQuality, Warning, TEXT("Capture quality %s turns off unknown show flag %s"), *Profile.Name.ToString(), *Flag);
+			continue;
+		}
+		FlagIndices.Add(Index);
+	}
+
+	for (USceneCaptureComponent2D* Capture : Captures)
+	{
+		if (!Capture)
+		{
+			continue;
+		}
+
+		const FBaseline* Baseline = Baselines.FindByPredicate([Capture](const FBaseline& Candidate) { return Candidate.Capture == Capture; });
+		if (!Baseline)
+		{
+			Baseline = &Baselines[Baselines.Add(FBaseline{ Capture, Capture->ShowFlags, Capture->PostProcessSettings, Capture->PostProcessBlendWeight, Capture->LODDistanceFactor })];
+		}
+
+		Capture->ShowFlags = Baseline->ShowFlags;
+		for (int32 Index : FlagIndices)
+		{
+			Capture->ShowFlags.SetSingleFlag(Index, false);
+		}
+
+		Capture->PostProcessSettings = Profile.bOverridePostProcess ? Profile.PostProcessSettings : Baseline->PostProcessSettings;
+		Capture->PostProcessBlendWeight = Profile.bOverridePostProcess ? Profile.PostProcessBlendWeight : Baseline->PostProcessBlendWeight;
+		Capture->LODDistanceFactor = Baseline->LODDistanceFactor * Profile.LODDistanceFactor;
+	}
+
+	ActiveProfile = Profile;
+}
+
+void FSterioCaptureQuality::Restore(const TArray<USceneCaptureComponent2D*>& Captures)
+{
+	for (USceneCaptureComponent2D* Capture : Captures)
+	{
+		const FBaseline* Baseline = Baselines.FindByPredicate([Capture](const FBaseline& Candidate) { return Candidate.Capture == Capture; });
+		if (Capture && Baseline)
+		{
+			Capture->ShowFlags = Baseline->ShowFlags;
+			Capture->PostProcessSettings = Baseline->PostProcessSettings;
+			Capture->PostProcessBlendWeight = Baseline->PostProcessBlendWeight;
+			Capture->LODDistanceFactor = Baseline->LODDistanceFactor;
+		}
+	}
+	Baselines.Reset();
+}
+
+float FSterioCaptureQuality::GetLODDistanceFactor(const USceneCaptureComponent2D* Capture) const
+{
+	const FBaseline* Baseline = Baselines.FindByPredicate([Capture](const FBaseline& Candidate) { return Candidate.Capture == Capture; });
+	return Baseline ? Baseline->LODDistanceFactor * ActiveProfile.LODDistanceFactor : Capture->LODDistanceFactor;
+}
+
+float FSterioCaptureQuality::GetViewDistance(float DepthModeDistance) const
+{
+	if (ActiveProfile.MaxViewDistance <= 0.f)
+	{
+		return DepthModeDistance;
+	}
+	return (DepthModeDistance < 0.f) ? ActiveProfile.MaxViewDistance : FMath::Min(DepthModeDistance, ActiveProfile.MaxViewDistance);
+}
+
+const TArray<FString>& FSterioCaptureQualityTuner::GetDefaultCandidates()
+{
+	static TArray<FString> Candidates;
+	if (Candidates.Num() == 0)
+	{
+		static const TCHAR* const Flags[] =
+		{
+			TEXT("PostProcessing"), TEXT("DynamicShadows"), TEXT("AmbientOcclusion"), TEXT("DistanceFieldAO"),
+			TEXT("ScreenSpaceReflections"), TEXT("ReflectionEnvironment"), TEXT("MotionBlur"), TEXT("Bloom"),
+			TEXT("LensFlares"), TEXT("EyeAdaptation"), TEXT("DepthOfField"), TEXT("AntiAliasing"), TEXT("Fog"),
+			TEXT("AtmosphericFog"), TEXT("VolumetricFog"), TEXT("SkyLighting"), TEXT("Translucency"), TEXT("Particles"),
+			TEXT("Decals"),
+		};
+		for (const TCHAR* Flag : Flags)
+		{
+			Candidates.Add(Flag);
+		}
+	}
+	return Candidates;
+}
+
+void FSterioCaptureQualityTuner::Start(const FSterioCaptureQualityProfile& InStartProfile, float InTargetFrameTimeMs, int32 InMeasureFrames, int32 InWarmupFrames,
+	const TArray<FString>& InCandidates)
+{
+	StartProfile = InStartProfile;
+	TargetFrameTimeMs = InTargetFrameTimeMs;
+	MeasureFrames = FMath::Max(1, InMeasureFrames);
+	WarmupFrames = FMath::Max(0, InWarmupFrames);
+
+	// Flags that are off already, or that this engine doesn't have, can't save anything
+	Candidates.Reset();
+	for (const FString& Flag : (InCandidates.Num() > 0) ? InCandidates : GetDefaultCandidates())
+	{
+		if (!StartProfile.DisabledShowFlags.Contains(Flag) && FSterioCaptureQuality::FindShowFlag(Flag) != INDEX_NONE)
+		{
+			Candidates.AddUnique(Flag);
+		}
+	}
+
+	Steps.Reset();
+	Steps.AddZeroed(Candidates.Num() + 2);
+	for (int32 Index = 0; Index < Candidates.Num(); ++Index)
+	{
+		Steps[Index + 1].ShowFlag = Candidates[Index];
+	}
+
+	Recommendation = StartProfile;
+	EstimatedFrameTimeMs = 0.f;
+	StepIndex = 0;
+	StepFrame = 0;
+	FrameSamples.Reset();
+	RenderSamples.Reset();
+	bRunning = true;
+}
+
+bool FSterioCaptureQualityTuner::Tick(FSterioCaptureQualityProfile& OutProfile)
+{
+	if (!bRunning)
+	{
+		return false;
+	}
+
+	if (++StepFrame <= WarmupFrames)
+	{
+		return false;
+	}
+
+	FrameSamples.Add(FSterioResolutionController::SampleFrameTimeMs());
+	RenderSamples.Add((float)FPlatformTime::ToMilliseconds(FMath::Max(GRenderThreadTime, RHIGetGPUFrameCycles())));
+	if (FrameSamples.Num() < MeasureFrames)
+	{
+		return false;
+	}
+
+	FSterioCaptureQualityStep& Step = Steps[StepIndex];
+	Step.FrameTimeMs = CaptureQualityMedian(FrameSamples);
+	Step.RenderTimeMs = CaptureQualityMedian(RenderSamples);
+	Step.SavingMs = Steps[0].FrameTimeMs - Step.FrameTimeMs;
+	FrameSamples.Reset();
+	RenderSamples.Reset();
+	StepFrame = 0;
+
+	++StepIndex;
+	if (StepIndex == Steps.Num() - 1)
+	{
+		Recommend();
+	}
+	if (StepIndex == Steps.Num())
+	{
+		bRunning = false;
+		OutProfile = StartProfile;
+		return true;
+	}
+
+	OutProfile = MakeStepProfile(StepIndex);
+	return true;
+}
+
+FSterioCaptureQualityProfile FSterioCaptureQualityTuner::MakeStepProfile(int32 Index) const
+{
+	if (Index == Steps.Num() - 1)
+	{
+		return Recommendation;
+	}
+
+	FSterioCaptureQualityProfile Profile = StartProfile;
+	if (Index > 0)
+	{
+		Profile.DisabledShowFlags.Add(Steps[Index].ShowFlag);
+	}
+	return Profile;
+}
+
+void FSterioCaptureQualityTuner::Recommend()
+{
+	TArray<FSterioCaptureQualityStep> Ranked = GetReport();
+
+	Recommendation = StartProfile;
+	Recommendation.Name = TEXT("Tuned");
+	EstimatedFrameTimeMs = Steps[0].FrameTimeMs;
+	for (const FSterioCaptureQualityStep& Step : Ranked)
+	{
+		if (EstimatedFrameTimeMs <= TargetFrameTimeMs)
+		{
+			break;
+		}
+		if (!Step.ShowFlag.IsEmpty() && Step.SavingMs > CaptureQualityNoiseMs)
+		{
+			Recommendation.DisabledShowFlags.Add(Step.ShowFlag);
+			EstimatedFrameTimeMs -= Step.SavingMs;
+		}
+	}
+}
+
+TArray<FSterioCaptureQualityStep> FSterioCaptureQualityTuner::GetReport() const
+{
+	TArray<FSterioCaptureQualityStep> Report;
+	if (Steps.Num() < 2)
+	{
+		return Report;
+	}
+
+	Report.Append(&Steps[1], Steps.Num() - 2);
+	Report.Sort([](const FSterioCaptureQualityStep& A, const FSterioCaptureQualityStep& B) { return A.SavingMs > B.SavingMs; });
+	Report.Insert(Steps[0], 0);
+	Report.Add(Steps.Last());
+	return Report;
+}
+
+void FSterioCaptureQualityTuner::LogReport() const
+{
+	const TArray<FSterioCaptureQualityStep> Report = GetReport();
+	if (Report.Num() == 0)
+	{
+		return;
+	}
+
+	UE_LOG(LogSterioCaptureQuality, Display, TEXT("%-24s %10s %10s %10s"), TEXT("Turned off"), TEXT("Frame ms"), TEXT("Render ms"), TEXT("Saving ms"));
+	for (int32 Index = 0; Index < Report.Num(); ++Index)
+	{
+		const FSterioCaptureQualityStep& Step = Report[Index];
+		const FString Label = (Index == 0) ? FString::Printf(TEXT("(%s)"), *StartProfile.Name.ToString())
+			: (Index == Report.Num() - 1) ? FString::Printf(TEXT("(%s)"), *Recommendation.Name.ToString())
+			: Step.ShowFlag;
+		UE_LOG(LogSterioCaptureQuality, Display, TEXT("%-24s %10.3f %10.3f %10.3f"), *Label, Step.FrameTimeMs, Step.RenderTimeMs, Step.SavingMs);
+	}
+
+	const int32 NumAdded = Recommendation.DisabledShowFlags.Num() - StartProfile.DisabledShowFlags.Num();
+	const FString Added = FString::Join(TArray<FString>(Recommendation.DisabledShowFlags.GetData() + StartProfile.DisabledShowFlags.Num(), NumAdded), TEXT(", "));
+	UE_LOG(LogSterioCaptureQuality, Display, TEXT("Recommended %s turns off %s: estimated %.3f ms, measured %.3f ms, target %.3f ms"),
+		*Recommendation.Name.ToString(), NumAdded > 0 ? *Added : TEXT("nothing more"), EstimatedFrameTimeMs, Report.Last().FrameTimeMs, TargetFrameTimeMs);
+	if (Report.Last().FrameTimeMs > TargetFrameTimeMs)
+	{
+		UE_LOG(LogSterioCaptureQuality, Warning, TEXT("The recommendation still misses the %.3f ms target; the remaining cost is not in the captures' show flags"), TargetFrameTimeMs);
+	}
+}
+
+bool FSterioCaptureQualityTuner::SaveReport(const FString& Path) const
+{
+	FString Csv = TEXT("turned_off,frame_ms,render_ms,saving_ms\n");
+	const TArray<FSterioCaptureQualityStep> Report = GetReport();
+	for (int32 Index = 0; Index < Report.Num(); ++Index)
+	{
+		const FSterioCaptureQualityStep& Step = Report[Index];
+		const FString Label = (Index == 0) ? TEXT("start") : (Index == Report.Num() - 1) ? TEXT("recommended") : Step.ShowFlag;
+		Csv += FString::Printf(TEXT("%s,%.4f,%.4f,%.4f\n"), *Label, Step.FrameTimeMs, Step.RenderTimeMs, Step.SavingMs);
+	}
+	return FFileHelper::SaveStringToFile(Csv, *Path);
+}
+
+static void ForEachCaptureQualityRig(UWorld* World, TFunctionRef<void(ASterio_4_16Character*)> Callback)
+{
+	if (World)
+	{
+		for (TActorIterator<ASterio_4_16Character> It(World); It; ++It)
+		{
+			Callback(*It);
+		}
+	}
+}
+
+static void RunCaptureQualityCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (Args.Num() < 1)
+	{
+		ForEachCaptureQualityRig(World, [](ASterio_4_16Character* Rig)
+		{
+			UE_LOG(LogSterioCaptureQuality, Display, TEXT("%s: %s"), *Rig->GetName(), *Rig->GetCaptureQuality().ToString());
+		});
+		UE_LOG(LogSterioCaptureQuality, Display, TEXT("Usage: Sterio.CaptureQuality Profile; built in are Full, Projector and Minimal"));
+		return;
+	}
+
+	const FName Name = *Args[0];
+	ForEachCaptureQualityRig(World, [Name](ASterio_4_16Character* Rig)
+	{
+		if (!Rig->SetCaptureQuality(Name))
+		{
+			UE_LOG(LogSterioCaptureQuality, Error, TEXT("%s has no capture quality profile %s"), *Rig->GetName(), *Name.ToString());
+		}
+	});
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SterioCaptureQualityCommand(
+	TEXT("Sterio.CaptureQuality"),
+	TEXT("Applies a capture quality profile to the eye captures of every rig. Usage: Sterio.CaptureQuality [Profile]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunCaptureQualityCommand));
+
+static void RunCaptureQualityTuneCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (Args.Num() < 1 || FCString::Atof(*Args[0]) <= 0.f)
+	{
+		UE_LOG(LogSterioCaptureQuality, Error, TEXT("Usage: Sterio.CaptureQuality.Tune TargetFrameTimeMs [MeasureFrames]"));
+		return;
+	}
+
+	const float TargetFrameTimeMs = FCString::Atof(*Args[0]);
+	const int32 MeasureFrames = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 60;
+	bool bStarted = false;
+	ForEachCaptureQualityRig(World, [&](ASterio_4_16Character* Rig)
+	{
+		// Rigs share the GPU, so only one can be measured at a time
+		if (!bStarted)
+		{
+			Rig->StartCaptureQualityTuning(TargetFrameTimeMs, MeasureFrames);
+			bStarted = true;
+		}
+	});
+	if (!bStarted)
+	{
+		UE_LOG(LogSterioCaptureQuality, Error, TEXT("Sterio.CaptureQuality.Tune needs a stereo rig in the world"));
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SterioCaptureQualityTuneCommand(
+	TEXT("Sterio.CaptureQuality.Tune"),
+	TEXT("Measures what each capture show flag costs and recommends a profile for the frame time target, added to the rig as Tuned. Usage: Sterio.CaptureQuality.Tune TargetFrameTimeMs [MeasureFrames]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunCaptureQualityTuneCommand));
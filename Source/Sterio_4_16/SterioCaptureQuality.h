@@ -0,0 +1,166 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Scene.h"
+#include "ShowFlags.h"
+#include "SterioCaptureQuality.generated.h"
+
+class USceneCaptureComponent2D;
+
+/**
+ * How much of the renderer the eye captures use. Projector output has no use for camera effects like motion blur,
+ * bloom or lens flares, and often not for shadows either, yet every eye pays for them with default capture settings.
+ */
+USTRUCT(BlueprintType)
+struct FSterioCaptureQualityProfile
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture)
+	FName Name;
+
+	/** Show flags turned off on every eye capture, named as for the ShowFlag console command, e.g. MotionBlur or DynamicShadows */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture)
+	TArray<FString> DisabledShowFlags;
+
+	/** Replaces the captures' own post process settings, which are blended over the world's post process volumes */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture)
+	bool bOverridePostProcess = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture, meta = (EditCondition = "bOverridePostProcess"))
+	FPostProcessSettings PostProcessSettings;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture, meta = (EditCondition = "bOverridePostProcess", ClampMin = "0.0", ClampMax = "1.0"))
+	float PostProcessBlendWeight = 1.f;
+
+	/** Scales the distances LODs are picked by; above 1 switches to coarser LODs sooner */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture, meta = (ClampMin = "0.1"))
+	float LODDistanceFactor = 1.f;
+
+	/** Nothing further than this is drawn, in cm; 0 leaves it to the depth mode */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture, meta = (ClampMin = "0.0"))
+	float MaxViewDistance = 0.f;
+};
+
+/**
+ * Applies capture quality profiles to a rig's eye captures.
+ *
+ * The settings the captures were authored with are kept on the first Apply, and every profile is applied on
+ * top of those, so switching profiles never accumulates changes and the empty "Full" profile restores them.
+ */
+class FSterioCaptureQuality
+{
+public:
+	/** Full, Projector and Minimal, from no change at all to everything the rig can do without. */
+	static const TArray<FSterioCaptureQualityProfile>& GetBuiltInProfiles();
+
+	/** Looks Name up in Profiles, then in the built-in profiles. */
+	static const FSterioCaptureQualityProfile* FindProfile(FName Name, const TArray<FSterioCaptureQualityProfile>& Profiles);
+
+	/** Index of a show flag by its console name, or INDEX_NONE. */
+	static int32 FindShowFlag(const FString& Name);
+
+	/** Applies Profile to every capture. Show flags this engine doesn't know are skipped with a warning. */
+	void Apply(const FSterioCaptureQualityProfile& Profile, const TArray<USceneCaptureComponent2D*>& Captures);
+
+	/** Puts the authored settings back on the captures and forgets every capture seen so far. */
+	void Restore(const TArray<USceneCaptureComponent2D*>& Captures);
+
+	const FSterioCaptureQualityProfile& GetActiveProfile() const { return ActiveProfile; }
+
+	/** LOD distance factor the active profile gives Capture, for adjustments made on top of it. */
+	float GetLODDistanceFactor(const USceneCaptureComponent2D* Capture) const;
+
+	/** Combines the view distance of the depth mode (negative for unlimited) with the one of the active profile. */
+	float GetViewDistance(float DepthModeDistance) const;
+
+private:
+	/** Settings of one capture as authored */
+	struct FBaseline
+	{
+		const USceneCaptureComponent2D* Capture;
+		FEngineShowFlags ShowFlags;
+		FPostProcessSettings PostProcessSettings;
+		float PostProcessBlendWeight;
+		float LODDistanceFactor;
+	};
+
+	TArray<FBaseline> Baselines;
+	FSterioCaptureQualityProfile ActiveProfile;
+};
+
+/** One measured step of a tuning run. */
+struct FSterioCaptureQualityStep
+{
+	/** Show flag turned off on top of the starting profile; empty for the starting profile and the recommendation */
+	FString ShowFlag;
+
+	/** Median frame time, and median of the render thread and GPU times where the captures are paid for, in ms */
+	float FrameTimeMs;
+	float RenderTimeMs;
+
+	/** Frame time saved against the starting profile, in ms */
+	float SavingMs;
+};
+
+/**
+ * Finds out what each capture feature costs on the running scene and recommends a profile for a frame time target.
+ *
+ * Starting from the active profile, it measures the frame time, then turns every candidate show flag off on its
+ * own and measures again. Flags are ranked by the time they save, and the recommendation turns off the most
+ * expensive ones until the estimated frame time fits the target. The recommendation is measured last, so the report
+ * shows how far the estimate was off. Every step waits out a few frames for timings to catch up before measuring.
+ */
+class FSterioCaptureQualityTuner
+{
+public:
+	/** Show flags tried when no candidates are given. */
+	static const TArray<FString>& GetDefaultCandidates();
+
+	void Start(const FSterioCaptureQualityProfile& InStartProfile, float InTargetFrameTimeMs, int32 InMeasureFrames = 60, int32 InWarmupFrames = 10,
+		const TArray<FString>& InCandidates = TArray<FString>());
+
+	bool IsRunning() const { return bRunning; }
+
+	/**
+	 * Feeds the timings of the last completed frame. Returns true when a different profile has to be applied to the
+	 * captures before the next frame, and sets OutProfile to it.
+	 */
+	bool Tick(FSterioCaptureQualityProfile& OutProfile);
+
+	/** Ranked steps, most expensive feature first, with the starting profile at the front and the recommendation at the back. */
+	TArray<FSterioCaptureQualityStep> GetReport() const;
+
+	const FSterioCaptureQualityProfile& GetRecommendation() const { return Recommendation; }
+	const FSterioCaptureQualityProfile& GetStartProfile() const { return StartProfile; }
+
+	void LogReport() const;
+
+	/** Writes the report as CSV. */
+	bool SaveReport(const FString& Path) const;
+
+private:
+	/** Profile measured by the given step: the start, one flag off, or the recommendation */
+	FSterioCaptureQualityProfile MakeStepProfile(int32 Index) const;
+
+	/** Ranks the flags and builds the recommendation once every flag has been measured. */
+	void Recommend();
+
+	FSterioCaptureQualityProfile StartProfile;
+	FSterioCaptureQualityProfile Recommendation;
+	TArray<FString> Candidates;
+	float TargetFrameTimeMs = 0.f;
+	int32 MeasureFrames = 0;
+	int32 WarmupFrames = 0;
+
+	/** Start, one per candidate, then the recommendation */
+	TArray<FSterioCaptureQualityStep> Steps;
+	float EstimatedFrameTimeMs = 0.f;
+	int32 StepIndex = 0;
+	int32 StepFrame = 0;
+	TArray<float> FrameSamples;
+	TArray<float> RenderSamples;
+	bool bRunning = false;
+};
@@ -0,0 +1,144 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioCaptureScheduler.h"
+#include "SterioProjectionCache.h"
+
+FSterioCaptureScheduler::FSterioCaptureScheduler()
+{
+	ResetCounters();
+}
+
+void FSterioCaptureScheduler::Reset(int32 NumSlots)
+{
+	Slots.SetNum(NumSlots);
+	for (FSlot& Slot : Slots)
+	{
+		Slot.CapturedTransform = FTransform::Identity;
+		Slot.PendingTransform = FTransform::Identity;
+		Slot.CapturedVersion = 0;
+		Slot.PendingVersion = 0;
+		Slot.FramesSinceCapture = 0;
+		Slot.bCaptured = false;
+		Slot.bDirty = true;
+		Slot.bActive = false;
+	}
+}
+
+void FSterioCaptureScheduler::MarkSceneDirty()
+{
+	for (FSlot& Slot : Slots)
+	{
+		Slot.bDirty = true;
+	}
+}
+
+void FSterioCaptureScheduler::SetSlotState(int32 Slot, uint32 InputVersion, const FTransform& CaptureTransform)
+{
+	FSlot& State = Slots[Slot];
+	State.PendingVersion = InputVersion;
+	State.PendingTransform = CaptureTransform;
+	State.bActive = true;
+}
+
+bool FSterioCaptureScheduler::HasChanged(const FSlot& Slot, const FSterioCaptureSchedulerSettings& Settings) const
+{
+	if (!Slot.bCaptured || Slot.bDirty || Slot.PendingVersion != Slot.CapturedVersion)
+	{
+		return true;
+	}
+	if (Settings.MaxStaleFrames > 0 && Slot.FramesSinceCapture >= Settings.MaxStaleFrames)
+	{
+		return true;
+	}
+	return !Slot.PendingTransform.GetLocation().Equals(Slot.CapturedTransform.GetLocation(), Settings.PoseTolerance)
+		|| !Slot.PendingTransform.GetRotation().Equals(Slot.CapturedTransform.GetRotation(), KINDA_SMALL_NUMBER);
+}
+
+void FSterioCaptureScheduler::Schedule(const FSterioCaptureSchedulerSettings& Settings, uint64 FrameNumber, TArray<int32, TInlineAllocator<16>>& OutSlots)
+{
+	OutSlots.Reset();
+	Candidates.Reset();
+
+	const int32 AlternateEye = (int32)(FrameNumber & 1);
+	for (int32 Index = 0; Index < Slots.Num(); ++Index)
+	{
+		const FSlot& Slot = Slots[Index];
+		if (!Slot.bActive)
+		{
+			continue;
+		}
+
+		switch (Settings.Policy)
+		{
+		case ESterioCapturePolicy::EveryFrame:
+			OutSlots.Add(Index);
+			break;
+
+		case ESterioCapturePolicy::AlternateEye:
+			// A steady half rate per eye, so a reprojecting display always gets a fresh eye one frame apart
+			if (FSterioProjectionCache::GetSlotEye(Index) == AlternateEye && HasChanged(Slot, Settings))
+			{
+				OutSlots.Add(Index);
+			}
+			break;
+
+		case ESterioCapturePolicy::Budget:
+			if (HasChanged(Slot, Settings))
+			{
+				Candidates.Add(Index);
+			}
+			break;
+
+		default:
+			if (HasChanged(Slot, Settings))
+			{
+				OutSlots.Add(Index);
+			}
+			break;
+		}
+	}
+
+	if (Settings.Policy == ESterioCapturePolicy::Budget)
+	{
+		// Stalest first; the stable sort keeps the two eyes of a screen next to each other
+		Candidates.StableSort([this](int32 A, int32 B)
+		{
+			return Slots[A].FramesSinceCapture > Slots[B].FramesSinceCapture;
+		});
+		OutSlots.Append(Candidates.GetData(), FMath::Min(Candidates.Num(), FMath::Max(1, Settings.MaxCapturesPerFrame)));
+	}
+
+	for (int32 Index : OutSlots)
+	{
+		FSlot& Slot = Slots[Index];
+		Slot.CapturedVersion = Slot.PendingVersion;
+		Slot.CapturedTransform = Slot.PendingTransform;
+		Slot.FramesSinceCapture = -1;
+		Slot.bCaptured = true;
+		Slot.bDirty = false;
+		++Issued[FSterioProjectionCache::GetSlotEye(Index)];
+	}
+
+	for (int32 Index = 0; Index < Slots.Num(); ++Index)
+	{
+		FSlot& Slot = Slots[Index];
+		if (Slot.bActive)
+		{
+			if (Slot.FramesSinceCapture >= 0)
+			{
+				++Skipped[FSterioProjectionCache::GetSlotEye(Index)];
+			}
+			++Slot.FramesSinceCapture;
+			Slot.bActive = false;
+		}
+	}
+}
+
+void FSterioCaptureScheduler::ResetCounters()
+{
+	for (int32 Eye = 0; Eye < 2; ++Eye)
+	{
+		Issued[Eye] = 0;
+		Skipped[Eye] = 0;
+	}
+}
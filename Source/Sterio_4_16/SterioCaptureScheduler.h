@@ -0,0 +1,97 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SterioCaptureScheduler.generated.h"
+
+UENUM(BlueprintType)
+enum class ESterioCapturePolicy : uint8
+{
+	/** Every eye is captured every frame */
+	EveryFrame,
+	/**
+	 * An eye is captured only when its pose, projection or the scene changed. The scheduler sees the rig's own
+	 * changes only: moving actors, animation and particles count once MarkSceneDirty is called for them, and
+	 * otherwise refresh only every MaxStaleFrames. Meant for static scenes, or scenes that report their changes.
+	 */
+	OnChange,
+	/** Left eyes on even frames, right eyes on odd ones, each only when changed (with the same caveat as OnChange) */
+	AlternateEye,
+	/** Changed eyes are captured stalest first, up to MaxCapturesPerFrame (with the same caveat as OnChange) */
+	Budget,
+};
+
+USTRUCT(BlueprintType)
+struct FSterioCaptureSchedulerSettings
+{
+	GENERATED_BODY()
+
+	/** Every frame by default, which is what the eye captures did before the scheduler; the other policies are opt-in */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture)
+	ESterioCapturePolicy Policy = ESterioCapturePolicy::EveryFrame;
+
+	/** Budget: eye captures issued per frame at most */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture, meta = (ClampMin = "1"))
+	int32 MaxCapturesPerFrame = 2;
+
+	/** An unchanged eye is captured anyway after this many frames so animated content keeps moving; 0 never refreshes */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture, meta = (ClampMin = "0"))
+	int32 MaxStaleFrames = 30;
+
+	/** Capture movement below this, in cm, doesn't count as a change */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCapture, meta = (ClampMin = "0.0"))
+	float PoseTolerance = 0.01f;
+};
+
+/**
+ * Decides which eye captures are issued each frame.
+ *
+ * A slot (see FSterioProjectionCache::GetSlot) counts as changed when the projection cache input version it
+ * would be rendered with, or the world transform of its capture, differs from the last capture, or when the
+ * scene was marked dirty since. The policy then picks among the changed slots.
+ */
+class FSterioCaptureScheduler
+{
+public:
+	FSterioCaptureScheduler();
+
+	/** Resizes for the given number of slots; every slot starts out changed. */
+	void Reset(int32 NumSlots);
+
+	/** Marks every slot as changed, e.g. because something moved in front of the screens. */
+	void MarkSceneDirty();
+
+	/** Records the state a slot would be captured with this frame. Slots not reported are neither captured nor counted. */
+	void SetSlotState(int32 Slot, uint32 InputVersion, const FTransform& CaptureTransform);
+
+	/** Picks this frame's captures. Picked slots are remembered as captured with the state reported for them. */
+	void Schedule(const FSterioCaptureSchedulerSettings& Settings, uint64 FrameNumber, TArray<int32, TInlineAllocator<16>>& OutSlots);
+
+	uint64 GetIssued(int32 Eye) const { return Issued[Eye]; }
+	uint64 GetSkipped(int32 Eye) const { return Skipped[Eye]; }
+	void ResetCounters();
+
+private:
+	struct FSlot
+	{
+		FTransform CapturedTransform;
+		FTransform PendingTransform;
+		uint32 CapturedVersion;
+		uint32 PendingVersion;
+		int32 FramesSinceCapture;
+		bool bCaptured;
+		bool bDirty;
+		bool bActive;
+	};
+
+	bool HasChanged(const FSlot& Slot, const FSterioCaptureSchedulerSettings& Settings) const;
+
+	TArray<FSlot> Slots;
+
+	/** Scratch for the budget policy */
+	TArray<int32, TInlineAllocator<16>> Candidates;
+
+	uint64 Issued[2];
+	uint64 Skipped[2];
+};
@@ -0,0 +1,226 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioCluster.h"
+#include "Common/UdpSocketBuilder.h"
+#include "HAL/IConsoleManager.h"
+#include "Interfaces/IPv4/IPv4Address.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+#include "RenderingThread.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioCluster, Log, All);
+
+static TAutoConsoleVariable<int32> CVarSterioClusterFlush(
+	TEXT("Sterio.Cluster.FlushBeforeBarrier"),
+	1,
+	TEXT("1 to wait for the render thread to finish the frame before entering the cluster swap barrier, 0 to lock game thread frames only."),
+	ECVF_Default);
+
+FSterioClusterSettings FSterioClusterSettings::FromCommandLine(const TCHAR* CommandLine)
+{
+	FSterioClusterSettings Settings;
+
+	FString Role;
+	if (FParse::Value(CommandLine, TEXT("SterioCluster="), Role))
+	{
+		if (Role == TEXT("Primary"))
+		{
+			Settings.Role = ESterioClusterRole::Primary;
+		}
+		else if (Role == TEXT("Secondary"))
+		{
+			Settings.Role = ESterioClusterRole::Secondary;
+		}
+	}
+
+	FParse::Value(CommandLine, TEXT("SterioClusterNode="), Settings.NodeIndex);
+	FParse::Value(CommandLine, TEXT("SterioClusterNodes="), Settings.NumNodes);
+	FParse::Value(CommandLine, TEXT("SterioClusterPort="), Settings.BasePort);
+	FParse::Value(CommandLine, TEXT("SterioClusterTimeout="), Settings.TimeoutSeconds);
+
+	FString Screens;
+	if (FParse::Value(CommandLine, TEXT("SterioClusterScreens="), Screens, false))
+	{
+		TArray<FString> Indices;
+		Screens.ParseIntoArray(Indices, TEXT(","));
+		for (const FString& Index : Indices)
+		{
+			Settings.Screens.Add(FCString::Atoi(*Index));
+		}
+	}
+
+	if (Settings.Role == ESterioClusterRole::Primary)
+	{
+		Settings.NodeIndex = 0;
+	}
+	return Settings;
+}
+
+namespace
+{
+	/** Nodes started in this process, one per rig, each on its own lane of ports; game thread only */
+	TArray<const FSterioClusterNode*> GStartedNodes;
+}
+
+FSterioClusterNode::FSterioClusterNode()
+	: Lane(INDEX_NONE)
+	, Socket(nullptr)
+	, BarrierFrames(0)
+	, BarrierTimeouts(0)
+	, BarrierWaitSeconds(0.0)
+{
+}
+
+FSterioClusterNode::~FSterioClusterNode()
+{
+	Shutdown();
+}
+
+bool FSterioClusterNode::Start(const FSterioClusterSettings& InSettings)
+{
+	check(!Socket);
+	Settings = InSettings;
+
+	if (!SterioCluster::IsValidLayout(Settings.NodeIndex, Settings.NumNodes))
+	{
+		UE_LOG(LogSterioCluster, Error, TEXT("Node %d of %d is not a valid cluster layout"), Settings.NodeIndex, Settings.NumNodes);
+		return false;
+	}
+
+	// The lowest lane no other rig of this process holds; rigs start in the same order on every node
+	Lane = 0;
+	while (GStartedNodes.ContainsByPredicate([this](const FSterioClusterNode* Other) { return Other->Lane == Lane; }))
+	{
+		++Lane;
+	}
+
+	const int32 Port = SterioCluster::GetPort(Settings.BasePort, Lane, Settings.NumNodes, Settings.NodeIndex);
+	Socket = FUdpSocketBuilder(TEXT("SterioCluster"))
+		.AsNonBlocking()
+		.BoundToAddress(FIPv4Address(127, 0, 0, 1))
+		.BoundToPort(Port)
+		.WithReceiveBufferSize(64 * 1024)
+		.Build();
+
+	if (!Socket)
+	{
+		UE_LOG(LogSterioCluster, Error, TEXT("Could not bind cluster socket to port %d (lane %d); is another process using it?"), Port, Lane);
+		Lane = INDEX_NONE;
+		return false;
+	}
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	for (int32 Node = 0; Node < Settings.NumNodes; ++Node)
+	{
+		TSharedRef<FInternetAddr> Address = SocketSubsystem->CreateInternetAddr(FIPv4Address(127, 0, 0, 1).Value, SterioCluster::GetPort(Settings.BasePort, Lane, Settings.NumNodes, Node));
+		NodeAddresses.Add(Address);
+	}
+
+	FrameLock.Reset(new SterioCluster::TFrameLock<FSterioClusterNode>(*this, Settings.NodeIndex, Settings.NumNodes, Settings.TimeoutSeconds));
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FSterioClusterNode::OnEndFrame);
+	GStartedNodes.Add(this);
+
+	UE_LOG(LogSterioCluster, Log, TEXT("Cluster node %d of %d started as %s on port %d (lane %d)"), Settings.NodeIndex, Settings.NumNodes,
+		IsPrimary() ? TEXT("primary") : TEXT("secondary"), Port, Lane);
+	return true;
+}
+
+void FSterioClusterNode::Shutdown()
+{
+	if (EndFrameHandle.IsValid())
+	{
+		FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+		EndFrameHandle.Reset();
+	}
+
+	if (Socket)
+	{
+		UE_LOG(LogSterioCluster, Log, TEXT("Cluster node %d stopped after %d locked frames, %d barrier timeouts, %.2f ms average barrier wait"),
+			Settings.NodeIndex, BarrierFrames, BarrierTimeouts, GetAverageBarrierWaitMs());
+
+		Socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+
+	GStartedNodes.Remove(this);
+	Lane = INDEX_NONE;
+	NodeAddresses.Empty();
+	FrameLock.Reset();
+}
+
+void FSterioClusterNode::Send(const SterioCluster::FPacket& Packet, int32 Node)
+{
+	int32 BytesSent = 0;
+	Socket->SendTo((const uint8*)&Packet, sizeof(Packet), BytesSent, *NodeAddresses[Node]);
+}
+
+bool FSterioClusterNode::Receive(SterioCluster::FPacket& OutPacket, double Deadline)
+{
+	for (;;)
+	{
+		int32 BytesRead = 0;
+		if (Socket->Recv((uint8*)&OutPacket, sizeof(OutPacket), BytesRead) && BytesRead == sizeof(OutPacket))
+		{
+			return true;
+		}
+
+		const double Remaining = Deadline - FPlatformTime::Seconds();
+		if (Remaining <= 0.0)
+		{
+			return false;
+		}
+		Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(Remaining));
+	}
+}
+
+void FSterioClusterNode::BroadcastFrame(const FVector& LeftEye, const FVector& RightEye)
+{
+	check(IsPrimary() && FrameLock.IsValid());
+
+	const float Left[3] = { LeftEye.X, LeftEye.Y, LeftEye.Z };
+	const float Right[3] = { RightEye.X, RightEye.Y, RightEye.Z };
+	FrameLock->BroadcastFrame(Left, Right);
+}
+
+bool FSterioClusterNode::ReceiveFrame(FVector& OutLeftEye, FVector& OutRightEye)
+{
+	check(IsSecondary() && FrameLock.IsValid());
+
+	float Left[3], Right[3];
+	if (!FrameLock->ReceiveFrame(Left, Right))
+	{
+		UE_LOG(LogSterioCluster, Warning, TEXT("No frame from the primary within %.2f s, rendering frame %llu again"), Settings.TimeoutSeconds, (uint64)FrameLock->GetFrameNumber());
+		return false;
+	}
+
+	OutLeftEye = FVector(Left[0], Left[1], Left[2]);
+	OutRightEye = FVector(Right[0], Right[1], Right[2]);
+	return true;
+}
+
+void FSterioClusterNode::OnEndFrame()
+{
+	if (!FrameLock.IsValid() || !FrameLock->IsBarrierArmed())
+	{
+		return;
+	}
+
+	if (CVarSterioClusterFlush.GetValueOnGameThread() != 0)
+	{
+		FlushRenderingCommands();
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const bool bReleased = FrameLock->RunBarrier();
+
+	++BarrierFrames;
+	BarrierWaitSeconds += FPlatformTime::Seconds() - StartTime;
+	if (!bReleased)
+	{
+		++BarrierTimeouts;
+		UE_LOG(LogSterioCluster, Warning, TEXT("Swap barrier of frame %llu timed out after %.2f s"), (uint64)FrameLock->GetFrameNumber(), Settings.TimeoutSeconds);
+	}
+}
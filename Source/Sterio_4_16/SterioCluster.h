@@ -0,0 +1,96 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SterioClusterProtocol.h"
+
+class FSocket;
+class FInternetAddr;
+
+enum class ESterioClusterRole : uint8
+{
+	/** Single process, renders every screen */
+	None,
+	/** Owns the tracker, broadcasts each frame's pose and releases the swap barrier */
+	Primary,
+	/** Renders its screens with the pose the primary broadcast */
+	Secondary,
+};
+
+/**
+ * Where a process sits in a render cluster. Read from the command line so every node can run the same map:
+ *
+ *   -SterioCluster=Primary|Secondary   role of this process
+ *   -SterioClusterNode=1               index of this node; the primary is node 0
+ *   -SterioClusterNodes=3              number of nodes, primary included
+ *   -SterioClusterPort=40200           node N listens on 127.0.0.1:Port+N, see below
+ *   -SterioClusterScreens=1,2          screens this node renders; all of them if omitted
+ *
+ * Every rig of a process runs its own cluster. The first one to start takes ports Port to Port+Nodes-1, the
+ * next one the Nodes ports after those, and so on (see SterioCluster::GetPort). Rigs pair up across nodes as
+ * long as every node runs the same map, so that they start in the same order.
+ */
+struct FSterioClusterSettings
+{
+	ESterioClusterRole Role = ESterioClusterRole::None;
+	int32 NodeIndex = 0;
+	int32 NumNodes = 1;
+	int32 BasePort = 40200;
+	TArray<int32> Screens;
+	/** How long a node waits for the next frame or for the barrier before running on alone */
+	float TimeoutSeconds = 1.f;
+
+	static FSterioClusterSettings FromCommandLine(const TCHAR* CommandLine);
+};
+
+/**
+ * One process of a render cluster, running SterioCluster::TFrameLock over loopback UDP. The swap barrier is
+ * met at the end of the game thread frame, after the rendering commands have been flushed.
+ */
+class FSterioClusterNode
+{
+public:
+	FSterioClusterNode();
+	~FSterioClusterNode();
+
+	bool Start(const FSterioClusterSettings& InSettings);
+	void Shutdown();
+
+	bool IsPrimary() const { return Settings.Role == ESterioClusterRole::Primary; }
+	bool IsSecondary() const { return Settings.Role == ESterioClusterRole::Secondary; }
+	bool RendersScreen(int32 ScreenIndex) const { return Settings.Screens.Num() == 0 || Settings.Screens.Contains(ScreenIndex); }
+
+	/** Primary: sends this frame's pose to every secondary and arms the barrier. */
+	void BroadcastFrame(const FVector& LeftEye, const FVector& RightEye);
+
+	/** Secondary: waits for the primary's next frame. Returns false on timeout, in which case the barrier is skipped too. */
+	bool ReceiveFrame(FVector& OutLeftEye, FVector& OutRightEye);
+
+	uint64 GetFrameNumber() const { return FrameLock.IsValid() ? FrameLock->GetFrameNumber() : 0; }
+	int32 GetLane() const { return Lane; }
+	int32 GetBarrierTimeouts() const { return BarrierTimeouts; }
+	double GetAverageBarrierWaitMs() const { return BarrierFrames > 0 ? BarrierWaitSeconds * 1000.0 / BarrierFrames : 0.0; }
+
+private:
+	friend class SterioCluster::TFrameLock<FSterioClusterNode>;
+
+	/** Bound to FCoreDelegates::OnEndFrame */
+	void OnEndFrame();
+
+	/** The frame lock's transport, see SterioClusterProtocol.h */
+	void Send(const SterioCluster::FPacket& Packet, int32 Node);
+	bool Receive(SterioCluster::FPacket& OutPacket, double Deadline);
+	double Now() const { return FPlatformTime::Seconds(); }
+
+	FSterioClusterSettings Settings;
+	int32 Lane;
+	FSocket* Socket;
+	TArray<TSharedRef<FInternetAddr>> NodeAddresses;
+	FDelegateHandle EndFrameHandle;
+	TUniquePtr<SterioCluster::TFrameLock<FSterioClusterNode>> FrameLock;
+
+	int32 BarrierFrames;
+	int32 BarrierTimeouts;
+	double BarrierWaitSeconds;
+};
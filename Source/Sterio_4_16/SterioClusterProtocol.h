@@ -0,0 +1,213 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+// Wire format and frame lock of a render cluster.
+//
+// Like SterioFrameTransport.h this header has no engine dependency. The frame lock is written against a transport
+// that can send a packet to a node and wait for one until a deadline. FSterioClusterNode provides one over the
+// engine's sockets. Source/SterioStandalone/ClusterLoopbackTest.cpp provides one over POSIX sockets and runs every
+// node of a cluster as its own process.
+//
+// A transport provides:
+//
+//   void Send(const SterioCluster::FPacket& Packet, int32_t Node);
+//   bool Receive(SterioCluster::FPacket& OutPacket, double Deadline);   // false once Deadline has passed
+//   double Now() const;                                                // seconds, the clock Deadline is on
+
+#include <cstdint>
+
+namespace SterioCluster
+{
+	/** Datagram: little-endian, 40 bytes, no padding. */
+	struct FPacket
+	{
+		enum EKind : uint32_t
+		{
+			/** Primary to secondaries: the pose of the frame to render */
+			Frame = 1,
+			/** Node to primary: the frame has been submitted */
+			Ready = 2,
+			/** Primary to secondaries: every node has submitted the frame */
+			Release = 3,
+		};
+
+		uint32_t Kind;
+		uint32_t Node;
+		uint64_t FrameNumber;
+		float LeftEye[3];
+		float RightEye[3];
+
+		enum { Size = 40 };
+	};
+
+	static_assert(sizeof(FPacket) == FPacket::Size, "Cluster packets are a fixed wire format");
+
+	/** The ready set of the primary is a 64-bit mask */
+	enum { MaxNodes = 64 };
+
+	inline bool IsValidLayout(int32_t NodeIndex, int32_t NumNodes)
+	{
+		return NumNodes >= 2 && NumNodes <= MaxNodes && NodeIndex >= 0 && NodeIndex < NumNodes;
+	}
+
+	/**
+	 * UDP port of a node. Each cluster in a process (one per rig) takes the next lane of NumNodes ports, so rigs that
+	 * start in the same order on every node pair up without sharing a port.
+	 */
+	inline int32_t GetPort(int32_t BasePort, int32_t Lane, int32_t NumNodes, int32_t Node)
+	{
+		return BasePort + Lane * NumNodes + Node;
+	}
+
+	/**
+	 * One node's side of the frame lock. Node 0 is the primary: it broadcasts each frame's eye pose and cluster
+	 * frame number to every secondary. All nodes then meet at a swap barrier, so no node starts frame N+1 before
+	 * every node submitted N. Every wait ends after TimeoutSeconds, and the node then runs on alone.
+	 */
+	template<typename TransportType>
+	class TFrameLock
+	{
+	public:
+		TFrameLock(TransportType& InTransport, int32_t InNodeIndex, int32_t InNumNodes, double InTimeoutSeconds)
+			: Transport(InTransport)
+			, NodeIndex(InNodeIndex)
+			, NumNodes(InNumNodes)
+			, TimeoutSeconds(InTimeoutSeconds)
+			, FrameNumber(0)
+			, bBarrierArmed(false)
+			, bHasPendingFrame(false)
+		{
+		}
+
+		bool IsPrimary() const { return NodeIndex == 0; }
+		uint64_t GetFrameNumber() const { return FrameNumber; }
+		bool IsBarrierArmed() const { return bBarrierArmed; }
+
+		/** Primary: sends the next frame's pose to every secondary and arms the barrier. Returns its frame number. */
+		uint64_t BroadcastFrame(const float LeftEye[3], const float RightEye[3])
+		{
+			FPacket Packet;
+			Packet.Kind = FPacket::Frame;
+			Packet.Node = 0;
+			Packet.FrameNumber = ++FrameNumber;
+			for (int32_t Axis = 0; Axis < 3; ++Axis)
+			{
+				Packet.LeftEye[Axis] = LeftEye[Axis];
+				Packet.RightEye[Axis] = RightEye[Axis];
+			}
+
+			for (int32_t Node = 1; Node < NumNodes; ++Node)
+			{
+				Transport.Send(Packet, Node);
+			}
+			bBarrierArmed = true;
+			return FrameNumber;
+		}
+
+		/** Secondary: waits for the primary's next frame. Returns false on timeout, in which case the barrier is skipped too. */
+		bool ReceiveFrame(float OutLeftEye[3], float OutRightEye[3])
+		{
+			FPacket Packet;
+			bool bReceived = false;
+			if (bHasPendingFrame)
+			{
+				Packet = PendingFrame;
+				bHasPendingFrame = false;
+				bReceived = true;
+			}
+
+			const double Deadline = Transport.Now() + TimeoutSeconds;
+			while (!bReceived && Transport.Receive(Packet, Deadline))
+			{
+				// Releases of frames already given up on are stale
+				bReceived = (Packet.Kind == FPacket::Frame && Packet.FrameNumber > FrameNumber);
+			}
+			if (!bReceived)
+			{
+				return false;
+			}
+
+			FrameNumber = Packet.FrameNumber;
+			for (int32_t Axis = 0; Axis < 3; ++Axis)
+			{
+				OutLeftEye[Axis] = Packet.LeftEye[Axis];
+				OutRightEye[Axis] = Packet.RightEye[Axis];
+			}
+			bBarrierArmed = true;
+			return true;
+		}
+
+		/**
+		 * Every node, once its frame is submitted: waits until every node got there. The primary releases the
+		 * secondaries even after a timeout, so the ones that did make it don't wait out their own. Returns false
+		 * if this node timed out.
+		 */
+		bool RunBarrier()
+		{
+			bBarrierArmed = false;
+			const double Deadline = Transport.Now() + TimeoutSeconds;
+			bool bReleased = false;
+			FPacket Packet;
+
+			if (IsPrimary())
+			{
+				// Bit N set once node N is ready; the primary is always ready by the time it gets here
+				const uint64_t AllNodes = (NumNodes == MaxNodes) ? ~0ull : ((1ull << NumNodes) - 1);
+				uint64_t ReadyNodes = 1;
+				while (ReadyNodes != AllNodes && Transport.Receive(Packet, Deadline))
+				{
+					if (Packet.Kind == FPacket::Ready && Packet.FrameNumber == FrameNumber && Packet.Node < (uint32_t)NumNodes)
+					{
+						ReadyNodes |= 1ull << Packet.Node;
+					}
+				}
+				bReleased = (ReadyNodes == AllNodes);
+
+				Packet.Kind = FPacket::Release;
+				Packet.Node = 0;
+				Packet.FrameNumber = FrameNumber;
+				for (int32_t Node = 1; Node < NumNodes; ++Node)
+				{
+					Transport.Send(Packet, Node);
+				}
+			}
+			else
+			{
+				Packet.Kind = FPacket::Ready;
+				Packet.Node = (uint32_t)NodeIndex;
+				Packet.FrameNumber = FrameNumber;
+				Transport.Send(Packet, 0);
+
+				while (!bReleased && Transport.Receive(Packet, Deadline))
+				{
+					if (Packet.Kind == FPacket::Release && Packet.FrameNumber >= FrameNumber)
+					{
+						bReleased = true;
+					}
+					else if (Packet.Kind == FPacket::Frame && Packet.FrameNumber > FrameNumber)
+					{
+						// The next frame implies the release was lost
+						PendingFrame = Packet;
+						bHasPendingFrame = true;
+						bReleased = true;
+					}
+				}
+			}
+			return bReleased;
+		}
+
+	private:
+		TransportType& Transport;
+		int32_t NodeIndex;
+		int32_t NumNodes;
+		double TimeoutSeconds;
+
+		uint64_t FrameNumber;
+		bool bBarrierArmed;
+
+		/** A Frame packet that arrived while waiting for a Release */
+		bool bHasPendingFrame;
+		FPacket PendingFrame;
+	};
+}
@@ -0,0 +1,370 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+// Visibility culling shared by every eye of a screen.
+//
+// Like SterioProjectionKernel.h this header has no engine dependency. Instead of culling the scene once
+// per eye, the rig builds one conservative frustum enclosing the frusta of all eyes looking through a
+// screen and culls a bounding volume hierarchy against it once. CullBruteForce is the reference the
+// hierarchy is checked against.
+
+#include "SterioProjectionKernel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+namespace SterioCulling
+{
+	using SterioProjection::FVec3;
+	using SterioProjection::MakeVec3;
+	using SterioProjection::Sub;
+	using SterioProjection::Dot;
+	using SterioProjection::Cross;
+	using SterioProjection::Normalize;
+
+	struct FAabb
+	{
+		FVec3 Min, Max;
+	};
+
+	inline FAabb MakeEmptyAabb()
+	{
+		FAabb Box = { MakeVec3(FLT_MAX, FLT_MAX, FLT_MAX), MakeVec3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+		return Box;
+	}
+
+	inline void Grow(FAabb& Box, const FAabb& Other)
+	{
+		Box.Min = MakeVec3(std::min(Box.Min.X, Other.Min.X), std::min(Box.Min.Y, Other.Min.Y), std::min(Box.Min.Z, Other.Min.Z));
+		Box.Max = MakeVec3(std::max(Box.Max.X, Other.Max.X), std::max(Box.Max.Y, Other.Max.Y), std::max(Box.Max.Z, Other.Max.Z));
+	}
+
+	inline FVec3 GetCenter(const FAabb& Box)
+	{
+		return MakeVec3((Box.Min.X + Box.Max.X) * 0.5f, (Box.Min.Y + Box.Max.Y) * 0.5f, (Box.Min.Z + Box.Max.Z) * 0.5f);
+	}
+
+	/** Points with Dot(Normal, P) + D >= 0 are inside. */
+	struct FPlane
+	{
+		FVec3 Normal;
+		float D;
+	};
+
+	/** Convex volume bounded by up to six inward-facing planes. */
+	struct FFrustum
+	{
+		FPlane Planes[6];
+		int32_t NumPlanes;
+	};
+
+	enum class ECullResult : uint8_t
+	{
+		Outside,
+		Intersecting,
+		Inside,
+	};
+
+	/** Conservative box test: a box is only reported outside if it is entirely behind one plane. */
+	inline ECullResult TestAabb(const FFrustum& Frustum, const FAabb& Box)
+	{
+		ECullResult Result = ECullResult::Inside;
+		for (int32_t Index = 0; Index < Frustum.NumPlanes; ++Index)
+		{
+			const FPlane& Plane = Frustum.Planes[Index];
+
+			// Corner furthest along the normal, and the one furthest against it
+			const FVec3 Positive = MakeVec3(Plane.Normal.X >= 0.0f ? Box.Max.X : Box.Min.X, Plane.Normal.Y >= 0.0f ? Box.Max.Y : Box.Min.Y, Plane.Normal.Z >= 0.0f ? Box.Max.Z : Box.Min.Z);
+			if (Dot(Plane.Normal, Positive) + Plane.D < 0.0f)
+			{
+				return ECullResult::Outside;
+			}
+
+			const FVec3 Negative = MakeVec3(Plane.Normal.X >= 0.0f ? Box.Min.X : Box.Max.X, Plane.Normal.Y >= 0.0f ? Box.Min.Y : Box.Max.Y, Plane.Normal.Z >= 0.0f ? Box.Min.Z : Box.Max.Z);
+			if (Dot(Plane.Normal, Negative) + Plane.D < 0.0f)
+			{
+				Result = ECullResult::Intersecting;
+			}
+		}
+		return Result;
+	}
+
+	namespace Detail
+	{
+		/** Corners of the part of an eye's frustum at the given distance from the eye, along the screen normal. */
+		inline void GetSliceCorners(const FVec3 Corners[4], const FVec3& Eye, const FVec3& ViewDir, float Distance, FVec3 Out[4])
+		{
+			const float EyeToScreen = Dot(ViewDir, Sub(Corners[0], Eye));
+			const float Scale = Distance / EyeToScreen;
+			for (int32_t Index = 0; Index < 4; ++Index)
+			{
+				const FVec3 Ray = Sub(Corners[Index], Eye);
+				Out[Index] = MakeVec3(Eye.X + Ray.X * Scale, Eye.Y + Ray.Y * Scale, Eye.Z + Ray.Z * Scale);
+			}
+		}
+
+		/** Moves a plane back along its normal until every point is inside. Returns how far it moved. */
+		inline float EnclosePoints(FPlane& Plane, const FVec3* Points, int32_t NumPoints)
+		{
+			float MinDistance = 0.0f;
+			for (int32_t Index = 0; Index < NumPoints; ++Index)
+			{
+				MinDistance = std::min(MinDistance, Dot(Plane.Normal, Points[Index]) + Plane.D);
+			}
+			Plane.D -= MinDistance;
+			return -MinDistance;
+		}
+	}
+
+	/**
+	 * Builds one frustum that contains the off-axis frusta of every eye looking through a screen, each
+	 * clipped to [Near, Far] along the screen normal. Works in any space, whatever its handedness, as long
+	 * as the screen corners and eyes are given in the same one and every eye is in front of the screen.
+	 *
+	 * Every side plane passes through a screen edge, tilted like the edge plane of one of the eyes and
+	 * pushed out just far enough to contain the other eyes' frusta; the eye needing the smallest push wins.
+	 * Near and far planes are parallel to the screen and enclose every eye's near and far slice.
+	 */
+	inline FFrustum MakeUnionFrustum(const SterioProjection::FScreen& Screen, const FVec3* Eyes, int32_t NumEyes, float Near, float Far)
+	{
+		const FVec3 Pd = MakeVec3(Screen.Pb.X + Screen.Pc.X - Screen.Pa.X, Screen.Pb.Y + Screen.Pc.Y - Screen.Pa.Y, Screen.Pb.Z + Screen.Pc.Z - Screen.Pa.Z);
+		const FVec3 Corners[4] = { Screen.Pa, Screen.Pb, Pd, Screen.Pc };
+		const FVec3 Center = MakeVec3((Screen.Pa.X + Pd.X) * 0.5f, (Screen.Pa.Y + Pd.Y) * 0.5f, (Screen.Pa.Z + Pd.Z) * 0.5f);
+
+		// Screen normal pointing away from the eyes, into the scene
+		FVec3 ViewDir = Normalize(Cross(Sub(Screen.Pb, Screen.Pa), Sub(Screen.Pc, Screen.Pa)));
+		if (NumEyes > 0 && Dot(ViewDir, Sub(Center, Eyes[0])) < 0.0f)
+		{
+			ViewDir = MakeVec3(-ViewDir.X, -ViewDir.Y, -ViewDir.Z);
+		}
+
+		// The frustum of every eye is the convex hull of its near and far slices, so containing those contains the union
+		std::vector<FVec3> Points(NumEyes * 8);
+		for (int32_t Eye = 0; Eye < NumEyes; ++Eye)
+		{
+			Detail::GetSliceCorners(Corners, Eyes[Eye], ViewDir, Near, &Points[Eye * 8]);
+			Detail::GetSliceCorners(Corners, Eyes[Eye], ViewDir, Far, &Points[Eye * 8 + 4]);
+		}
+		const int32_t NumPoints = (int32_t)Points.size();
+
+		FFrustum Frustum;
+		Frustum.NumPlanes = 6;
+
+		for (int32_t Edge = 0; Edge < 4; ++Edge)
+		{
+			const FVec3& A = Corners[Edge];
+			const FVec3& B = Corners[(Edge + 1) % 4];
+
+			float BestPush = FLT_MAX;
+			for (int32_t Eye = 0; Eye < NumEyes; ++Eye)
+			{
+				FPlane Candidate;
+				Candidate.Normal = Normalize(Cross(Sub(B, A), Sub(Eyes[Eye], A)));
+				if (Dot(Candidate.Normal, Sub(Center, A)) < 0.0f)
+				{
+					Candidate.Normal = MakeVec3(-Candidate.Normal.X, -Candidate.Normal.Y, -Candidate.Normal.Z);
+				}
+				Candidate.D = -Dot(Candidate.Normal, A);
+
+				const float Push = Detail::EnclosePoints(Candidate, Points.data(), NumPoints);
+				if (Push < BestPush)
+				{
+					BestPush = Push;
+					Frustum.Planes[Edge] = Candidate;
+				}
+			}
+		}
+
+		FPlane& NearPlane = Frustum.Planes[4];
+		NearPlane.Normal = ViewDir;
+		NearPlane.D = -Dot(NearPlane.Normal, Points[0]);
+		Detail::EnclosePoints(NearPlane, Points.data(), NumPoints);
+
+		FPlane& FarPlane = Frustum.Planes[5];
+		FarPlane.Normal = MakeVec3(-ViewDir.X, -ViewDir.Y, -ViewDir.Z);
+		FarPlane.D = -Dot(FarPlane.Normal, Points[0]);
+		Detail::EnclosePoints(FarPlane, Points.data(), NumPoints);
+
+		return Frustum;
+	}
+
+	/** Indices of every box not entirely outside the frustum, in ascending order. */
+	inline void CullBruteForce(const FFrustum& Frustum, const FAabb* Boxes, int32_t NumBoxes, std::vector<int32_t>& OutVisible)
+	{
+		OutVisible.clear();
+		for (int32_t Index = 0; Index < NumBoxes; ++Index)
+		{
+			if (TestAabb(Frustum, Boxes[Index]) != ECullResult::Outside)
+			{
+				OutVisible.push_back(Index);
+			}
+		}
+	}
+
+	/**
+	 * Bounding volume hierarchy over a set of boxes, split at the median of the longest centroid axis.
+	 * Boxes that move without changing the set only need Refit; Build again when boxes come or go.
+	 */
+	class FBvh
+	{
+	public:
+		enum { MaxLeafSize = 4 };
+
+		void Build(const FAabb* Boxes, int32_t NumBoxes)
+		{
+			Nodes.clear();
+			Items.resize(NumBoxes);
+			for (int32_t Index = 0; Index < NumBoxes; ++Index)
+			{
+				Items[Index] = Index;
+			}
+			if (NumBoxes > 0)
+			{
+				Nodes.reserve(2 * (NumBoxes / MaxLeafSize + 1));
+				BuildNode(Boxes, 0, NumBoxes);
+			}
+		}
+
+		/** Recomputes every node's bounds bottom-up after boxes moved. Boxes must be the same set Build saw. */
+		void Refit(const FAabb* Boxes)
+		{
+			// Children always come after their parent, so a reverse walk sees them first
+			for (int32_t NodeIndex = (int32_t)Nodes.size() - 1; NodeIndex >= 0; --NodeIndex)
+			{
+				FNode& Node = Nodes[NodeIndex];
+				Node.Bounds = MakeEmptyAabb();
+				if (Node.Count > 0)
+				{
+					for (int32_t Index = 0; Index < Node.Count; ++Index)
+					{
+						Grow(Node.Bounds, Boxes[Items[Node.First + Index]]);
+					}
+				}
+				else
+				{
+					Grow(Node.Bounds, Nodes[NodeIndex + 1].Bounds);
+					Grow(Node.Bounds, Nodes[Node.First].Bounds);
+				}
+			}
+		}
+
+		/**
+		 * Same result as CullBruteForce, except that the indices are in hierarchy order. Subtrees entirely
+		 * inside the frustum are taken without testing their boxes. Returns the number of box tests made.
+		 */
+		int32_t Cull(const FFrustum& Frustum, const FAabb* Boxes, std::vector<int32_t>& OutVisible) const
+		{
+			OutVisible.clear();
+			int32_t NumTests = 0;
+			if (!Nodes.empty())
+			{
+				CullNode(0, Frustum, Boxes, OutVisible, NumTests);
+			}
+			return NumTests;
+		}
+
+		int32_t GetNumNodes() const { return (int32_t)Nodes.size(); }
+
+	private:
+		/** Inner nodes have Count 0, their first child right after them and their second child at First. */
+		struct FNode
+		{
+			FAabb Bounds;
+			int32_t First;
+			int32_t Count;
+		};
+
+		int32_t BuildNode(const FAabb* Boxes, int32_t Begin, int32_t End)
+		{
+			const int32_t NodeIndex = (int32_t)Nodes.size();
+			Nodes.push_back(FNode());
+
+			FAabb Bounds = MakeEmptyAabb();
+			FAabb Centroids = MakeEmptyAabb();
+			for (int32_t Index = Begin; Index < End; ++Index)
+			{
+				const FAabb& Box = Boxes[Items[Index]];
+				const FVec3 Center = GetCenter(Box);
+				const FAabb CenterBox = { Center, Center };
+				Grow(Bounds, Box);
+				Grow(Centroids, CenterBox);
+			}
+			Nodes[NodeIndex].Bounds = Bounds;
+
+			if (End - Begin <= MaxLeafSize)
+			{
+				Nodes[NodeIndex].First = Begin;
+				Nodes[NodeIndex].Count = End - Begin;
+				return NodeIndex;
+			}
+
+			const FVec3 Extent = Sub(Centroids.Max, Centroids.Min);
+			const int32_t Axis = (Extent.X >= Extent.Y && Extent.X >= Extent.Z) ? 0 : (Extent.Y >= Extent.Z ? 1 : 2);
+			const int32_t Middle = Begin + (End - Begin) / 2;
+			std::nth_element(Items.begin() + Begin, Items.begin() + Middle, Items.begin() + End, [Boxes, Axis](int32_t A, int32_t B)
+			{
+				const FVec3 CenterA = GetCenter(Boxes[A]);
+				const FVec3 CenterB = GetCenter(Boxes[B]);
+				return (&CenterA.X)[Axis] < (&CenterB.X)[Axis];
+			});
+
+			BuildNode(Boxes, Begin, Middle);
+			const int32_t SecondChild = BuildNode(Boxes, Middle, End);
+			Nodes[NodeIndex].First = SecondChild;
+			Nodes[NodeIndex].Count = 0;
+			return NodeIndex;
+		}
+
+		void CullNode(int32_t NodeIndex, const FFrustum& Frustum, const FAabb* Boxes, std::vector<int32_t>& OutVisible, int32_t& NumTests) const
+		{
+			const FNode& Node = Nodes[NodeIndex];
+			++NumTests;
+			const ECullResult Result = TestAabb(Frustum, Node.Bounds);
+			if (Result == ECullResult::Outside)
+			{
+				return;
+			}
+
+			if (Result == ECullResult::Inside)
+			{
+				AppendSubtree(NodeIndex, OutVisible);
+				return;
+			}
+
+			if (Node.Count > 0)
+			{
+				for (int32_t Index = 0; Index < Node.Count; ++Index)
+				{
+					const int32_t Item = Items[Node.First + Index];
+					++NumTests;
+					if (TestAabb(Frustum, Boxes[Item]) != ECullResult::Outside)
+					{
+						OutVisible.push_back(Item);
+					}
+				}
+				return;
+			}
+
+			CullNode(NodeIndex + 1, Frustum, Boxes, OutVisible, NumTests);
+			CullNode(Node.First, Frustum, Boxes, OutVisible, NumTests);
+		}
+
+		void AppendSubtree(int32_t NodeIndex, std::vector<int32_t>& OutVisible) const
+		{
+			const FNode& Node = Nodes[NodeIndex];
+			if (Node.Count > 0)
+			{
+				OutVisible.insert(OutVisible.end(), Items.begin() + Node.First, Items.begin() + Node.First + Node.Count);
+				return;
+			}
+			AppendSubtree(NodeIndex + 1, OutVisible);
+			AppendSubtree(Node.First, OutVisible);
+		}
+
+		std::vector<FNode> Nodes;
+		std::vector<int32_t> Items;
+	};
+}
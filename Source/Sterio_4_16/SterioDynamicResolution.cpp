@@ -0,0 +1,69 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioDynamicResolution.h"
+#include "RenderCore.h"
+#include "RHI.h"
+
+FSterioResolutionController::FSterioResolutionController()
+{
+	Configure(FSterioResolutionSettings());
+}
+
+void FSterioResolutionController::Configure(const FSterioResolutionSettings& InSettings)
+{
+	Settings = InSettings;
+	Settings.MaxScale = FMath::Max(Settings.MaxScale, Settings.MinScale);
+	NumSteps = FMath::CeilToInt((Settings.MaxScale - Settings.MinScale) / Settings.StepSize - KINDA_SMALL_NUMBER) + 1;
+	Step = NumSteps - 1;
+	SmoothedFrameTimeMs = 0.f;
+	FramesOverBudget = 0;
+	FramesUnderBudget = 0;
+}
+
+float FSterioResolutionController::GetStepScale(int32 InStep) const
+{
+	// The last step is exactly MaxScale even when the range isn't a multiple of StepSize
+	return (InStep >= NumSteps - 1) ? Settings.MaxScale : Settings.MinScale + InStep * Settings.StepSize;
+}
+
+bool FSterioResolutionController::Update(float FrameTimeMs)
+{
+	if (FrameTimeMs <= 0.f)
+	{
+		return false;
+	}
+
+	SmoothedFrameTimeMs = (SmoothedFrameTimeMs > 0.f) ? FMath::Lerp(SmoothedFrameTimeMs, FrameTimeMs, 0.1f) : FrameTimeMs;
+
+	const float Ratio = SmoothedFrameTimeMs / Settings.TargetFrameTimeMs;
+	FramesOverBudget = (Ratio > Settings.DownscaleThreshold) ? FramesOverBudget + 1 : 0;
+	FramesUnderBudget = (Ratio < Settings.UpscaleThreshold) ? FramesUnderBudget + 1 : 0;
+
+	int32 NewStep = Step;
+	if (FramesOverBudget >= Settings.SettleFrames)
+	{
+		NewStep = FMath::Max(Step - 1, 0);
+	}
+	else if (FramesUnderBudget >= Settings.SettleFrames)
+	{
+		NewStep = FMath::Min(Step + 1, NumSteps - 1);
+	}
+
+	if (NewStep == Step)
+	{
+		return false;
+	}
+
+	// Timings measured at the old scale say nothing about the new one
+	Step = NewStep;
+	SmoothedFrameTimeMs = 0.f;
+	FramesOverBudget = 0;
+	FramesUnderBudget = 0;
+	return true;
+}
+
+float FSterioResolutionController::SampleFrameTimeMs()
+{
+	const uint32 Cycles = FMath::Max3(GGameThreadTime, GRenderThreadTime, RHIGetGPUFrameCycles());
+	return (float)FPlatformTime::ToMilliseconds(Cycles);
+}
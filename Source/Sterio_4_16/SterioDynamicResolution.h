@@ -0,0 +1,82 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SterioDynamicResolution.generated.h"
+
+USTRUCT(BlueprintType)
+struct FSterioResolutionSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioResolution)
+	bool bEnabled = false;
+
+	/** Frame time the rig has to fit in, in ms */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioResolution, meta = (ClampMin = "1.0"))
+	float TargetFrameTimeMs = 16.6f;
+
+	/** Smallest fraction of the authored render target size the eyes may drop to */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioResolution, meta = (ClampMin = "0.1", ClampMax = "1.0"))
+	float MinScale = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioResolution, meta = (ClampMin = "0.1", ClampMax = "1.0"))
+	float MaxScale = 1.f;
+
+	/** Scale change per step; every step has its own pooled targets */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioResolution, meta = (ClampMin = "0.05", ClampMax = "0.5"))
+	float StepSize = 0.125f;
+
+	/** Resolution drops when the smoothed frame time exceeds this fraction of the target */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioResolution, meta = (ClampMin = "0.5", ClampMax = "2.0"))
+	float DownscaleThreshold = 1.f;
+
+	/** Resolution rises when the smoothed frame time stays under this fraction of the target */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioResolution, meta = (ClampMin = "0.1", ClampMax = "1.0"))
+	float UpscaleThreshold = 0.75f;
+
+	/** Frames a threshold has to be crossed in a row before the scale steps */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioResolution, meta = (ClampMin = "1"))
+	int32 SettleFrames = 30;
+
+	/** Texture parameter of the eye materials that samples the render target */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioResolution)
+	FName TextureParameterName = TEXT("Texture");
+};
+
+/**
+ * Picks the eye render target scale from frame timings.
+ *
+ * Scales are quantised into steps between MinScale and MaxScale so that each step can keep its targets
+ * around. The two thresholds and the settle frames give the hysteresis: a frame time between the
+ * thresholds, or a short spike across one, never changes the scale.
+ */
+class FSterioResolutionController
+{
+public:
+	FSterioResolutionController();
+
+	/** Applies new settings and goes back to the largest step. */
+	void Configure(const FSterioResolutionSettings& InSettings);
+
+	/** Feeds the frame time of the last frame. Returns true if the scale stepped. */
+	bool Update(float FrameTimeMs);
+
+	int32 GetNumSteps() const { return NumSteps; }
+	int32 GetStep() const { return Step; }
+	float GetScale() const { return GetStepScale(Step); }
+	float GetStepScale(int32 InStep) const;
+	float GetSmoothedFrameTimeMs() const { return SmoothedFrameTimeMs; }
+
+	/** Slowest of the game thread, render thread and GPU over the last completed frame, in ms. */
+	static float SampleFrameTimeMs();
+
+private:
+	FSterioResolutionSettings Settings;
+	int32 NumSteps;
+	int32 Step;
+	float SmoothedFrameTimeMs;
+	int32 FramesOverBudget;
+	int32 FramesUnderBudget;
+};
@@ -0,0 +1,383 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+// Stereo frame packing: combines a left and a right eye image into the single frame a 3D display expects.
+//
+// Like the projection kernels this header has no engine dependency, so it runs equally on render target
+// readbacks and on offline frames. Pixels are 32-bit BGRA words as laid out by FColor (A in the top byte,
+// B in the bottom one). Every format is frame compatible: the packed frame has the size of one eye image.
+// Half-float RGBA images, the engine's default render target format, are converted to that layout first.
+
+#include "SterioProjectionKernel.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace SterioPacking
+{
+	using SterioProjection::EKernel;
+	using SterioProjection::GetBestKernel;
+	using SterioProjection::IsKernelAvailable;
+
+	enum class EFormat : uint8_t
+	{
+		/** Left eye squeezed into the left half, right eye into the right half */
+		SideBySide,
+		/** Left eye squeezed into the top half, right eye into the bottom half */
+		TopBottom,
+		/** Even rows from the left eye, odd rows from the right (line-interleaved passive displays) */
+		RowInterleaved,
+		/** Even columns from the left eye, odd columns from the right */
+		ColumnInterleaved,
+		/** Pixels whose x + y is even from the left eye, the others from the right (DLP checkerboard) */
+		Checkerboard,
+		/** Channels in the anaglyph mask from the left eye, the rest from the right; red/cyan by default */
+		Anaglyph,
+	};
+
+	struct FConstImage
+	{
+		const uint32_t* Pixels;
+		int32_t Width, Height;
+		/** Distance between rows, in pixels */
+		int32_t Stride;
+	};
+
+	struct FImage
+	{
+		uint32_t* Pixels;
+		int32_t Width, Height;
+		int32_t Stride;
+	};
+
+	/** Four 16-bit floats per pixel, R first, as PF_FloatRGBA lays them out */
+	struct FConstHalfImage
+	{
+		const uint16_t* Pixels;
+		int32_t Width, Height;
+		/** Distance between rows, in pixels */
+		int32_t Stride;
+	};
+
+	/** Left eye takes red and alpha, the right eye green and blue. */
+	const uint32_t RedCyanMask = 0xFFFF0000u;
+
+	namespace Detail
+	{
+		/** Per-byte rounded average, the same rounding as _mm_avg_epu8. */
+		inline uint32_t Average(uint32_t A, uint32_t B)
+		{
+			return (A | B) - (((A ^ B) & 0xFEFEFEFEu) >> 1);
+		}
+
+		/** Out[i] = average of Src[2i] and Src[2i+1], Src[] clamped to SrcWidth. */
+		inline void SqueezeRowScalar(const uint32_t* Src, int32_t SrcWidth, uint32_t* Out, int32_t First, int32_t Count)
+		{
+			for (int32_t Index = First; Index < Count; ++Index)
+			{
+				const int32_t X0 = 2 * Index < SrcWidth ? 2 * Index : SrcWidth - 1;
+				const int32_t X1 = 2 * Index + 1 < SrcWidth ? 2 * Index + 1 : SrcWidth - 1;
+				Out[Index] = Average(Src[X0], Src[X1]);
+			}
+		}
+
+		inline void AverageRowsScalar(const uint32_t* A, const uint32_t* B, uint32_t* Out, int32_t First, int32_t Count)
+		{
+			for (int32_t Index = First; Index < Count; ++Index)
+			{
+				Out[Index] = Average(A[Index], B[Index]);
+			}
+		}
+
+		/** Takes the bits of MaskEven (even x) or MaskOdd (odd x) from Left and the others from Right. */
+		inline void SelectRowScalar(const uint32_t* Left, const uint32_t* Right, uint32_t* Out, int32_t First, int32_t Count, uint32_t MaskEven, uint32_t MaskOdd)
+		{
+			for (int32_t Index = First; Index < Count; ++Index)
+			{
+				const uint32_t Mask = (Index & 1) ? MaskOdd : MaskEven;
+				Out[Index] = (Left[Index] & Mask) | (Right[Index] & ~Mask);
+			}
+		}
+
+#if STERIO_PROJECTION_SSE
+		inline int32_t SqueezeRowSSE(const uint32_t* Src, uint32_t* Out, int32_t Count)
+		{
+			int32_t Index = 0;
+			for (; Index + 4 <= Count; Index += 4)
+			{
+				const __m128 A = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(Src + 2 * Index)));
+				const __m128 B = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(Src + 2 * Index + 4)));
+				const __m128i Even = _mm_castps_si128(_mm_shuffle_ps(A, B, _MM_SHUFFLE(2, 0, 2, 0)));
+				const __m128i Odd = _mm_castps_si128(_mm_shuffle_ps(A, B, _MM_SHUFFLE(3, 1, 3, 1)));
+				_mm_storeu_si128((__m128i*)(Out + Index), _mm_avg_epu8(Even, Odd));
+			}
+			return Index;
+		}
+
+		inline int32_t AverageRowsSSE(const uint32_t* A, const uint32_t* B, uint32_t* Out, int32_t Count)
+		{
+			int32_t Index = 0;
+			for (; Index + 4 <= Count; Index += 4)
+			{
+				const __m128i VA = _mm_loadu_si128((const __m128i*)(A + Index));
+				const __m128i VB = _mm_loadu_si128((const __m128i*)(B + Index));
+				_mm_storeu_si128((__m128i*)(Out + Index), _mm_avg_epu8(VA, VB));
+			}
+			return Index;
+		}
+
+		inline int32_t SelectRowSSE(const uint32_t* Left, const uint32_t* Right, uint32_t* Out, int32_t Count, uint32_t MaskEven, uint32_t MaskOdd)
+		{
+			const __m128i Mask = _mm_set_epi32((int)MaskOdd, (int)MaskEven, (int)MaskOdd, (int)MaskEven);
+			int32_t Index = 0;
+			for (; Index + 4 <= Count; Index += 4)
+			{
+				const __m128i L = _mm_loadu_si128((const __m128i*)(Left + Index));
+				const __m128i R = _mm_loadu_si128((const __m128i*)(Right + Index));
+				_mm_storeu_si128((__m128i*)(Out + Index), _mm_or_si128(_mm_and_si128(Mask, L), _mm_andnot_si128(Mask, R)));
+			}
+			return Index;
+		}
+#endif
+
+#if STERIO_PROJECTION_AVX2
+		inline int32_t SqueezeRowAVX2(const uint32_t* Src, uint32_t* Out, int32_t Count)
+		{
+			int32_t Index = 0;
+			for (; Index + 8 <= Count; Index += 8)
+			{
+				const __m256 A = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)(Src + 2 * Index)));
+				const __m256 B = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)(Src + 2 * Index + 8)));
+				// The shuffles work per 128-bit lane, leaving the pixels in 0 1 4 5 2 3 6 7 order of 64-bit pairs
+				const __m256i Even = _mm256_castps_si256(_mm256_shuffle_ps(A, B, _MM_SHUFFLE(2, 0, 2, 0)));
+				const __m256i Odd = _mm256_castps_si256(_mm256_shuffle_ps(A, B, _MM_SHUFFLE(3, 1, 3, 1)));
+				const __m256i Averaged = _mm256_permute4x64_epi64(_mm256_avg_epu8(Even, Odd), _MM_SHUFFLE(3, 1, 2, 0));
+				_mm256_storeu_si256((__m256i*)(Out + Index), Averaged);
+			}
+			return Index;
+		}
+
+		inline int32_t AverageRowsAVX2(const uint32_t* A, const uint32_t* B, uint32_t* Out, int32_t Count)
+		{
+			int32_t Index = 0;
+			for (; Index + 8 <= Count; Index += 8)
+			{
+				const __m256i VA = _mm256_loadu_si256((const __m256i*)(A + Index));
+				const __m256i VB = _mm256_loadu_si256((const __m256i*)(B + Index));
+				_mm256_storeu_si256((__m256i*)(Out + Index), _mm256_avg_epu8(VA, VB));
+			}
+			return Index;
+		}
+
+		inline int32_t SelectRowAVX2(const uint32_t* Left, const uint32_t* Right, uint32_t* Out, int32_t Count, uint32_t MaskEven, uint32_t MaskOdd)
+		{
+			const __m256i Mask = _mm256_set_epi32((int)MaskOdd, (int)MaskEven, (int)MaskOdd, (int)MaskEven, (int)MaskOdd, (int)MaskEven, (int)MaskOdd, (int)MaskEven);
+			int32_t Index = 0;
+			for (; Index + 8 <= Count; Index += 8)
+			{
+				const __m256i L = _mm256_loadu_si256((const __m256i*)(Left + Index));
+				const __m256i R = _mm256_loadu_si256((const __m256i*)(Right + Index));
+				_mm256_storeu_si256((__m256i*)(Out + Index), _mm256_or_si256(_mm256_and_si256(Mask, L), _mm256_andnot_si256(Mask, R)));
+			}
+			return Index;
+		}
+#endif
+
+		/** Squeezes Count output pixels out of a SrcWidth-wide row; the vector kernels stop at the last full pixel pair. */
+		inline void SqueezeRow(EKernel Kernel, const uint32_t* Src, int32_t SrcWidth, uint32_t* Out, int32_t Count)
+		{
+			int32_t Done = 0;
+#if STERIO_PROJECTION_SSE
+			const int32_t Paired = SrcWidth / 2 < Count ? SrcWidth / 2 : Count;
+#else
+			(void)Kernel;
+#endif
+#if STERIO_PROJECTION_AVX2
+			if (Kernel == EKernel::AVX2)
+			{
+				Done = SqueezeRowAVX2(Src, Out, Paired);
+			}
+#endif
+#if STERIO_PROJECTION_SSE
+			if (Kernel != EKernel::Scalar)
+			{
+				Done += SqueezeRowSSE(Src + 2 * Done, Out + Done, Paired - Done);
+			}
+#endif
+			SqueezeRowScalar(Src, SrcWidth, Out, Done, Count);
+		}
+
+		inline void AverageRows(EKernel Kernel, const uint32_t* A, const uint32_t* B, uint32_t* Out, int32_t Count)
+		{
+			int32_t Done = 0;
+#if !STERIO_PROJECTION_SSE
+			(void)Kernel;
+#endif
+#if STERIO_PROJECTION_AVX2
+			if (Kernel == EKernel::AVX2)
+			{
+				Done = AverageRowsAVX2(A, B, Out, Count);
+			}
+#endif
+#if STERIO_PROJECTION_SSE
+			if (Kernel != EKernel::Scalar)
+			{
+				Done += AverageRowsSSE(A + Done, B + Done, Out + Done, Count - Done);
+			}
+#endif
+			AverageRowsScalar(A, B, Out, Done, Count);
+		}
+
+		inline void SelectRow(EKernel Kernel, const uint32_t* Left, const uint32_t* Right, uint32_t* Out, int32_t Count, uint32_t MaskEven, uint32_t MaskOdd)
+		{
+			// The vector kernels always start on an even pixel, so the mask phase carries over
+			int32_t Done = 0;
+#if !STERIO_PROJECTION_SSE
+			(void)Kernel;
+#endif
+#if STERIO_PROJECTION_AVX2
+			if (Kernel == EKernel::AVX2)
+			{
+				Done = SelectRowAVX2(Left, Right, Out, Count, MaskEven, MaskOdd);
+			}
+#endif
+#if STERIO_PROJECTION_SSE
+			if (Kernel != EKernel::Scalar)
+			{
+				Done += SelectRowSSE(Left + Done, Right + Done, Out + Done, Count - Done, MaskEven, MaskOdd);
+			}
+#endif
+			SelectRowScalar(Left, Right, Out, Done, Count, MaskEven, MaskOdd);
+		}
+	}
+
+	/**
+	 * Packs two eye images into Out. All three images must have the same size; returns false otherwise.
+	 * Squeezed formats average each pair of source pixels or rows; the second half gets the odd pixel of an odd size.
+	 * Kernels that were not compiled in fall back to the widest available one, and every kernel gives identical results.
+	 */
+	inline bool Pack(EFormat Format, const FConstImage& Left, const FConstImage& Right, const FImage& Out, EKernel Kernel = GetBestKernel(), uint32_t AnaglyphMask = RedCyanMask)
+	{
+		const int32_t Width = Out.Width;
+		const int32_t Height = Out.Height;
+		if (Left.Width != Width || Right.Width != Width || Left.Height != Height || Right.Height != Height || Width <= 0 || Height <= 0)
+		{
+			return false;
+		}
+
+		if (!IsKernelAvailable(Kernel))
+		{
+			Kernel = GetBestKernel();
+		}
+
+		const uint32_t All = 0xFFFFFFFFu;
+		for (int32_t Y = 0; Y < Height; ++Y)
+		{
+			const uint32_t* LeftRow = Left.Pixels + (ptrdiff_t)Y * Left.Stride;
+			const uint32_t* RightRow = Right.Pixels + (ptrdiff_t)Y * Right.Stride;
+			uint32_t* OutRow = Out.Pixels + (ptrdiff_t)Y * Out.Stride;
+
+			switch (Format)
+			{
+			case EFormat::SideBySide:
+			{
+				const int32_t Half = Width / 2;
+				Detail::SqueezeRow(Kernel, LeftRow, Width, OutRow, Half);
+				Detail::SqueezeRow(Kernel, RightRow, Width, OutRow + Half, Width - Half);
+				break;
+			}
+			case EFormat::TopBottom:
+			{
+				const int32_t Half = Height / 2;
+				const FConstImage& Source = (Y < Half) ? Left : Right;
+				const int32_t SourceY = 2 * (Y < Half ? Y : Y - Half);
+				const int32_t NextY = SourceY + 1 < Height ? SourceY + 1 : Height - 1;
+				Detail::AverageRows(Kernel, Source.Pixels + (ptrdiff_t)SourceY * Source.Stride, Source.Pixels + (ptrdiff_t)NextY * Source.Stride, OutRow, Width);
+				break;
+			}
+			case EFormat::RowInterleaved:
+				std::memcpy(OutRow, (Y & 1) ? RightRow : LeftRow, (size_t)Width * sizeof(uint32_t));
+				break;
+			case EFormat::ColumnInterleaved:
+				Detail::SelectRow(Kernel, LeftRow, RightRow, OutRow, Width, All, 0u);
+				break;
+			case EFormat::Checkerboard:
+				Detail::SelectRow(Kernel, LeftRow, RightRow, OutRow, Width, (Y & 1) ? 0u : All, (Y & 1) ? All : 0u);
+				break;
+			case EFormat::Anaglyph:
+				Detail::SelectRow(Kernel, LeftRow, RightRow, OutRow, Width, AnaglyphMask, AnaglyphMask);
+				break;
+			}
+		}
+		return true;
+	}
+
+	inline float HalfToFloat(uint16_t Half)
+	{
+		const uint32_t Sign = (uint32_t)(Half & 0x8000u) << 16;
+		const uint32_t Exponent = (Half >> 10) & 0x1Fu;
+		const uint32_t Mantissa = Half & 0x3FFu;
+		if (Exponent == 0)
+		{
+			// Zero or subnormal: Mantissa * 2^-24
+			const float Value = Mantissa * (1.f / 16777216.f);
+			return Sign ? -Value : Value;
+		}
+
+		const uint32_t Bits = Sign | (Exponent == 31 ? 0x7F800000u : (Exponent + 112) << 23) | (Mantissa << 13);
+		float Value;
+		std::memcpy(&Value, &Bits, sizeof(Value));
+		return Value;
+	}
+
+	/**
+	 * Converts half-float RGBA pixels to BGRA words through a table per channel kind, indexed by the half's bits.
+	 * The bytes are those FLinearColor::ToFColor gives, which is also what the engine's readback of a float target
+	 * gives: clamped to [0, 1] (NaN to 1) and, for sRGB, color but not alpha gamma encoded.
+	 */
+	class FHalfToBGRA
+	{
+	public:
+		explicit FHalfToBGRA(bool bSRGB)
+		{
+			for (uint32_t Bits = 0; Bits < 65536; ++Bits)
+			{
+				const float Value = HalfToFloat((uint16_t)Bits);
+				const float Clamped = Value < 0.f ? 0.f : (Value < 1.f ? Value : 1.f);
+				const float Encoded = (!bSRGB || Clamped <= 0.0031308f) ? (bSRGB ? Clamped * 12.92f : Clamped) : std::pow(Clamped, 1.f / 2.4f) * 1.055f - 0.055f;
+				Color[Bits] = (uint8_t)(int32_t)std::floor(Encoded * 255.999f);
+				Alpha[Bits] = (uint8_t)(int32_t)std::floor(Clamped * 255.999f);
+			}
+		}
+
+		uint32_t ConvertPixel(const uint16_t* RGBA) const
+		{
+			return ((uint32_t)Alpha[RGBA[3]] << 24) | ((uint32_t)Color[RGBA[0]] << 16) | ((uint32_t)Color[RGBA[1]] << 8) | Color[RGBA[2]];
+		}
+
+		/** Both images must have the same size; returns false otherwise. */
+		bool Convert(const FConstHalfImage& Source, const FImage& Out) const
+		{
+			if (Source.Width != Out.Width || Source.Height != Out.Height || Out.Width <= 0 || Out.Height <= 0)
+			{
+				return false;
+			}
+
+			for (int32_t Y = 0; Y < Out.Height; ++Y)
+			{
+				const uint16_t* SourceRow = Source.Pixels + (ptrdiff_t)Y * Source.Stride * 4;
+				uint32_t* OutRow = Out.Pixels + (ptrdiff_t)Y * Out.Stride;
+				for (int32_t X = 0; X < Out.Width; ++X)
+				{
+					OutRow[X] = ConvertPixel(SourceRow + 4 * X);
+				}
+			}
+			return true;
+		}
+
+	private:
+		uint8_t Color[65536];
+		uint8_t Alpha[65536];
+	};
+}
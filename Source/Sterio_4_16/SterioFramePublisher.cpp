@@ -0,0 +1,209 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioFramePublisher.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Misc/CoreDelegates.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "TextureResource.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioTransport, Log, All);
+
+FSterioFramePublisher::FSterioFramePublisher()
+	: Format(SterioPacking::EFormat::SideBySide)
+	, NextStagingPair(0)
+	, QueuedFrameNumber(0)
+{
+}
+
+FSterioFramePublisher::~FSterioFramePublisher()
+{
+	Shutdown();
+}
+
+bool FSterioFramePublisher::Start(const FString& Name, int32 NumSlots, int32 MaxWidth, int32 MaxHeight, SterioPacking::EFormat InFormat)
+{
+	Shutdown();
+
+	if (!Producer.Create(TCHAR_TO_UTF8(*Name), (uint32)FMath::Max(2, NumSlots), (uint32)FMath::Max(1, MaxWidth), (uint32)FMath::Max(1, MaxHeight)))
+	{
+		UE_LOG(LogSterioTransport, Error, TEXT("Could not create the shared memory frame ring %s"), *Name);
+		return false;
+	}
+
+	Format = InFormat;
+	NextStagingPair = 0;
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FSterioFramePublisher::OnEndFrame);
+	UE_LOG(LogSterioTransport, Log, TEXT("Publishing %dx%d stereo frames to %s"), MaxWidth, MaxHeight, *Name);
+	return true;
+}
+
+void FSterioFramePublisher::Shutdown()
+{
+	if (EndFrameHandle.IsValid())
+	{
+		FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+		EndFrameHandle.Reset();
+	}
+
+	if (Producer.IsOpen())
+	{
+		// The render thread may still be writing into the ring; pairs still staged are dropped
+		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+			SterioReleaseStaging,
+			FSterioFramePublisher*, Publisher, this,
+			{
+				for (FStagingPair& Pair : Publisher->StagingPairs)
+				{
+					Pair = FStagingPair();
+				}
+			});
+		FlushRenderingCommands();
+		Producer.Close();
+	}
+
+	QueuedLeft.Reset();
+	QueuedRight.Reset();
+}
+
+void FSterioFramePublisher::QueueFrame(UTextureRenderTarget2D* Left, UTextureRenderTarget2D* Right, uint64 FrameNumber)
+{
+	QueuedLeft = Left;
+	QueuedRight = Right;
+	QueuedFrameNumber = FrameNumber;
+}
+
+void FSterioFramePublisher::OnEndFrame()
+{
+	// Staged pairs have to be published even on frames that queue nothing new
+	UTextureRenderTarget2D* Left = QueuedLeft.Get();
+	UTextureRenderTarget2D* Right = QueuedRight.Get();
+	QueuedLeft.Reset();
+	QueuedRight.Reset();
+	const bool bQueued = Left && Right;
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_FOURPARAMETER(
+		SterioPublishFrame,
+		FSterioFramePublisher*, Publisher, this,
+		FTextureRenderTargetResource*, LeftResource, bQueued ? Left->GameThread_GetRenderTargetResource() : nullptr,
+		FTextureRenderTargetResource*, RightResource, bQueued ? Right->GameThread_GetRenderTargetResource() : nullptr,
+		uint64, FrameNumber, QueuedFrameNumber,
+		{
+			Publisher->UpdateOnRenderThread(RHICmdList, LeftResource, RightResource, FrameNumber);
+		});
+}
+
+void FSterioFramePublisher::UpdateOnRenderThread(FRHICommandListImmediate& RHICmdList, FTextureRenderTargetResource* Left, FTextureRenderTargetResource* Right, uint64 FrameNumber)
+{
+	// Oldest first, so frames reach the ring in order
+	for (int32 Offset = 0; Offset < NumStagingPairs; ++Offset)
+	{
+		FStagingPair& Pair = StagingPairs[(NextStagingPair + Offset) % NumStagingPairs];
+		if (Pair.bPending && GFrameNumberRenderThread - Pair.CopiedFrame >= (uint32)ReadbackLatency)
+		{
+			PublishStagedOnRenderThread(RHICmdList, Pair);
+		}
+	}
+
+	if (Left && Right)
+	{
+		StageOnRenderThread(RHICmdList, Left, Right, FrameNumber);
+	}
+}
+
+void FSterioFramePublisher::StageOnRenderThread(FRHICommandListImmediate& RHICmdList, FTextureRenderTargetResource* Left, FTextureRenderTargetResource* Right, uint64 FrameNumber)
+{
+	const FTexture2DRHIRef& LeftTexture = Left->GetRenderTargetTexture();
+	const FTexture2DRHIRef& RightTexture = Right->GetRenderTargetTexture();
+	const FIntPoint Size = Left->GetSizeXY();
+	if (!LeftTexture || !RightTexture || Right->GetSizeXY() != Size)
+	{
+		return;
+	}
+	const EPixelFormat PixelFormat = LeftTexture->GetFormat();
+	if ((PixelFormat != PF_B8G8R8A8 && PixelFormat != PF_FloatRGBA) || RightTexture->GetFormat() != PixelFormat)
+	{
+		Unsupported.Increment();
+		return;
+	}
+
+	// Every older pair was published above, so the oldest pair is free; a new target size or format needs new staging textures
+	FStagingPair& Pair = StagingPairs[NextStagingPair];
+	NextStagingPair = (NextStagingPair + 1) % NumStagingPairs;
+	check(!Pair.bPending);
+	if (!Pair.Left || Pair.Size != Size || Pair.PixelFormat != PixelFormat)
+	{
+		FRHIResourceCreateInfo CreateInfo;
+		Pair.Left = RHICreateTexture2D(Size.X, Size.Y, PixelFormat, 1, 1, TexCreate_CPUReadback, CreateInfo);
+		Pair.Right = RHICreateTexture2D(Size.X, Size.Y, PixelFormat, 1, 1, TexCreate_CPUReadback, CreateInfo);
+		Pair.Size = Size;
+		Pair.PixelFormat = PixelFormat;
+	}
+
+	// The captures were submitted earlier in this render frame; the copies queue up behind them on the GPU
+	RHICmdList.CopyToResolveTarget(LeftTexture, Pair.Left, true, FResolveParams());
+	RHICmdList.CopyToResolveTarget(RightTexture, Pair.Right, true, FResolveParams());
+	Pair.FrameNumber = FrameNumber;
+	Pair.CopiedFrame = GFrameNumberRenderThread;
+	Pair.bPending = true;
+}
+
+void FSterioFramePublisher::PublishStagedOnRenderThread(FRHICommandListImmediate& RHICmdList, FStagingPair& Pair)
+{
+	Pair.bPending = false;
+
+	// Mapped rows may be padded; the mapped width is the row pitch in pixels
+	void* LeftData = nullptr;
+	void* RightData = nullptr;
+	int32 LeftStride = 0, RightStride = 0, MappedHeight = 0;
+	RHICmdList.MapStagingSurface(Pair.Left, LeftData, LeftStride, MappedHeight);
+	RHICmdList.MapStagingSurface(Pair.Right, RightData, RightStride, MappedHeight);
+
+	if (LeftData && RightData && LeftStride >= Pair.Size.X && RightStride >= Pair.Size.X)
+	{
+		uint32* Slot = Producer.BeginWrite((uint32)Pair.Size.X, (uint32)Pair.Size.Y, (uint32)Format);
+		if (Slot)
+		{
+			SterioPacking::FConstImage LeftImage = { (const uint32*)LeftData, Pair.Size.X, Pair.Size.Y, LeftStride };
+			SterioPacking::FConstImage RightImage = { (const uint32*)RightData, Pair.Size.X, Pair.Size.Y, RightStride };
+			if (Pair.PixelFormat == PF_FloatRGBA)
+			{
+				ConvertHalfPair(Pair, LeftData, LeftStride, RightData, RightStride, LeftImage, RightImage);
+			}
+
+			const SterioPacking::FImage Out = { Slot, Pair.Size.X, Pair.Size.Y, Pair.Size.X };
+			SterioPacking::Pack(Format, LeftImage, RightImage, Out);
+			Producer.EndWrite(Pair.FrameNumber);
+		}
+		else
+		{
+			Oversized.Increment();
+		}
+	}
+
+	RHICmdList.UnmapStagingSurface(Pair.Left);
+	RHICmdList.UnmapStagingSurface(Pair.Right);
+}
+
+void FSterioFramePublisher::ConvertHalfPair(const FStagingPair& Pair, const void* LeftData, int32 LeftStride, const void* RightData, int32 RightStride, SterioPacking::FConstImage& OutLeft, SterioPacking::FConstImage& OutRight)
+{
+	if (!HalfToBGRA.IsValid())
+	{
+		// The same gamma encoding ReadPixels applies to float targets
+		HalfToBGRA = MakeUnique<SterioPacking::FHalfToBGRA>(true);
+	}
+
+	const int32 NumPixels = Pair.Size.X * Pair.Size.Y;
+	LeftConverted.SetNumUninitialized(NumPixels, false);
+	RightConverted.SetNumUninitialized(NumPixels, false);
+
+	const SterioPacking::FConstHalfImage LeftHalf = { (const uint16*)LeftData, Pair.Size.X, Pair.Size.Y, LeftStride };
+	const SterioPacking::FConstHalfImage RightHalf = { (const uint16*)RightData, Pair.Size.X, Pair.Size.Y, RightStride };
+	const SterioPacking::FImage LeftOut = { LeftConverted.GetData(), Pair.Size.X, Pair.Size.Y, Pair.Size.X };
+	const SterioPacking::FImage RightOut = { RightConverted.GetData(), Pair.Size.X, Pair.Size.Y, Pair.Size.X };
+	HalfToBGRA->Convert(LeftHalf, LeftOut);
+	HalfToBGRA->Convert(RightHalf, RightOut);
+
+	OutLeft = { LeftConverted.GetData(), Pair.Size.X, Pair.Size.Y, Pair.Size.X };
+	OutRight = { RightConverted.GetData(), Pair.Size.X, Pair.Size.Y, Pair.Size.X };
+}
@@ -0,0 +1,93 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "RHI.h"
+#include "SterioFramePacking.h"
+#include "SterioFrameTransport.h"
+
+class FRHICommandListImmediate;
+class FTextureRenderTargetResource;
+class UTextureRenderTarget2D;
+
+/**
+ * Publishes one screen's eye pair, packed, into a SterioTransport shared-memory ring for an external
+ * compositor. The game thread queues the pair; at the end of the frame, once the frame's captures have
+ * been issued to the renderer, the render thread copies both targets into a pair of staging textures.
+ * ReadbackLatency frames later, when the GPU is done with them, it maps the pair and packs straight from
+ * the mapped memory into the ring slot, so neither thread waits for the GPU and nothing is copied twice.
+ *
+ * 8-bit BGRA targets (RTF_RGBA8) are packed as mapped. Half-float targets (RTF_RGBA16f, the engine's default and
+ * what the shipped eye targets use) are first converted to the bytes ReadPixels would give for them. Pairs in any
+ * other format are skipped and counted.
+ */
+class FSterioFramePublisher
+{
+public:
+	FSterioFramePublisher();
+	~FSterioFramePublisher();
+
+	bool Start(const FString& Name, int32 NumSlots, int32 MaxWidth, int32 MaxHeight, SterioPacking::EFormat InFormat);
+	void Shutdown();
+
+	/** Game thread only: publishes the pair at the end of this frame. */
+	void QueueFrame(UTextureRenderTarget2D* Left, UTextureRenderTarget2D* Right, uint64 FrameNumber);
+
+	/** Frames skipped because they were larger than the ring was created for */
+	int32 GetOversizedCount() const { return Oversized.GetValue(); }
+
+	/** Frames skipped because their targets were neither 8-bit BGRA nor half-float RGBA */
+	int32 GetUnsupportedCount() const { return Unsupported.GetValue(); }
+
+	/** Frames a staged pair waits before it is mapped; the ring keeps one more pair than that */
+	enum { ReadbackLatency = 2, NumStagingPairs = ReadbackLatency + 1 };
+	uint64 GetPublishedCount() const { return Producer.GetPublishedCount(); }
+
+private:
+	/** Bound to FCoreDelegates::OnEndFrame */
+	void OnEndFrame();
+
+	/** Publishes the staged pairs that are old enough, then stages this frame's pair if there is one. */
+	void UpdateOnRenderThread(FRHICommandListImmediate& RHICmdList, FTextureRenderTargetResource* Left, FTextureRenderTargetResource* Right, uint64 FrameNumber);
+
+	struct FStagingPair
+	{
+		FTexture2DRHIRef Left;
+		FTexture2DRHIRef Right;
+		FIntPoint Size = FIntPoint::ZeroValue;
+		EPixelFormat PixelFormat = PF_Unknown;
+		uint64 FrameNumber = 0;
+		/** Render frame the copy was issued in */
+		uint32 CopiedFrame = 0;
+		bool bPending = false;
+	};
+
+	void StageOnRenderThread(FRHICommandListImmediate& RHICmdList, FTextureRenderTargetResource* Left, FTextureRenderTargetResource* Right, uint64 FrameNumber);
+	void PublishStagedOnRenderThread(FRHICommandListImmediate& RHICmdList, FStagingPair& Pair);
+
+	/** Converts a mapped half-float pair into LeftConverted and RightConverted and points the images at them. */
+	void ConvertHalfPair(const FStagingPair& Pair, const void* LeftData, int32 LeftStride, const void* RightData, int32 RightStride, SterioPacking::FConstImage& OutLeft, SterioPacking::FConstImage& OutRight);
+
+	SterioPacking::EFormat Format;
+	FDelegateHandle EndFrameHandle;
+
+	/** Render thread only once started */
+	SterioTransport::FProducer Producer;
+	FStagingPair StagingPairs[NumStagingPairs];
+	/** The pair staged next, which is also the oldest one */
+	int32 NextStagingPair;
+
+	/** Half-float pairs only: created with the first one, and the eyes converted before packing */
+	TUniquePtr<SterioPacking::FHalfToBGRA> HalfToBGRA;
+	TArray<uint32> LeftConverted;
+	TArray<uint32> RightConverted;
+
+	TWeakObjectPtr<UTextureRenderTarget2D> QueuedLeft;
+	TWeakObjectPtr<UTextureRenderTarget2D> QueuedRight;
+	uint64 QueuedFrameNumber;
+
+	FThreadSafeCounter Oversized;
+	FThreadSafeCounter Unsupported;
+};
@@ -0,0 +1,376 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+// Stereo frame transport to an external compositor through a POSIX shared-memory ring.
+//
+// This header and SterioSeqLock.h have no engine dependency: the compositor side includes them as they are
+// and uses FConsumer.
+// The ring is a header followed by NumSlots slots, each a slot header and room for MaxWidth x MaxHeight
+// 32-bit pixels. Every slot carries a SterioSeqLock::FSequence: odd while the producer writes it, even
+// once the frame is complete. The producer never waits for anyone; a consumer that falls
+// behind simply finds newer frames (and counts the ones it missed), and a consumer that was overtaken
+// while reading sees the sequence change and drops that frame.
+//
+// Reference consumer loop:
+//
+//   SterioTransport::FConsumer Consumer;
+//   Consumer.Open("/sterio_frames");
+//   for (;;)
+//   {
+//       SterioTransport::FFrameView Frame;
+//       if (Consumer.AcquireLatest(Frame))
+//       {
+//           Warp(Frame.Pixels, Frame.Width, Frame.Height);   // reads shared memory in place
+//           if (!Consumer.IsStillValid(Frame)) { /* overwritten meanwhile, discard the result */ }
+//       }
+//   }
+//
+// Source/SterioStandalone/SterioTransportConsumer.cpp is this loop as a program, reporting drops and latency; the
+// TransportRateTest_120Hz test there publishes at 120 Hz while it reads from a separate process.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "SterioSeqLock.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#define STERIO_TRANSPORT_POSIX 1
+#else
+	#define STERIO_TRANSPORT_POSIX 0
+#endif
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Ring sequence numbers are shared between processes and must be lock-free");
+
+namespace SterioTransport
+{
+	enum { Magic = 0x52465453 /* 'STFR' */, Version = 1, CacheLine = 64 };
+
+	/** Nanoseconds on the monotonic clock, which is shared by every process on the host. */
+	inline int64_t NowNanoseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	struct alignas(CacheLine) FRingHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t NumSlots;
+		uint32_t MaxPixels;
+		/** Bytes from one slot header to the next */
+		uint64_t SlotStride;
+		/** Number of frames completed so far; frame N lives in slot N % NumSlots */
+		std::atomic<uint64_t> Published;
+	};
+
+	struct alignas(CacheLine) FSlotHeader
+	{
+		/** Write N of the ring is frame N the producer completed, counting from 0 */
+		SterioSeqLock::FSequence Sequence;
+		uint64_t FrameNumber;
+		int64_t PublishTimeNs;
+		uint32_t Width;
+		uint32_t Height;
+		/** Producer-defined, e.g. the frame packing format */
+		uint32_t Format;
+	};
+
+	/** A frame in shared memory; valid until the producer laps it, see FConsumer::IsStillValid. */
+	struct FFrameView
+	{
+		const uint32_t* Pixels;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Format;
+		uint64_t FrameNumber;
+		int64_t PublishTimeNs;
+
+		const FSlotHeader* Slot;
+		/** Index of the write in the ring, see FRingHeader::Published */
+		uint64_t RingFrame;
+	};
+
+	namespace Detail
+	{
+		inline uint64_t GetSlotStride(uint32_t MaxPixels)
+		{
+			const uint64_t Bytes = sizeof(FSlotHeader) + (uint64_t)MaxPixels * sizeof(uint32_t);
+			return (Bytes + CacheLine - 1) / CacheLine * CacheLine;
+		}
+
+		inline FSlotHeader* GetSlot(uint8_t* Base, uint64_t Index)
+		{
+			const FRingHeader* Ring = (const FRingHeader*)Base;
+			return (FSlotHeader*)(Base + sizeof(FRingHeader) + (Index % Ring->NumSlots) * Ring->SlotStride);
+		}
+
+		inline uint32_t* GetSlotPixels(FSlotHeader* Slot)
+		{
+			return (uint32_t*)((uint8_t*)Slot + sizeof(FSlotHeader));
+		}
+	}
+
+	/** Writes frames into the ring. One producer per ring; it owns (creates and unlinks) the shared memory. */
+	class FProducer
+	{
+	public:
+		FProducer() : Base(nullptr), Size(0), NextFrame(0), Writing(nullptr) { Name[0] = 0; }
+		~FProducer() { Close(); }
+
+		/** Creates (or recreates) the ring. At least three slots leave a reader of the newest frame two frame times to finish. */
+		bool Create(const char* InName, uint32_t NumSlots, uint32_t MaxWidth, uint32_t MaxHeight)
+		{
+			Close();
+#if STERIO_TRANSPORT_POSIX
+			if (NumSlots < 2 || MaxWidth == 0 || MaxHeight == 0 || std::strlen(InName) >= sizeof(Name))
+			{
+				return false;
+			}
+
+			const uint32_t MaxPixels = MaxWidth * MaxHeight;
+			const uint64_t SlotStride = Detail::GetSlotStride(MaxPixels);
+			const size_t Bytes = (size_t)(sizeof(FRingHeader) + NumSlots * SlotStride);
+
+			shm_unlink(InName);
+			const int File = shm_open(InName, O_CREAT | O_RDWR, 0600);
+			if (File < 0)
+			{
+				return false;
+			}
+			void* Mapped = (ftruncate(File, (off_t)Bytes) == 0) ? mmap(nullptr, Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0) : MAP_FAILED;
+			close(File);
+			if (Mapped == MAP_FAILED)
+			{
+				shm_unlink(InName);
+				return false;
+			}
+
+			std::strcpy(Name, InName);
+			Base = (uint8_t*)Mapped;
+			Size = Bytes;
+			NextFrame = 0;
+
+			// Consumers check the magic last, so it is written after everything else
+			FRingHeader* Ring = (FRingHeader*)Base;
+			Ring->Version = Version;
+			Ring->NumSlots = NumSlots;
+			Ring->MaxPixels = MaxPixels;
+			Ring->SlotStride = SlotStride;
+			Ring->Published.store(0, std::memory_order_relaxed);
+			for (uint32_t Index = 0; Index < NumSlots; ++Index)
+			{
+				Detail::GetSlot(Base, Index)->Sequence.Reset();
+			}
+			std::atomic_thread_fence(std::memory_order_release);
+			Ring->Magic = Magic;
+			return true;
+#else
+			(void)InName; (void)NumSlots; (void)MaxWidth; (void)MaxHeight;
+			return false;
+#endif
+		}
+
+		void Close()
+		{
+#if STERIO_TRANSPORT_POSIX
+			if (Base)
+			{
+				munmap(Base, Size);
+				shm_unlink(Name);
+			}
+#endif
+			Base = nullptr;
+			Size = 0;
+			Writing = nullptr;
+			Name[0] = 0;
+		}
+
+		bool IsOpen() const { return Base != nullptr; }
+
+		/**
+		 * Claims the next slot and returns where Width x Height pixels (stride Width) go, so frames can be packed
+		 * straight into shared memory. Returns null if the frame doesn't fit. Never blocks.
+		 */
+		uint32_t* BeginWrite(uint32_t Width, uint32_t Height, uint32_t Format)
+		{
+			if (!Base || Writing || (uint64_t)Width * Height > ((const FRingHeader*)Base)->MaxPixels)
+			{
+				return nullptr;
+			}
+
+			Writing = Detail::GetSlot(Base, NextFrame);
+			Writing->Sequence.BeginWrite(NextFrame);
+			Writing->Width = Width;
+			Writing->Height = Height;
+			Writing->Format = Format;
+			return Detail::GetSlotPixels(Writing);
+		}
+
+		/** Completes the frame claimed by BeginWrite. */
+		void EndWrite(uint64_t FrameNumber)
+		{
+			if (!Writing)
+			{
+				return;
+			}
+
+			Writing->FrameNumber = FrameNumber;
+			Writing->PublishTimeNs = NowNanoseconds();
+			Writing->Sequence.EndWrite(NextFrame);
+			((FRingHeader*)Base)->Published.store(++NextFrame, std::memory_order_release);
+			Writing = nullptr;
+		}
+
+		uint64_t GetPublishedCount() const { return NextFrame; }
+
+	private:
+		char Name[64];
+		uint8_t* Base;
+		size_t Size;
+		uint64_t NextFrame;
+		FSlotHeader* Writing;
+	};
+
+	/** Reads the newest frame of a ring. Any number of consumers may read one ring; none of them take locks. */
+	class FConsumer
+	{
+	public:
+		FConsumer() : Base(nullptr), Size(0), LastPublished(0), Dropped(0), Torn(0) {}
+		~FConsumer() { Close(); }
+
+		/** Maps an existing ring read-only. Returns false if it doesn't exist yet or isn't a ring of this version. */
+		bool Open(const char* Name)
+		{
+			Close();
+#if STERIO_TRANSPORT_POSIX
+			const int File = shm_open(Name, O_RDONLY, 0);
+			if (File < 0)
+			{
+				return false;
+			}
+
+			struct stat Stat;
+			void* Mapped = (fstat(File, &Stat) == 0 && (size_t)Stat.st_size >= sizeof(FRingHeader)) ? mmap(nullptr, (size_t)Stat.st_size, PROT_READ, MAP_SHARED, File, 0) : MAP_FAILED;
+			close(File);
+			if (Mapped == MAP_FAILED)
+			{
+				return false;
+			}
+
+			Base = (uint8_t*)Mapped;
+			Size = (size_t)Stat.st_size;
+
+			// The producer writes the magic last; everything else is only trusted once it is seen
+			const FRingHeader* Ring = (const FRingHeader*)Base;
+			const bool bInitialized = Ring->Magic == Magic;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (!bInitialized || Ring->Version != Version || Size < sizeof(FRingHeader) + Ring->NumSlots * Ring->SlotStride)
+			{
+				Close();
+				return false;
+			}
+			LastPublished = Ring->Published.load(std::memory_order_acquire);
+			return true;
+#else
+			(void)Name;
+			return false;
+#endif
+		}
+
+		void Close()
+		{
+#if STERIO_TRANSPORT_POSIX
+			if (Base)
+			{
+				munmap(Base, Size);
+			}
+#endif
+			Base = nullptr;
+			Size = 0;
+		}
+
+		bool IsOpen() const { return Base != nullptr; }
+
+		/**
+		 * Points Out at the newest complete frame, if one was published since the last successful call.
+		 * Frames published in between are counted as dropped. The pixels are read in place: check IsStillValid
+		 * once done with them.
+		 */
+		bool AcquireLatest(FFrameView& Out)
+		{
+			if (!Base)
+			{
+				return false;
+			}
+
+			const FRingHeader* Ring = (const FRingHeader*)Base;
+			for (int32_t Attempt = 0; Attempt < 4; ++Attempt)
+			{
+				const uint64_t Published = Ring->Published.load(std::memory_order_acquire);
+				if (Published == LastPublished)
+				{
+					return false;
+				}
+
+				const uint64_t Frame = Published - 1;
+				const FSlotHeader* Slot = Detail::GetSlot(Base, Frame);
+				if (!Slot->Sequence.BeginRead(Frame))
+				{
+					// Already being overwritten by a newer frame; look again
+					continue;
+				}
+
+				Out.Pixels = Detail::GetSlotPixels(const_cast<FSlotHeader*>(Slot));
+				Out.Width = Slot->Width;
+				Out.Height = Slot->Height;
+				Out.Format = Slot->Format;
+				Out.FrameNumber = Slot->FrameNumber;
+				Out.PublishTimeNs = Slot->PublishTimeNs;
+				Out.Slot = Slot;
+				Out.RingFrame = Frame;
+
+				if (!Slot->Sequence.Validate(Frame))
+				{
+					continue;
+				}
+
+				Dropped += Frame - LastPublished;
+				LastPublished = Published;
+				return true;
+			}
+			return false;
+		}
+
+		/** True if the producer hasn't started overwriting View's slot; counts a torn frame otherwise. */
+		bool IsStillValid(const FFrameView& View)
+		{
+			if (View.Slot->Sequence.Validate(View.RingFrame))
+			{
+				return true;
+			}
+			++Torn;
+			return false;
+		}
+
+		/** Frames published that this consumer never acquired */
+		uint64_t GetDroppedCount() const { return Dropped; }
+
+		/** Frames that were overwritten while being read */
+		uint64_t GetTornCount() const { return Torn; }
+
+	private:
+		uint8_t* Base;
+		size_t Size;
+		uint64_t LastPublished;
+		uint64_t Dropped;
+		uint64_t Torn;
+	};
+}
@@ -0,0 +1,30 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioLateLatch.h"
+#include "Sterio_4_16Character.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarSterioLateLatch(
+	TEXT("Sterio.LateLatch"),
+	1,
+	TEXT("0: eye captures render the tracker pose sampled at Tick\n")
+	TEXT("1: the pose is sampled again at the end of the frame, just before the captures are dispatched"),
+	ECVF_Default);
+
+bool FSterioLateLatchTickFunction::IsEnabled()
+{
+	return CVarSterioLateLatch.GetValueOnGameThread() != 0;
+}
+
+void FSterioLateLatchTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && !Target->IsPendingKillOrUnreachable())
+	{
+		Target->LateUpdate();
+	}
+}
+
+FString FSterioLateLatchTickFunction::DiagnosticMessage()
+{
+	return Target ? Target->GetFullName() + TEXT("[LateLatch]") : TEXT("<unbound>[LateLatch]");
+}
@@ -0,0 +1,47 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "SterioLateLatch.generated.h"
+
+class ASterio_4_16Character;
+
+/**
+ * Second tick of the stereo rig, run after everything else in the frame has updated.
+ *
+ * Scene captures issued during the frame are only turned into render commands at the end of the frame,
+ * from whatever transform and projection their components hold by then. Re-sampling the tracker here
+ * and patching the eye captures lets them render the newest pose instead of the one seen at Tick.
+ * The captures themselves are issued from here too, once their final state is known.
+ */
+USTRUCT()
+struct FSterioLateLatchTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	FSterioLateLatchTickFunction()
+		: Target(nullptr)
+	{
+	}
+
+	ASterio_4_16Character* Target;
+
+	/** Sterio.LateLatch: 0 renders the pose seen at Tick, 1 re-samples it at the end of the frame. */
+	static bool IsEnabled();
+
+	// FTickFunction interface
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	// End of FTickFunction interface
+};
+
+template<>
+struct TStructOpsTypeTraits<FSterioLateLatchTickFunction> : public TStructOpsTypeTraitsBase2<FSterioLateLatchTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
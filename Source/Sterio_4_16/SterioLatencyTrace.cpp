@@ -0,0 +1,608 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioLatencyTrace.h"
+#include "Containers/CircularQueue.h"
+#include "Engine/Engine.h"
+#include "Framework/Application/SlateApplication.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Rendering/SlateRenderer.h"
+#include "RenderingThread.h"
+#include "SceneView.h"
+#include "SceneViewExtension.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioLatency, Log, All);
+
+static TAutoConsoleVariable<int32> CVarSterioLatency(
+	TEXT("Sterio.Latency"),
+	0,
+	TEXT("0: off\n")
+	TEXT("1: mark every stage from tracker pose to present and keep p50/p99 per stage for Sterio.Latency.Summary\n")
+	TEXT("2: also write the marks and stages as Chrome trace events to Saved/Sterio/Latency"),
+	ECVF_Default);
+
+enum
+{
+	LatencyThreadCapacity = 4096,
+	/** Frames stay open for late marks from the render thread for this many frames */
+	LatencyFrameLag = 4,
+	/** Chrome trace lanes of the stages start at this thread id */
+	LatencySpanLaneBase = 1000,
+};
+
+static const TCHAR* const GSterioLatencyStageNames[] =
+{
+	TEXT("PoseReceived"),
+	TEXT("PoseApplied"),
+	TEXT("ProjectionBegin"),
+	TEXT("ProjectionEnd"),
+	TEXT("CaptureIssued"),
+	TEXT("CaptureSubmitted"),
+	TEXT("Presented"),
+};
+static_assert(ARRAY_COUNT(GSterioLatencyStageNames) == (int32)ESterioLatencyStage::Num, "One name per stage");
+
+static const TCHAR* const GSterioLatencySpanNames[] =
+{
+	TEXT("tracker"),
+	TEXT("projection"),
+	TEXT("capture"),
+	TEXT("present"),
+	TEXT("motion_to_present"),
+};
+
+FThreadSafeBool FSterioLatencyTrace::bEnabled;
+
+/** Marks of one thread; that thread is the only producer, the writer thread the only consumer. */
+struct FSterioLatencyTrace::FThreadBuffer
+{
+	FThreadBuffer()
+		: Queue(LatencyThreadCapacity)
+		, ThreadId(FPlatformTLS::GetCurrentThreadId())
+		, bNamed(false)
+	{
+		if (IsInGameThread())
+		{
+			ThreadName = TEXT("GameThread");
+		}
+		else if (IsInRenderingThread())
+		{
+			ThreadName = TEXT("RenderThread");
+		}
+		else if (FRunnableThread* Thread = FRunnableThread::GetRunnableThread())
+		{
+			ThreadName = Thread->GetThreadName();
+		}
+		else
+		{
+			ThreadName = FString::Printf(TEXT("Thread %u"), ThreadId);
+		}
+	}
+
+	TCircularQueue<FSterioLatencyEvent> Queue;
+	uint32 ThreadId;
+	FString ThreadName;
+	FThreadSafeCounter Dropped;
+
+	/** Writer thread: the trace already names this thread */
+	bool bNamed;
+};
+
+/** Everything marked for one frame; times are 0 until marked. */
+struct FSterioLatencyTrace::FFrameMarks
+{
+	FFrameMarks()
+	{
+		FMemory::Memzero(Stages);
+	}
+
+	/** Latest pose marks, earliest projection begin, capture submission and present */
+	double Stages[(int32)ESterioLatencyStage::Num];
+
+	/** ProjectionEnd and CaptureIssued of the individual eyes */
+	TArray<FSterioLatencyEvent, TInlineAllocator<16>> EyeMarks;
+};
+
+/** Tells the tracer when the main view family starts rendering, which is after the scene captures deferred to the frame. */
+class FSterioLatencyViewExtension : public ISceneViewExtension
+{
+public:
+	// ISceneViewExtension interface
+	virtual void SetupViewFamily(FSceneViewFamily& InViewFamily) override {}
+	virtual void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override {}
+	virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override {}
+	virtual void PreRenderView_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneView& InView) override {}
+	virtual void PreRenderViewFamily_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily) override
+	{
+		FSterioLatencyTrace::Get().OnViewFamilyRendering(InViewFamily);
+	}
+	// End of ISceneViewExtension interface
+};
+
+FSterioLatencyTrace& FSterioLatencyTrace::Get()
+{
+	static FSterioLatencyTrace Trace;
+	return Trace;
+}
+
+FSterioLatencyTrace::FSterioLatencyTrace()
+	: Thread(nullptr)
+	, WorkEvent(nullptr)
+	, NewestFrame(0)
+	, FinishedFrame(0)
+	, LastPoseReceived(0.0)
+	, TraceArchive(nullptr)
+	, bTraceRequested(false)
+	, bFirstTraceEvent(true)
+	, StartTime(0.0)
+{
+	FMemory::Memzero(NumSpanDurations);
+
+	// The writer thread and the render thread callbacks have to be gone before the engine is
+	FCoreDelegates::OnPreExit.AddRaw(this, &FSterioLatencyTrace::Shutdown);
+}
+
+FSterioLatencyTrace::~FSterioLatencyTrace()
+{
+	Shutdown();
+
+	// Threads that marked may be gone, so their buffers are freed here rather than with them
+	for (FThreadBuffer* Buffer : Buffers)
+	{
+		delete Buffer;
+	}
+}
+
+FSterioLatencyTrace::FThreadBuffer* FSterioLatencyTrace::GetThreadBuffer()
+{
+	static const uint32 TlsSlot = FPlatformTLS::AllocTlsSlot();
+
+	FThreadBuffer* Buffer = (FThreadBuffer*)FPlatformTLS::GetTlsValue(TlsSlot);
+	if (!Buffer)
+	{
+		Buffer = new FThreadBuffer();
+		FSterioLatencyTrace& Trace = Get();
+		FScopeLock Lock(&Trace.BuffersLock);
+		Trace.Buffers.Add(Buffer);
+		FPlatformTLS::SetTlsValue(TlsSlot, Buffer);
+	}
+	return Buffer;
+}
+
+void FSterioLatencyTrace::Mark(ESterioLatencyStage Stage, uint32 Frame, int32 Screen, int32 Eye, double Time)
+{
+	if (!bEnabled)
+	{
+		return;
+	}
+
+	FSterioLatencyEvent Event;
+	Event.Time = Time;
+	Event.Frame = Frame;
+	Event.Screen = (int8)Screen;
+	Event.Eye = (int8)Eye;
+	Event.Stage = Stage;
+
+	FThreadBuffer* Buffer = GetThreadBuffer();
+	if (!Buffer->Queue.Enqueue(Event))
+	{
+		Buffer->Dropped.Increment();
+	}
+}
+
+void FSterioLatencyTrace::MarkCaptureIssued(uint32 Frame, int32 Screen, int32 Eye)
+{
+	if (!bEnabled)
+	{
+		return;
+	}
+
+	Mark(ESterioLatencyStage::CaptureIssued, Frame, Screen, Eye);
+}
+
+void FSterioLatencyTrace::ApplySettings()
+{
+	const int32 Mode = FMath::Clamp(CVarSterioLatency.GetValueOnGameThread(), 0, 2);
+	const bool bWantTrace = (Mode == 2);
+	if (Thread && (Mode == 0 || bWantTrace != bTraceRequested))
+	{
+		Shutdown();
+	}
+	if (!Thread && Mode != 0)
+	{
+		Start(bWantTrace);
+	}
+}
+
+void FSterioLatencyTrace::Start(bool bWriteTrace)
+{
+	check(IsInGameThread() && !Thread);
+
+	// Marks left behind by threads that raced the previous shutdown
+	{
+		FScopeLock Lock(&BuffersLock);
+		FSterioLatencyEvent Discarded;
+		for (FThreadBuffer* Buffer : Buffers)
+		{
+			while (Buffer->Queue.Dequeue(Discarded))
+			{
+			}
+			Buffer->Dropped.Reset();
+			Buffer->bNamed = false;
+		}
+	}
+	{
+		FScopeLock Lock(&SpansLock);
+		for (int32 Span = 0; Span < NumSpans; ++Span)
+		{
+			SpanDurations[Span].Reset();
+			NumSpanDurations[Span] = 0;
+		}
+	}
+	bTraceRequested = bWriteTrace;
+	NewestFrame = 0;
+	FinishedFrame = 0;
+	LastPoseReceived = 0.0;
+	UnsubmittedCaptures.Reset();
+	StartTime = FPlatformTime::Seconds();
+
+	if (bWriteTrace)
+	{
+		const FString Path = FPaths::GameSavedDir() / TEXT("Sterio") / TEXT("Latency") / (FDateTime::Now().ToString() + TEXT(".json"));
+		IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+		TraceArchive = IFileManager::Get().CreateFileWriter(*Path);
+		if (TraceArchive)
+		{
+			UE_LOG(LogSterioLatency, Log, TEXT("Writing latency trace to %s"), *Path);
+			bFirstTraceEvent = true;
+			WriteTraceLine(TEXT("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"));
+			for (int32 Span = 0; Span < NumSpans; ++Span)
+			{
+				WriteTraceLine(FString::Printf(TEXT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Latency: %s\"}}"),
+					LatencySpanLaneBase + Span, GSterioLatencySpanNames[Span]));
+			}
+		}
+		else
+		{
+			UE_LOG(LogSterioLatency, Warning, TEXT("Could not open latency trace %s"), *Path);
+		}
+	}
+
+	if (GEngine)
+	{
+		ViewExtension = MakeShareable(new FSterioLatencyViewExtension());
+		GEngine->ViewExtensions.Add(ViewExtension);
+	}
+	if (FSlateApplication::IsInitialized())
+	{
+		FSlateRenderer* Renderer = FSlateApplication::Get().GetRenderer();
+		if (Renderer)
+		{
+			PresentHandle = Renderer->OnBackBufferReadyToPresent().AddRaw(this, &FSterioLatencyTrace::OnBackBufferReadyToPresent);
+		}
+	}
+
+	WorkEvent = FPlatformProcess::GetSynchEventFromPool();
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, TEXT("SterioLatencyTrace"), 0, TPri_BelowNormal);
+	bEnabled = (Thread != nullptr);
+}
+
+void FSterioLatencyTrace::Shutdown()
+{
+	if (!Thread)
+	{
+		return;
+	}
+
+	bEnabled = false;
+
+	// The render thread may be inside one of the callbacks
+	FlushRenderingCommands();
+	if (GEngine && ViewExtension.IsValid())
+	{
+		GEngine->ViewExtensions.Remove(ViewExtension);
+	}
+	ViewExtension.Reset();
+	if (PresentHandle.IsValid() && FSlateApplication::IsInitialized() && FSlateApplication::Get().GetRenderer())
+	{
+		FSlateApplication::Get().GetRenderer()->OnBackBufferReadyToPresent().Remove(PresentHandle);
+	}
+	PresentHandle.Reset();
+
+	Stop();
+	Thread->WaitForCompletion();
+	delete Thread;
+	Thread = nullptr;
+
+	FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+	WorkEvent = nullptr;
+
+	if (TraceArchive)
+	{
+		WriteTraceLine(TEXT("\n]}\n"));
+		TraceArchive->Close();
+		delete TraceArchive;
+		TraceArchive = nullptr;
+	}
+
+	LogSummary();
+}
+
+uint32 FSterioLatencyTrace::Run()
+{
+	while (!bStopping)
+	{
+		WorkEvent->Wait(50);
+		Drain(false);
+	}
+	Drain(true);
+	return 0;
+}
+
+void FSterioLatencyTrace::Stop()
+{
+	bStopping = true;
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+}
+
+void FSterioLatencyTrace::OnViewFamilyRendering(const FSceneViewFamily& ViewFamily)
+{
+	// Scene capture families render before the main one and are what is being timed
+	if (!bEnabled || ViewFamily.Views.Num() == 0 || ViewFamily.Views[0]->bIsSceneCapture)
+	{
+		return;
+	}
+
+	// Every capture the game thread issued up to this frame has been submitted; FinishFrame pairs them
+	Mark(ESterioLatencyStage::CaptureSubmitted, GFrameNumberRenderThread);
+}
+
+void FSterioLatencyTrace::OnBackBufferReadyToPresent(SWindow& Window, const FTexture2DRHIRef& BackBuffer)
+{
+	Mark(ESterioLatencyStage::Presented, GFrameNumberRenderThread);
+}
+
+void FSterioLatencyTrace::Drain(bool bFinal)
+{
+	TArray<FThreadBuffer*, TInlineAllocator<16>> Snapshot;
+	{
+		FScopeLock Lock(&BuffersLock);
+		Snapshot.Append(Buffers);
+	}
+
+	FSterioLatencyEvent Event;
+	for (FThreadBuffer* Buffer : Snapshot)
+	{
+		if (TraceArchive && !Buffer->bNamed)
+		{
+			WriteTraceLine(FString::Printf(TEXT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}"),
+				Buffer->ThreadId, *Buffer->ThreadName));
+			Buffer->bNamed = true;
+		}
+		while (Buffer->Queue.Dequeue(Event))
+		{
+			AddToFrame(Event, Buffer->ThreadId);
+		}
+	}
+
+	// Frames finish oldest first, so every frame sees the pose the ones before it latched
+	TArray<uint32, TInlineAllocator<16>> Finished;
+	for (const TPair<uint32, FFrameMarks*>& Pair : OpenFrames)
+	{
+		if (bFinal || Pair.Key + LatencyFrameLag <= NewestFrame)
+		{
+			Finished.Add(Pair.Key);
+		}
+	}
+	Finished.Sort();
+	for (uint32 Frame : Finished)
+	{
+		FFrameMarks* Marks = OpenFrames.FindAndRemoveChecked(Frame);
+		FinishFrame(Frame, *Marks);
+		FinishedFrame = FMath::Max(FinishedFrame, Frame);
+		delete Marks;
+	}
+}
+
+void FSterioLatencyTrace::AddToFrame(const FSterioLatencyEvent& Event, uint32 ThreadId)
+{
+	if (TraceArchive)
+	{
+		WriteTraceLine(FString::Printf(TEXT("{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"frame\":%u,\"screen\":%d,\"eye\":%d}}"),
+			GSterioLatencyStageNames[(int32)Event.Stage], (Event.Time - StartTime) * 1e6, ThreadId, Event.Frame, Event.Screen, Event.Eye));
+	}
+
+	if (Event.Frame <= FinishedFrame)
+	{
+		// Too late for a frame that has been finished already
+		return;
+	}
+	NewestFrame = FMath::Max(NewestFrame, Event.Frame);
+
+	FFrameMarks*& Marks = OpenFrames.FindOrAdd(Event.Frame);
+	if (!Marks)
+	{
+		Marks = new FFrameMarks();
+	}
+
+	double& Stage = Marks->Stages[(int32)Event.Stage];
+	switch (Event.Stage)
+	{
+	case ESterioLatencyStage::ProjectionBegin:
+	case ESterioLatencyStage::CaptureSubmitted:
+	case ESterioLatencyStage::Presented:
+		Stage = (Stage > 0.0) ? FMath::Min(Stage, Event.Time) : Event.Time;
+		break;
+	case ESterioLatencyStage::ProjectionEnd:
+	case ESterioLatencyStage::CaptureIssued:
+		Marks->EyeMarks.Add(Event);
+		// Fall through; the frame keeps the latest of them too
+	default:
+		Stage = FMath::Max(Stage, Event.Time);
+		break;
+	}
+}
+
+void FSterioLatencyTrace::FinishFrame(uint32 Frame, const FFrameMarks& Marks)
+{
+	const double* Stages = Marks.Stages;
+	const double PoseReceived = Stages[(int32)ESterioLatencyStage::PoseReceived];
+	const double PoseApplied = Stages[(int32)ESterioLatencyStage::PoseApplied];
+	const double ProjectionBegin = Stages[(int32)ESterioLatencyStage::ProjectionBegin];
+	const double CaptureSubmitted = Stages[(int32)ESterioLatencyStage::CaptureSubmitted];
+	const double Presented = Stages[(int32)ESterioLatencyStage::Presented];
+
+	// A frame that consumed no pose still shows the last one that was
+	if (PoseReceived > 0.0)
+	{
+		LastPoseReceived = PoseReceived;
+		if (PoseApplied > 0.0)
+		{
+			AddSpan(SpanTracker, Frame, -1, -1, PoseReceived, PoseApplied);
+		}
+	}
+
+	for (const FSterioLatencyEvent& Event : Marks.EyeMarks)
+	{
+		if (Event.Stage == ESterioLatencyStage::ProjectionEnd && ProjectionBegin > 0.0)
+		{
+			AddSpan(SpanProjection, Frame, Event.Screen, Event.Eye, ProjectionBegin, Event.Time);
+		}
+		else if (Event.Stage == ESterioLatencyStage::CaptureIssued)
+		{
+			UnsubmittedCaptures.Add(Event);
+		}
+	}
+
+	// A capture is submitted by the first main view family rendered in or after its frame
+	if (CaptureSubmitted > 0.0)
+	{
+		for (const FSterioLatencyEvent& Issued : UnsubmittedCaptures)
+		{
+			AddSpan(SpanCapture, Issued.Frame, Issued.Screen, Issued.Eye, Issued.Time, CaptureSubmitted);
+		}
+		UnsubmittedCaptures.Reset();
+	}
+	else
+	{
+		// Without a main view (a headless or minimised client) nothing ever submits them
+		UnsubmittedCaptures.RemoveAll([Frame](const FSterioLatencyEvent& Issued) { return Issued.Frame + LatencyFrameLag < Frame; });
+	}
+
+	if (Presented > 0.0)
+	{
+		if (CaptureSubmitted > 0.0)
+		{
+			AddSpan(SpanPresent, Frame, -1, -1, CaptureSubmitted, Presented);
+		}
+		if (LastPoseReceived > 0.0)
+		{
+			AddSpan(SpanMotionToPresent, Frame, -1, -1, LastPoseReceived, Presented);
+		}
+	}
+}
+
+void FSterioLatencyTrace::AddSpan(ESpan Span, uint32 Frame, int32 Screen, int32 Eye, double Begin, double End)
+{
+	const float Milliseconds = (float)((End - Begin) * 1000.0);
+	{
+		FScopeLock Lock(&SpansLock);
+		TArray<float>& Durations = SpanDurations[Span];
+		if (Durations.Num() < SpanHistory)
+		{
+			Durations.Add(Milliseconds);
+		}
+		else
+		{
+			Durations[NumSpanDurations[Span] % SpanHistory] = Milliseconds;
+		}
+		++NumSpanDurations[Span];
+	}
+
+	if (TraceArchive)
+	{
+		WriteTraceLine(FString::Printf(TEXT("{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"frame\":%u,\"screen\":%d,\"eye\":%d}}"),
+			GSterioLatencySpanNames[Span], (Begin - StartTime) * 1e6, (End - Begin) * 1e6, LatencySpanLaneBase + (int32)Span, Frame, Screen, Eye));
+	}
+}
+
+void FSterioLatencyTrace::WriteTraceLine(const FString& Line)
+{
+	// The header and footer are written as they are; events are separated by commas
+	const bool bEvent = Line.StartsWith(TEXT("{\"name\""));
+	if (bEvent && !bFirstTraceEvent)
+	{
+		TraceArchive->Serialize((void*)",\n", 2);
+	}
+	bFirstTraceEvent &= !bEvent;
+
+	FTCHARToUTF8 Utf8(*Line);
+	TraceArchive->Serialize((void*)Utf8.Get(), Utf8.Length());
+}
+
+void FSterioLatencyTrace::LogSummary()
+{
+	int32 Dropped = 0;
+	{
+		FScopeLock Lock(&BuffersLock);
+		for (const FThreadBuffer* Buffer : Buffers)
+		{
+			Dropped += Buffer->Dropped.GetValue();
+		}
+	}
+
+	FScopeLock Lock(&SpansLock);
+	if (NumSpanDurations[SpanTracker] + NumSpanDurations[SpanProjection] + NumSpanDurations[SpanCapture] == 0)
+	{
+		UE_LOG(LogSterioLatency, Display, TEXT("Nothing traced; enable with Sterio.Latency 1"));
+		return;
+	}
+
+	UE_LOG(LogSterioLatency, Display, TEXT("%-18s %8s %9s %9s %9s"), TEXT("Stage (ms)"), TEXT("Count"), TEXT("p50"), TEXT("p99"), TEXT("Max"));
+	TArray<float> Sorted;
+	for (int32 Span = 0; Span < NumSpans; ++Span)
+	{
+		Sorted = SpanDurations[Span];
+		if (Sorted.Num() == 0)
+		{
+			UE_LOG(LogSterioLatency, Display, TEXT("%-18s %8d %9s %9s %9s"), GSterioLatencySpanNames[Span], 0, TEXT("-"), TEXT("-"), TEXT("-"));
+			continue;
+		}
+		Sorted.Sort();
+
+		// Nearest rank, over the most recent SpanHistory durations
+		const int32 Num = Sorted.Num();
+		const float P50 = Sorted[FMath::Clamp(FMath::CeilToInt(0.50f * Num) - 1, 0, Num - 1)];
+		const float P99 = Sorted[FMath::Clamp(FMath::CeilToInt(0.99f * Num) - 1, 0, Num - 1)];
+		UE_LOG(LogSterioLatency, Display, TEXT("%-18s %8d %9.3f %9.3f %9.3f"), GSterioLatencySpanNames[Span], NumSpanDurations[Span], P50, P99, Sorted.Last());
+	}
+	if (Dropped > 0)
+	{
+		UE_LOG(LogSterioLatency, Warning, TEXT("%d marks dropped by full thread buffers"), Dropped);
+	}
+}
+
+static void OnSterioLatencySettingsChanged()
+{
+	FSterioLatencyTrace::Get().ApplySettings();
+}
+
+static FAutoConsoleVariableSink SterioLatencySettingsSink(FConsoleCommandDelegate::CreateStatic(&OnSterioLatencySettingsChanged));
+
+static void LogLatencySummaryCommand()
+{
+	FSterioLatencyTrace::Get().LogSummary();
+}
+
+static FAutoConsoleCommand SterioLatencySummaryCommand(
+	TEXT("Sterio.Latency.Summary"),
+	TEXT("Logs p50 and p99 of every stage from tracker pose to present, traced since Sterio.Latency was enabled"),
+	FConsoleCommandDelegate::CreateStatic(&LogLatencySummaryCommand));
@@ -0,0 +1,154 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "RHI.h"
+
+class FRunnableThread;
+class FSceneViewFamily;
+class FSterioLatencyViewExtension;
+class SWindow;
+
+/** Points in the life of a frame between a tracker pose arriving and the frame being presented. */
+enum class ESterioLatencyStage : uint8
+{
+	/** The pose the frame renders reached the process; stamped with the tracker thread's receive time */
+	PoseReceived,
+	/** The game thread moved the eyes to that pose */
+	PoseApplied,
+	/** The game thread started rebuilding stale eye projections */
+	ProjectionBegin,
+	/** An eye's projection was rebuilt and uploaded to its capture */
+	ProjectionEnd,
+	/** An eye's capture was issued */
+	CaptureIssued,
+	/** The render thread has submitted the frame's captures and moved on to its main view; marked once for all eyes */
+	CaptureSubmitted,
+	/** The render thread handed the viewport with the SterioWidget over for presentation */
+	Presented,
+
+	Num
+};
+
+/** One mark, as kept in the per-thread buffers. */
+struct FSterioLatencyEvent
+{
+	/** FPlatformTime::Seconds(), monotonic */
+	double Time;
+	uint32 Frame;
+	int8 Screen;
+	/** 0 left, 1 right, -1 for marks that cover both eyes */
+	int8 Eye;
+	ESterioLatencyStage Stage;
+};
+
+/**
+ * Traces where motion-to-photon latency accumulates.
+ *
+ * Any thread marks stages of a frame into its own lock-free buffer; a background thread drains the buffers,
+ * pairs the marks of each frame into spans (tracker, projection, capture, present and the whole
+ * motion-to-present) and keeps their p50/p99 for Sterio.Latency.Summary. With Sterio.Latency 2 it also
+ * writes every mark and span as Chrome trace events (chrome://tracing) to Saved/Sterio/Latency.
+ *
+ * Frames are numbered by GFrameNumber on the game thread and GFrameNumberRenderThread on the render thread,
+ * which agree for the same frame. With tracing off, a mark is one flag read.
+ */
+class FSterioLatencyTrace : public FRunnable
+{
+public:
+	static FSterioLatencyTrace& Get();
+
+	static bool IsEnabled() { return bEnabled; }
+
+	/** Records Stage of Frame from the calling thread. */
+	static void Mark(ESterioLatencyStage Stage, uint32 Frame, int32 Screen = -1, int32 Eye = -1, double Time = FPlatformTime::Seconds());
+
+	/**
+	 * Game thread: marks the capture as issued. The render thread marks CaptureSubmitted for the whole frame from
+	 * its own buffer, and the writer thread pairs the two when it drains them, so neither thread shares state.
+	 */
+	static void MarkCaptureIssued(uint32 Frame, int32 Screen, int32 Eye);
+
+	/** Starts or stops tracing to match Sterio.Latency. */
+	void ApplySettings();
+
+	/** Logs count, p50, p99 and max of every span since tracing was enabled. */
+	void LogSummary();
+
+	virtual ~FSterioLatencyTrace();
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End of FRunnable interface
+
+private:
+	FSterioLatencyTrace();
+
+	friend class FSterioLatencyViewExtension;
+
+	struct FThreadBuffer;
+	struct FFrameMarks;
+
+	enum ESpan
+	{
+		SpanTracker,
+		SpanProjection,
+		SpanCapture,
+		SpanPresent,
+		SpanMotionToPresent,
+		NumSpans
+	};
+
+	enum { SpanHistory = 16384 };
+
+	static FThreadBuffer* GetThreadBuffer();
+
+	void Start(bool bWriteTrace);
+	void Shutdown();
+
+	/** Render thread: a view family is about to render, after every capture deferred to it */
+	void OnViewFamilyRendering(const FSceneViewFamily& ViewFamily);
+	void OnBackBufferReadyToPresent(SWindow& Window, const FTexture2DRHIRef& BackBuffer);
+
+	/** Writer thread: drains every buffer and finishes frames that can't receive marks any more. */
+	void Drain(bool bFinal);
+	void AddToFrame(const FSterioLatencyEvent& Event, uint32 ThreadId);
+	void FinishFrame(uint32 Frame, const FFrameMarks& Marks);
+	void AddSpan(ESpan Span, uint32 Frame, int32 Screen, int32 Eye, double Begin, double End);
+	void WriteTraceLine(const FString& Line);
+
+	static FThreadSafeBool bEnabled;
+
+	FCriticalSection BuffersLock;
+	TArray<FThreadBuffer*> Buffers;
+
+	FRunnableThread* Thread;
+	FEvent* WorkEvent;
+	FThreadSafeBool bStopping;
+	TSharedPtr<FSterioLatencyViewExtension, ESPMode::ThreadSafe> ViewExtension;
+	FDelegateHandle PresentHandle;
+
+	/** Writer thread state */
+	TMap<uint32, FFrameMarks*> OpenFrames;
+	uint32 NewestFrame;
+	/** Marks for this frame or older arrive too late to be paired */
+	uint32 FinishedFrame;
+	/** Receive time of the pose the frames being finished are rendered with */
+	double LastPoseReceived;
+	/** CaptureIssued marks of finished frames that no CaptureSubmitted has followed yet */
+	TArray<FSterioLatencyEvent> UnsubmittedCaptures;
+	FArchive* TraceArchive;
+	/** Sterio.Latency asked for a trace file, whether or not it could be opened */
+	bool bTraceRequested;
+	bool bFirstTraceEvent;
+	double StartTime;
+
+	/** Ring of the latest durations of every span, in ms; shared with LogSummary */
+	FCriticalSection SpansLock;
+	TArray<float> SpanDurations[NumSpans];
+	int32 NumSpanDurations[NumSpans];
+};
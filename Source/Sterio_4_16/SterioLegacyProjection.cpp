@@ -0,0 +1,137 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioLegacyProjection.h"
+
+FMatrix FSterioLegacyProjection::GeneralizedPerspectiveProjection(FVector pe) const
+{
+	float zoff = 0.0f;
+	FVector pa = FVector(-width / 2.0f, -height / 2.0f, -zoff);
+	FVector pb = FVector(width / 2.0f, -height / 2.0f, -zoff);
+	FVector pc = FVector(-width / 2.0f, height / 2.0f, -zoff);
+
+	FVector va, vb, vc;
+	FVector vr, vu, vn;
+
+	float left, right, bottom, top, eyedistance;
+
+	FMatrix projectionM;
+
+	///Calculate the orthonormal for the screen (the screen coordinate system
+	vr = pb - pa;
+	vr.Normalize();
+	vu = pc - pa;
+	vu.Normalize();
+	vn = FVector::CrossProduct(vr, vu);
+	vn.Normalize();
+
+	//Calculate the vector from eye (pe) to screen corners (pa, pb, pc)
+	va = pa - pe;
+	vb = pb - pe;
+	vc = pc - pe;
+
+	//Get the distance;; from the eye to the screen plane
+	eyedistance = -(FVector::DotProduct(va, vn));
+
+	//Get the varaibles for the off center projection
+	left = (FVector::DotProduct(vr, va) * NearClipPlane) / eyedistance;
+	right = (FVector::DotProduct(vr, vb) * NearClipPlane) / eyedistance;
+	bottom = (FVector::DotProduct(vu, va) * NearClipPlane) / eyedistance;
+	top = (FVector::DotProduct(vu, vc) * NearClipPlane) / eyedistance;
+
+	float SumRL = (right + left);
+	float SumTB = (top + bottom);
+	float InvRL = (1.0f / (right - left));
+	float InvTB = (1.0f / (top - bottom));
+
+	projectionM.M[0][0] = 2.f * NearClipPlane * InvRL * M_0_0; // Connect to Z
+	projectionM.M[0][1] = 0.f;
+	projectionM.M[0][2] = 0.f;
+	projectionM.M[0][3] = 0.f + M_0_3;
+
+	projectionM.M[1][0] = 0.f;
+	projectionM.M[1][1] = 2.f * NearClipPlane * InvTB * M_1_1; // Connect to Z
+	projectionM.M[1][2] = 0.f;
+	projectionM.M[1][3] = 0.f + M_1_3;
+
+	projectionM.M[2][0] = SumRL * InvRL;
+	projectionM.M[2][1] = SumTB * InvTB;
+	projectionM.M[2][2] = 0.0f;
+	projectionM.M[2][3] = 1.0f;
+
+	projectionM.M[3][0] = 0.f;
+	projectionM.M[3][1] = 0.f;
+	projectionM.M[3][2] = NearClipPlane;
+	projectionM.M[3][3] = 0.f;
+
+	return projectionM;
+}
+
+FMatrix FSterioLegacyProjection::GeneralizedPerspectiveProjection1(FVector pe) const
+{
+	float zoff = 0.0f;
+	FVector pa = FVector(-width / 2.0f, -height / 2.0f, -zoff);
+	FVector pb = FVector(width / 2.0f, -height / 2.0f, -zoff);
+	FVector pc = FVector(-width / 2.0f, height / 2.0f, -zoff);
+
+	FVector va, vb, vc;
+	FVector vr, vu, vn;
+
+	float left, right, bottom, top, eyedistance;
+
+	FMatrix projectionM;
+
+	///Calculate the orthonormal for the screen (the screen coordinate system
+	vr = pb - pa;
+	vr.Normalize();
+	vu = pc - pa;
+	vu.Normalize();
+	vn = FVector::CrossProduct(vr, vu);
+	vn.Normalize();
+
+	//Calculate the vector from eye (pe) to screen corners (pa, pb, pc)
+	va = pa - pe;
+	vb = pb - pe;
+	vc = pc - pe;
+
+	//Get the distance;; from the eye to the screen plane
+	eyedistance = -(FVector::DotProduct(va, vn));
+
+	//Get the varaibles for the off center projection
+	left = (FVector::DotProduct(vr, va) * NearClipPlane) / eyedistance;
+	right = (FVector::DotProduct(vr, vb) * NearClipPlane) / eyedistance;
+	bottom = (FVector::DotProduct(vu, va) * NearClipPlane) / eyedistance;
+	top = (FVector::DotProduct(vu, vc) * NearClipPlane) / eyedistance;
+
+	// Have to flip left/right and top/bottom to match UE4 expectations
+	float Right = -FPlatformMath::Tan(left);
+	float Left = -FPlatformMath::Tan(right);
+	float Bottom = -FPlatformMath::Tan(top);
+	float Top = -FPlatformMath::Tan(bottom);
+
+	float SumRL = (Right + Left);
+	float SumTB = (Top + Bottom);
+	float InvRL = (1.0f / (Right - Left));
+	float InvTB = (1.0f / (Top - Bottom));
+
+	projectionM.M[0][0] = 2.f * NearClipPlane * InvRL * M_0_0; // Connect to Z
+	projectionM.M[0][1] = 0.f;
+	projectionM.M[0][2] = 0.f;
+	projectionM.M[0][3] = 0.f + M_0_3;
+
+	projectionM.M[1][0] = 0.f;
+	projectionM.M[1][1] = 2.f * NearClipPlane * InvTB * M_1_1; // Connect to Z
+	projectionM.M[1][2] = 0.f;
+	projectionM.M[1][3] = 0.f + M_1_3;
+
+	projectionM.M[2][0] = SumRL * InvRL;
+	projectionM.M[2][1] = SumTB * InvTB;
+	projectionM.M[2][2] = 0.0f;
+	projectionM.M[2][3] = 1.0f;
+
+	projectionM.M[3][0] = 0.f;
+	projectionM.M[3][1] = 0.f;
+	projectionM.M[3][2] = NearClipPlane;
+	projectionM.M[3][3] = 0.f;
+
+	return projectionM;
+}
@@ -0,0 +1,37 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * The rig's original per-eye projection builders, kept unchanged as the numeric reference
+ * the batched kernel is checked against by the benchmark suite.
+ */
+struct FSterioLegacyProjection
+{
+	FSterioLegacyProjection()
+		: width(160.f)
+		, height(100.f)
+		, NearClipPlane(1.f)
+		, M_0_0(1.f)
+		, M_0_3(0.f)
+		, M_1_1(1.f)
+		, M_1_3(0.f)
+	{
+	}
+
+	float width;
+	float height;
+	float NearClipPlane;
+	float M_0_0;
+	float M_0_3;
+	float M_1_1;
+	float M_1_3;
+
+	/** Direct extents, used for the left eye. */
+	FMatrix GeneralizedPerspectiveProjection(FVector pe) const;
+
+	/** Tan-flipped extents, used for the right eye. */
+	FMatrix GeneralizedPerspectiveProjection1(FVector pe) const;
+};
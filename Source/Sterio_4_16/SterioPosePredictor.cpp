@@ -0,0 +1,262 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioPosePredictor.h"
+#include "SterioTrackerInput.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioPrediction, Log, All);
+
+FSterioPosePredictor::FSterioPosePredictor()
+{
+	Reset();
+}
+
+void FSterioPosePredictor::Configure(const FSterioPredictionSettings& InSettings)
+{
+	if (InSettings.Mode != Settings.Mode)
+	{
+		Reset();
+	}
+	Settings = InSettings;
+}
+
+void FSterioPosePredictor::Reset()
+{
+	FMemory::Memzero(Axes);
+	LastSampleTime = 0.0;
+	ClockOffset = 0.0;
+	NumSamples = 0;
+}
+
+void FSterioPosePredictor::AddSample(double SampleTime, double ReceiveTime, const FVector& LeftEye, const FVector& RightEye)
+{
+	const double Measured[NumAxes] = { LeftEye.X, LeftEye.Y, LeftEye.Z, RightEye.X, RightEye.Y, RightEye.Z };
+
+	if (NumSamples == 0)
+	{
+		for (int32 Index = 0; Index < NumAxes; ++Index)
+		{
+			FAxisState& Axis = Axes[Index];
+			Axis.Position = Measured[Index];
+			Axis.Velocity = 0.0;
+			// Start uncertain about velocity so the filter locks on within a few samples
+			Axis.P00 = FMath::Square(Settings.MeasurementNoise);
+			Axis.P01 = 0.0;
+			Axis.P11 = 1.e4;
+		}
+		LastSampleTime = SampleTime;
+		ClockOffset = ReceiveTime - SampleTime;
+		NumSamples = 1;
+		return;
+	}
+
+	const double DeltaTime = SampleTime - LastSampleTime;
+	if (DeltaTime <= 0.0)
+	{
+		return;
+	}
+
+	for (int32 Index = 0; Index < NumAxes; ++Index)
+	{
+		UpdateAxis(Axes[Index], Measured[Index], DeltaTime);
+	}
+
+	LastSampleTime = SampleTime;
+	ClockOffset = FMath::Min(ClockOffset, ReceiveTime - SampleTime);
+	++NumSamples;
+}
+
+void FSterioPosePredictor::UpdateAxis(FAxisState& Axis, double Measured, double DeltaTime) const
+{
+	switch (Settings.Mode)
+	{
+	case ESterioPredictionMode::ConstantVelocity:
+	{
+		const double Velocity = (Measured - Axis.Position) / DeltaTime;
+		Axis.Velocity = FMath::Lerp(Axis.Velocity, Velocity, (double)Settings.VelocitySmoothing);
+		Axis.Position = Measured;
+		break;
+	}
+
+	case ESterioPredictionMode::Kalman:
+	{
+		// Predict with constant velocity: x' = x + v dt, P' = F P F^T + Q
+		const double Dt = DeltaTime;
+		const double Q = Settings.ProcessNoise;
+		const double Position = Axis.Position + Axis.Velocity * Dt;
+		const double P00 = Axis.P00 + 2.0 * Dt * Axis.P01 + Dt * Dt * Axis.P11 + Q * Dt * Dt * Dt / 3.0;
+		const double P01 = Axis.P01 + Dt * Axis.P11 + Q * Dt * Dt / 2.0;
+		const double P11 = Axis.P11 + Q * Dt;
+
+		// Correct with the measured position
+		const double S = P00 + FMath::Square((double)Settings.MeasurementNoise);
+		const double K0 = P00 / S;
+		const double K1 = P01 / S;
+		const double Innovation = Measured - Position;
+
+		Axis.Position = Position + K0 * Innovation;
+		Axis.Velocity = Axis.Velocity + K1 * Innovation;
+		Axis.P00 = (1.0 - K0) * P00;
+		Axis.P01 = (1.0 - K0) * P01;
+		Axis.P11 = P11 - K1 * P01;
+		break;
+	}
+
+	default:
+		Axis.Position = Measured;
+		Axis.Velocity = 0.0;
+		break;
+	}
+}
+
+FVector FSterioPosePredictor::PredictEye(int32 FirstAxis, double DeltaTime) const
+{
+	const FVector Current((float)Axes[FirstAxis].Position, (float)Axes[FirstAxis + 1].Position, (float)Axes[FirstAxis + 2].Position);
+	if (Settings.Mode == ESterioPredictionMode::None || DeltaTime <= 0.0)
+	{
+		return Current;
+	}
+
+	const FVector Velocity((float)Axes[FirstAxis].Velocity, (float)Axes[FirstAxis + 1].Velocity, (float)Axes[FirstAxis + 2].Velocity);
+	const FVector Offset = (Velocity * (float)DeltaTime).GetClampedToMaxSize(Settings.MaxExtrapolation);
+	return Current + Offset;
+}
+
+void FSterioPosePredictor::PredictAtSampleTime(double SampleTime, FVector& OutLeftEye, FVector& OutRightEye) const
+{
+	const double DeltaTime = SampleTime - LastSampleTime;
+	OutLeftEye = PredictEye(0, DeltaTime);
+	OutRightEye = PredictEye(3, DeltaTime);
+}
+
+void FSterioPosePredictor::PredictAtLocalTime(double LocalTime, FVector& OutLeftEye, FVector& OutRightEye) const
+{
+	PredictAtSampleTime(LocalTime - ClockOffset, OutLeftEye, OutRightEye);
+}
+
+void FSterioPosePredictor::Evaluate(const TArray<FSterioTrackerPacket>& Recording, const FSterioPredictionSettings& InSettings, const TArray<float>& Horizons, TArray<FSterioPredictionError>& OutErrors)
+{
+	OutErrors.Reset();
+
+	TArray<float> Errors;
+	Errors.Reserve(Recording.Num() * 2);
+
+	for (float Horizon : Horizons)
+	{
+		FSterioPosePredictor Predictor;
+		Predictor.Configure(InSettings);
+		Errors.Reset();
+
+		int32 Truth = 0;
+		for (int32 Index = 0; Index < Recording.Num(); ++Index)
+		{
+			const FSterioTrackedPose Pose = Recording[Index].ToPose(Recording[Index].SampleTime);
+			Predictor.AddSample(Pose.SampleTime, Pose.ReceiveTime, Pose.LeftEye, Pose.RightEye);
+
+			// Find the recorded samples bracketing the time being predicted
+			const double Target = Pose.SampleTime + Horizon;
+			while (Truth + 1 < Recording.Num() && Recording[Truth + 1].SampleTime < Target)
+			{
+				++Truth;
+			}
+			if (Truth + 1 >= Recording.Num())
+			{
+				break;
+			}
+
+			const FSterioTrackedPose Before = Recording[Truth].ToPose(0.0);
+			const FSterioTrackedPose After = Recording[Truth + 1].ToPose(0.0);
+			const double Span = After.SampleTime - Before.SampleTime;
+			const float Alpha = Span > 0.0 ? (float)FMath::Clamp((Target - Before.SampleTime) / Span, 0.0, 1.0) : 0.f;
+
+			FVector PredictedLeft, PredictedRight;
+			Predictor.PredictAtSampleTime(Target, PredictedLeft, PredictedRight);
+			Errors.Add(FVector::Dist(PredictedLeft, FMath::Lerp(Before.LeftEye, After.LeftEye, Alpha)));
+			Errors.Add(FVector::Dist(PredictedRight, FMath::Lerp(Before.RightEye, After.RightEye, Alpha)));
+		}
+
+		FSterioPredictionError Result;
+		Result.HorizonSeconds = Horizon;
+		Result.Samples = Errors.Num();
+		Result.RmsError = 0.f;
+		Result.P95Error = 0.f;
+		Result.MaxError = 0.f;
+
+		if (Errors.Num() > 0)
+		{
+			double SumSquares = 0.0;
+			for (float Error : Errors)
+			{
+				SumSquares += FMath::Square((double)Error);
+			}
+			Errors.Sort();
+			Result.RmsError = (float)FMath::Sqrt(SumSquares / Errors.Num());
+			Result.P95Error = Errors[FMath::Min(Errors.Num() - 1, (Errors.Num() * 95) / 100)];
+			Result.MaxError = Errors.Last();
+		}
+
+		OutErrors.Add(Result);
+	}
+}
+
+static void EvaluatePredictionCommand(const TArray<FString>& Args)
+{
+	if (Args.Num() < 1)
+	{
+		UE_LOG(LogSterioPrediction, Warning, TEXT("Usage: Sterio.Predictor.Evaluate <Recording> [HorizonMs...]"));
+		return;
+	}
+
+	TArray<FSterioTrackerPacket> Recording;
+	if (!FSterioTrackerPacket::LoadRecording(Args[0], Recording) || Recording.Num() < 2)
+	{
+		UE_LOG(LogSterioPrediction, Error, TEXT("Could not load tracker recording %s"), *Args[0]);
+		return;
+	}
+
+	TArray<float> Horizons;
+	for (int32 Index = 1; Index < Args.Num(); ++Index)
+	{
+		Horizons.Add(FCString::Atof(*Args[Index]) / 1000.f);
+	}
+	if (Horizons.Num() == 0)
+	{
+		const float DefaultHorizonsMs[] = { 0.f, 8.f, 16.f, 25.f, 33.f, 50.f, 75.f, 100.f };
+		for (float HorizonMs : DefaultHorizonsMs)
+		{
+			Horizons.Add(HorizonMs / 1000.f);
+		}
+	}
+
+	FString Csv = TEXT("mode,horizon_ms,samples,rms_cm,p95_cm,max_cm\n");
+	const ESterioPredictionMode Modes[] = { ESterioPredictionMode::None, ESterioPredictionMode::ConstantVelocity, ESterioPredictionMode::Kalman };
+	const TCHAR* ModeNames[] = { TEXT("none"), TEXT("constant_velocity"), TEXT("kalman") };
+
+	for (int32 ModeIndex = 0; ModeIndex < ARRAY_COUNT(Modes); ++ModeIndex)
+	{
+		FSterioPredictionSettings Settings;
+		Settings.Mode = Modes[ModeIndex];
+
+		TArray<FSterioPredictionError> Errors;
+		FSterioPosePredictor::Evaluate(Recording, Settings, Horizons, Errors);
+
+		for (const FSterioPredictionError& Error : Errors)
+		{
+			UE_LOG(LogSterioPrediction, Display, TEXT("%-18s %6.1f ms  rms %7.3f cm  p95 %7.3f cm  max %7.3f cm"), ModeNames[ModeIndex], Error.HorizonSeconds * 1000.f, Error.RmsError, Error.P95Error, Error.MaxError);
+			Csv += FString::Printf(TEXT("%s,%.1f,%d,%.4f,%.4f,%.4f\n"), ModeNames[ModeIndex], Error.HorizonSeconds * 1000.f, Error.Samples, Error.RmsError, Error.P95Error, Error.MaxError);
+		}
+	}
+
+	const FString Path = FPaths::GameSavedDir() / TEXT("Sterio") / TEXT("Prediction") / (FPaths::GetBaseFilename(Args[0]) + TEXT(".csv"));
+	if (FFileHelper::SaveStringToFile(Csv, *Path))
+	{
+		UE_LOG(LogSterioPrediction, Display, TEXT("Prediction report written to %s"), *Path);
+	}
+}
+
+static FAutoConsoleCommand SterioPredictorEvaluateCommand(
+	TEXT("Sterio.Predictor.Evaluate"),
+	TEXT("Replays a tracker recording through every prediction mode and reports error versus horizon. Usage: Sterio.Predictor.Evaluate <Recording> [HorizonMs...]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&EvaluatePredictionCommand));
@@ -0,0 +1,115 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SterioPosePredictor.generated.h"
+
+struct FSterioTrackerPacket;
+
+UENUM(BlueprintType)
+enum class ESterioPredictionMode : uint8
+{
+	/** Use the newest sample as-is */
+	None,
+	/** Extrapolate with a smoothed finite-difference velocity */
+	ConstantVelocity,
+	/** Extrapolate with a per-axis constant-velocity Kalman filter */
+	Kalman,
+};
+
+USTRUCT(BlueprintType)
+struct FSterioPredictionSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioPrediction)
+	ESterioPredictionMode Mode = ESterioPredictionMode::None;
+
+	/** Seconds from the start of the frame to when its captures reach the display */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioPrediction, meta = (ClampMin = "0.0", UIMax = "0.1"))
+	float HorizonSeconds = 0.033f;
+
+	/** Constant velocity: weight of the newest velocity estimate, 1 = no smoothing */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioPrediction, meta = (ClampMin = "0.01", ClampMax = "1.0"))
+	float VelocitySmoothing = 0.5f;
+
+	/** Kalman: white-noise acceleration density; higher follows sudden moves faster but jitters more */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioPrediction, meta = (ClampMin = "0.0"))
+	float ProcessNoise = 2000.f;
+
+	/** Kalman: standard deviation of the tracker's position noise, in cm */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioPrediction, meta = (ClampMin = "0.001"))
+	float MeasurementNoise = 0.05f;
+
+	/** Predictions never move an eye further than this from its newest sample, in cm */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioPrediction, meta = (ClampMin = "0.0"))
+	float MaxExtrapolation = 10.f;
+};
+
+/** Prediction error of one mode at one horizon, as reported by FSterioPosePredictor::Evaluate. */
+struct FSterioPredictionError
+{
+	float HorizonSeconds;
+	int32 Samples;
+	float RmsError;
+	float P95Error;
+	float MaxError;
+};
+
+/**
+ * Extrapolates tracked eye positions to the time the frame being built will be displayed.
+ *
+ * Samples carry the tracker's own time stamp; the offset to the local clock is estimated as the
+ * smallest receive delay seen so far, which keeps network jitter out of the velocity estimate.
+ */
+class FSterioPosePredictor
+{
+public:
+	FSterioPosePredictor();
+
+	void Configure(const FSterioPredictionSettings& InSettings);
+	const FSterioPredictionSettings& GetSettings() const { return Settings; }
+
+	void Reset();
+
+	/** Feeds one sample. Samples must arrive in sample time order; older ones are ignored. */
+	void AddSample(double SampleTime, double ReceiveTime, const FVector& LeftEye, const FVector& RightEye);
+
+	bool HasSamples() const { return NumSamples > 0; }
+
+	/** Tracker time stamp of the newest sample fed */
+	double GetNewestSampleTime() const { return LastSampleTime; }
+
+	/** Eye positions expected at LocalTime (FPlatformTime::Seconds() clock). */
+	void PredictAtLocalTime(double LocalTime, FVector& OutLeftEye, FVector& OutRightEye) const;
+
+	/** Eye positions expected at the given tracker sample time. */
+	void PredictAtSampleTime(double SampleTime, FVector& OutLeftEye, FVector& OutRightEye) const;
+
+	/**
+	 * Replays a recording through a predictor with the given settings and measures, for each horizon,
+	 * the distance between the prediction made at every sample and the recorded position that followed.
+	 */
+	static void Evaluate(const TArray<FSterioTrackerPacket>& Recording, const FSterioPredictionSettings& InSettings, const TArray<float>& Horizons, TArray<FSterioPredictionError>& OutErrors);
+
+private:
+	/** Position and velocity of one coordinate, with the Kalman covariance when that mode is used. */
+	struct FAxisState
+	{
+		double Position;
+		double Velocity;
+		double P00, P01, P11;
+	};
+
+	enum { NumAxes = 6 };
+
+	void UpdateAxis(FAxisState& Axis, double Measured, double DeltaTime) const;
+	FVector PredictEye(int32 FirstAxis, double DeltaTime) const;
+
+	FSterioPredictionSettings Settings;
+	FAxisState Axes[NumAxes];
+	double LastSampleTime;
+	double ClockOffset;
+	int32 NumSamples;
+};
@@ -0,0 +1,149 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Versioned cache of the off-axis projection of every screen x eye slot.
+ *
+ * Inputs are tracked with version counters rather than compared value by value: the shared version
+ * covers everything all slots depend on (clip planes, M_x_y tuning), each screen has a version for its
+ * corners and each eye one for its pose. A slot is rebuilt only when one of the versions it was built
+ * from has moved on.
+ */
+struct FSterioProjectionCache
+{
+	enum { NumEyes = 2 };
+
+	FSterioProjectionCache()
+		: SharedVersion(1)
+		, RigVersion(0)
+		, Hits(0)
+		, Misses(0)
+	{
+		for (int32 Eye = 0; Eye < NumEyes; ++Eye)
+		{
+			EyeVersions[Eye] = 1;
+		}
+		Reset(1);
+	}
+
+	/** Resizes the cache for the given number of screens; every slot starts out stale. */
+	void Reset(int32 NumScreens)
+	{
+		check(NumScreens > 0);
+		ScreenVersions.Init(1, NumScreens);
+		Entries.Reset();
+		Entries.SetNum(NumScreens * NumEyes);
+		++RigVersion;
+	}
+
+	static int32 GetSlot(int32 Screen, int32 Eye) { return Screen * NumEyes + Eye; }
+	static int32 GetSlotScreen(int32 Slot) { return Slot / NumEyes; }
+	static int32 GetSlotEye(int32 Slot) { return Slot % NumEyes; }
+
+	int32 GetNumScreens() const { return ScreenVersions.Num(); }
+	int32 GetNumSlots() const { return Entries.Num(); }
+
+	/** Marks the inputs shared by every slot as changed. */
+	void InvalidateShared()
+	{
+		++SharedVersion;
+		++RigVersion;
+	}
+
+	/** Marks the corners of a single screen as changed. */
+	void InvalidateScreen(int32 Screen)
+	{
+		++ScreenVersions[Screen];
+		++RigVersion;
+	}
+
+	/** Marks the pose of a single eye as changed, on every screen. */
+	void InvalidateEye(int32 Eye)
+	{
+		check(Eye >= 0 && Eye < NumEyes);
+		++EyeVersions[Eye];
+	}
+
+	/** Forces every slot to be rebuilt on the next update. */
+	void InvalidateAll()
+	{
+		for (FEntry& Entry : Entries)
+		{
+			Entry.bValid = false;
+		}
+	}
+
+	/** Returns true and counts a miss if the slot has to be rebuilt, otherwise counts a hit. */
+	bool NeedsRebuild(int32 Slot)
+	{
+		const FEntry& Entry = Entries[Slot];
+		if (Entry.bValid && Entry.BuiltVersion == GetInputVersion(Slot))
+		{
+			++Hits;
+			return false;
+		}
+		++Misses;
+		return true;
+	}
+
+	/** Stores a freshly built projection, stamping it with the current input version. */
+	void Store(int32 Slot, const FMatrix& Projection)
+	{
+		FEntry& Entry = Entries[Slot];
+		Entry.Projection = Projection;
+		Entry.BuiltVersion = GetInputVersion(Slot);
+		Entry.bValid = true;
+	}
+
+	const FMatrix& GetProjection(int32 Slot) const
+	{
+		return Entries[Slot].Projection;
+	}
+
+	/** Monotonic version of everything the slot's projection depends on. Every component only grows, so neither does the sum. */
+	uint32 GetInputVersion(int32 Slot) const
+	{
+		return SharedVersion + ScreenVersions[GetSlotScreen(Slot)] + EyeVersions[GetSlotEye(Slot)];
+	}
+
+	/** Version of everything but the eyes: moves on whenever the shared inputs or any screen change, or the cache is resized. */
+	uint32 GetRigVersion() const
+	{
+		return RigVersion;
+	}
+
+	uint64 GetHits() const { return Hits; }
+	uint64 GetMisses() const { return Misses; }
+
+	void ResetCounters()
+	{
+		Hits = 0;
+		Misses = 0;
+	}
+
+private:
+	struct FEntry
+	{
+		FEntry()
+			: Projection(FMatrix::Identity)
+			, BuiltVersion(0)
+			, bValid(false)
+		{
+		}
+
+		FMatrix Projection;
+		uint32 BuiltVersion;
+		bool bValid;
+	};
+
+	TArray<FEntry> Entries;
+	uint32 SharedVersion;
+	TArray<uint32> ScreenVersions;
+	uint32 EyeVersions[NumEyes];
+	uint32 RigVersion;
+	uint64 Hits;
+	uint64 Misses;
+};
@@ -0,0 +1,756 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+// Off-axis ("generalized perspective") projection kernels for the stereo rig.
+//
+// This header deliberately has no engine dependency so it can be compiled on its own; the rig converts
+// FVector/FMatrix at the boundary. Matrices use the same row-vector layout as FMatrix (M[Row][Col]).
+//
+// Projections are computed for N eyes x M screens in one call. Eye positions are passed as a
+// structure of arrays so the per-eye frustum extents can be computed several eyes at a time.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define STERIO_PROJECTION_SSE 1
+	#define STERIO_PROJECTION_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define STERIO_PROJECTION_SSE 1
+	#define STERIO_PROJECTION_AVX2 0
+#else
+	#define STERIO_PROJECTION_SSE 0
+	#define STERIO_PROJECTION_AVX2 0
+#endif
+
+namespace SterioProjection
+{
+	/** How the near-plane extents are turned into the matrix; matches the two original rig builders. */
+	enum class EFlavor : uint8_t
+	{
+		/** Extents used as-is (GeneralizedPerspectiveProjection). */
+		Direct,
+		/** Extents passed through -tan() with left/right and top/bottom swapped (GeneralizedPerspectiveProjection1). */
+		TanFlipped,
+	};
+
+	enum class EKernel : uint8_t
+	{
+		Scalar,
+		SSE,
+		AVX2,
+	};
+
+	struct FVec3
+	{
+		float X, Y, Z;
+	};
+
+	inline FVec3 MakeVec3(float X, float Y, float Z)
+	{
+		FVec3 Result = { X, Y, Z };
+		return Result;
+	}
+
+	inline FVec3 Sub(const FVec3& A, const FVec3& B)
+	{
+		return MakeVec3(A.X - B.X, A.Y - B.Y, A.Z - B.Z);
+	}
+
+	inline float Dot(const FVec3& A, const FVec3& B)
+	{
+		return A.X * B.X + A.Y * B.Y + A.Z * B.Z;
+	}
+
+	inline FVec3 Cross(const FVec3& A, const FVec3& B)
+	{
+		return MakeVec3(A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X);
+	}
+
+	inline FVec3 Normalize(const FVec3& V)
+	{
+		const float SquareSum = Dot(V, V);
+		if (SquareSum > 1.e-8f)
+		{
+			const float Scale = 1.0f / std::sqrt(SquareSum);
+			return MakeVec3(V.X * Scale, V.Y * Scale, V.Z * Scale);
+		}
+		return V;
+	}
+
+	/** Screen rectangle given by its lower-left (Pa), lower-right (Pb) and upper-left (Pc) corners. */
+	struct FScreen
+	{
+		FVec3 Pa, Pb, Pc;
+	};
+
+	/**
+	 * Which projection path a screen takes. The specialised shapes drop the basis terms they know to be zero
+	 * and work from per-screen constants, so they need one division per eye instead of seven.
+	 */
+	enum class EScreenShape : uint8_t
+	{
+		/** Facing +Z, right along +X and up along +Y, like the rig's default screen. */
+		AxisAligned,
+		/** Upright but turned about the up (Y) axis, like the walls of a CAVE. */
+		SingleAxis,
+		/** Anything else, including floors and tilted screens. */
+		General,
+	};
+
+	/**
+	 * Largest basis component a specialised shape may ignore. With eyes within 10 m of the screen the
+	 * specialised paths then agree with the general one to 1e-5 relative, see ShapeAgreementTolerance.
+	 */
+	const float ShapeTolerance = 1.e-6f;
+	const float ShapeAgreementTolerance = 1.e-5f;
+
+	/** Screen corners plus the orthonormal screen basis (right, up, normal); computed once per screen. */
+	struct FScreenBasis
+	{
+		FVec3 Pa, Pb, Pc;
+		FVec3 Vr, Vu, Vn;
+
+		EScreenShape Shape;
+
+		/** Vr.Pa, Vr.Pb, Vu.Pa, Vu.Pc and Vn.Pa: the eye-independent halves of the extents, used by the specialised shapes */
+		float RightA, RightB, UpA, UpC, NormalA;
+	};
+
+	inline EScreenShape ClassifyScreen(const FVec3& Vr, const FVec3& Vu)
+	{
+		const bool bUpright = std::fabs(Vu.X) <= ShapeTolerance && std::fabs(Vu.Z) <= ShapeTolerance && std::fabs(Vr.Y) <= ShapeTolerance && Vu.Y > 0.0f;
+		if (!bUpright)
+		{
+			return EScreenShape::General;
+		}
+		return (std::fabs(Vr.Z) <= ShapeTolerance && Vr.X > 0.0f) ? EScreenShape::AxisAligned : EScreenShape::SingleAxis;
+	}
+
+	inline FScreenBasis MakeScreenBasis(const FScreen& Screen)
+	{
+		FScreenBasis Basis;
+		Basis.Pa = Screen.Pa;
+		Basis.Pb = Screen.Pb;
+		Basis.Pc = Screen.Pc;
+		Basis.Vr = Normalize(Sub(Screen.Pb, Screen.Pa));
+		Basis.Vu = Normalize(Sub(Screen.Pc, Screen.Pa));
+		Basis.Vn = Normalize(Cross(Basis.Vr, Basis.Vu));
+
+		Basis.Shape = ClassifyScreen(Basis.Vr, Basis.Vu);
+		Basis.RightA = Dot(Basis.Vr, Screen.Pa);
+		Basis.RightB = Dot(Basis.Vr, Screen.Pb);
+		Basis.UpA = Dot(Basis.Vu, Screen.Pa);
+		Basis.UpC = Dot(Basis.Vu, Screen.Pc);
+		Basis.NormalA = Dot(Basis.Vn, Screen.Pa);
+		return Basis;
+	}
+
+	/** Axis-aligned screen of the given size centred on the origin, as the rig has always used. */
+	inline FScreen MakeCenteredScreen(float Width, float Height, float ZOffset = 0.0f)
+	{
+		FScreen Screen;
+		Screen.Pa = MakeVec3(-Width / 2.0f, -Height / 2.0f, -ZOffset);
+		Screen.Pb = MakeVec3(Width / 2.0f, -Height / 2.0f, -ZOffset);
+		Screen.Pc = MakeVec3(-Width / 2.0f, Height / 2.0f, -ZOffset);
+		return Screen;
+	}
+
+	/** The M_x_y tuning terms the projection consumes. */
+	struct FTuning
+	{
+		float M00, M11, M03, M13;
+	};
+
+	/** How view depth maps to NDC depth. The engine renders with reversed Z, so Finite is only meant for consumers outside it. */
+	enum class EDepthMode : uint8_t
+	{
+		/** No far plane: near maps to 1 and depth falls towards 0 at infinity, as the rig has always done. */
+		Infinite,
+		/** Near maps to 0, far to 1. */
+		Finite,
+		/** Near maps to 1, far to 0. */
+		ReversedFinite,
+	};
+
+	struct FFrustumParams
+	{
+		float Near;
+		/** Ignored by EDepthMode::Infinite. */
+		float Far;
+		EDepthMode DepthMode;
+		FTuning Tuning;
+	};
+
+	inline FFrustumParams MakeFrustumParams(float Near, EDepthMode DepthMode = EDepthMode::Infinite, float Far = 0.0f)
+	{
+		FFrustumParams Params;
+		Params.Near = Near;
+		Params.Far = Far;
+		Params.DepthMode = DepthMode;
+		Params.Tuning.M00 = 1.0f;
+		Params.Tuning.M11 = 1.0f;
+		Params.Tuning.M03 = 0.0f;
+		Params.Tuning.M13 = 0.0f;
+		return Params;
+	}
+
+	struct alignas(16) FMatrix44
+	{
+		float M[4][4];
+	};
+
+	/** Eye positions in screen space as a structure of arrays. Flavors may be null (all Direct). */
+	struct FEyesSoA
+	{
+		const float* X;
+		const float* Y;
+		const float* Z;
+		const EFlavor* Flavors;
+		int32_t Num;
+	};
+
+	/** Near-plane frustum extents of one eye. */
+	struct FExtents
+	{
+		float Left, Right, Bottom, Top;
+	};
+
+	inline FExtents ComputeExtents(const FScreenBasis& Basis, const FVec3& Eye, float Near)
+	{
+		const FVec3 Va = Sub(Basis.Pa, Eye);
+		const FVec3 Vb = Sub(Basis.Pb, Eye);
+		const FVec3 Vc = Sub(Basis.Pc, Eye);
+
+		const float EyeDistance = -Dot(Va, Basis.Vn);
+
+		FExtents Extents;
+		Extents.Left = (Dot(Basis.Vr, Va) * Near) / EyeDistance;
+		Extents.Right = (Dot(Basis.Vr, Vb) * Near) / EyeDistance;
+		Extents.Bottom = (Dot(Basis.Vu, Va) * Near) / EyeDistance;
+		Extents.Top = (Dot(Basis.Vu, Vc) * Near) / EyeDistance;
+		return Extents;
+	}
+
+	/** The four matrix terms that depend on the eye; everything else is constant per call. */
+	struct FCoefficients
+	{
+		float ScaleX, ScaleY, OffsetX, OffsetY;
+	};
+
+	inline FCoefficients ComputeCoefficients(const FExtents& In, EFlavor Flavor, const FFrustumParams& Params)
+	{
+		FExtents E = In;
+		if (Flavor == EFlavor::TanFlipped)
+		{
+			// Have to flip left/right and top/bottom to match UE4 expectations
+			E.Right = -std::tan(In.Left);
+			E.Left = -std::tan(In.Right);
+			E.Bottom = -std::tan(In.Top);
+			E.Top = -std::tan(In.Bottom);
+		}
+
+		const float SumRL = E.Right + E.Left;
+		const float SumTB = E.Top + E.Bottom;
+		const float InvRL = 1.0f / (E.Right - E.Left);
+		const float InvTB = 1.0f / (E.Top - E.Bottom);
+
+		FCoefficients C;
+		C.ScaleX = 2.f * Params.Near * InvRL * Params.Tuning.M00;
+		C.ScaleY = 2.f * Params.Near * InvTB * Params.Tuning.M11;
+		C.OffsetX = SumRL * InvRL;
+		C.OffsetY = SumTB * InvTB;
+		return C;
+	}
+
+	/** M[2][2] and M[3][2], the only terms that depend on the depth mode. A far plane at or inside the near one falls back to Infinite. */
+	inline void ComputeDepthTerms(const FFrustumParams& Params, float& OutM22, float& OutM32)
+	{
+		const float Near = Params.Near;
+		const float Far = Params.Far;
+		if (Params.DepthMode == EDepthMode::Infinite || Far <= Near)
+		{
+			OutM22 = 0.0f;
+			OutM32 = Near;
+		}
+		else if (Params.DepthMode == EDepthMode::Finite)
+		{
+			OutM22 = Far / (Far - Near);
+			OutM32 = -Near * Far / (Far - Near);
+		}
+		else
+		{
+			OutM22 = Near / (Near - Far);
+			OutM32 = Far * Near / (Far - Near);
+		}
+	}
+
+	inline void WriteMatrix(const FCoefficients& C, const FFrustumParams& Params, FMatrix44& Out)
+	{
+		float M22, M32;
+		ComputeDepthTerms(Params, M22, M32);
+
+		Out.M[0][0] = C.ScaleX;
+		Out.M[0][1] = 0.f;
+		Out.M[0][2] = 0.f;
+		Out.M[0][3] = 0.f + Params.Tuning.M03;
+
+		Out.M[1][0] = 0.f;
+		Out.M[1][1] = C.ScaleY;
+		Out.M[1][2] = 0.f;
+		Out.M[1][3] = 0.f + Params.Tuning.M13;
+
+		Out.M[2][0] = C.OffsetX;
+		Out.M[2][1] = C.OffsetY;
+		Out.M[2][2] = M22;
+		Out.M[2][3] = 1.0f;
+
+		Out.M[3][0] = 0.f;
+		Out.M[3][1] = 0.f;
+		Out.M[3][2] = M32;
+		Out.M[3][3] = 0.f;
+	}
+
+	/** Single-eye reference path. */
+	inline FMatrix44 ComputeProjection(const FScreenBasis& Basis, const FVec3& Eye, EFlavor Flavor, const FFrustumParams& Params)
+	{
+		FMatrix44 Result;
+		WriteMatrix(ComputeCoefficients(ComputeExtents(Basis, Eye, Params.Near), Flavor, Params), Params, Result);
+		return Result;
+	}
+
+	namespace Detail
+	{
+		/** Eyes are processed in blocks of this many so per-block scratch lives on the stack. */
+		enum { BlockSize = 8 };
+
+		struct FBlock
+		{
+			float Left[BlockSize], Right[BlockSize], Bottom[BlockSize], Top[BlockSize];
+			float ScaleX[BlockSize], ScaleY[BlockSize], OffsetX[BlockSize], OffsetY[BlockSize];
+		};
+
+		inline void ComputeBlockScalar(const FScreenBasis& Basis, const FEyesSoA& Eyes, int32_t First, int32_t Count, const FFrustumParams& Params, FBlock& Block, int32_t Offset)
+		{
+			for (int32_t Index = 0; Index < Count; ++Index)
+			{
+				const int32_t EyeIndex = First + Index;
+				const FExtents E = ComputeExtents(Basis, MakeVec3(Eyes.X[EyeIndex], Eyes.Y[EyeIndex], Eyes.Z[EyeIndex]), Params.Near);
+				const FCoefficients C = ComputeCoefficients(E, EFlavor::Direct, Params);
+				Block.Left[Offset + Index] = E.Left;
+				Block.Right[Offset + Index] = E.Right;
+				Block.Bottom[Offset + Index] = E.Bottom;
+				Block.Top[Offset + Index] = E.Top;
+				Block.ScaleX[Offset + Index] = C.ScaleX;
+				Block.ScaleY[Offset + Index] = C.ScaleY;
+				Block.OffsetX[Offset + Index] = C.OffsetX;
+				Block.OffsetY[Offset + Index] = C.OffsetY;
+			}
+		}
+
+#if STERIO_PROJECTION_SSE
+		inline __m128 Dot4(__m128 Ax, __m128 Ay, __m128 Az, float Bx, float By, float Bz)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Bx), Ax), _mm_mul_ps(_mm_set1_ps(By), Ay)), _mm_mul_ps(_mm_set1_ps(Bz), Az));
+		}
+
+		/** Four eyes per iteration; Count must be a multiple of 4. */
+		inline void ComputeBlockSSE(const FScreenBasis& Basis, const FEyesSoA& Eyes, int32_t First, int32_t Count, const FFrustumParams& Params, FBlock& Block, int32_t Offset)
+		{
+			const FScreenBasis& B = Basis;
+			const __m128 Near = _mm_set1_ps(Params.Near);
+			const __m128 TwoNearX = _mm_set1_ps(2.f * Params.Near * Params.Tuning.M00);
+			const __m128 TwoNearY = _mm_set1_ps(2.f * Params.Near * Params.Tuning.M11);
+			const __m128 One = _mm_set1_ps(1.0f);
+
+			for (int32_t Index = 0; Index < Count; Index += 4)
+			{
+				const __m128 Ex = _mm_loadu_ps(Eyes.X + First + Index);
+				const __m128 Ey = _mm_loadu_ps(Eyes.Y + First + Index);
+				const __m128 Ez = _mm_loadu_ps(Eyes.Z + First + Index);
+
+				const __m128 VaX = _mm_sub_ps(_mm_set1_ps(B.Pa.X), Ex);
+				const __m128 VaY = _mm_sub_ps(_mm_set1_ps(B.Pa.Y), Ey);
+				const __m128 VaZ = _mm_sub_ps(_mm_set1_ps(B.Pa.Z), Ez);
+				const __m128 VbX = _mm_sub_ps(_mm_set1_ps(B.Pb.X), Ex);
+				const __m128 VbY = _mm_sub_ps(_mm_set1_ps(B.Pb.Y), Ey);
+				const __m128 VbZ = _mm_sub_ps(_mm_set1_ps(B.Pb.Z), Ez);
+				const __m128 VcX = _mm_sub_ps(_mm_set1_ps(B.Pc.X), Ex);
+				const __m128 VcY = _mm_sub_ps(_mm_set1_ps(B.Pc.Y), Ey);
+				const __m128 VcZ = _mm_sub_ps(_mm_set1_ps(B.Pc.Z), Ez);
+
+				const __m128 Distance = _mm_sub_ps(_mm_setzero_ps(), Dot4(VaX, VaY, VaZ, B.Vn.X, B.Vn.Y, B.Vn.Z));
+
+				const __m128 L = _mm_div_ps(_mm_mul_ps(Dot4(VaX, VaY, VaZ, B.Vr.X, B.Vr.Y, B.Vr.Z), Near), Distance);
+				const __m128 R = _mm_div_ps(_mm_mul_ps(Dot4(VbX, VbY, VbZ, B.Vr.X, B.Vr.Y, B.Vr.Z), Near), Distance);
+				const __m128 Bt = _mm_div_ps(_mm_mul_ps(Dot4(VaX, VaY, VaZ, B.Vu.X, B.Vu.Y, B.Vu.Z), Near), Distance);
+				const __m128 T = _mm_div_ps(_mm_mul_ps(Dot4(VcX, VcY, VcZ, B.Vu.X, B.Vu.Y, B.Vu.Z), Near), Distance);
+
+				const __m128 InvRL = _mm_div_ps(One, _mm_sub_ps(R, L));
+				const __m128 InvTB = _mm_div_ps(One, _mm_sub_ps(T, Bt));
+
+				_mm_storeu_ps(Block.Left + Offset + Index, L);
+				_mm_storeu_ps(Block.Right + Offset + Index, R);
+				_mm_storeu_ps(Block.Bottom + Offset + Index, Bt);
+				_mm_storeu_ps(Block.Top + Offset + Index, T);
+				_mm_storeu_ps(Block.ScaleX + Offset + Index, _mm_mul_ps(TwoNearX, InvRL));
+				_mm_storeu_ps(Block.ScaleY + Offset + Index, _mm_mul_ps(TwoNearY, InvTB));
+				_mm_storeu_ps(Block.OffsetX + Offset + Index, _mm_mul_ps(_mm_add_ps(R, L), InvRL));
+				_mm_storeu_ps(Block.OffsetY + Offset + Index, _mm_mul_ps(_mm_add_ps(T, Bt), InvTB));
+			}
+		}
+#endif
+
+#if STERIO_PROJECTION_AVX2
+		inline __m256 Dot8(__m256 Ax, __m256 Ay, __m256 Az, float Bx, float By, float Bz)
+		{
+			return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(Bx), Ax), _mm256_mul_ps(_mm256_set1_ps(By), Ay)), _mm256_mul_ps(_mm256_set1_ps(Bz), Az));
+		}
+
+		/** Eight eyes per iteration; Count must be a multiple of 8. */
+		inline void ComputeBlockAVX2(const FScreenBasis& Basis, const FEyesSoA& Eyes, int32_t First, int32_t Count, const FFrustumParams& Params, FBlock& Block, int32_t Offset)
+		{
+			const FScreenBasis& B = Basis;
+			const __m256 Near = _mm256_set1_ps(Params.Near);
+			const __m256 TwoNearX = _mm256_set1_ps(2.f * Params.Near * Params.Tuning.M00);
+			const __m256 TwoNearY = _mm256_set1_ps(2.f * Params.Near * Params.Tuning.M11);
+			const __m256 One = _mm256_set1_ps(1.0f);
+
+			for (int32_t Index = 0; Index < Count; Index += 8)
+			{
+				const __m256 Ex = _mm256_loadu_ps(Eyes.X + First + Index);
+				const __m256 Ey = _mm256_loadu_ps(Eyes.Y + First + Index);
+				const __m256 Ez = _mm256_loadu_ps(Eyes.Z + First + Index);
+
+				const __m256 VaX = _mm256_sub_ps(_mm256_set1_ps(B.Pa.X), Ex);
+				const __m256 VaY = _mm256_sub_ps(_mm256_set1_ps(B.Pa.Y), Ey);
+				const __m256 VaZ = _mm256_sub_ps(_mm256_set1_ps(B.Pa.Z), Ez);
+				const __m256 VbX = _mm256_sub_ps(_mm256_set1_ps(B.Pb.X), Ex);
+				const __m256 VbY = _mm256_sub_ps(_mm256_set1_ps(B.Pb.Y), Ey);
+				const __m256 VbZ = _mm256_sub_ps(_mm256_set1_ps(B.Pb.Z), Ez);
+				const __m256 VcX = _mm256_sub_ps(_mm256_set1_ps(B.Pc.X), Ex);
+				const __m256 VcY = _mm256_sub_ps(_mm256_set1_ps(B.Pc.Y), Ey);
+				const __m256 VcZ = _mm256_sub_ps(_mm256_set1_ps(B.Pc.Z), Ez);
+
+				const __m256 Distance = _mm256_sub_ps(_mm256_setzero_ps(), Dot8(VaX, VaY, VaZ, B.Vn.X, B.Vn.Y, B.Vn.Z));
+
+				const __m256 L = _mm256_div_ps(_mm256_mul_ps(Dot8(VaX, VaY, VaZ, B.Vr.X, B.Vr.Y, B.Vr.Z), Near), Distance);
+				const __m256 R = _mm256_div_ps(_mm256_mul_ps(Dot8(VbX, VbY, VbZ, B.Vr.X, B.Vr.Y, B.Vr.Z), Near), Distance);
+				const __m256 Bt = _mm256_div_ps(_mm256_mul_ps(Dot8(VaX, VaY, VaZ, B.Vu.X, B.Vu.Y, B.Vu.Z), Near), Distance);
+				const __m256 T = _mm256_div_ps(_mm256_mul_ps(Dot8(VcX, VcY, VcZ, B.Vu.X, B.Vu.Y, B.Vu.Z), Near), Distance);
+
+				const __m256 InvRL = _mm256_div_ps(One, _mm256_sub_ps(R, L));
+				const __m256 InvTB = _mm256_div_ps(One, _mm256_sub_ps(T, Bt));
+
+				_mm256_storeu_ps(Block.Left + Offset + Index, L);
+				_mm256_storeu_ps(Block.Right + Offset + Index, R);
+				_mm256_storeu_ps(Block.Bottom + Offset + Index, Bt);
+				_mm256_storeu_ps(Block.Top + Offset + Index, T);
+				_mm256_storeu_ps(Block.ScaleX + Offset + Index, _mm256_mul_ps(TwoNearX, InvRL));
+				_mm256_storeu_ps(Block.ScaleY + Offset + Index, _mm256_mul_ps(TwoNearY, InvTB));
+				_mm256_storeu_ps(Block.OffsetX + Offset + Index, _mm256_mul_ps(_mm256_add_ps(R, L), InvRL));
+				_mm256_storeu_ps(Block.OffsetY + Offset + Index, _mm256_mul_ps(_mm256_add_ps(T, Bt), InvTB));
+			}
+		}
+#endif
+
+		/**
+		 * Constants of the specialised shapes. With D = Vn.E - Vn.Pa the eye's distance to the screen plane:
+		 *   Left = (Vr.Pa - Vr.E) * Near / D, and likewise for Right, Bottom and Top
+		 *   ScaleX = 2 * Near * M00 / (Right - Left) = 2 * M00 / Width * D
+		 *   OffsetX = (Right + Left) / (Right - Left) = (Vr.Pa + Vr.Pb - 2 * Vr.E) / Width
+		 * so only Near / D is left to divide per eye.
+		 */
+		struct FShapeConstants
+		{
+			float InvWidth, InvHeight;
+			float ScaleXPerDistance, ScaleYPerDistance;
+			float SumRight, SumUp;
+		};
+
+		inline FShapeConstants MakeShapeConstants(const FScreenBasis& B, const FFrustumParams& Params)
+		{
+			FShapeConstants K;
+			K.InvWidth = 1.0f / (B.RightB - B.RightA);
+			K.InvHeight = 1.0f / (B.UpC - B.UpA);
+			K.ScaleXPerDistance = 2.f * Params.Tuning.M00 * K.InvWidth;
+			K.ScaleYPerDistance = 2.f * Params.Tuning.M11 * K.InvHeight;
+			K.SumRight = B.RightA + B.RightB;
+			K.SumUp = B.UpA + B.UpC;
+			return K;
+		}
+
+		/** Vr.E and Vn.E without the terms Shape guarantees to be zero; Vu.E is always E.Y for the specialised shapes. */
+		template <EScreenShape Shape>
+		inline float ProjectRight(const FScreenBasis& B, float Ex, float Ez)
+		{
+			return Shape == EScreenShape::AxisAligned ? Ex : B.Vr.X * Ex + B.Vr.Z * Ez;
+		}
+
+		template <EScreenShape Shape>
+		inline float ProjectNormal(const FScreenBasis& B, float Ex, float Ez)
+		{
+			return Shape == EScreenShape::AxisAligned ? Ez : B.Vn.X * Ex + B.Vn.Z * Ez;
+		}
+
+		template <EScreenShape Shape>
+		inline void ComputeBlockShapedScalar(const FScreenBasis& B, const FEyesSoA& Eyes, int32_t First, int32_t Count, const FFrustumParams& Params, FBlock& Block, int32_t Offset)
+		{
+			const FShapeConstants K = MakeShapeConstants(B, Params);
+			for (int32_t Index = 0; Index < Count; ++Index)
+			{
+				const int32_t EyeIndex = First + Index;
+				const float RightE = ProjectRight<Shape>(B, Eyes.X[EyeIndex], Eyes.Z[EyeIndex]);
+				const float UpE = Eyes.Y[EyeIndex];
+				const float Distance = ProjectNormal<Shape>(B, Eyes.X[EyeIndex], Eyes.Z[EyeIndex]) - B.NormalA;
+				const float Scale = Params.Near / Distance;
+
+				Block.Left[Offset + Index] = (B.RightA - RightE) * Scale;
+				Block.Right[Offset + Index] = (B.RightB - RightE) * Scale;
+				Block.Bottom[Offset + Index] = (B.UpA - UpE) * Scale;
+				Block.Top[Offset + Index] = (B.UpC - UpE) * Scale;
+				Block.ScaleX[Offset + Index] = K.ScaleXPerDistance * Distance;
+				Block.ScaleY[Offset + Index] = K.ScaleYPerDistance * Distance;
+				Block.OffsetX[Offset + Index] = (K.SumRight - 2.f * RightE) * K.InvWidth;
+				Block.OffsetY[Offset + Index] = (K.SumUp - 2.f * UpE) * K.InvHeight;
+			}
+		}
+
+#if STERIO_PROJECTION_SSE
+		template <EScreenShape Shape>
+		inline __m128 ProjectRight4(const FScreenBasis& B, __m128 Ex, __m128 Ez)
+		{
+			return Shape == EScreenShape::AxisAligned ? Ex : _mm_add_ps(_mm_mul_ps(_mm_set1_ps(B.Vr.X), Ex), _mm_mul_ps(_mm_set1_ps(B.Vr.Z), Ez));
+		}
+
+		template <EScreenShape Shape>
+		inline __m128 ProjectNormal4(const FScreenBasis& B, __m128 Ex, __m128 Ez)
+		{
+			return Shape == EScreenShape::AxisAligned ? Ez : _mm_add_ps(_mm_mul_ps(_mm_set1_ps(B.Vn.X), Ex), _mm_mul_ps(_mm_set1_ps(B.Vn.Z), Ez));
+		}
+
+		/** Four eyes per iteration; Count must be a multiple of 4. */
+		template <EScreenShape Shape>
+		inline void ComputeBlockShapedSSE(const FScreenBasis& B, const FEyesSoA& Eyes, int32_t First, int32_t Count, const FFrustumParams& Params, FBlock& Block, int32_t Offset)
+		{
+			const FShapeConstants K = MakeShapeConstants(B, Params);
+			const __m128 Near = _mm_set1_ps(Params.Near);
+			const __m128 RightA = _mm_set1_ps(B.RightA);
+			const __m128 RightB = _mm_set1_ps(B.RightB);
+			const __m128 UpA = _mm_set1_ps(B.UpA);
+			const __m128 UpC = _mm_set1_ps(B.UpC);
+			const __m128 NormalA = _mm_set1_ps(B.NormalA);
+			const __m128 InvWidth = _mm_set1_ps(K.InvWidth);
+			const __m128 InvHeight = _mm_set1_ps(K.InvHeight);
+			const __m128 ScaleXPerDistance = _mm_set1_ps(K.ScaleXPerDistance);
+			const __m128 ScaleYPerDistance = _mm_set1_ps(K.ScaleYPerDistance);
+			const __m128 SumRight = _mm_set1_ps(K.SumRight);
+			const __m128 SumUp = _mm_set1_ps(K.SumUp);
+
+			for (int32_t Index = 0; Index < Count; Index += 4)
+			{
+				const __m128 Ex = _mm_loadu_ps(Eyes.X + First + Index);
+				const __m128 Ey = _mm_loadu_ps(Eyes.Y + First + Index);
+				const __m128 Ez = _mm_loadu_ps(Eyes.Z + First + Index);
+
+				const __m128 RightE = ProjectRight4<Shape>(B, Ex, Ez);
+				const __m128 Distance = _mm_sub_ps(ProjectNormal4<Shape>(B, Ex, Ez), NormalA);
+				const __m128 Scale = _mm_div_ps(Near, Distance);
+
+				_mm_storeu_ps(Block.Left + Offset + Index, _mm_mul_ps(_mm_sub_ps(RightA, RightE), Scale));
+				_mm_storeu_ps(Block.Right + Offset + Index, _mm_mul_ps(_mm_sub_ps(RightB, RightE), Scale));
+				_mm_storeu_ps(Block.Bottom + Offset + Index, _mm_mul_ps(_mm_sub_ps(UpA, Ey), Scale));
+				_mm_storeu_ps(Block.Top + Offset + Index, _mm_mul_ps(_mm_sub_ps(UpC, Ey), Scale));
+				_mm_storeu_ps(Block.ScaleX + Offset + Index, _mm_mul_ps(ScaleXPerDistance, Distance));
+				_mm_storeu_ps(Block.ScaleY + Offset + Index, _mm_mul_ps(ScaleYPerDistance, Distance));
+				_mm_storeu_ps(Block.OffsetX + Offset + Index, _mm_mul_ps(_mm_sub_ps(SumRight, _mm_add_ps(RightE, RightE)), InvWidth));
+				_mm_storeu_ps(Block.OffsetY + Offset + Index, _mm_mul_ps(_mm_sub_ps(SumUp, _mm_add_ps(Ey, Ey)), InvHeight));
+			}
+		}
+#endif
+
+#if STERIO_PROJECTION_AVX2
+		template <EScreenShape Shape>
+		inline __m256 ProjectRight8(const FScreenBasis& B, __m256 Ex, __m256 Ez)
+		{
+			return Shape == EScreenShape::AxisAligned ? Ex : _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(B.Vr.X), Ex), _mm256_mul_ps(_mm256_set1_ps(B.Vr.Z), Ez));
+		}
+
+		template <EScreenShape Shape>
+		inline __m256 ProjectNormal8(const FScreenBasis& B, __m256 Ex, __m256 Ez)
+		{
+			return Shape == EScreenShape::AxisAligned ? Ez : _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(B.Vn.X), Ex), _mm256_mul_ps(_mm256_set1_ps(B.Vn.Z), Ez));
+		}
+
+		/** Eight eyes per iteration; Count must be a multiple of 8. */
+		template <EScreenShape Shape>
+		inline void ComputeBlockShapedAVX2(const FScreenBasis& B, const FEyesSoA& Eyes, int32_t First, int32_t Count, const FFrustumParams& Params, FBlock& Block, int32_t Offset)
+		{
+			const FShapeConstants K = MakeShapeConstants(B, Params);
+			const __m256 Near = _mm256_set1_ps(Params.Near);
+			const __m256 RightA = _mm256_set1_ps(B.RightA);
+			const __m256 RightB = _mm256_set1_ps(B.RightB);
+			const __m256 UpA = _mm256_set1_ps(B.UpA);
+			const __m256 UpC = _mm256_set1_ps(B.UpC);
+			const __m256 NormalA = _mm256_set1_ps(B.NormalA);
+			const __m256 InvWidth = _mm256_set1_ps(K.InvWidth);
+			const __m256 InvHeight = _mm256_set1_ps(K.InvHeight);
+			const __m256 ScaleXPerDistance = _mm256_set1_ps(K.ScaleXPerDistance);
+			const __m256 ScaleYPerDistance = _mm256_set1_ps(K.ScaleYPerDistance);
+			const __m256 SumRight = _mm256_set1_ps(K.SumRight);
+			const __m256 SumUp = _mm256_set1_ps(K.SumUp);
+
+			for (int32_t Index = 0; Index < Count; Index += 8)
+			{
+				const __m256 Ex = _mm256_loadu_ps(Eyes.X + First + Index);
+				const __m256 Ey = _mm256_loadu_ps(Eyes.Y + First + Index);
+				const __m256 Ez = _mm256_loadu_ps(Eyes.Z + First + Index);
+
+				const __m256 RightE = ProjectRight8<Shape>(B, Ex, Ez);
+				const __m256 Distance = _mm256_sub_ps(ProjectNormal8<Shape>(B, Ex, Ez), NormalA);
+				const __m256 Scale = _mm256_div_ps(Near, Distance);
+
+				_mm256_storeu_ps(Block.Left + Offset + Index, _mm256_mul_ps(_mm256_sub_ps(RightA, RightE), Scale));
+				_mm256_storeu_ps(Block.Right + Offset + Index, _mm256_mul_ps(_mm256_sub_ps(RightB, RightE), Scale));
+				_mm256_storeu_ps(Block.Bottom + Offset + Index, _mm256_mul_ps(_mm256_sub_ps(UpA, Ey), Scale));
+				_mm256_storeu_ps(Block.Top + Offset + Index, _mm256_mul_ps(_mm256_sub_ps(UpC, Ey), Scale));
+				_mm256_storeu_ps(Block.ScaleX + Offset + Index, _mm256_mul_ps(ScaleXPerDistance, Distance));
+				_mm256_storeu_ps(Block.ScaleY + Offset + Index, _mm256_mul_ps(ScaleYPerDistance, Distance));
+				_mm256_storeu_ps(Block.OffsetX + Offset + Index, _mm256_mul_ps(_mm256_sub_ps(SumRight, _mm256_add_ps(RightE, RightE)), InvWidth));
+				_mm256_storeu_ps(Block.OffsetY + Offset + Index, _mm256_mul_ps(_mm256_sub_ps(SumUp, _mm256_add_ps(Ey, Ey)), InvHeight));
+			}
+		}
+#endif
+
+		template <EScreenShape Shape>
+		inline void ComputeBlockShaped(EKernel Kernel, const FScreenBasis& Basis, const FEyesSoA& Eyes, int32_t First, int32_t Count, const FFrustumParams& Params, FBlock& Block)
+		{
+			int32_t Done = 0;
+#if !STERIO_PROJECTION_SSE
+			(void)Kernel;
+#endif
+#if STERIO_PROJECTION_AVX2
+			if (Kernel == EKernel::AVX2)
+			{
+				const int32_t Wide = Count & ~7;
+				ComputeBlockShapedAVX2<Shape>(Basis, Eyes, First, Wide, Params, Block, 0);
+				Done = Wide;
+			}
+#endif
+#if STERIO_PROJECTION_SSE
+			if (Kernel != EKernel::Scalar)
+			{
+				const int32_t Wide = (Count - Done) & ~3;
+				ComputeBlockShapedSSE<Shape>(Basis, Eyes, First + Done, Wide, Params, Block, Done);
+				Done += Wide;
+			}
+#endif
+			ComputeBlockShapedScalar<Shape>(Basis, Eyes, First + Done, Count - Done, Params, Block, Done);
+		}
+
+		inline void ComputeBlock(EKernel Kernel, const FScreenBasis& Basis, const FEyesSoA& Eyes, int32_t First, int32_t Count, const FFrustumParams& Params, FBlock& Block)
+		{
+			if (Basis.Shape == EScreenShape::AxisAligned)
+			{
+				ComputeBlockShaped<EScreenShape::AxisAligned>(Kernel, Basis, Eyes, First, Count, Params, Block);
+				return;
+			}
+			if (Basis.Shape == EScreenShape::SingleAxis)
+			{
+				ComputeBlockShaped<EScreenShape::SingleAxis>(Kernel, Basis, Eyes, First, Count, Params, Block);
+				return;
+			}
+
+			int32_t Done = 0;
+#if STERIO_PROJECTION_AVX2
+			if (Kernel == EKernel::AVX2)
+			{
+				const int32_t Wide = Count & ~7;
+				ComputeBlockAVX2(Basis, Eyes, First, Wide, Params, Block, 0);
+				Done = Wide;
+			}
+#endif
+#if STERIO_PROJECTION_SSE
+			if (Kernel != EKernel::Scalar)
+			{
+				const int32_t Wide = (Count - Done) & ~3;
+				ComputeBlockSSE(Basis, Eyes, First + Done, Wide, Params, Block, Done);
+				Done += Wide;
+			}
+#endif
+			ComputeBlockScalar(Basis, Eyes, First + Done, Count - Done, Params, Block, Done);
+		}
+	}
+
+	/** Widest kernel this translation unit was compiled with. */
+	inline EKernel GetBestKernel()
+	{
+#if STERIO_PROJECTION_AVX2
+		return EKernel::AVX2;
+#elif STERIO_PROJECTION_SSE
+		return EKernel::SSE;
+#else
+		return EKernel::Scalar;
+#endif
+	}
+
+	inline bool IsKernelAvailable(EKernel Kernel)
+	{
+		return (int32_t)Kernel <= (int32_t)GetBestKernel();
+	}
+
+	/**
+	 * Computes the projection of every eye onto every screen.
+	 * Out receives NumScreens * Eyes.Num matrices, screen-major: Out[Screen * Eyes.Num + Eye].
+	 * Each screen takes the path of its Shape; set it to General to force the fully general one.
+	 * Kernels that were not compiled in fall back to the widest available one.
+	 */
+	inline void ComputeProjections(const FScreenBasis* Screens, int32_t NumScreens, const FEyesSoA& Eyes, const FFrustumParams& Params, FMatrix44* Out, EKernel Kernel = GetBestKernel())
+	{
+		if (!IsKernelAvailable(Kernel))
+		{
+			Kernel = GetBestKernel();
+		}
+
+		Detail::FBlock Block;
+		for (int32_t ScreenIndex = 0; ScreenIndex < NumScreens; ++ScreenIndex)
+		{
+			const FScreenBasis& Basis = Screens[ScreenIndex];
+			FMatrix44* ScreenOut = Out + (ptrdiff_t)ScreenIndex * Eyes.Num;
+
+			for (int32_t First = 0; First < Eyes.Num; First += Detail::BlockSize)
+			{
+				const int32_t Count = (Eyes.Num - First) < Detail::BlockSize ? (Eyes.Num - First) : (int32_t)Detail::BlockSize;
+				Detail::ComputeBlock(Kernel, Basis, Eyes, First, Count, Params, Block);
+
+				for (int32_t Index = 0; Index < Count; ++Index)
+				{
+					const EFlavor Flavor = Eyes.Flavors ? Eyes.Flavors[First + Index] : EFlavor::Direct;
+
+					FCoefficients C;
+					if (Flavor == EFlavor::Direct)
+					{
+						C.ScaleX = Block.ScaleX[Index];
+						C.ScaleY = Block.ScaleY[Index];
+						C.OffsetX = Block.OffsetX[Index];
+						C.OffsetY = Block.OffsetY[Index];
+					}
+					else
+					{
+						FExtents E;
+						E.Left = Block.Left[Index];
+						E.Right = Block.Right[Index];
+						E.Bottom = Block.Bottom[Index];
+						E.Top = Block.Top[Index];
+						C = ComputeCoefficients(E, Flavor, Params);
+					}
+					WriteMatrix(C, Params, ScreenOut[First + Index]);
+				}
+			}
+		}
+	}
+}
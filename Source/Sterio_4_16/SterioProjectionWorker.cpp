@@ -0,0 +1,322 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioProjectionWorker.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/ScopeLock.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioProjectionWorker, Log, All);
+
+FSterioProjectionWorker::FSterioProjectionWorker(const SterioProjection::EFlavor* InEyeFlavors)
+	: EyeFlavors(InEyeFlavors)
+	, Queue(256)
+	, Thread(nullptr)
+	, WorkEvent(nullptr)
+	, PendingRigVersion(0)
+	, RigVersion(0)
+	, bHasPose(false)
+{
+}
+
+FSterioProjectionWorker::~FSterioProjectionWorker()
+{
+	Shutdown();
+}
+
+bool FSterioProjectionWorker::Start()
+{
+	check(!Thread);
+
+	WorkEvent = FPlatformProcess::GetSynchEventFromPool();
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, TEXT("SterioProjectionWorker"), 0, TPri_AboveNormal);
+	return Thread != nullptr;
+}
+
+void FSterioProjectionWorker::Shutdown()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	if (WorkEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		WorkEvent = nullptr;
+	}
+}
+
+void FSterioProjectionWorker::AddPose(const FSterioTrackedPose& Pose)
+{
+	if (!Queue.Enqueue(Pose))
+	{
+		Dropped.Increment();
+	}
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+}
+
+bool FSterioProjectionWorker::SetRig(const TArray<SterioProjection::FScreenBasis>& InBases, const SterioProjection::FFrustumParams& InParams, uint32 InRigVersion)
+{
+	if (InBases.Num() > FSterioProjectionSet::MaxScreens)
+	{
+		return false;
+	}
+
+	{
+		FScopeLock Lock(&RigLock);
+		PendingBases = InBases;
+		PendingParams = InParams;
+		PendingRigVersion = InRigVersion;
+	}
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+	return true;
+}
+
+bool FSterioProjectionWorker::ReadLatest(FSterioProjectionSet& OutSet) const
+{
+	uint64_t Sequence;
+	if (!Publication.Read(OutSet, Sequence))
+	{
+		return false;
+	}
+	OutSet.Sequence = Sequence;
+	return true;
+}
+
+uint32 FSterioProjectionWorker::Run()
+{
+	while (!bStopping)
+	{
+		// Wake up regularly so Stop() is noticed even when the tracker is silent
+		WorkEvent->Wait(50);
+
+		// Only the newest pose matters; the ones it overtook would be stale by the time anyone read them
+		bool bChanged = false;
+		FSterioTrackedPose Pose;
+		while (Queue.Dequeue(Pose))
+		{
+			LatestPose = Pose;
+			bHasPose = true;
+			bChanged = true;
+		}
+
+		{
+			FScopeLock Lock(&RigLock);
+			if (PendingRigVersion != RigVersion)
+			{
+				Bases = PendingBases;
+				Params = PendingParams;
+				RigVersion = PendingRigVersion;
+				bChanged = true;
+			}
+		}
+
+		if (bChanged && bHasPose && Bases.Num() > 0)
+		{
+			Publish();
+		}
+	}
+	return 0;
+}
+
+void FSterioProjectionWorker::Stop()
+{
+	bStopping = true;
+	WorkEvent->Trigger();
+}
+
+void FSterioProjectionWorker::Publish()
+{
+	FSterioProjectionSet& Set = Publication.BeginWrite();
+	Set.RigVersion = RigVersion;
+	Set.NumScreens = Bases.Num();
+	Set.SampleTime = LatestPose.SampleTime;
+	Set.ReceiveTime = LatestPose.ReceiveTime;
+	Set.LeftEye = LatestPose.LeftEye;
+	Set.RightEye = LatestPose.RightEye;
+
+	const float EyeX[] = { LatestPose.LeftEye.X, LatestPose.RightEye.X };
+	const float EyeY[] = { LatestPose.LeftEye.Y, LatestPose.RightEye.Y };
+	const float EyeZ[] = { LatestPose.LeftEye.Z, LatestPose.RightEye.Z };
+	const SterioProjection::FEyesSoA Eyes = { EyeX, EyeY, EyeZ, EyeFlavors, FSterioProjectionCache::NumEyes };
+	SterioProjection::ComputeProjections(Bases.GetData(), Bases.Num(), Eyes, Params, Set.Projections);
+
+	Publication.EndWrite();
+}
+
+namespace
+{
+	const SterioProjection::EFlavor GStressEyeFlavors[FSterioProjectionCache::NumEyes] = { SterioProjection::EFlavor::Direct, SterioProjection::EFlavor::TanFlipped };
+
+	/** The right eye of every stress pose sits this far from the left one */
+	const FVector GStressEyeOffset(6.4f, 0.f, 0.f);
+
+	/** Deterministic left eye of stress pose Index, in whole cm so it survives the round trip through SampleTime. */
+	FVector MakeStressEye(int64 Index)
+	{
+		return FVector(-30.f + (Index % 61), -10.f + (Index % 23), 60.f + (Index % 37));
+	}
+
+	/** The default screen alone, and the CAVE of the default screen between two walls; the stress test switches between them. */
+	void MakeStressRig(int32 Variant, TArray<SterioProjection::FScreenBasis>& OutBases)
+	{
+		OutBases.Reset();
+		OutBases.Add(SterioProjection::MakeScreenBasis(SterioProjection::MakeCenteredScreen(100.f, 56.25f)));
+		if (Variant % 2 == 1)
+		{
+			SterioProjection::FScreen LeftWall;
+			LeftWall.Pa = SterioProjection::MakeVec3(-50.f, -28.125f, 50.f);
+			LeftWall.Pb = SterioProjection::MakeVec3(-50.f, -28.125f, 0.f);
+			LeftWall.Pc = SterioProjection::MakeVec3(-50.f, 28.125f, 50.f);
+			OutBases.Add(SterioProjection::MakeScreenBasis(LeftWall));
+
+			SterioProjection::FScreen RightWall;
+			RightWall.Pa = SterioProjection::MakeVec3(50.f, -28.125f, 0.f);
+			RightWall.Pb = SterioProjection::MakeVec3(50.f, -28.125f, 50.f);
+			RightWall.Pc = SterioProjection::MakeVec3(50.f, 28.125f, 0.f);
+			OutBases.Add(SterioProjection::MakeScreenBasis(RightWall));
+		}
+	}
+
+	struct FStressReaderStats
+	{
+		int64 Reads = 0;
+		int64 Checked = 0;
+		int64 Mismatched = 0;
+		int64 OutOfOrder = 0;
+	};
+}
+
+static void RunProjectionWorkerStressCommand(const TArray<FString>& Args)
+{
+	const double Seconds = Args.Num() > 0 ? FCString::Atod(*Args[0]) : 5.0;
+	const int32 NumReaders = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 4;
+	const int32 PosesPerRig = 1000;
+
+	TArray<SterioProjection::FScreenBasis> Rigs[2];
+	MakeStressRig(0, Rigs[0]);
+	MakeStressRig(1, Rigs[1]);
+	const SterioProjection::FFrustumParams Params = SterioProjection::MakeFrustumParams(10.f);
+
+	FSterioProjectionWorker Worker(GStressEyeFlavors);
+	uint32 RigVersion = 1;
+	Worker.SetRig(Rigs[RigVersion % 2], Params, RigVersion);
+	if (!Worker.Start())
+	{
+		UE_LOG(LogSterioProjectionWorker, Error, TEXT("Could not start the projection worker for the stress test"));
+		return;
+	}
+
+	// Readers stand in for the game and render threads: every new set they see has to be one pose, projected
+	// exactly as a fresh computation from that pose and the set's rig would
+	FThreadSafeBool bStop;
+	TArray<FStressReaderStats> Stats;
+	Stats.SetNum(NumReaders);
+	TArray<TFuture<void>> Readers;
+	for (int32 ReaderIndex = 0; ReaderIndex < NumReaders; ++ReaderIndex)
+	{
+		FStressReaderStats* ReaderStats = &Stats[ReaderIndex];
+		Readers.Add(Async<void>(EAsyncExecution::Thread, [&Worker, &Rigs, &Params, &bStop, ReaderStats]()
+		{
+			uint64 LastSequence = 0;
+			SterioProjection::FMatrix44 Expected[FSterioProjectionSet::MaxSlots];
+			FSterioProjectionSet Set;
+			while (!bStop)
+			{
+				if (!Worker.ReadLatest(Set))
+				{
+					FPlatformProcess::Sleep(0.f);
+					continue;
+				}
+
+				++ReaderStats->Reads;
+				if (Set.Sequence < LastSequence)
+				{
+					++ReaderStats->OutOfOrder;
+				}
+				if (Set.Sequence <= LastSequence)
+				{
+					continue;
+				}
+				LastSequence = Set.Sequence;
+				++ReaderStats->Checked;
+
+				const TArray<SterioProjection::FScreenBasis>& Bases = Rigs[Set.RigVersion % 2];
+				const float EyeX[] = { Set.LeftEye.X, Set.RightEye.X };
+				const float EyeY[] = { Set.LeftEye.Y, Set.RightEye.Y };
+				const float EyeZ[] = { Set.LeftEye.Z, Set.RightEye.Z };
+				const SterioProjection::FEyesSoA Eyes = { EyeX, EyeY, EyeZ, GStressEyeFlavors, FSterioProjectionCache::NumEyes };
+				SterioProjection::ComputeProjections(Bases.GetData(), Bases.Num(), Eyes, Params, Expected);
+
+				const bool bSamePose = Set.LeftEye.Equals(MakeStressEye((int64)Set.SampleTime), 0.f) && Set.RightEye.Equals(Set.LeftEye + GStressEyeOffset, 0.f);
+				const bool bSameRig = Set.NumScreens == Bases.Num();
+				const bool bSameMatrices = bSameRig && FMemory::Memcmp(Set.Projections, Expected, sizeof(SterioProjection::FMatrix44) * Bases.Num() * FSterioProjectionCache::NumEyes) == 0;
+				if (!bSamePose || !bSameMatrices)
+				{
+					++ReaderStats->Mismatched;
+				}
+			}
+		}));
+	}
+
+	// Faster than any tracker; yields now and then so the worker isn't starved on a loaded machine
+	const double StartTime = FPlatformTime::Seconds();
+	int64 NumPoses = 0;
+	while (FPlatformTime::Seconds() - StartTime < Seconds)
+	{
+		FSterioTrackedPose Pose;
+		Pose.SampleTime = (double)NumPoses;
+		Pose.ReceiveTime = FPlatformTime::Seconds();
+		Pose.LeftEye = MakeStressEye(NumPoses);
+		Pose.RightEye = Pose.LeftEye + GStressEyeOffset;
+		Worker.AddPose(Pose);
+		++NumPoses;
+
+		if (NumPoses % PosesPerRig == 0)
+		{
+			++RigVersion;
+			Worker.SetRig(Rigs[RigVersion % 2], Params, RigVersion);
+		}
+		if (NumPoses % 64 == 0)
+		{
+			FPlatformProcess::Sleep(0.f);
+		}
+	}
+	const double Elapsed = FPlatformTime::Seconds() - StartTime;
+
+	bStop = true;
+	for (TFuture<void>& Reader : Readers)
+	{
+		Reader.Wait();
+	}
+	Worker.Shutdown();
+
+	FStressReaderStats Total;
+	for (const FStressReaderStats& ReaderStats : Stats)
+	{
+		Total.Reads += ReaderStats.Reads;
+		Total.Checked += ReaderStats.Checked;
+		Total.Mismatched += ReaderStats.Mismatched;
+		Total.OutOfOrder += ReaderStats.OutOfOrder;
+	}
+
+	const bool bPassed = Total.Mismatched == 0 && Total.OutOfOrder == 0 && Total.Checked > 0;
+	UE_LOG(LogSterioProjectionWorker, Display, TEXT("Projection worker stress test %s: %lld poses in %.1f s, %llu sets published (%.0f per second), %lld poses dropped; %d readers made %lld reads of %lld distinct sets with %lld retries, %lld mismatched, %lld out of order"),
+		bPassed ? TEXT("passed") : TEXT("FAILED"), NumPoses, Elapsed, Worker.GetPublishedCount(), Worker.GetPublishedCount() / FMath::Max(Elapsed, 1.e-3),
+		Worker.GetDroppedCount(), NumReaders, Total.Reads, Total.Checked, Worker.GetRetryCount(), Total.Mismatched, Total.OutOfOrder);
+}
+
+static FAutoConsoleCommandWithArgs SterioProjectionWorkerStressCommand(
+	TEXT("Sterio.ProjectionWorker.Stress"),
+	TEXT("Publishes projections for synthetic poses as fast as the worker computes them while reader threads check every set they see is one consistent pose. Usage: Sterio.ProjectionWorker.Stress [Seconds] [Readers]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunProjectionWorkerStressCommand));
@@ -0,0 +1,107 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "SterioProjectionCache.h"
+#include "SterioProjectionKernel.h"
+#include "SterioSeqLock.h"
+#include "SterioTrackerInput.h"
+
+class FRunnableThread;
+
+/** Every eye projection of a rig for one tracker pose, as published by FSterioProjectionWorker. */
+struct FSterioProjectionSet
+{
+	enum { MaxScreens = 8, MaxSlots = MaxScreens * FSterioProjectionCache::NumEyes };
+
+	/** Sequence number of the publication, from 1; 0 until a set was read */
+	uint64 Sequence = 0;
+	/** Rig version the screens and frustum parameters were handed over with, see FSterioProjectionWorker::SetRig */
+	uint32 RigVersion = 0;
+	int32 NumScreens = 0;
+
+	/** The pose every projection of the set was computed for */
+	double SampleTime;
+	double ReceiveTime;
+	FVector LeftEye;
+	FVector RightEye;
+
+	/** Indexed by FSterioProjectionCache::GetSlot(Screen, Eye) */
+	SterioProjection::FMatrix44 Projections[MaxSlots];
+};
+
+/**
+ * Computes a rig's eye projections on its own thread for every tracker pose, as the poses arrive, and publishes
+ * them through a SterioSeqLock::TPublication. The game thread takes the newest set instead of computing one once per
+ * frame; any other thread may read it too. Every reader gets the matrices of both eyes of every screen for the
+ * same pose, never the left eye of one pose with the right eye of another.
+ *
+ * The worker projects raw tracker poses. The screens and frustum parameters are a snapshot the game thread hands
+ * over through SetRig whenever they change; sets computed before it arrived still carry the previous version.
+ */
+class FSterioProjectionWorker : public FRunnable
+{
+public:
+	/** EyeFlavors holds the flavor of each eye of a screen and must outlive the worker. */
+	explicit FSterioProjectionWorker(const SterioProjection::EFlavor* InEyeFlavors);
+	virtual ~FSterioProjectionWorker();
+
+	bool Start();
+	void Shutdown();
+
+	/** Single producer, usually the tracker's receive thread: queues a pose and wakes the worker. Never blocks. */
+	void AddPose(const FSterioTrackedPose& Pose);
+
+	/**
+	 * Game thread: hands over the screens and frustum parameters of the rig, which the newest pose is recomputed
+	 * with right away. Returns false if the rig has more screens than a set holds.
+	 */
+	bool SetRig(const TArray<SterioProjection::FScreenBasis>& InBases, const SterioProjection::FFrustumParams& InParams, uint32 InRigVersion);
+
+	/** Any thread: copies the newest set. Returns false if none was published yet. */
+	bool ReadLatest(FSterioProjectionSet& OutSet) const;
+
+	uint64 GetPublishedCount() const { return Publication.GetPublishedCount(); }
+	int64 GetRetryCount() const { return (int64)Publication.GetRetryCount(); }
+	int64 GetDroppedCount() const { return Dropped.GetValue(); }
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End of FRunnable interface
+
+private:
+	/** Worker thread: computes and publishes the set of LatestPose. */
+	void Publish();
+
+	const SterioProjection::EFlavor* EyeFlavors;
+
+	/** Capacity must be a power of two; one slot stays empty */
+	TCircularQueue<FSterioTrackedPose> Queue;
+
+	FRunnableThread* Thread;
+	FEvent* WorkEvent;
+	FThreadSafeBool bStopping;
+
+	/** Handed over by SetRig, guarded by RigLock */
+	FCriticalSection RigLock;
+	TArray<SterioProjection::FScreenBasis> PendingBases;
+	SterioProjection::FFrustumParams PendingParams;
+	uint32 PendingRigVersion;
+
+	/** Worker thread state */
+	TArray<SterioProjection::FScreenBasis> Bases;
+	SterioProjection::FFrustumParams Params;
+	uint32 RigVersion;
+	FSterioTrackedPose LatestPose;
+	bool bHasPose;
+
+	SterioSeqLock::TPublication<FSterioProjectionSet> Publication;
+
+	FThreadSafeCounter64 Dropped;
+};
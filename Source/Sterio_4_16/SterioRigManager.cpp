@@ -0,0 +1,241 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioRigManager.h"
+#include "Sterio_4_16Character.h"
+#include "SterioTelemetry.h"
+#include "Async/ParallelFor.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarSterioRigManager(
+	TEXT("Sterio.RigManager"),
+	1,
+	TEXT("0: every rig rebuilds its eye projections in its own Tick and late latch tick\n")
+	TEXT("1: rigs that begin play from now on are updated together by their world's rig manager"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarSterioRigManagerJobsPerTask(
+	TEXT("Sterio.RigManager.JobsPerTask"),
+	8,
+	TEXT("Rigs computed by each task of the batched projection pass; a single task runs inline on the game thread"),
+	ECVF_Default);
+
+TMap<const UWorld*, FSterioRigManager*> FSterioRigManager::Managers;
+
+void FSterioRigManagerTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target)
+	{
+		Target->Update();
+	}
+}
+
+FString FSterioRigManagerTickFunction::DiagnosticMessage()
+{
+	return TEXT("FSterioRigManager");
+}
+
+FSterioRigManager::FSterioRigManager(UWorld* InWorld)
+	: World(InWorld)
+	, bUpdating(false)
+{
+	TickFunction.bCanEverTick = true;
+	TickFunction.bStartWithTickEnabled = true;
+	TickFunction.TickGroup = TG_PostUpdateWork;
+	TickFunction.Target = this;
+	TickFunction.RegisterTickFunction(World->PersistentLevel);
+}
+
+FSterioRigManager::~FSterioRigManager()
+{
+	if (TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.UnRegisterTickFunction();
+	}
+}
+
+bool FSterioRigManager::Register(ASterio_4_16Character* Rig)
+{
+	UWorld* World = Rig ? Rig->GetWorld() : nullptr;
+	if (!World || !World->PersistentLevel || CVarSterioRigManager.GetValueOnGameThread() == 0)
+	{
+		return false;
+	}
+
+	static bool bCleanupBound = false;
+	if (!bCleanupBound)
+	{
+		FWorldDelegates::OnWorldCleanup.AddStatic(&FSterioRigManager::OnWorldCleanup);
+		bCleanupBound = true;
+	}
+
+	FSterioRigManager*& Manager = Managers.FindOrAdd(World);
+	if (!Manager)
+	{
+		Manager = new FSterioRigManager(World);
+	}
+
+	Manager->Rigs.AddUnique(Rig);
+	Manager->TickFunction.AddPrerequisite(Rig, Rig->PrimaryActorTick);
+
+	// The manager runs the rig's late update from now on
+	Rig->bManagedByRigManager = true;
+	Rig->LateLatchTick.SetTickFunctionEnable(false);
+	return true;
+}
+
+void FSterioRigManager::Unregister(ASterio_4_16Character* Rig)
+{
+	if (!Rig || !Rig->bManagedByRigManager)
+	{
+		return;
+	}
+	Rig->bManagedByRigManager = false;
+
+	FSterioRigManager** Found = Managers.Find(Rig->GetWorld());
+	if (!Found)
+	{
+		return;
+	}
+	FSterioRigManager* Manager = *Found;
+	Manager->TickFunction.RemovePrerequisite(Rig, Rig->PrimaryActorTick);
+
+	if (Manager->bUpdating)
+	{
+		// Update skips and compacts the gaps once it is done with the arrays, and retires the manager if none are left
+		const int32 Index = Manager->Rigs.Find(Rig);
+		if (Index != INDEX_NONE)
+		{
+			Manager->Rigs[Index] = nullptr;
+		}
+		return;
+	}
+
+	Manager->Rigs.Remove(Rig);
+	if (Manager->Rigs.Num() == 0)
+	{
+		Managers.Remove(Manager->World);
+		delete Manager;
+	}
+}
+
+FSterioRigManager* FSterioRigManager::Find(const UWorld* World)
+{
+	FSterioRigManager** Found = Managers.Find(World);
+	return Found ? *Found : nullptr;
+}
+
+void FSterioRigManager::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	FSterioRigManager* Manager = nullptr;
+	if (Managers.RemoveAndCopyValue(World, Manager))
+	{
+		for (ASterio_4_16Character* Rig : Manager->Rigs)
+		{
+			if (Rig)
+			{
+				Rig->bManagedByRigManager = false;
+			}
+		}
+		delete Manager;
+	}
+}
+
+void FSterioRigManager::Update()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SterioRigBatch);
+	TGuardValue<bool> UpdatingGuard(bUpdating, true);
+
+	// Poses first, so a secondary cluster node has its frame before anything is gathered
+	for (ASterio_4_16Character* Rig : Rigs)
+	{
+		if (Rig)
+		{
+			Rig->LatchPose();
+		}
+	}
+
+	// Gather the stale rigs into contiguous arrays
+	Jobs.Reset();
+	Bases.Reset();
+	Params.Reset();
+	EyeX.Reset();
+	EyeY.Reset();
+	EyeZ.Reset();
+	for (ASterio_4_16Character* Rig : Rigs)
+	{
+		// Rigs projected at tracker rate only need the worker's newest set uploaded
+		if (!Rig || !Rig->CollectStaleSlots() || Rig->ApplyProjectionWorkerSet())
+		{
+			continue;
+		}
+
+		FJob& Job = Jobs[Jobs.AddUninitialized()];
+		Job.Rig = Rig;
+		Job.FirstScreen = Bases.Num();
+		Rig->AppendScreenBases(Bases);
+		Job.NumScreens = Bases.Num() - Job.FirstScreen;
+
+		Params.Add(Rig->MakeFrustumParams());
+		EyeX.Add(Rig->LeftEye.X);
+		EyeX.Add(Rig->RightEye.X);
+		EyeY.Add(Rig->LeftEye.Y);
+		EyeY.Add(Rig->RightEye.Y);
+		EyeZ.Add(Rig->LeftEye.Z);
+		EyeZ.Add(Rig->RightEye.Z);
+	}
+
+	if (Jobs.Num() > 0)
+	{
+		Projections.SetNumUninitialized(Bases.Num() * FSterioProjectionCache::NumEyes);
+		{
+			SCOPE_CYCLE_COUNTER(STAT_SterioProjection);
+			const int32 JobsPerTask = FMath::Max(1, CVarSterioRigManagerJobsPerTask.GetValueOnGameThread());
+			const int32 NumTasks = FMath::DivideAndRoundUp(Jobs.Num(), JobsPerTask);
+			ParallelFor(NumTasks, [this, JobsPerTask](int32 Task)
+			{
+				const int32 Begin = Task * JobsPerTask;
+				ComputeJobs(Begin, FMath::Min(Begin + JobsPerTask, Jobs.Num()));
+			}, NumTasks == 1);
+		}
+
+		for (const FJob& Job : Jobs)
+		{
+			Job.Rig->ApplyProjections(&Bases[Job.FirstScreen], &Projections[Job.FirstScreen * FSterioProjectionCache::NumEyes]);
+		}
+	}
+
+	for (ASterio_4_16Character* Rig : Rigs)
+	{
+		if (Rig)
+		{
+			Rig->FinishFrame();
+		}
+	}
+
+	Rigs.Remove(nullptr);
+	if (Rigs.Num() == 0)
+	{
+		// Every rig left during this tick. The tick function is still executing, so the manager is only
+		// unhooked here and deleted once the world tick is over; a rig registering meanwhile gets a new one.
+		Managers.Remove(World);
+		TickFunction.UnRegisterTickFunction();
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([this](float)
+		{
+			delete this;
+			return false;
+		}));
+	}
+}
+
+void FSterioRigManager::ComputeJobs(int32 Begin, int32 End)
+{
+	for (int32 JobIndex = Begin; JobIndex < End; ++JobIndex)
+	{
+		const FJob& Job = Jobs[JobIndex];
+		const int32 FirstEye = JobIndex * FSterioProjectionCache::NumEyes;
+		const SterioProjection::FEyesSoA Eyes = { &EyeX[FirstEye], &EyeY[FirstEye], &EyeZ[FirstEye], ASterio_4_16Character::EyeFlavors, FSterioProjectionCache::NumEyes };
+		SterioProjection::ComputeProjections(&Bases[Job.FirstScreen], Job.NumScreens, Eyes, Params[JobIndex], &Projections[Job.FirstScreen * FSterioProjectionCache::NumEyes]);
+	}
+}
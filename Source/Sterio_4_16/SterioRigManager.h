@@ -0,0 +1,104 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "SterioProjectionKernel.h"
+#include "SterioRigManager.generated.h"
+
+class ASterio_4_16Character;
+class FSterioRigManager;
+class UWorld;
+
+/** End-of-frame tick of a world's rig manager; takes the place of the late latch tick of every registered rig. */
+USTRUCT()
+struct FSterioRigManagerTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	FSterioRigManagerTickFunction()
+		: Target(nullptr)
+	{
+	}
+
+	FSterioRigManager* Target;
+
+	// FTickFunction interface
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	// End of FTickFunction interface
+};
+
+template<>
+struct TStructOpsTypeTraits<FSterioRigManagerTickFunction> : public TStructOpsTypeTraitsBase2<FSterioRigManagerTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Updates every stereo rig of a world in one pass at the end of the frame.
+ *
+ * Each rig latches its own pose, then the stale screens and eyes of all rigs are gathered into contiguous
+ * arrays, their projections computed in one ParallelFor batch and the results written back rig by rig.
+ * The rigs' own Tick no longer rebuilds anything, so a frame pays for one dispatch and one pass over
+ * packed inputs however many rigs there are, instead of one late tick and one kernel call per rig.
+ *
+ * One manager exists per world while it has registered rigs. Sterio.RigManager 0 leaves new rigs
+ * to update themselves.
+ */
+class FSterioRigManager
+{
+public:
+	/** Hands the rig's end-of-frame update over to the manager of its world. Returns false if Sterio.RigManager is off. */
+	static bool Register(ASterio_4_16Character* Rig);
+
+	static void Unregister(ASterio_4_16Character* Rig);
+
+	/** Manager of the given world, or null if no rig of it is registered. */
+	static FSterioRigManager* Find(const UWorld* World);
+
+	int32 GetNumRigs() const { return Rigs.Num(); }
+
+	/** Latches, rebuilds, issues and records every registered rig. Called by the tick function. */
+	void Update();
+
+private:
+	explicit FSterioRigManager(UWorld* InWorld);
+	~FSterioRigManager();
+
+	/** A rig with stale slots this frame, and where its inputs and outputs sit in the batch */
+	struct FJob
+	{
+		ASterio_4_16Character* Rig;
+		int32 FirstScreen;
+		int32 NumScreens;
+	};
+
+	/** Computes the projections of Jobs [Begin, End). */
+	void ComputeJobs(int32 Begin, int32 End);
+
+	static void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+	UWorld* World;
+
+	/** Registered rigs; entries unregistered during Update are nulled and compacted once it is done */
+	TArray<ASterio_4_16Character*> Rigs;
+	bool bUpdating;
+
+	FSterioRigManagerTickFunction TickFunction;
+
+	/** Batch inputs and outputs, kept to avoid per-frame allocations. Eyes are indexed Job * NumEyes + Eye. */
+	TArray<FJob> Jobs;
+	TArray<SterioProjection::FScreenBasis> Bases;
+	TArray<SterioProjection::FFrustumParams> Params;
+	TArray<float> EyeX;
+	TArray<float> EyeY;
+	TArray<float> EyeZ;
+	TArray<SterioProjection::FMatrix44> Projections;
+
+	static TMap<const UWorld*, FSterioRigManager*> Managers;
+};
@@ -0,0 +1,87 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SterioProjectionKernel.h"
+#include "SterioScreen.generated.h"
+
+class UTextureRenderTarget2D;
+
+/**
+ * One projection surface of the stereo rig and the render targets its eye pair draws into.
+ * Corners are in screen space: x right, y up, z towards the viewer, shared by every screen and eye.
+ */
+USTRUCT(BlueprintType)
+struct FSterioScreen
+{
+	GENERATED_BODY()
+
+	/** Lower-left corner */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCam)
+	FVector Pa;
+
+	/** Lower-right corner */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCam)
+	FVector Pb;
+
+	/** Upper-left corner */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCam)
+	FVector Pc;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCam)
+	UTextureRenderTarget2D* LeftTarget;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioCam)
+	UTextureRenderTarget2D* RightTarget;
+
+	/** Defaults to the rig's original 160 x 100 screen centred on the origin. */
+	FSterioScreen()
+		: Pa(-80.f, -50.f, 0.f)
+		, Pb(80.f, -50.f, 0.f)
+		, Pc(-80.f, 50.f, 0.f)
+		, LeftTarget(nullptr)
+		, RightTarget(nullptr)
+	{
+	}
+
+	SterioProjection::FScreen ToProjectionScreen() const
+	{
+		SterioProjection::FScreen Screen;
+		Screen.Pa = ToProjectionVec(Pa);
+		Screen.Pb = ToProjectionVec(Pb);
+		Screen.Pc = ToProjectionVec(Pc);
+		return Screen;
+	}
+
+	/** Screen space to the rig's component space (x forward, y right, z up). */
+	static FVector ToComponentSpace(const FVector& ScreenPoint)
+	{
+		return FVector(-ScreenPoint.Z, ScreenPoint.X, ScreenPoint.Y);
+	}
+
+	static FVector ToComponentSpace(const SterioProjection::FVec3& ScreenPoint)
+	{
+		return FVector(-ScreenPoint.Z, ScreenPoint.X, ScreenPoint.Y);
+	}
+
+	/** Relative rotation that makes a capture look straight through the screen, as the off-axis projection expects. */
+	static FRotator GetComponentRotation(const SterioProjection::FScreenBasis& Basis)
+	{
+		const FVector Forward = ToComponentSpace(SterioProjection::MakeVec3(-Basis.Vn.X, -Basis.Vn.Y, -Basis.Vn.Z));
+		const FVector Up = ToComponentSpace(Basis.Vu);
+		return FRotationMatrix::MakeFromXZ(Forward, Up).Rotator();
+	}
+
+	static SterioProjection::FVec3 ToProjectionVec(const FVector& V)
+	{
+		return SterioProjection::MakeVec3(V.X, V.Y, V.Z);
+	}
+
+	static FMatrix ToFMatrix(const SterioProjection::FMatrix44& In)
+	{
+		FMatrix Out;
+		FMemory::Memcpy(Out.M, In.M, sizeof(Out.M));
+		return Out;
+	}
+};
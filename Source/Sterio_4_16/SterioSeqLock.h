@@ -0,0 +1,135 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+// Single-writer sequence locks shared by the frame transport and the projection worker.
+//
+// This header has no engine dependency, so SterioFrameTransport.h can hand it to a compositor along with itself.
+// A writer never waits. A reader copies what it wants and then checks that the writer did not start over
+// meanwhile. If it did, the reader discards the copy.
+
+#include <atomic>
+#include <cstdint>
+
+namespace SterioSeqLock
+{
+	/**
+	 * Sequence number of one slot: 0 before its first write, 2N + 1 while write N (counting from 0) fills it and
+	 * 2N + 2 once that write is complete. Nothing but the atomic, so it can live in shared memory.
+	 */
+	struct FSequence
+	{
+		std::atomic<uint64_t> Value;
+
+		void Reset() { Value.store(0, std::memory_order_relaxed); }
+
+		/** Writer: marks write N as in progress. The slot's contents may be changed once this returns. */
+		void BeginWrite(uint64_t N)
+		{
+			Value.store(2 * N + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		/** Writer: completes write N. */
+		void EndWrite(uint64_t N) { Value.store(2 * N + 2, std::memory_order_release); }
+
+		/** Reader: true if the slot holds the complete write N. Read its contents next, then call Validate. */
+		bool BeginRead(uint64_t N) const { return Value.load(std::memory_order_acquire) == 2 * N + 2; }
+
+		/** Reader: true if write N is still in the slot, so whatever was read since BeginRead belongs to it. */
+		bool Validate(uint64_t N) const
+		{
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return Value.load(std::memory_order_relaxed) == 2 * N + 2;
+		}
+	};
+
+	static_assert(sizeof(FSequence) == sizeof(uint64_t), "FSequence is part of the shared memory ring layout");
+
+	/**
+	 * Single writer, any number of readers, nobody waits. The writer fills the oldest of NumSlots copies of T.
+	 * Readers copy the newest complete copy and retry with a newer one if the writer overtook them. With three
+	 * copies the writer has to publish twice more before it reuses the copy a reader just picked, so retries
+	 * are rare.
+	 *
+	 * T must be trivially copyable.
+	 */
+	template<typename T, int NumSlots = 3>
+	class TPublication
+	{
+	public:
+		static_assert(NumSlots >= 2, "The writer needs a copy besides the one being read");
+
+		TPublication()
+			: Published(0)
+			, Retries(0)
+			, NextWrite(0)
+		{
+			for (FSlot& Slot : Slots)
+			{
+				Slot.Sequence.Reset();
+			}
+		}
+
+		/** Writer only: the copy to fill for the next write. */
+		T& BeginWrite()
+		{
+			FSlot& Slot = Slots[NextWrite % NumSlots];
+			Slot.Sequence.BeginWrite(NextWrite);
+			return Slot.Value;
+		}
+
+		/** Writer only: publishes the copy filled since BeginWrite and returns its sequence number, from 1. */
+		uint64_t EndWrite()
+		{
+			Slots[NextWrite % NumSlots].Sequence.EndWrite(NextWrite);
+			Published.store(++NextWrite, std::memory_order_release);
+			return NextWrite;
+		}
+
+		/** Any thread: copies the newest complete value. Returns false if nothing was published yet. */
+		bool Read(T& Out, uint64_t& OutSequence) const
+		{
+			for (;;)
+			{
+				const uint64_t Newest = Published.load(std::memory_order_acquire);
+				if (Newest == 0)
+				{
+					return false;
+				}
+
+				const FSlot& Slot = Slots[(Newest - 1) % NumSlots];
+				if (Slot.Sequence.BeginRead(Newest - 1))
+				{
+					Out = Slot.Value;
+					if (Slot.Sequence.Validate(Newest - 1))
+					{
+						OutSequence = Newest;
+						return true;
+					}
+				}
+				Retries.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		/** Sequence number of the newest publication, 0 before the first. */
+		uint64_t GetPublishedCount() const { return Published.load(std::memory_order_acquire); }
+
+		/** How often a reader was overtaken and had to read again */
+		uint64_t GetRetryCount() const { return Retries.load(std::memory_order_relaxed); }
+
+	private:
+		struct FSlot
+		{
+			FSequence Sequence;
+			T Value;
+		};
+
+		FSlot Slots[NumSlots];
+		std::atomic<uint64_t> Published;
+		mutable std::atomic<uint64_t> Retries;
+
+		/** Writer state */
+		uint64_t NextWrite;
+	};
+}
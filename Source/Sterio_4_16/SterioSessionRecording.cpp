@@ -0,0 +1,228 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioSessionRecording.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if PLATFORM_LINUX || PLATFORM_MAC
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#define STERIO_SESSION_MMAP 1
+#else
+	#define STERIO_SESSION_MMAP 0
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioSession, Log, All);
+
+FSterioSessionWriter::FSterioSessionWriter()
+	: Queue(4096)
+	, Archive(nullptr)
+	, Thread(nullptr)
+	, WorkEvent(nullptr)
+{
+}
+
+FSterioSessionWriter::~FSterioSessionWriter()
+{
+	Close();
+}
+
+bool FSterioSessionWriter::Open(const FString& Path)
+{
+	check(!Thread);
+
+	Archive = IFileManager::Get().CreateFileWriter(*Path);
+	if (!Archive)
+	{
+		UE_LOG(LogSterioSession, Error, TEXT("Could not open session recording %s"), *Path);
+		return false;
+	}
+
+	FSterioSessionRecord Header;
+	FMemory::Memzero(Header);
+	Header.Type = FSterioSessionRecord::Header;
+	Header.Index = FSterioSessionRecord::Version;
+	Archive->Serialize(&Header, sizeof(Header));
+
+	WorkEvent = FPlatformProcess::GetSynchEventFromPool();
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, TEXT("SterioSessionWriter"), 0, TPri_BelowNormal);
+	return Thread != nullptr;
+}
+
+void FSterioSessionWriter::Close()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	if (WorkEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		WorkEvent = nullptr;
+	}
+
+	if (Archive)
+	{
+		// Anything queued after the thread's last pass
+		Drain();
+		Archive->Close();
+		delete Archive;
+		Archive = nullptr;
+	}
+}
+
+void FSterioSessionWriter::Write(const FSterioSessionRecord& Record)
+{
+	if (!Queue.Enqueue(Record))
+	{
+		Dropped.Increment();
+	}
+}
+
+void FSterioSessionWriter::Flush()
+{
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+}
+
+void FSterioSessionWriter::Drain()
+{
+	FSterioSessionRecord Record;
+	while (Queue.Dequeue(Record))
+	{
+		Archive->Serialize(&Record, sizeof(Record));
+		Written.Increment();
+	}
+}
+
+uint32 FSterioSessionWriter::Run()
+{
+	while (!bStopping)
+	{
+		WorkEvent->Wait(100);
+		Drain();
+	}
+	Drain();
+	return 0;
+}
+
+void FSterioSessionWriter::Stop()
+{
+	bStopping = true;
+	if (WorkEvent)
+	{
+		WorkEvent->Trigger();
+	}
+}
+
+FSterioSessionReader::FSterioSessionReader()
+	: Records(nullptr)
+	, NumRecords(0)
+	, Cursor(1)
+	, Mapping(nullptr)
+	, MappingSize(0)
+{
+}
+
+FSterioSessionReader::~FSterioSessionReader()
+{
+	Close();
+}
+
+bool FSterioSessionReader::Open(const FString& Path)
+{
+	Close();
+
+	const void* Data = nullptr;
+	int64 Size = 0;
+
+#if STERIO_SESSION_MMAP
+	const FString FullPath = FPaths::ConvertRelativePathToFull(Path);
+	const int File = open(TCHAR_TO_UTF8(*FullPath), O_RDONLY);
+	if (File >= 0)
+	{
+		struct stat Stat;
+		if (fstat(File, &Stat) == 0 && Stat.st_size > 0)
+		{
+			void* Mapped = mmap(nullptr, (size_t)Stat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+			if (Mapped != MAP_FAILED)
+			{
+				madvise(Mapped, (size_t)Stat.st_size, MADV_SEQUENTIAL);
+				Mapping = Mapped;
+				MappingSize = Stat.st_size;
+				Data = Mapped;
+				Size = Stat.st_size;
+			}
+		}
+		close(File);
+	}
+#endif
+
+	if (!Data)
+	{
+		if (!FFileHelper::LoadFileToArray(Loaded, *Path))
+		{
+			UE_LOG(LogSterioSession, Error, TEXT("Could not read session recording %s"), *Path);
+			return false;
+		}
+		Data = Loaded.GetData();
+		Size = Loaded.Num();
+	}
+
+	Records = (const FSterioSessionRecord*)Data;
+	NumRecords = Size / FSterioSessionRecord::Size;
+	if (NumRecords == 0 || Records[0].Type != FSterioSessionRecord::Header || Records[0].Index != FSterioSessionRecord::Version)
+	{
+		UE_LOG(LogSterioSession, Error, TEXT("%s is not a version %d session recording"), *Path, (int32)FSterioSessionRecord::Version);
+		Close();
+		return false;
+	}
+
+	Cursor = 1;
+	return true;
+}
+
+void FSterioSessionReader::Close()
+{
+#if STERIO_SESSION_MMAP
+	if (Mapping)
+	{
+		munmap(Mapping, (size_t)MappingSize);
+	}
+#endif
+	Mapping = nullptr;
+	MappingSize = 0;
+	Loaded.Empty();
+	Records = nullptr;
+	NumRecords = 0;
+	Cursor = 1;
+}
+
+int32 FSterioSessionReader::NextFrame(const FSterioSessionRecord*& OutGroup)
+{
+	const int64 First = Cursor;
+	while (Cursor < NumRecords)
+	{
+		if (Records[Cursor++].Type == FSterioSessionRecord::Frame)
+		{
+			OutGroup = Records + First;
+			return (int32)(Cursor - First);
+		}
+	}
+
+	// A trailing group without its Frame record is an interrupted recording
+	Cursor = NumRecords;
+	return 0;
+}
@@ -0,0 +1,121 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+class FArchive;
+class FEvent;
+class FRunnableThread;
+
+/**
+ * One fixed-size record of a rig session recording. A file is a Header record followed by groups of
+ * Screen, Tuning and Matrix records, each group closed by the Frame record of the frame it belongs to.
+ * Screens and tuning are only written when they change; matrices only when a slot was rebuilt.
+ */
+struct FSterioSessionRecord
+{
+	enum EType : uint32
+	{
+		Header = 0x52545348,	// 'HSTR'
+		Frame = 1,
+		Screen = 2,
+		Tuning = 3,
+		Matrix = 4,
+	};
+
+	enum { Version = 1, Size = 96 };
+
+	uint32 Type;
+	/** Header: format version. Screen: screen index. Matrix: slot. */
+	int32 Index;
+	uint64 FrameNumber;
+	double Time;
+	/**
+	 * Frame: delta seconds, left eye xyz, right eye xyz, near, far, depth mode.
+	 * Screen: Pa, Pb, Pc. Tuning: M_0_0..M_3_3 row by row. Matrix: the projection row by row.
+	 */
+	float Data[18];
+};
+
+static_assert(sizeof(FSterioSessionRecord) == FSterioSessionRecord::Size, "Session records are a fixed file format");
+
+/**
+ * Appends records to a session file from a dedicated thread. The game thread only copies each record into
+ * a lock-free ring; the thread drains it through a buffered archive. If the writer falls far enough behind
+ * to fill the ring, records are dropped and counted, and the recording is no longer a faithful replay.
+ */
+class FSterioSessionWriter : public FRunnable
+{
+public:
+	FSterioSessionWriter();
+	virtual ~FSterioSessionWriter();
+
+	bool Open(const FString& Path);
+	void Close();
+	bool IsOpen() const { return Thread != nullptr; }
+
+	/** Game thread only. */
+	void Write(const FSterioSessionRecord& Record);
+
+	/** Game thread only: wakes the writer once the frame's records are queued. */
+	void Flush();
+
+	int64 GetWrittenCount() const { return Written.GetValue(); }
+	int64 GetDroppedCount() const { return Dropped.GetValue(); }
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End of FRunnable interface
+
+private:
+	void Drain();
+
+	TCircularQueue<FSterioSessionRecord> Queue;
+	FArchive* Archive;
+	FRunnableThread* Thread;
+	FEvent* WorkEvent;
+	FThreadSafeBool bStopping;
+	FThreadSafeCounter64 Written;
+	FThreadSafeCounter64 Dropped;
+};
+
+/**
+ * Reads a session file frame group by frame group. The file is memory mapped where the platform allows it
+ * (Linux, Mac) and loaded whole otherwise; either way records are handed out in place, without copies.
+ */
+class FSterioSessionReader
+{
+public:
+	FSterioSessionReader();
+	~FSterioSessionReader();
+
+	bool Open(const FString& Path);
+	void Close();
+
+	/**
+	 * Points OutGroup at the records of the next frame, its Frame record last. Returns the number of records
+	 * in the group, or 0 at the end of the file.
+	 */
+	int32 NextFrame(const FSterioSessionRecord*& OutGroup);
+
+	/** Starts over from the first frame. */
+	void Rewind() { Cursor = 1; }
+
+	int64 GetNumRecords() const { return NumRecords; }
+
+private:
+	const FSterioSessionRecord* Records;
+	int64 NumRecords;
+	int64 Cursor;
+
+	/** Backing store when the file could not be mapped */
+	TArray<uint8> Loaded;
+	void* Mapping;
+	int64 MappingSize;
+};
@@ -0,0 +1,120 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioSharedVisibility.h"
+#include "EngineUtils.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/WorldSettings.h"
+#include "Components/PrimitiveComponent.h"
+
+namespace
+{
+	SterioCulling::FAabb ToCullingAabb(const FBox& Box)
+	{
+		SterioCulling::FAabb Result;
+		Result.Min = SterioCulling::MakeVec3(Box.Min.X, Box.Min.Y, Box.Min.Z);
+		Result.Max = SterioCulling::MakeVec3(Box.Max.X, Box.Max.Y, Box.Max.Z);
+		return Result;
+	}
+
+	/** Bounds of everything the actor renders, or an empty box that no frustum contains. */
+	SterioCulling::FAabb GetActorCullingBounds(const AActor* Actor)
+	{
+		if (!Actor || Actor->bHidden)
+		{
+			SterioCulling::FAabb Empty = SterioCulling::MakeEmptyAabb();
+			return Empty;
+		}
+
+		const FBox Bounds = Actor->GetComponentsBoundingBox(true);
+		return Bounds.IsValid ? ToCullingAabb(Bounds) : SterioCulling::MakeEmptyAabb();
+	}
+
+	bool CastsShadow(const AActor* Actor)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+		for (const UPrimitiveComponent* Primitive : Primitives)
+		{
+			if (Primitive->CastShadow && Primitive->IsVisible())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+FSterioSharedVisibility::FSterioSharedVisibility()
+	: FramesSinceRebuild(0)
+	, bKeptShadowCasters(true)
+{
+}
+
+void FSterioSharedVisibility::Rebuild(UWorld* World, const AActor* Ignore, bool bKeepShadowCasters)
+{
+	Actors.Reset();
+	Boxes.clear();
+	FramesSinceRebuild = 0;
+	bKeptShadowCasters = bKeepShadowCasters;
+
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		AActor* Actor = *It;
+		if (Actor == Ignore || Actor->bHidden || Actor->IsA<AWorldSettings>() || (bKeepShadowCasters && CastsShadow(Actor)))
+		{
+			continue;
+		}
+
+		const FBox Bounds = Actor->GetComponentsBoundingBox(true);
+		if (Bounds.IsValid)
+		{
+			Actors.Add(Actor);
+			Boxes.push_back(ToCullingAabb(Bounds));
+		}
+	}
+
+	Bvh.Build(Boxes.data(), (int32_t)Boxes.size());
+}
+
+void FSterioSharedVisibility::Refit()
+{
+	for (int32 Index = 0; Index < Actors.Num(); ++Index)
+	{
+		Boxes[Index] = GetActorCullingBounds(Actors[Index].Get());
+	}
+	Bvh.Refit(Boxes.data());
+}
+
+void FSterioSharedVisibility::Update(UWorld* World, const AActor* Ignore, const FSterioVisibilitySettings& Settings)
+{
+	if (Actors.Num() == 0 || ++FramesSinceRebuild >= Settings.RebuildIntervalFrames || Settings.bKeepShadowCasters != bKeptShadowCasters)
+	{
+		Rebuild(World, Ignore, Settings.bKeepShadowCasters);
+	}
+	else
+	{
+		Refit();
+	}
+}
+
+int32 FSterioSharedVisibility::Cull(const SterioCulling::FFrustum& Frustum, TArray<AActor*>& OutHidden)
+{
+	const int32 NumTests = Bvh.Cull(Frustum, Boxes.data(), Visible);
+
+	VisibleMask.Init(false, Actors.Num());
+	for (int32_t Index : Visible)
+	{
+		VisibleMask[Index] = true;
+	}
+
+	// Walk in tracking order so an unchanged result produces an identical list
+	OutHidden.Reset();
+	for (int32 Index = 0; Index < Actors.Num(); ++Index)
+	{
+		AActor* Actor = Actors[Index].Get();
+		if (Actor && !VisibleMask[Index])
+		{
+			OutHidden.Add(Actor);
+		}
+	}
+	return NumTests;
+}
@@ -0,0 +1,74 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SterioCulling.h"
+#include "SterioSharedVisibility.generated.h"
+
+class AActor;
+class UWorld;
+
+USTRUCT(BlueprintType)
+struct FSterioVisibilitySettings
+{
+	GENERATED_BODY()
+
+	/**
+	 * Cull once per screen against the union of its eyes' frusta and hide what is outside from both captures. The
+	 * engine still culls every capture on its own; this only takes the hidden actors out of its work. The
+	 * capture_pair cases of Sterio.Bench measure what that saves on the running level.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioVisibility)
+	bool bEnabled = false;
+
+	/** Frames between full hierarchy rebuilds, which pick up spawned and destroyed actors; moved actors are refitted every frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioVisibility, meta = (ClampMin = "1"))
+	int32 RebuildIntervalFrames = 120;
+
+	/**
+	 * Never cull actors with a visible shadow-casting primitive. A capture's hidden actors are gone from all of its
+	 * rendering, so culling one outside the frusta would also take its shadow and its reflections off what is in
+	 * view. Turn off only where shadow casters outside the view don't matter, e.g. with baked lighting.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioVisibility)
+	bool bKeepShadowCasters = true;
+};
+
+/**
+ * CPU-side bounding volume hierarchy over the actors of a world, culled once per screen for all of its eyes.
+ *
+ * Culled actors are added to the captures' hidden lists rather than the visible ones given as a
+ * show-only list, so geometry the hierarchy doesn't track (BSP, kept shadow casters, actors spawned
+ * since the last rebuild) keeps rendering.
+ */
+class FSterioSharedVisibility
+{
+public:
+	FSterioSharedVisibility();
+
+	/** Gathers every visible actor with bounds, except Ignore and, if asked, shadow casters, and rebuilds the hierarchy. */
+	void Rebuild(UWorld* World, const AActor* Ignore, bool bKeepShadowCasters);
+
+	/** Re-reads the bounds of the tracked actors. */
+	void Refit();
+
+	/** Rebuilds if the settings' interval has passed or they changed which actors are tracked, refits otherwise. */
+	void Update(UWorld* World, const AActor* Ignore, const FSterioVisibilitySettings& Settings);
+
+	/** Culls the hierarchy once and lists the tracked actors entirely outside the frustum. Returns the number of box tests. */
+	int32 Cull(const SterioCulling::FFrustum& Frustum, TArray<AActor*>& OutHidden);
+
+	int32 GetNumActors() const { return Actors.Num(); }
+
+private:
+	TArray<TWeakObjectPtr<AActor>> Actors;
+	std::vector<SterioCulling::FAabb> Boxes;
+	SterioCulling::FBvh Bvh;
+	int32 FramesSinceRebuild;
+	bool bKeptShadowCasters;
+
+	/** Scratch kept to avoid per-frame allocations */
+	std::vector<int32_t> Visible;
+	TBitArray<> VisibleMask;
+};
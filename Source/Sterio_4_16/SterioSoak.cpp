@@ -0,0 +1,332 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioSoak.h"
+#include "SterioAllocationCounter.h"
+#include "SterioLegacyProjection.h"
+#include "Sterio_4_16Character.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioSoak, Log, All);
+
+const float FSterioSoak::MatrixTolerance = 1.e-4f;
+
+namespace
+{
+	/**
+	 * Scripted head motion: a slow Lissajous sweep in front of the screen that holds still one second in
+	 * four, so the run sees both rebuilding and cached frames.
+	 */
+	void GetSoakEyes(int32 Frame, FVector& OutLeftEye, FVector& OutRightEye)
+	{
+		const int32 HeldFrame = ((Frame / 60) % 4 == 3) ? (Frame / 60) * 60 : Frame;
+		const float Time = HeldFrame / 60.f;
+		const FVector Head(30.f * FMath::Sin(Time * 0.7f), 15.f * FMath::Sin(Time * 1.3f), 160.f + 40.f * FMath::Sin(Time * 0.5f));
+		const FVector HalfIpd(3.2f * FMath::Cos(Time * 0.2f), 0.f, 3.2f * FMath::Sin(Time * 0.2f));
+		OutLeftEye = Head + HalfIpd;
+		OutRightEye = Head - HalfIpd;
+	}
+
+	float GetSoakMaxRelDiff(const FMatrix& Reference, const FMatrix& Actual)
+	{
+		float MaxRelDiff = 0.f;
+		for (int32 Row = 0; Row < 4; ++Row)
+		{
+			for (int32 Col = 0; Col < 4; ++Col)
+			{
+				const float AbsDiff = FMath::Abs(Reference.M[Row][Col] - Actual.M[Row][Col]);
+				MaxRelDiff = FMath::Max(MaxRelDiff, AbsDiff / FMath::Max(1.f, FMath::Abs(Reference.M[Row][Col])));
+			}
+		}
+		return MaxRelDiff;
+	}
+}
+
+FSterioSoak::FSterioSoak(UWorld* InWorld, int32 InFrames)
+	: World(InWorld)
+	, Frames(FMath::Max(1, InFrames))
+{
+	FMemory::Memzero(Result);
+}
+
+bool FSterioSoak::Run()
+{
+	FMemory::Memzero(Result);
+
+	if (!World || !World->HasBegunPlay())
+	{
+		UE_LOG(LogSterioSoak, Error, TEXT("The soak needs a world that has begun play"));
+		return false;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ASterio_4_16Character* Rig = World->SpawnActor<ASterio_4_16Character>(FVector(0.f, 0.f, 100000.f), FRotator::ZeroRotator, SpawnParameters);
+	if (!Rig)
+	{
+		UE_LOG(LogSterioSoak, Error, TEXT("Could not spawn the rig"));
+		return false;
+	}
+
+	// Pin every input the reference depends on, whatever the class defaults are
+	FSterioLegacyProjection Reference;
+	Reference.M_0_0 = 1.05f;
+	Reference.M_1_1 = 0.95f;
+	FMatrix Tuning = FMatrix::Identity;
+	Tuning.M[0][0] = Reference.M_0_0;
+	Tuning.M[1][1] = Reference.M_1_1;
+	Rig->SetScreenSize(Reference.width, Reference.height);
+	Rig->SetClipPlanes(Reference.NearClipPlane, 600000.f);
+	Rig->SetDepthMode(ESterioDepthMode::Infinite);
+	Rig->SetProjectionTuning(Tuning);
+	Rig->ResetProjectionCacheCounters();
+
+	const float DeltaTime = 1.f / 60.f;
+	TArray<double> TickMicroseconds;
+	TickMicroseconds.Reserve(Frames);
+
+	const bool bCountAllocations = FSterioAllocationCounter::IsInstalled();
+	if (!bCountAllocations)
+	{
+		UE_LOG(LogSterioSoak, Warning, TEXT("The allocation counter is not installed, so this run does not count allocations; start with -SterioCountAllocs"));
+	}
+	int64 Allocations = 0;
+
+	for (int32 Frame = 0; Frame < Frames; ++Frame)
+	{
+		FVector LeftEye, RightEye;
+		GetSoakEyes(Frame, LeftEye, RightEye);
+
+		const int64 StartAllocations = FSterioAllocationCounter::GetGameThreadAllocations();
+		const uint32 StartCycles = FPlatformTime::Cycles();
+
+		Rig->SetEyePositions(LeftEye, RightEye);
+		Rig->TickActor(DeltaTime, LEVELTICK_All, Rig->PrimaryActorTick);
+		Rig->LateUpdate();
+
+		const uint32 EndCycles = FPlatformTime::Cycles();
+		Allocations += FSterioAllocationCounter::GetGameThreadAllocations() - StartAllocations;
+		TickMicroseconds.Add(FPlatformTime::ToMilliseconds(EndCycles - StartCycles) * 1000.0);
+
+		const float LeftDiff = GetSoakMaxRelDiff(Reference.GeneralizedPerspectiveProjection(LeftEye), Rig->GetEyeCapture(0, 0)->CustomProjectionMatrix);
+		const float RightDiff = GetSoakMaxRelDiff(Reference.GeneralizedPerspectiveProjection1(RightEye), Rig->GetEyeCapture(0, 1)->CustomProjectionMatrix);
+		Result.MaxRelDiff = FMath::Max(Result.MaxRelDiff, FMath::Max(LeftDiff, RightDiff));
+	}
+
+	const double Hits = Rig->GetProjectionCacheHits();
+	const double Misses = Rig->GetProjectionCacheMisses();
+	Rig->Destroy();
+
+	double TotalMicroseconds = 0.0;
+	for (double Microseconds : TickMicroseconds)
+	{
+		TotalMicroseconds += Microseconds;
+	}
+	TickMicroseconds.Sort();
+
+	Result.Frames = Frames;
+	Result.TickMicrosecondsMean = TotalMicroseconds / Frames;
+	Result.TickMicrosecondsP99 = TickMicroseconds[FMath::Min(Frames - 1, (int32)(Frames * 0.99))];
+	Result.AllocationsPerTick = (double)Allocations / Frames;
+	Result.bCountedAllocations = bCountAllocations;
+	Result.CacheHitRate = (Hits + Misses) > 0.0 ? Hits / (Hits + Misses) : 0.0;
+
+	UE_LOG(LogSterioSoak, Display, TEXT("%d frames: %.2f us/tick mean, %.2f us p99, %.3f allocs/tick%s, %.1f%% cache hits, max rel diff %g"),
+		Result.Frames, Result.TickMicrosecondsMean, Result.TickMicrosecondsP99, Result.AllocationsPerTick, bCountAllocations ? TEXT("") : TEXT(" (not counted)"),
+		Result.CacheHitRate * 100.0, Result.MaxRelDiff);
+	return true;
+}
+
+bool FSterioSoak::CheckBudget(const FSterioSoakResult& Budget, double Tolerance, TArray<FString>& OutOverruns) const
+{
+	const int32 NumBefore = OutOverruns.Num();
+
+	if (Result.TickMicrosecondsMean > Budget.TickMicrosecondsMean * (1.0 + Tolerance))
+	{
+		OutOverruns.Add(FString::Printf(TEXT("tick_us_mean %.2f, budget %.2f"), Result.TickMicrosecondsMean, Budget.TickMicrosecondsMean));
+	}
+	if (Result.TickMicrosecondsP99 > Budget.TickMicrosecondsP99 * (1.0 + Tolerance))
+	{
+		OutOverruns.Add(FString::Printf(TEXT("tick_us_p99 %.2f, budget %.2f"), Result.TickMicrosecondsP99, Budget.TickMicrosecondsP99));
+	}
+
+	// Allocation counts and cache behaviour are deterministic for a given build, so they get no tolerance
+	if (Result.bCountedAllocations && Budget.bCountedAllocations && Result.AllocationsPerTick > Budget.AllocationsPerTick)
+	{
+		OutOverruns.Add(FString::Printf(TEXT("allocs_per_tick %.3f, budget %.3f"), Result.AllocationsPerTick, Budget.AllocationsPerTick));
+	}
+	if (Result.CacheHitRate < Budget.CacheHitRate)
+	{
+		OutOverruns.Add(FString::Printf(TEXT("cache_hit_rate %.4f, budget at least %.4f"), Result.CacheHitRate, Budget.CacheHitRate));
+	}
+
+	return OutOverruns.Num() == NumBefore;
+}
+
+FString FSterioSoak::ToJson(const FString& Label) const
+{
+	FString Json;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Json);
+
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("label"), Label);
+	Writer->WriteValue(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+	Writer->WriteValue(TEXT("frames"), Result.Frames);
+	Writer->WriteValue(TEXT("tick_us_mean"), Result.TickMicrosecondsMean);
+	Writer->WriteValue(TEXT("tick_us_p99"), Result.TickMicrosecondsP99);
+	if (Result.bCountedAllocations)
+	{
+		Writer->WriteValue(TEXT("allocs_per_tick"), Result.AllocationsPerTick);
+	}
+	Writer->WriteValue(TEXT("cache_hit_rate"), Result.CacheHitRate);
+	Writer->WriteValue(TEXT("max_rel_diff"), Result.MaxRelDiff);
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	return Json;
+}
+
+bool FSterioSoak::FromJson(const FString& Json, FSterioSoakResult& OutResult)
+{
+	TSharedPtr<FJsonObject> Object;
+	if (!FJsonSerializer::Deserialize(TJsonReaderFactory<TCHAR>::Create(Json), Object) || !Object.IsValid())
+	{
+		return false;
+	}
+
+	FMemory::Memzero(OutResult);
+	OutResult.Frames = (int32)Object->GetNumberField(TEXT("frames"));
+	OutResult.TickMicrosecondsMean = Object->GetNumberField(TEXT("tick_us_mean"));
+	OutResult.TickMicrosecondsP99 = Object->GetNumberField(TEXT("tick_us_p99"));
+	OutResult.bCountedAllocations = Object->TryGetNumberField(TEXT("allocs_per_tick"), OutResult.AllocationsPerTick);
+	OutResult.CacheHitRate = Object->GetNumberField(TEXT("cache_hit_rate"));
+	OutResult.MaxRelDiff = (float)Object->GetNumberField(TEXT("max_rel_diff"));
+	return true;
+}
+
+FString FSterioSoak::GetBudgetPath()
+{
+	return FPaths::GameDir() / TEXT("Build") / TEXT("Sterio") / TEXT("SoakBudget.json");
+}
+
+namespace
+{
+	/** The world a test runs in: the game's, or the play-in-editor session's. */
+	UWorld* FindSoakWorld()
+	{
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			if ((Context.WorldType == EWorldType::Game || Context.WorldType == EWorldType::PIE) && Context.World())
+			{
+				return Context.World();
+			}
+		}
+		return nullptr;
+	}
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSterioSoakRigTest, "Sterio.Soak.Rig", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSterioSoakRigTest::RunTest(const FString& Parameters)
+{
+	FSterioSoak Soak(FindSoakWorld(), FSterioSoak::DefaultFrames);
+	if (!Soak.Run())
+	{
+		AddError(TEXT("Could not run the rig; see the log"));
+		return false;
+	}
+
+	const FSterioSoakResult& Result = Soak.GetResult();
+	if (Result.MaxRelDiff > FSterioSoak::MatrixTolerance)
+	{
+		AddError(FString::Printf(TEXT("Eye matrices deviate from the reference by %g (tolerance %g)"), Result.MaxRelDiff, FSterioSoak::MatrixTolerance));
+	}
+
+	const FString BudgetPath = FSterioSoak::GetBudgetPath();
+	FString BudgetJson;
+	FSterioSoakResult Budget;
+	if (!FFileHelper::LoadFileToString(BudgetJson, *BudgetPath) || !FSterioSoak::FromJson(BudgetJson, Budget))
+	{
+		AddError(FString::Printf(TEXT("No soak budget at %s"), *BudgetPath));
+		return false;
+	}
+
+	// An uncounted run would pass the allocation budget whatever it allocates
+	if (!Result.bCountedAllocations)
+	{
+		const TCHAR* Message = TEXT("Allocations were not counted, so the allocs_per_tick budget was not checked; run with -SterioCountAllocs");
+		if (FParse::Param(FCommandLine::Get(), TEXT("SterioSoakUncountedAllocs")))
+		{
+			AddWarning(Message);
+		}
+		else
+		{
+			AddError(Message);
+		}
+	}
+
+	double Tolerance = 0.0;
+	FParse::Value(FCommandLine::Get(), TEXT("SterioSoakTolerance="), Tolerance);
+
+	TArray<FString> Overruns;
+	Soak.CheckBudget(Budget, Tolerance, Overruns);
+	for (const FString& Overrun : Overruns)
+	{
+		AddError(FString::Printf(TEXT("Over budget: %s"), *Overrun));
+	}
+
+	FFileHelper::SaveStringToFile(Soak.ToJson(TEXT("automation")), *(FPaths::GameSavedDir() / TEXT("Sterio") / TEXT("Benchmarks") / TEXT("automation_soak.json")));
+	return !HasAnyErrors();
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
+
+static void RunMeasureSoakCommand(const TArray<FString>& Args, UWorld* World)
+{
+	const int32 Frames = (Args.Num() > 0) ? FCString::Atoi(*Args[0]) : FSterioSoak::DefaultFrames;
+
+	FSterioSoak Soak(World, Frames);
+	if (!Soak.Run())
+	{
+		return;
+	}
+
+	FString BudgetJson;
+	FSterioSoakResult Budget;
+	TArray<FString> Overruns;
+	if (FFileHelper::LoadFileToString(BudgetJson, *FSterioSoak::GetBudgetPath()) && FSterioSoak::FromJson(BudgetJson, Budget) && !Soak.CheckBudget(Budget, 0.0, Overruns))
+	{
+		for (const FString& Overrun : Overruns)
+		{
+			UE_LOG(LogSterioSoak, Warning, TEXT("Over budget: %s"), *Overrun);
+		}
+	}
+
+	const FString Path = FPaths::GameSavedDir() / TEXT("Sterio") / TEXT("Benchmarks") / TEXT("soak.json");
+	if (FFileHelper::SaveStringToFile(Soak.ToJson(FString::Printf(TEXT("measured on %s"), FPlatformProcess::ComputerName())), *Path))
+	{
+		UE_LOG(LogSterioSoak, Display, TEXT("Soak measurements written to %s"), *Path);
+	}
+	else
+	{
+		UE_LOG(LogSterioSoak, Error, TEXT("Could not write the soak measurements to %s"), *Path);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SterioMeasureSoakCommand(
+	TEXT("Sterio.Soak.Measure"),
+	TEXT("Runs the rig soak on this machine, reports what is over the budget the Sterio.Soak.Rig test checks and writes the measurements to Saved/Sterio/Benchmarks/soak.json. Usage: Sterio.Soak.Measure [Frames]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunMeasureSoakCommand));
@@ -0,0 +1,71 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+/** What one soak run measured on the rig. */
+struct FSterioSoakResult
+{
+	int32 Frames;
+	double TickMicrosecondsMean;
+	double TickMicrosecondsP99;
+	/** Game thread allocations made while ticking the rig, per frame; only counted with -SterioCountAllocs */
+	double AllocationsPerTick;
+	bool bCountedAllocations;
+	double CacheHitRate;
+	/** Worst deviation of any eye matrix from the legacy reference over the whole run */
+	float MaxRelDiff;
+};
+
+/**
+ * Soak check of the whole rig: spawns an ASterio_4_16Character in the current world and ticks it (Tick,
+ * then the end-of-frame update) for thousands of frames under scripted eye motion, checking every eye
+ * matrix against FSterioLegacyProjection and checking time, allocations and cache behaviour per tick
+ * against a budget.
+ *
+ * Build/Sterio/SoakBudget.json is that budget: hand-set limits a tick has to stay within (time and allocations at
+ * most, cache hit rate at least), not numbers measured on any machine. Sterio.Soak.Measure [Frames] runs the soak
+ * on the current machine and writes what it measured to Saved/Sterio/Benchmarks/soak.json, from which the budget
+ * can be tightened.
+ *
+ * Runs as the Sterio.Soak.Rig automation test, headless on a build agent with
+ * -nullrhi -SterioCountAllocs -ExecCmds="Automation RunTests Sterio; Quit". The test fails on a wrong matrix, on
+ * every metric over budget (-SterioSoakTolerance=Fraction allows slower ticks, default 0), when there is no
+ * budget and when allocations were not counted (-SterioSoakUncountedAllocs turns that into a warning).
+ */
+class FSterioSoak
+{
+public:
+	FSterioSoak(UWorld* InWorld, int32 InFrames);
+
+	/** Ticks the rig and fills in the result. Returns false if the rig could not be spawned. */
+	bool Run();
+
+	/**
+	 * Checks the last run against Budget, appending a line per metric over it. Tick times may exceed it by the
+	 * Tolerance fraction. Returns false if any metric is over budget.
+	 */
+	bool CheckBudget(const FSterioSoakResult& Budget, double Tolerance, TArray<FString>& OutOverruns) const;
+
+	FString ToJson(const FString& Label) const;
+	static bool FromJson(const FString& Json, FSterioSoakResult& OutResult);
+
+	/** Where the budget is kept under source control. */
+	static FString GetBudgetPath();
+
+	/** Frames a run ticks by default */
+	static const int32 DefaultFrames = 5000;
+
+	const FSterioSoakResult& GetResult() const { return Result; }
+
+	/** Matrices may differ from the reference by this much before the run fails, see the kernel equivalence checks */
+	static const float MatrixTolerance;
+
+private:
+	UWorld* World;
+	int32 Frames;
+	FSterioSoakResult Result;
+};
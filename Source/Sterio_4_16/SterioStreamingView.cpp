@@ -0,0 +1,36 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioStreamingView.h"
+
+SterioProjection::FVec3 FSterioStreamingView::GetViewpoint(const SterioProjection::FVec3& LeftEye, const SterioProjection::FVec3& RightEye)
+{
+	return SterioProjection::MakeVec3((LeftEye.X + RightEye.X) * 0.5f, (LeftEye.Y + RightEye.Y) * 0.5f, (LeftEye.Z + RightEye.Z) * 0.5f);
+}
+
+float FSterioStreamingView::GetFOVScreenSize(const SterioProjection::FScreenBasis& Basis, const SterioProjection::FVec3& Viewpoint, float ScreenSizePixels)
+{
+	// Distance to the screen plane, and how wide the screen is there; the offset of the frustum doesn't change either
+	const float Distance = SterioProjection::Dot(Basis.Vn, Viewpoint) - Basis.NormalA;
+	const float Width = Basis.RightB - Basis.RightA;
+	if (Distance <= KINDA_SMALL_NUMBER || Width <= KINDA_SMALL_NUMBER)
+	{
+		return 0.f;
+	}
+	return ScreenSizePixels * Distance / Width * 2.f;
+}
+
+float FSterioStreamingView::GetScreenMultiple(const FMatrix& Projection)
+{
+	return FMath::Max(0.5f * FMath::Abs(Projection.M[0][0]), 0.5f * FMath::Abs(Projection.M[1][1]));
+}
+
+float FSterioStreamingView::GetLODScale(const FMatrix& EyeProjection, float SharedMultiple)
+{
+	// Screen sizes go with the multiple over the distance times the factor
+	const float EyeMultiple = GetScreenMultiple(EyeProjection);
+	if (SharedMultiple <= KINDA_SMALL_NUMBER || EyeMultiple <= KINDA_SMALL_NUMBER)
+	{
+		return 1.f;
+	}
+	return EyeMultiple / SharedMultiple;
+}
@@ -0,0 +1,61 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SterioProjectionKernel.h"
+#include "SterioStreamingView.generated.h"
+
+USTRUCT(BlueprintType)
+struct FSterioStreamingViewSettings
+{
+	GENERATED_BODY()
+
+	/** Stream textures for one view per screen, at the midpoint of the eyes, instead of one per capture */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioStreaming)
+	bool bEnabled = true;
+
+	/**
+	 * Make the screens' views the only ones texture streaming considers. The captures still register their own views,
+	 * with a field of view that means nothing for a custom projection; this keeps them, and the main viewport behind
+	 * the widget, from pulling in mips no screen shows. Turn off if the main viewport shows the world.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioStreaming, meta = (EditCondition = "bEnabled"))
+	bool bExclusive = true;
+
+	/** Scales the resolution textures are streamed at for the screens; below 1 trades sharpness for texture pool */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioStreaming, meta = (EditCondition = "bEnabled", ClampMin = "0.1", ClampMax = "4.0"))
+	float BoostFactor = 1.f;
+
+	/** Scale each eye's LOD distances so both eyes of a screen pick the LODs the shared view would */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SterioStreaming)
+	bool bAlignLODs = true;
+};
+
+/**
+ * Describes a screen's eye pair as a single view for texture streaming and mesh LOD selection.
+ *
+ * The eyes of a screen are a few centimetres apart and look through the same rectangle, so one view at their
+ * midpoint stands for both. Streaming registers that view once; LOD selection can't be handed a view, so each
+ * eye's LOD distance factor is scaled until its projection yields the screen sizes of the shared one.
+ * Both work in screen space, in cm.
+ */
+class FSterioStreamingView
+{
+public:
+	/** Midpoint of the eyes, where the shared view sits. */
+	static SterioProjection::FVec3 GetViewpoint(const SterioProjection::FVec3& LeftEye, const SterioProjection::FVec3& RightEye);
+
+	/**
+	 * Pixels per cm at 1 cm in front of Viewpoint when the screen is rendered ScreenSizePixels wide: the FOVScreenSize
+	 * of IStreamingManager::AddViewInformation, which expects ScreenSize / tan(FOV / 2) for a symmetric view and is
+	 * the same for an off-axis one. Returns 0 if Viewpoint is not in front of the screen.
+	 */
+	static float GetFOVScreenSize(const SterioProjection::FScreenBasis& Basis, const SterioProjection::FVec3& Viewpoint, float ScreenSizePixels);
+
+	/** Projected radius per unit of radius over distance, the way the engine's LOD selection reads a projection. */
+	static float GetScreenMultiple(const FMatrix& Projection);
+
+	/** LOD distance factor that makes an eye with EyeProjection see the screen sizes of SharedMultiple, relative to the eye's own factor. */
+	static float GetLODScale(const FMatrix& EyeProjection, float SharedMultiple);
+};
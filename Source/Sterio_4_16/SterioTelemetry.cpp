@@ -0,0 +1,219 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioTelemetry.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Paths.h"
+
+DEFINE_STAT(STAT_SterioTracker);
+DEFINE_STAT(STAT_SterioProjection);
+DEFINE_STAT(STAT_SterioUpload);
+DEFINE_STAT(STAT_SterioCapture);
+DEFINE_STAT(STAT_SterioRigBatch);
+DEFINE_STAT(STAT_SterioProjectionsRebuilt);
+DEFINE_STAT(STAT_SterioCapturesIssued);
+DEFINE_STAT(STAT_SterioCapturesSkipped);
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioTelemetry, Log, All);
+
+static TAutoConsoleVariable<int32> CVarSterioTelemetry(
+	TEXT("Sterio.Telemetry"),
+	0,
+	TEXT("0: off\n")
+	TEXT("1: keep the most recent eye projections and tracker poses for Sterio.Telemetry.Dump"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarSterioTelemetryTrace(
+	TEXT("Sterio.Telemetry.Trace"),
+	0,
+	TEXT("With Sterio.Telemetry 1, also stream every record to Saved/Sterio/Telemetry:\n")
+	TEXT("0: no trace file\n")
+	TEXT("1: binary, FSterioProjectionRecord/FSterioPoseRecord each preceded by a one-byte tag (P or T)\n")
+	TEXT("2: CSV"),
+	ECVF_Default);
+
+enum
+{
+	TraceNone = 0,
+	TraceBinary = 1,
+	TraceCsv = 2,
+};
+
+FSterioTelemetry& FSterioTelemetry::Get()
+{
+	static FSterioTelemetry Telemetry;
+	return Telemetry;
+}
+
+bool FSterioTelemetry::IsEnabled()
+{
+	return CVarSterioTelemetry.GetValueOnGameThread() != 0;
+}
+
+FSterioTelemetry::FSterioTelemetry()
+	: NumProjections(0)
+	, NumPoses(0)
+	, TraceFile(nullptr)
+	, TraceFormat(TraceNone)
+{
+}
+
+FSterioTelemetry::~FSterioTelemetry()
+{
+	CloseTrace();
+}
+
+void FSterioTelemetry::Prepare()
+{
+	if (Projections.Num() == 0)
+	{
+		Projections.SetNumZeroed(RingCapacity);
+		Poses.SetNumZeroed(RingCapacity);
+	}
+
+	const int32 WantedFormat = FMath::Clamp(CVarSterioTelemetryTrace.GetValueOnGameThread(), (int32)TraceNone, (int32)TraceCsv);
+	if (WantedFormat == TraceFormat)
+	{
+		return;
+	}
+
+	CloseTrace();
+	if (WantedFormat == TraceNone)
+	{
+		return;
+	}
+
+	const FString Path = FPaths::GameSavedDir() / TEXT("Sterio") / TEXT("Telemetry") / (FDateTime::Now().ToString() + (WantedFormat == TraceCsv ? TEXT(".csv") : TEXT(".bin")));
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+	TraceFile = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Path);
+	if (!TraceFile)
+	{
+		UE_LOG(LogSterioTelemetry, Warning, TEXT("Could not open telemetry trace %s"), *Path);
+		return;
+	}
+
+	TraceFormat = WantedFormat;
+	UE_LOG(LogSterioTelemetry, Log, TEXT("Writing telemetry trace to %s"), *Path);
+	if (TraceFormat == TraceCsv)
+	{
+		const ANSICHAR Header[] = "kind,frame,time,slot_or_sample_time,x0,y0,z0,x1,y1,z1,m00,m01,m02,m03,m10,m11,m12,m13,m20,m21,m22,m23,m30,m31,m32,m33\n";
+		TraceFile->Write((const uint8*)Header, sizeof(Header) - 1);
+	}
+}
+
+void FSterioTelemetry::CloseTrace()
+{
+	delete TraceFile;
+	TraceFile = nullptr;
+	TraceFormat = TraceNone;
+}
+
+void FSterioTelemetry::RecordProjection(uint64 Frame, int32 Slot, const FVector& Eye, const FMatrix& Projection)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+	Prepare();
+
+	FSterioProjectionRecord& Record = Projections[NumProjections++ % RingCapacity];
+	Record.Frame = Frame;
+	Record.Time = FPlatformTime::Seconds();
+	Record.Slot = Slot;
+	Record.Eye[0] = Eye.X;
+	Record.Eye[1] = Eye.Y;
+	Record.Eye[2] = Eye.Z;
+	FMemory::Memcpy(Record.Projection, Projection.M, sizeof(Record.Projection));
+
+	if (TraceFormat == TraceBinary)
+	{
+		const uint8 Tag = 'P';
+		TraceFile->Write(&Tag, 1);
+		TraceFile->Write((const uint8*)&Record, sizeof(Record));
+	}
+	else if (TraceFormat == TraceCsv)
+	{
+		const float (&M)[4][4] = Record.Projection;
+		ANSICHAR Line[512];
+		const int32 Length = FCStringAnsi::Snprintf(Line, sizeof(Line),
+			"P,%llu,%.6f,%d,%g,%g,%g,,,,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g\n",
+			(unsigned long long)Record.Frame, Record.Time, Record.Slot, Record.Eye[0], Record.Eye[1], Record.Eye[2],
+			M[0][0], M[0][1], M[0][2], M[0][3], M[1][0], M[1][1], M[1][2], M[1][3],
+			M[2][0], M[2][1], M[2][2], M[2][3], M[3][0], M[3][1], M[3][2], M[3][3]);
+		TraceFile->Write((const uint8*)Line, FMath::Clamp(Length, 0, (int32)sizeof(Line) - 1));
+	}
+}
+
+void FSterioTelemetry::RecordPose(uint64 Frame, double SampleTime, const FVector& LeftEye, const FVector& RightEye)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+	Prepare();
+
+	FSterioPoseRecord& Record = Poses[NumPoses++ % RingCapacity];
+	Record.Frame = Frame;
+	Record.Time = FPlatformTime::Seconds();
+	Record.SampleTime = SampleTime;
+	Record.LeftEye[0] = LeftEye.X;
+	Record.LeftEye[1] = LeftEye.Y;
+	Record.LeftEye[2] = LeftEye.Z;
+	Record.RightEye[0] = RightEye.X;
+	Record.RightEye[1] = RightEye.Y;
+	Record.RightEye[2] = RightEye.Z;
+
+	if (TraceFormat == TraceBinary)
+	{
+		const uint8 Tag = 'T';
+		TraceFile->Write(&Tag, 1);
+		TraceFile->Write((const uint8*)&Record, sizeof(Record));
+	}
+	else if (TraceFormat == TraceCsv)
+	{
+		ANSICHAR Line[256];
+		const int32 Length = FCStringAnsi::Snprintf(Line, sizeof(Line), "T,%llu,%.6f,%.6f,%g,%g,%g,%g,%g,%g\n",
+			(unsigned long long)Record.Frame, Record.Time, Record.SampleTime,
+			Record.LeftEye[0], Record.LeftEye[1], Record.LeftEye[2], Record.RightEye[0], Record.RightEye[1], Record.RightEye[2]);
+		TraceFile->Write((const uint8*)Line, FMath::Clamp(Length, 0, (int32)sizeof(Line) - 1));
+	}
+}
+
+void FSterioTelemetry::Dump(int32 Count) const
+{
+	if (Projections.Num() == 0)
+	{
+		UE_LOG(LogSterioTelemetry, Display, TEXT("Nothing recorded; enable with Sterio.Telemetry 1"));
+		return;
+	}
+
+	const uint64 NumShownPoses = FMath::Min<uint64>(FMath::Min<uint64>(NumPoses, RingCapacity), (uint64)Count);
+	for (uint64 Index = NumPoses - NumShownPoses; Index < NumPoses; ++Index)
+	{
+		const FSterioPoseRecord& Record = Poses[Index % RingCapacity];
+		UE_LOG(LogSterioTelemetry, Display, TEXT("Frame %llu pose sampled %.4f: left (%g %g %g) right (%g %g %g)"),
+			Record.Frame, Record.SampleTime, Record.LeftEye[0], Record.LeftEye[1], Record.LeftEye[2], Record.RightEye[0], Record.RightEye[1], Record.RightEye[2]);
+	}
+
+	const uint64 NumShownProjections = FMath::Min<uint64>(FMath::Min<uint64>(NumProjections, RingCapacity), (uint64)Count);
+	for (uint64 Index = NumProjections - NumShownProjections; Index < NumProjections; ++Index)
+	{
+		const FSterioProjectionRecord& Record = Projections[Index % RingCapacity];
+		FMatrix Projection;
+		FMemory::Memcpy(Projection.M, Record.Projection, sizeof(Record.Projection));
+		UE_LOG(LogSterioTelemetry, Display, TEXT("Frame %llu slot %d eye (%g %g %g): %s"),
+			Record.Frame, Record.Slot, Record.Eye[0], Record.Eye[1], Record.Eye[2], *Projection.ToString());
+	}
+}
+
+static void DumpTelemetryCommand(const TArray<FString>& Args)
+{
+	const int32 Count = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 16;
+	FSterioTelemetry::Get().Dump(Count);
+}
+
+static FAutoConsoleCommand SterioTelemetryDumpCommand(
+	TEXT("Sterio.Telemetry.Dump"),
+	TEXT("Logs the most recent eye projections and tracker poses. Usage: Sterio.Telemetry.Dump [Count]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&DumpTelemetryCommand));
@@ -0,0 +1,80 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+class IFileHandle;
+
+DECLARE_STATS_GROUP(TEXT("Sterio"), STATGROUP_Sterio, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tracker"), STAT_SterioTracker, STATGROUP_Sterio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projection"), STAT_SterioProjection, STATGROUP_Sterio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Upload"), STAT_SterioUpload, STATGROUP_Sterio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Capture"), STAT_SterioCapture, STATGROUP_Sterio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rig batch"), STAT_SterioRigBatch, STATGROUP_Sterio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Projections rebuilt"), STAT_SterioProjectionsRebuilt, STATGROUP_Sterio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Captures issued"), STAT_SterioCapturesIssued, STATGROUP_Sterio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Captures skipped"), STAT_SterioCapturesSkipped, STATGROUP_Sterio, );
+
+/** One rebuilt eye projection, as kept in the ring and written to binary traces. */
+struct FSterioProjectionRecord
+{
+	uint64 Frame;
+	double Time;
+	int32 Slot;
+	float Eye[3];
+	float Projection[4][4];
+};
+
+/** One tracker pose as applied to the rig (after prediction), as kept in the ring and written to binary traces. */
+struct FSterioPoseRecord
+{
+	uint64 Frame;
+	double Time;
+	double SampleTime;
+	float LeftEye[3];
+	float RightEye[3];
+};
+
+/**
+ * Recent rig state for diagnostics, replacing per-frame log dumps.
+ *
+ * Sterio.Telemetry 1 keeps the last projections and poses in fixed rings, printed by Sterio.Telemetry.Dump.
+ * Sterio.Telemetry.Trace 1 or 2 additionally streams every record to a binary or CSV file under
+ * Saved/Sterio/Telemetry. The rings are allocated once when first enabled; with telemetry off, recording
+ * is a console variable read and nothing else.
+ */
+class FSterioTelemetry
+{
+public:
+	enum { RingCapacity = 256 };
+
+	static FSterioTelemetry& Get();
+
+	static bool IsEnabled();
+
+	void RecordProjection(uint64 Frame, int32 Slot, const FVector& Eye, const FMatrix& Projection);
+	void RecordPose(uint64 Frame, double SampleTime, const FVector& LeftEye, const FVector& RightEye);
+
+	/** Logs the newest Count records of each ring, oldest first. */
+	void Dump(int32 Count) const;
+
+	~FSterioTelemetry();
+
+private:
+	FSterioTelemetry();
+
+	/** Allocates the rings and opens, switches or closes the trace file to match the console variables. */
+	void Prepare();
+	void CloseTrace();
+
+	TArray<FSterioProjectionRecord> Projections;
+	TArray<FSterioPoseRecord> Poses;
+	uint64 NumProjections;
+	uint64 NumPoses;
+
+	IFileHandle* TraceFile;
+	int32 TraceFormat;
+};
@@ -0,0 +1,261 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "SterioTrackerInput.h"
+#include "Common/UdpSocketBuilder.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/RunnableThread.h"
+#include "Interfaces/IPv4/IPv4Address.h"
+#include "Misc/FileHelper.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSterioTracker, Log, All);
+
+FSterioTrackerPacket FSterioTrackerPacket::FromPose(const FSterioTrackedPose& Pose)
+{
+	FSterioTrackerPacket Packet;
+	Packet.SampleTime = Pose.SampleTime;
+	Packet.LeftEye[0] = Pose.LeftEye.X;
+	Packet.LeftEye[1] = Pose.LeftEye.Y;
+	Packet.LeftEye[2] = Pose.LeftEye.Z;
+	Packet.RightEye[0] = Pose.RightEye.X;
+	Packet.RightEye[1] = Pose.RightEye.Y;
+	Packet.RightEye[2] = Pose.RightEye.Z;
+	return Packet;
+}
+
+FSterioTrackedPose FSterioTrackerPacket::ToPose(double ReceiveTime) const
+{
+	FSterioTrackedPose Pose;
+	Pose.SampleTime = SampleTime;
+	Pose.ReceiveTime = ReceiveTime;
+	Pose.LeftEye = FVector(LeftEye[0], LeftEye[1], LeftEye[2]);
+	Pose.RightEye = FVector(RightEye[0], RightEye[1], RightEye[2]);
+	return Pose;
+}
+
+bool FSterioTrackerPacket::LoadRecording(const FString& Path, TArray<FSterioTrackerPacket>& OutPackets)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path))
+	{
+		return false;
+	}
+
+	OutPackets.SetNumUninitialized(Bytes.Num() / Size);
+	FMemory::Memcpy(OutPackets.GetData(), Bytes.GetData(), OutPackets.Num() * Size);
+	return true;
+}
+
+FSterioTrackerInput::FSterioTrackerInput()
+	: Source(ESterioTrackerSource::None)
+	, Queue(256)
+	, Thread(nullptr)
+	, Socket(nullptr)
+	, RecordFile(nullptr)
+	, bLoopReplay(false)
+{
+}
+
+FSterioTrackerInput::~FSterioTrackerInput()
+{
+	Shutdown();
+}
+
+bool FSterioTrackerInput::StartUdp(int32 Port, const FString& RecordPath)
+{
+	check(!Thread);
+
+	Socket = FUdpSocketBuilder(TEXT("SterioTracker"))
+		.AsNonBlocking()
+		.BoundToAddress(FIPv4Address(127, 0, 0, 1))
+		.BoundToPort(Port)
+		.WithReceiveBufferSize(64 * 1024)
+		.Build();
+
+	if (!Socket)
+	{
+		UE_LOG(LogSterioTracker, Error, TEXT("Could not bind tracker socket to port %d"), Port);
+		return false;
+	}
+
+	if (!RecordPath.IsEmpty())
+	{
+		RecordFile = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*RecordPath);
+		if (!RecordFile)
+		{
+			UE_LOG(LogSterioTracker, Warning, TEXT("Could not open %s, tracker samples will not be recorded"), *RecordPath);
+		}
+	}
+
+	Source = ESterioTrackerSource::Udp;
+	return StartThread(TEXT("SterioTrackerUdp"));
+}
+
+bool FSterioTrackerInput::StartReplay(const FString& Path, bool bLoop)
+{
+	check(!Thread);
+
+	if (!FSterioTrackerPacket::LoadRecording(Path, ReplayPackets) || ReplayPackets.Num() == 0)
+	{
+		UE_LOG(LogSterioTracker, Error, TEXT("Could not load tracker recording %s"), *Path);
+		return false;
+	}
+
+	bLoopReplay = bLoop;
+	Source = ESterioTrackerSource::Replay;
+	return StartThread(TEXT("SterioTrackerReplay"));
+}
+
+bool FSterioTrackerInput::StartThread(const TCHAR* ThreadName)
+{
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, ThreadName, 0, TPri_AboveNormal);
+	return Thread != nullptr;
+}
+
+void FSterioTrackerInput::Shutdown()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	if (Socket)
+	{
+		Socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+
+	delete RecordFile;
+	RecordFile = nullptr;
+
+	ReplayPackets.Empty();
+	Source = ESterioTrackerSource::None;
+}
+
+void FSterioTrackerInput::SetPoseListener(TFunction<void(const FSterioTrackedPose&)> Listener)
+{
+	check(!Thread);
+	PoseListener = MoveTemp(Listener);
+}
+
+bool FSterioTrackerInput::ConsumeLatest(FSterioTrackedPose& OutPose)
+{
+	bool bConsumed = false;
+	FSterioTrackedPose Pose;
+	while (Queue.Dequeue(Pose))
+	{
+		OutPose = Pose;
+		bConsumed = true;
+	}
+	return bConsumed;
+}
+
+int32 FSterioTrackerInput::ConsumeAll(TArray<FSterioTrackedPose>& OutPoses)
+{
+	const int32 NumBefore = OutPoses.Num();
+	FSterioTrackedPose Pose;
+	while (Queue.Dequeue(Pose))
+	{
+		OutPoses.Add(Pose);
+	}
+	return OutPoses.Num() - NumBefore;
+}
+
+void FSterioTrackerInput::Publish(const FSterioTrackedPose& Pose)
+{
+	Received.Increment();
+	if (PoseListener)
+	{
+		PoseListener(Pose);
+	}
+	else if (!Queue.Enqueue(Pose))
+	{
+		Dropped.Increment();
+	}
+}
+
+uint32 FSterioTrackerInput::Run()
+{
+	if (Source == ESterioTrackerSource::Udp)
+	{
+		RunUdp();
+	}
+	else if (Source == ESterioTrackerSource::Replay)
+	{
+		RunReplay();
+	}
+	return 0;
+}
+
+void FSterioTrackerInput::Stop()
+{
+	bStopping = true;
+}
+
+void FSterioTrackerInput::RunUdp()
+{
+	uint8 Buffer[FSterioTrackerPacket::Size * 32];
+
+	while (!bStopping)
+	{
+		// Wake up regularly so Stop() is noticed even when the tracker is silent
+		if (!Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(50)))
+		{
+			continue;
+		}
+
+		int32 BytesRead = 0;
+		while (Socket->Recv(Buffer, sizeof(Buffer), BytesRead) && BytesRead > 0)
+		{
+			const double ReceiveTime = FPlatformTime::Seconds();
+			for (int32 Offset = 0; Offset + FSterioTrackerPacket::Size <= BytesRead; Offset += FSterioTrackerPacket::Size)
+			{
+				FSterioTrackerPacket Packet;
+				FMemory::Memcpy(&Packet, Buffer + Offset, FSterioTrackerPacket::Size);
+				Publish(Packet.ToPose(ReceiveTime));
+			}
+
+			if (RecordFile)
+			{
+				RecordFile->Write(Buffer, BytesRead - BytesRead % FSterioTrackerPacket::Size);
+			}
+		}
+	}
+}
+
+void FSterioTrackerInput::RunReplay()
+{
+	do
+	{
+		// Replay at the recorded pace, anchored to when this pass started
+		const double StartTime = FPlatformTime::Seconds();
+		const double FirstSampleTime = ReplayPackets[0].SampleTime;
+
+		for (const FSterioTrackerPacket& Packet : ReplayPackets)
+		{
+			const double DueTime = StartTime + (Packet.SampleTime - FirstSampleTime);
+			double Now = FPlatformTime::Seconds();
+			while (Now < DueTime && !bStopping)
+			{
+				FPlatformProcess::Sleep((float)FMath::Min(DueTime - Now, 0.001));
+				Now = FPlatformTime::Seconds();
+			}
+
+			if (bStopping)
+			{
+				return;
+			}
+
+			// Rebase onto the local clock so looping never makes sample time run backwards
+			FSterioTrackedPose Pose = Packet.ToPose(Now);
+			Pose.SampleTime = DueTime;
+			Publish(Pose);
+		}
+	}
+	while (bLoopReplay && !bStopping);
+}
@@ -0,0 +1,123 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "SterioTrackerInput.generated.h"
+
+class FRunnableThread;
+class FSocket;
+class IFileHandle;
+
+UENUM(BlueprintType)
+enum class ESterioTrackerSource : uint8
+{
+	/** Eyes are only moved by hand or through the setter API */
+	None,
+	/** Poses arrive as datagrams on a local UDP port */
+	Udp,
+	/** Poses are replayed from a file recorded earlier */
+	Replay,
+};
+
+/** One head tracker sample: both eye positions in screen space. */
+struct FSterioTrackedPose
+{
+	/** Time stamped by the tracker, in seconds on its own clock; replayed samples are rebased onto FPlatformTime::Seconds() */
+	double SampleTime;
+	/** FPlatformTime::Seconds() when the sample reached this process */
+	double ReceiveTime;
+	FVector LeftEye;
+	FVector RightEye;
+};
+
+/**
+ * Tracker sample as sent over UDP and stored in recordings: little-endian, 32 bytes, no padding.
+ * A datagram may carry several packets back to back.
+ */
+struct FSterioTrackerPacket
+{
+	double SampleTime;
+	float LeftEye[3];
+	float RightEye[3];
+
+	enum { Size = 32 };
+
+	static FSterioTrackerPacket FromPose(const FSterioTrackedPose& Pose);
+	FSterioTrackedPose ToPose(double ReceiveTime) const;
+
+	/** Reads every packet of a recording. Returns false if the file could not be read. */
+	static bool LoadRecording(const FString& Path, TArray<FSterioTrackerPacket>& OutPackets);
+};
+
+static_assert(sizeof(FSterioTrackerPacket) == FSterioTrackerPacket::Size, "Tracker packets are a fixed wire format");
+
+/**
+ * Receives head tracker poses on a dedicated thread and hands them to the game thread through a
+ * single-producer/single-consumer lock-free ring, so tracker bursts never stall the game thread.
+ * If the game thread falls behind far enough to fill the ring, new samples are dropped and counted.
+ */
+class FSterioTrackerInput : public FRunnable
+{
+public:
+	FSterioTrackerInput();
+	virtual ~FSterioTrackerInput();
+
+	/** Starts receiving on a loopback UDP port. Live samples are appended to RecordPath if it isn't empty. */
+	bool StartUdp(int32 Port, const FString& RecordPath = FString());
+
+	/** Starts replaying a recording at its original pace. */
+	bool StartReplay(const FString& Path, bool bLoop);
+
+	/** Stops the receive thread and closes the socket or file. */
+	void Shutdown();
+
+	/**
+	 * Hands every pose to Listener on the receive thread as it arrives, instead of queueing it for the game thread.
+	 * Set before starting; the listener must not block and must outlive the receive thread.
+	 */
+	void SetPoseListener(TFunction<void(const FSterioTrackedPose&)> Listener);
+
+	/** Game thread only: drains the ring and returns the newest pose, or false if nothing arrived since the last call. */
+	bool ConsumeLatest(FSterioTrackedPose& OutPose);
+
+	/** Game thread only: drains the ring, appending every pose in arrival order. Returns how many were appended. */
+	int32 ConsumeAll(TArray<FSterioTrackedPose>& OutPoses);
+
+	int64 GetReceivedCount() const { return Received.GetValue(); }
+	int64 GetDroppedCount() const { return Dropped.GetValue(); }
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End of FRunnable interface
+
+private:
+	bool StartThread(const TCHAR* ThreadName);
+	void RunUdp();
+	void RunReplay();
+	void Publish(const FSterioTrackedPose& Pose);
+
+	ESterioTrackerSource Source;
+
+	TFunction<void(const FSterioTrackedPose&)> PoseListener;
+
+	/** Capacity must be a power of two; one slot stays empty */
+	TCircularQueue<FSterioTrackedPose> Queue;
+
+	FRunnableThread* Thread;
+	FThreadSafeBool bStopping;
+
+	FSocket* Socket;
+	IFileHandle* RecordFile;
+
+	TArray<FSterioTrackerPacket> ReplayPackets;
+	bool bLoopReplay;
+
+	FThreadSafeCounter64 Received;
+	FThreadSafeCounter64 Dropped;
+};
@@ -9,5 +9,7 @@ public class Sterio_4_16 : ModuleRules
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "HeadMountedDisplay" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "Json", "Networking", "RenderCore", "RHI", "Slate", "SlateCore", "Sockets", "UMG" });
 	}
 }
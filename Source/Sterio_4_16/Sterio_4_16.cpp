@@ -1,7 +1,16 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
 #include "Sterio_4_16.h"
+#include "SterioAllocationCounter.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Sterio_4_16, "Sterio_4_16" );
- 
\ No newline at end of file
+class FSterio_4_16GameModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		FSterioAllocationCounter::InstallFromCommandLine();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FSterio_4_16GameModule, Sterio_4_16, "Sterio_4_16" );
@@ -5,9 +5,22 @@
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
+#include "ContentStreaming.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Components/Image.h"
+#include "UObject/UObjectIterator.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Paths.h"
+#include "SterioFramePacking.h"
+#include "SterioLatencyTrace.h"
+#include "SterioRigManager.h"
+#include "SterioTelemetry.h"
+#include "Sterio_4_16GameMode.h"
 
 //////////////////////////////////////////////////////////////////////////
 // ASterio_4_16Character
@@ -49,6 +62,11 @@ ASterio_4_16Character::ASterio_4_16Character()
 	RightCam = CreateDefaultSubobject<USceneCaptureComponent2D>(TEXT("RightCam"));
 	RightCam->SetupAttachment(FollowCamera);
 
+	// Re-samples the tracker once everything else in the frame has moved, right before the captures are rendered
+	LateLatchTick.bCanEverTick = true;
+	LateLatchTick.bStartWithTickEnabled = true;
+	LateLatchTick.TickGroup = TG_PostUpdateWork;
+
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named MyCharacter (to avoid direct content references in C++)
 }
@@ -142,198 +160,1425 @@ void ASterio_4_16Character::MoveRight(float Value)
 void ASterio_4_16Character::BeginPlay()
 {
 	Super::BeginPlay();
-	LeftCam->bUseCustomProjectionMatrix = true;
-	RightCam->bUseCustomProjectionMatrix = true;
-}
-
-FMatrix ASterio_4_16Character::GeneralizedPerspectiveProjection(FVector pe)
-{
-	float zoff = 0.0f;
-	FVector pa = FVector(-width / 2.0f, -height / 2.0f, -zoff);
-	FVector pb = FVector(width / 2.0f, -height / 2.0f, -zoff);
-	FVector pc = FVector(-width / 2.0f, height / 2.0f, -zoff);
-
-	FVector va, vb, vc;
-	FVector vr, vu, vn;
-
-	float left, right, bottom, top, eyedistance;
-
-	FMatrix transformMatrix;
-	FMatrix projectionM;
-	FMatrix eyeTranslateM;
-	FMatrix finalProjection;
-
-	///Calculate the orthonormal for the screen (the screen coordinate system
-	vr = pb - pa;
-	vr.Normalize();
-	vu = pc - pa;
-	vu.Normalize();
-	vn = FVector::CrossProduct(vr, vu);
-	vn.Normalize();
-
-	//Calculate the vector from eye (pe) to screen corners (pa, pb, pc)
-	va = pa - pe;
-	vb = pb - pe;
-	vc = pc - pe;
-
-	//Get the distance;; from the eye to the screen plane
-	eyedistance = -(FVector::DotProduct(va, vn));
-
-	//Get the varaibles for the off center projection
-	left = (FVector::DotProduct(vr, va) * NearClipPlane) / eyedistance;
-	right = (FVector::DotProduct(vr, vb) * NearClipPlane) / eyedistance;
-	bottom = (FVector::DotProduct(vu, va) * NearClipPlane) / eyedistance;
-	top = (FVector::DotProduct(vu, vc) * NearClipPlane) / eyedistance;
-
-	float SumRL = (right + left);
-	float SumTB = (top + bottom);
-	float InvRL = (1.0f / (right - left));
-	float InvTB = (1.0f / (top - bottom));
-
-	projectionM.M[0][0] = 2.f * NearClipPlane * InvRL * M_0_0; // Connect to Z
-	projectionM.M[0][1] = 0.f;
-	projectionM.M[0][2] = 0.f;
-	projectionM.M[0][3] = 0.f + M_0_3;
-
-	projectionM.M[1][0] = 0.f;
-	projectionM.M[1][1] = 2.f * NearClipPlane * InvTB * M_1_1; // Connect to Z
-	projectionM.M[1][2] = 0.f;
-	projectionM.M[1][3] = 0.f + M_1_3;
-
-	projectionM.M[2][0] = SumRL * InvRL;
-	projectionM.M[2][1] = SumTB * InvTB;
-	projectionM.M[2][2] = 0.0f;
-	// I guess no.
-	//projectionM.M[2][2] = -(SumFN * InvFN); // OpenGL
-	//projectionM.M[2][2] = (NearClipPlane == FarClipPlane) ? 1.0f : FarClipPlane / (FarClipPlane - NearClipPlane); // FPerspectiveMatrix
-	//projectionM.M[2][2] = ((NearClipPlane == FarClipPlane) ? 0.0f : NearClipPlane / (NearClipPlane - FarClipPlane)); // FReversedZPerspectiveMatrix
-	//projectionM.M[2][3] = 1.f * pe.Z / 100.f;//-1.0f; My example connect to Z
-	projectionM.M[2][3] = 1.0f;
-
-	projectionM.M[3][0] = 0.f;
-	projectionM.M[3][1] = 0.f;
-	// I guess no.
-	//projectionM.M[3][2] = -(2.f * MulFN * InvFN); // OpenGL
-	//projectionM.M[3][2] = -NearClipPlane * ((NearClipPlane == FarClipPlane) ? 1.0f : FarClipPlane / (FarClipPlane - NearClipPlane)); // FPerspectiveMatrix
-	//projectionM.M[3][2] = ((NearClipPlane == FarClipPlane) ? NearClipPlane : -FarClipPlane * NearClipPlane / (NearClipPlane - FarClipPlane));//FReversedZPerspectiveMatrix
-	projectionM.M[3][2] = NearClipPlane;
-	projectionM.M[3][3] = 0.f;
-
-	return projectionM;
-}
-
-FMatrix ASterio_4_16Character::GeneralizedPerspectiveProjection1(FVector pe)
-{
-	float zoff = 0.0f;
-	FVector pa = FVector(-width / 2.0f, -height / 2.0f, -zoff);
-	FVector pb = FVector(width / 2.0f, -height / 2.0f, -zoff);
-	FVector pc = FVector(-width / 2.0f, height / 2.0f, -zoff);
-
-	FVector va, vb, vc;
-	FVector vr, vu, vn;
-
-	float left, right, bottom, top, eyedistance;
-
-	FMatrix transformMatrix;
-	FMatrix projectionM;
-	FMatrix eyeTranslateM;
-	FMatrix finalProjection;
-
-	///Calculate the orthonormal for the screen (the screen coordinate system
-	vr = pb - pa;
-	vr.Normalize();
-	vu = pc - pa;
-	vu.Normalize();
-	vn = FVector::CrossProduct(vr, vu);
-	vn.Normalize();
-
-	//Calculate the vector from eye (pe) to screen corners (pa, pb, pc)
-	va = pa - pe;
-	vb = pb - pe;
-	vc = pc - pe;
-
-	//Get the distance;; from the eye to the screen plane
-	eyedistance = -(FVector::DotProduct(va, vn));
-
-	//Get the varaibles for the off center projection
-	left = (FVector::DotProduct(vr, va) * NearClipPlane) / eyedistance;
-	right = (FVector::DotProduct(vr, vb) * NearClipPlane) / eyedistance;
-	bottom = (FVector::DotProduct(vu, va) * NearClipPlane) / eyedistance;
-	top = (FVector::DotProduct(vu, vc) * NearClipPlane) / eyedistance;
-
-	//UE_LOG(LogTemp, Warning, TEXT("left %f"), left);
-	//UE_LOG(LogTemp, Warning, TEXT("right %f"), right);
-	//UE_LOG(LogTemp, Warning, TEXT("bottom %f"), bottom);
-	//UE_LOG(LogTemp, Warning, TEXT("top %f"), top);
-
-	// Have to flip left/right and top/bottom to match UE4 expectations
-	float Right = -FPlatformMath::Tan(left);
-	float Left = -FPlatformMath::Tan(right);
-	float Bottom = -FPlatformMath::Tan(top);
-	float Top = -FPlatformMath::Tan(bottom);
-
-	//UE_LOG(LogTemp, Warning, TEXT("Left %f"), Left);
-	//UE_LOG(LogTemp, Warning, TEXT("Right %f"), Right);
-	//UE_LOG(LogTemp, Warning, TEXT("Bottom %f"), Bottom);
-	//UE_LOG(LogTemp, Warning, TEXT("Top %f"), Top);
-
-	float SumRL = (Right + Left);
-	float SumTB = (Top + Bottom);
-	float InvRL = (1.0f / (Right - Left));
-	float InvTB = (1.0f / (Top - Bottom));
-
-	projectionM.M[0][0] = 2.f * NearClipPlane * InvRL * M_0_0; // Connect to Z
-	projectionM.M[0][1] = 0.f;
-	projectionM.M[0][2] = 0.f;
-	projectionM.M[0][3] = 0.f + M_0_3;
-
-	projectionM.M[1][0] = 0.f;
-	projectionM.M[1][1] = 2.f * NearClipPlane * InvTB * M_1_1; // Connect to Z
-	projectionM.M[1][2] = 0.f;
-	projectionM.M[1][3] = 0.f + M_1_3;
-
-	projectionM.M[2][0] = SumRL * InvRL;
-	projectionM.M[2][1] = SumTB * InvTB;
-	projectionM.M[2][2] = 0.0f;
-	// I guess no.
-	//projectionM.M[2][2] = -(SumFN * InvFN); // OpenGL
-	//projectionM.M[2][2] = (NearClipPlane == FarClipPlane) ? 1.0f : FarClipPlane / (FarClipPlane - NearClipPlane); // FPerspectiveMatrix
-	//projectionM.M[2][2] = ((NearClipPlane == FarClipPlane) ? 0.0f : NearClipPlane / (NearClipPlane - FarClipPlane)); // FReversedZPerspectiveMatrix
-	//projectionM.M[2][3] = 1.f * pe.Z / 100.f;//-1.0f; My example connect to Z
-	projectionM.M[2][3] = 1.0f;
-
-	projectionM.M[3][0] = 0.f;
-	projectionM.M[3][1] = 0.f;
-	// I guess no.
-	//projectionM.M[3][2] = -(2.f * MulFN * InvFN); // OpenGL
-	//projectionM.M[3][2] = -NearClipPlane * ((NearClipPlane == FarClipPlane) ? 1.0f : FarClipPlane / (FarClipPlane - NearClipPlane)); // FPerspectiveMatrix
-	//projectionM.M[3][2] = ((NearClipPlane == FarClipPlane) ? NearClipPlane : -FarClipPlane * NearClipPlane / (NearClipPlane - FarClipPlane));//FReversedZPerspectiveMatrix
-	projectionM.M[3][2] = NearClipPlane;
-	projectionM.M[3][3] = 0.f;
-
-	return projectionM;
+
+	RebuildScreens();
+	ApplyDepthMode();
+
+	FSterioCalibrationProfile Profile;
+	if (!CalibrationProfile.IsEmpty() && Profile.Load(CalibrationProfile))
+	{
+		ApplyCalibration(Profile);
+		UE_LOG(LogTemp, Log, TEXT("Applied calibration profile %s from %s (%d samples, %.3f cm rms)"),
+			*CalibrationProfile, *Profile.Created.ToString(), Profile.NumSamples, Profile.RmsAfter);
+	}
+
+	if (!SessionRecordFile.IsEmpty())
+	{
+		SessionWriter.Reset(new FSterioSessionWriter());
+		if (!SessionWriter->Open(SessionRecordFile))
+		{
+			SessionWriter.Reset();
+		}
+		RecordedScreens.Reset();
+		bRecordedTuning = false;
+	}
+
+	const int32 TransportLeftSlot = FSterioProjectionCache::GetSlot(FrameTransportScreen, 0);
+	const int32 TransportRightSlot = FSterioProjectionCache::GetSlot(FrameTransportScreen, 1);
+	if (!FrameTransportName.IsEmpty() && AuthoredTargets.IsValidIndex(TransportLeftSlot) && AuthoredTargets.IsValidIndex(TransportRightSlot) && AuthoredTargets[TransportLeftSlot])
+	{
+		// Dynamic resolution only ever renders at the authored size or below
+		FramePublisher.Reset(new FSterioFramePublisher());
+		if (!FramePublisher->Start(FrameTransportName, FrameTransportSlots, AuthoredTargets[TransportLeftSlot]->SizeX, AuthoredTargets[TransportLeftSlot]->SizeY,
+			(SterioPacking::EFormat)FrameTransportPacking))
+		{
+			FramePublisher.Reset();
+		}
+	}
+
+	const FSterioClusterSettings ClusterSettings = FSterioClusterSettings::FromCommandLine(FCommandLine::Get());
+	if (ClusterSettings.Role != ESterioClusterRole::None)
+	{
+		Cluster.Reset(new FSterioClusterNode());
+		if (!Cluster->Start(ClusterSettings))
+		{
+			UE_LOG(LogTemp, Error, TEXT("%s could not join the render cluster and renders every screen on its own"), *GetName());
+			Cluster.Reset();
+		}
+	}
+
+	// Secondaries render the primary's pose; only the primary replays sessions or listens to the tracker
+	const bool bDrivenByCluster = Cluster.IsValid() && Cluster->IsSecondary();
+	if (!bDrivenByCluster && !SessionReplayFile.IsEmpty() && SessionReader.Open(SessionReplayFile))
+	{
+		// Step the world by the recorded frame times so every replay of a session sees the same frames
+		bReplayingSession = true;
+		NextReplayGroupSize = SessionReader.NextFrame(NextReplayGroup);
+		FApp::SetUseFixedTimeStep(true);
+		if (NextReplayGroupSize > 0)
+		{
+			FApp::SetFixedDeltaTime(NextReplayGroup[NextReplayGroupSize - 1].Data[0]);
+		}
+	}
+	else if (!bDrivenByCluster && TrackerSource != ESterioTrackerSource::None)
+	{
+		Tracker.Reset(new FSterioTrackerInput());
+
+		// The predictor needs every sample on the game thread, so only raw poses can be projected as they arrive
+		if (bTrackerRateProjection && Prediction.Mode == ESterioPredictionMode::None)
+		{
+			if (GetNumScreens() > FSterioProjectionSet::MaxScreens)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("%s has more than %d screens; its projections are computed on the game thread"), *GetName(), (int32)FSterioProjectionSet::MaxScreens);
+			}
+			else
+			{
+				ProjectionWorker.Reset(new FSterioProjectionWorker(EyeFlavors));
+				if (ProjectionWorker->Start())
+				{
+					FSterioProjectionWorker* Worker = ProjectionWorker.Get();
+					Tracker->SetPoseListener([Worker](const FSterioTrackedPose& Pose) { Worker->AddPose(Pose); });
+				}
+				else
+				{
+					ProjectionWorker.Reset();
+				}
+			}
+		}
+
+		const bool bStarted = (TrackerSource == ESterioTrackerSource::Udp)
+			? Tracker->StartUdp(TrackerPort, TrackerRecordFile)
+			: Tracker->StartReplay(TrackerReplayFile, bLoopTrackerReplay);
+		if (!bStarted)
+		{
+			Tracker.Reset();
+			ProjectionWorker.Reset();
+		}
+	}
+
+	FSterioRigManager::Register(this);
+}
+
+void ASterio_4_16Character::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FSterioRigManager::Unregister(this);
+
+	if (Tracker.IsValid())
+	{
+		UE_LOG(LogTemp, Log, TEXT("Tracker stopped after %lld samples, %lld dropped"), Tracker->GetReceivedCount(), Tracker->GetDroppedCount());
+
+		int32 LatchedFrames;
+		float AverageGainMs;
+		GetLateLatchStats(LatchedFrames, AverageGainMs);
+		UE_LOG(LogTemp, Log, TEXT("Late latch moved the eyes on %d frames, %.2f ms newer on average"), LatchedFrames, AverageGainMs);
+		Tracker.Reset();
+	}
+
+	if (ProjectionWorker.IsValid())
+	{
+		UE_LOG(LogTemp, Log, TEXT("Projection worker published %llu sets, %lld poses dropped, readers retried %lld times"),
+			ProjectionWorker->GetPublishedCount(), ProjectionWorker->GetDroppedCount(), ProjectionWorker->GetRetryCount());
+		ProjectionWorker.Reset();
+	}
+
+	if (bReplayingSession)
+	{
+		FApp::SetUseFixedTimeStep(false);
+		bReplayingSession = false;
+	}
+	if (ReplayedFrames > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Replayed %d session frames, %d did not match the recording"), ReplayedFrames, MismatchedReplayFrames);
+	}
+	SessionReader.Close();
+	Cluster.Reset();
+
+	if (FramePublisher.IsValid())
+	{
+		UE_LOG(LogTemp, Log, TEXT("Published %llu frames to %s, %d too large for the ring, %d in an unsupported format"), FramePublisher->GetPublishedCount(), *FrameTransportName, FramePublisher->GetOversizedCount(), FramePublisher->GetUnsupportedCount());
+		FramePublisher.Reset();
+	}
+	ReplayGroup = NextReplayGroup = nullptr;
+	ReplayGroupSize = NextReplayGroupSize = 0;
+
+	if (SessionWriter.IsValid())
+	{
+		SessionWriter->Close();
+		UE_LOG(LogTemp, Log, TEXT("Recorded %lld session records to %s, %lld dropped"), SessionWriter->GetWrittenCount(), *SessionRecordFile, SessionWriter->GetDroppedCount());
+		SessionWriter.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ASterio_4_16Character::RegisterActorTickFunctions(bool bRegister)
+{
+	Super::RegisterActorTickFunctions(bRegister);
+
+	if (bRegister)
+	{
+		if (LateLatchTick.bCanEverTick)
+		{
+			LateLatchTick.Target = this;
+			LateLatchTick.SetTickFunctionEnable(LateLatchTick.bStartWithTickEnabled);
+			LateLatchTick.RegisterTickFunction(GetLevel());
+			LateLatchTick.AddPrerequisite(this, PrimaryActorTick);
+		}
+	}
+	else if (LateLatchTick.IsTickFunctionRegistered())
+	{
+		LateLatchTick.UnRegisterTickFunction();
+	}
+}
+
+bool ASterio_4_16Character::ConsumeTrackerPose()
+{
+	if (!Tracker.IsValid())
+	{
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_SterioTracker);
+
+	if (ProjectionWorker.IsValid())
+	{
+		return ConsumeProjectionWorkerPose();
+	}
+
+	if (Prediction.Mode == ESterioPredictionMode::None)
+	{
+		FSterioTrackedPose Pose;
+		if (!Tracker->ConsumeLatest(Pose))
+		{
+			return false;
+		}
+		NewestPoseReceiveTime = Pose.ReceiveTime;
+		SetEyePositions(Pose.LeftEye, Pose.RightEye);
+		FSterioTelemetry::Get().RecordPose(GFrameCounter, Pose.SampleTime, LeftEye, RightEye);
+		FSterioLatencyTrace::Mark(ESterioLatencyStage::PoseReceived, GFrameNumber, -1, -1, NewestPoseReceiveTime);
+		FSterioLatencyTrace::Mark(ESterioLatencyStage::PoseApplied, GFrameNumber);
+		return true;
+	}
+
+	// The filters need every sample, not just the newest one
+	Predictor.Configure(Prediction);
+	PendingPoses.Reset();
+	const bool bNewSamples = Tracker->ConsumeAll(PendingPoses) > 0;
+	for (const FSterioTrackedPose& Pose : PendingPoses)
+	{
+		Predictor.AddSample(Pose.SampleTime, Pose.ReceiveTime, Pose.LeftEye, Pose.RightEye);
+	}
+	if (!Predictor.HasSamples())
+	{
+		return false;
+	}
+
+	// Predicted for this frame's display time even when no sample arrived, so the eyes keep moving between
+	// tracker updates instead of holding the last frame's prediction
+	FVector PredictedLeft, PredictedRight;
+	Predictor.PredictAtLocalTime(FrameDisplayTime, PredictedLeft, PredictedRight);
+	SetEyePositions(PredictedLeft, PredictedRight);
+	FSterioTelemetry::Get().RecordPose(GFrameCounter, Predictor.GetNewestSampleTime(), LeftEye, RightEye);
+	if (!bNewSamples)
+	{
+		return false;
+	}
+
+	NewestPoseReceiveTime = PendingPoses.Last().ReceiveTime;
+	FSterioLatencyTrace::Mark(ESterioLatencyStage::PoseReceived, GFrameNumber, -1, -1, NewestPoseReceiveTime);
+	FSterioLatencyTrace::Mark(ESterioLatencyStage::PoseApplied, GFrameNumber);
+	return true;
+}
+
+bool ASterio_4_16Character::ConsumeProjectionWorkerPose()
+{
+	const uint64 PreviousSequence = ProjectionWorkerSet.Sequence;
+	if (!ProjectionWorker->ReadLatest(ProjectionWorkerSet) || ProjectionWorkerSet.Sequence == PreviousSequence)
+	{
+		return false;
+	}
+
+	NewestPoseReceiveTime = ProjectionWorkerSet.ReceiveTime;
+	SetEyePositions(ProjectionWorkerSet.LeftEye, ProjectionWorkerSet.RightEye);
+	FSterioTelemetry::Get().RecordPose(GFrameCounter, ProjectionWorkerSet.SampleTime, LeftEye, RightEye);
+	FSterioLatencyTrace::Mark(ESterioLatencyStage::PoseReceived, GFrameNumber, -1, -1, NewestPoseReceiveTime);
+	FSterioLatencyTrace::Mark(ESterioLatencyStage::PoseApplied, GFrameNumber);
+	return true;
+}
+
+void ASterio_4_16Character::LateUpdate()
+{
+	// A managed rig skipped the rebuild at Tick, so it always has to look for stale slots here
+	if (LatchPose() || bManagedByRigManager)
+	{
+		UpdateEyeCaptures();
+	}
+	FinishFrame();
+}
+
+bool ASterio_4_16Character::LatchPose()
+{
+	bool bMoved = false;
+	if (FSterioLateLatchTickFunction::IsEnabled())
+	{
+		const double TickPoseReceiveTime = NewestPoseReceiveTime;
+		if (ConsumeTrackerPose())
+		{
+			bMoved = true;
+			++LateLatchedFrames;
+			if (TickPoseReceiveTime > 0.0)
+			{
+				LateLatchGainSeconds += NewestPoseReceiveTime - TickPoseReceiveTime;
+			}
+		}
+	}
+
+	if (Cluster.IsValid())
+	{
+		// The primary shares the pose it ends the frame with; secondaries block here until it arrives, which keeps them frame-locked
+		FVector ClusterLeftEye, ClusterRightEye;
+		if (Cluster->IsPrimary())
+		{
+			Cluster->BroadcastFrame(LeftEye, RightEye);
+		}
+		else if (Cluster->ReceiveFrame(ClusterLeftEye, ClusterRightEye))
+		{
+			SetEyePositions(ClusterLeftEye, ClusterRightEye);
+			bMoved = true;
+		}
+	}
+	return bMoved;
+}
+
+void ASterio_4_16Character::FinishFrame()
+{
+	if (ReplayGroupSize > 0)
+	{
+		VerifySessionFrame();
+	}
+
+	UpdateSharedVisibility();
+	UpdateStreamingViews();
+
+	// Deferred captures are rendered at the end of the frame from the state they have by then, so issuing them last costs nothing
+	IssueCaptures();
+
+	if (SessionWriter.IsValid())
+	{
+		RecordSessionFrame();
+	}
+}
+
+void ASterio_4_16Character::RecordSessionFrame()
+{
+	FSterioSessionRecord Record;
+	FMemory::Memzero(Record);
+	Record.FrameNumber = GFrameCounter;
+	Record.Time = FPlatformTime::Seconds();
+
+	// The projection treats the width x height fallback like any other screen, and so does the recording
+	const int32 NumScreens = ProjectionCache.GetNumScreens();
+	const int32 NumRecordedScreens = RecordedScreens.Num();
+	RecordedScreens.SetNumZeroed(NumScreens);
+	for (int32 ScreenIndex = 0; ScreenIndex < NumScreens; ++ScreenIndex)
+	{
+		const SterioProjection::FScreen Screen = GetProjectionScreen(ScreenIndex);
+		if (ScreenIndex >= NumRecordedScreens || FMemory::Memcmp(&Screen, &RecordedScreens[ScreenIndex], sizeof(Screen)) != 0)
+		{
+			RecordedScreens[ScreenIndex] = Screen;
+			Record.Type = FSterioSessionRecord::Screen;
+			Record.Index = ScreenIndex;
+			FMemory::Memcpy(Record.Data, &Screen, sizeof(Screen));
+			SessionWriter->Write(Record);
+		}
+	}
+
+	const float Tuning[16] =
+	{
+		M_0_0, M_0_1, M_0_2, M_0_3,
+		M_1_0, M_1_1, M_1_2, M_1_3,
+		M_2_0, M_2_1, M_2_2, M_2_3,
+		M_3_0, M_3_1, M_3_2, M_3_3,
+	};
+	if (!bRecordedTuning || FMemory::Memcmp(Tuning, RecordedTuning, sizeof(Tuning)) != 0)
+	{
+		FMemory::Memcpy(RecordedTuning, Tuning, sizeof(Tuning));
+		bRecordedTuning = true;
+		Record.Type = FSterioSessionRecord::Tuning;
+		Record.Index = 0;
+		FMemory::Memcpy(Record.Data, Tuning, sizeof(Tuning));
+		SessionWriter->Write(Record);
+	}
+
+	FMemory::Memzero(Record.Data);
+	Record.Type = FSterioSessionRecord::Frame;
+	Record.Index = 0;
+	Record.Data[0] = GetWorld()->GetDeltaSeconds();
+	Record.Data[1] = LeftEye.X;
+	Record.Data[2] = LeftEye.Y;
+	Record.Data[3] = LeftEye.Z;
+	Record.Data[4] = RightEye.X;
+	Record.Data[5] = RightEye.Y;
+	Record.Data[6] = RightEye.Z;
+	Record.Data[7] = NearClipPlane;
+	Record.Data[8] = FarClipPlane;
+	Record.Data[9] = (float)DepthMode;
+	SessionWriter->Write(Record);
+	SessionWriter->Flush();
+}
+
+bool ASterio_4_16Character::ApplySessionFrame()
+{
+	if (NextReplayGroupSize == 0 && bLoopSessionReplay)
+	{
+		SessionReader.Rewind();
+		NextReplayGroupSize = SessionReader.NextFrame(NextReplayGroup);
+	}
+
+	ReplayGroup = NextReplayGroup;
+	ReplayGroupSize = NextReplayGroupSize;
+	if (ReplayGroupSize == 0)
+	{
+		// The eyes stay where the recording left them; only the world goes back to real time
+		UE_LOG(LogTemp, Log, TEXT("Session replay of %s finished after %d frames"), *SessionReplayFile, ReplayedFrames);
+		FApp::SetUseFixedTimeStep(false);
+		bReplayingSession = false;
+		return false;
+	}
+
+	for (int32 Index = 0; Index < ReplayGroupSize; ++Index)
+	{
+		const FSterioSessionRecord& Record = ReplayGroup[Index];
+		const float* Data = Record.Data;
+		if (Record.Type == FSterioSessionRecord::Screen)
+		{
+			if (Screens.Num() == 0)
+			{
+				SetScreenSize(Data[3] - Data[0], Data[7] - Data[1]);
+			}
+			else
+			{
+				SetScreenCorners(Record.Index, FVector(Data[0], Data[1], Data[2]), FVector(Data[3], Data[4], Data[5]), FVector(Data[6], Data[7], Data[8]));
+			}
+		}
+		else if (Record.Type == FSterioSessionRecord::Tuning)
+		{
+			FMatrix Tuning;
+			FMemory::Memcpy(Tuning.M, Data, sizeof(Tuning.M));
+			SetProjectionTuning(Tuning);
+		}
+		else if (Record.Type == FSterioSessionRecord::Frame)
+		{
+			SetClipPlanes(Data[7], Data[8]);
+			SetDepthMode((ESterioDepthMode)(int32)Data[9]);
+			SetEyePositions(FVector(Data[1], Data[2], Data[3]), FVector(Data[4], Data[5], Data[6]));
+		}
+	}
+
+	NextReplayGroupSize = SessionReader.NextFrame(NextReplayGroup);
+	if (NextReplayGroupSize > 0)
+	{
+		FApp::SetFixedDeltaTime(NextReplayGroup[NextReplayGroupSize - 1].Data[0]);
+	}
+
+	++ReplayedFrames;
+	return true;
+}
+
+void ASterio_4_16Character::VerifySessionFrame()
+{
+	// A slot may have been rebuilt twice in the recorded frame (tick, then late latch); the last matrix is the one it kept
+	bool bMismatch = false;
+	for (int32 Index = ReplayGroupSize - 1; Index >= 0 && !bMismatch; --Index)
+	{
+		const FSterioSessionRecord& Record = ReplayGroup[Index];
+		if (Record.Type != FSterioSessionRecord::Matrix || Record.Index >= ProjectionCache.GetNumSlots())
+		{
+			continue;
+		}
+
+		bool bSuperseded = false;
+		for (int32 Later = Index + 1; Later < ReplayGroupSize; ++Later)
+		{
+			bSuperseded |= (ReplayGroup[Later].Type == FSterioSessionRecord::Matrix && ReplayGroup[Later].Index == Record.Index);
+		}
+
+		FMatrix Recorded;
+		FMemory::Memcpy(Recorded.M, Record.Data, sizeof(Recorded.M));
+		bMismatch = !bSuperseded && !ProjectionCache.GetProjection(Record.Index).Equals(Recorded, 1.e-5f);
+	}
+
+	if (bMismatch)
+	{
+		++MismatchedReplayFrames;
+		UE_LOG(LogTemp, Warning, TEXT("Replayed frame %llu rebuilt a projection that differs from the recording"), ReplayGroup[ReplayGroupSize - 1].FrameNumber);
+	}
+	ReplayGroupSize = 0;
+}
+
+void ASterio_4_16Character::GetSessionReplayStats(int32& OutReplayedFrames, int32& OutMismatchedFrames) const
+{
+	OutReplayedFrames = ReplayedFrames;
+	OutMismatchedFrames = MismatchedReplayFrames;
+}
+
+void ASterio_4_16Character::GetLateLatchStats(int32& OutLatchedFrames, float& OutAverageGainMs) const
+{
+	OutLatchedFrames = LateLatchedFrames;
+	OutAverageGainMs = LateLatchedFrames > 0 ? (float)(LateLatchGainSeconds * 1000.0 / LateLatchedFrames) : 0.f;
+}
+
+void ASterio_4_16Character::RebuildScreens()
+{
+	const TArray<UTextureRenderTarget2D*> PreviousTargets = GetCaptureTargets();
+
+	// Captures of new screens copy LeftCam/RightCam, which have to show their authored settings and targets for that
+	CaptureQualityState.Restore(EyeCaptures);
+	RestoreAuthoredHiddenActors();
+	for (int32 Slot = 0; Slot < FMath::Min(EyeCaptures.Num(), AuthoredTargets.Num()); ++Slot)
+	{
+		EyeCaptures[Slot]->TextureTarget = AuthoredTargets[Slot];
+	}
+
+	CreateEyeCaptures();
+	ProjectionCache.Reset(GetNumScreens());
+	CaptureScheduler.Reset(ProjectionCache.GetNumSlots());
+
+	// Every slot starts over at full scale; pooled targets of the previous screens are left to the garbage collector
+	ResolutionController.Configure(DynamicResolution);
+	AuthoredTargets = GetCaptureTargets();
+	AuthoredHiddenActors.SetNum(EyeCaptures.Num());
+	for (int32 Slot = 0; Slot < EyeCaptures.Num(); ++Slot)
+	{
+		AuthoredHiddenActors[Slot].Reset();
+		for (AActor* Actor : EyeCaptures[Slot]->HiddenActors)
+		{
+			AuthoredHiddenActors[Slot].Add(Actor);
+		}
+	}
+	ResolutionPool.Reset();
+	ResolutionPool.SetNumZeroed(EyeCaptures.Num() * ResolutionController.GetNumSteps());
+
+	// Materials stay bound to the slots that are left
+	EyeMaterials.SetNumZeroed(EyeCaptures.Num());
+	for (int32 Slot = 0; Slot < EyeCaptures.Num(); ++Slot)
+	{
+		UTextureRenderTarget2D* Target = AuthoredTargets[Slot];
+		if (EyeMaterials[Slot] && Target)
+		{
+			EyeMaterials[Slot]->SetTextureParameterValue(DynamicResolution.TextureParameterName, Target);
+		}
+		if (HasActorBegunPlay() && (!PreviousTargets.IsValidIndex(Slot) || PreviousTargets[Slot] != Target))
+		{
+			OnEyeTargetChanged.Broadcast(FSterioProjectionCache::GetSlotScreen(Slot), FSterioProjectionCache::GetSlotEye(Slot), Target);
+		}
+	}
+
+	if (!SetCaptureQuality(CaptureQuality))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s has no capture quality profile %s; the captures keep their own settings"), *GetName(), *CaptureQuality.ToString());
+		SetCaptureQuality(TEXT("Full"));
+	}
+
+	if (ProjectionWorker.IsValid() && GetNumScreens() > FSterioProjectionSet::MaxScreens)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s has more than %d screens; its projections are computed on the game thread"), *GetName(), (int32)FSterioProjectionSet::MaxScreens);
+	}
+}
+
+TArray<UTextureRenderTarget2D*> ASterio_4_16Character::GetCaptureTargets() const
+{
+	TArray<UTextureRenderTarget2D*> Targets;
+	for (const USceneCaptureComponent2D* Capture : EyeCaptures)
+	{
+		Targets.Add(Capture->TextureTarget);
+	}
+	return Targets;
+}
+
+void ASterio_4_16Character::SetScreens(const TArray<FSterioScreen>& InScreens)
+{
+	Screens = InScreens;
+	if (HasActorBegunPlay())
+	{
+		RebuildScreens();
+	}
+}
+
+void ASterio_4_16Character::CreateEyeCaptures()
+{
+	const int32 NumSlots = GetNumScreens() * FSterioProjectionCache::NumEyes;
+	if (EyeCaptures.Num() == 0)
+	{
+		EyeCaptures.Add(LeftCam);
+		EyeCaptures.Add(RightCam);
+
+		// The rig turns the captures to face their screen, see LeftCam; say so rather than drop an authored rotation silently
+		const FRotator ScreenRotation = FSterioScreen::GetComponentRotation(SterioProjection::MakeScreenBasis(GetProjectionScreen(0)));
+		for (const USceneCaptureComponent2D* Authored : EyeCaptures)
+		{
+			if (!Authored->RelativeRotation.Equals(ScreenRotation, 0.01f))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("%s: %s is authored at rotation %s; the rig turns it to %s to face screen 0"),
+					*GetName(), *Authored->GetName(), *Authored->RelativeRotation.ToString(), *ScreenRotation.ToString());
+			}
+		}
+	}
+
+	// Screen 0 always keeps LeftCam/RightCam; the captures of screens that are gone go with them
+	for (int32 Slot = EyeCaptures.Num() - 1; Slot >= NumSlots; --Slot)
+	{
+		EyeCaptures[Slot]->DestroyComponent();
+	}
+	EyeCaptures.SetNum(FMath::Min(EyeCaptures.Num(), NumSlots));
+
+	for (int32 Slot = EyeCaptures.Num(); Slot < NumSlots; ++Slot)
+	{
+		const int32 Eye = FSterioProjectionCache::GetSlotEye(Slot);
+
+		// Start from the matching eye of screen 0 so show flags and capture settings carry over
+		USceneCaptureComponent2D* Template = (Eye == 0) ? LeftCam : RightCam;
+		const FString BaseName = FString::Printf(TEXT("Screen%d%sCam"), FSterioProjectionCache::GetSlotScreen(Slot), (Eye == 0) ? TEXT("Left") : TEXT("Right"));
+		const FName Name = MakeUniqueObjectName(this, USceneCaptureComponent2D::StaticClass(), *BaseName);
+		USceneCaptureComponent2D* Capture = NewObject<USceneCaptureComponent2D>(this, Name, RF_NoFlags, Template);
+		Capture->TextureTarget = nullptr;
+		Capture->SetupAttachment(FollowCamera);
+		Capture->RegisterComponent();
+		EyeCaptures.Add(Capture);
+	}
+
+	for (int32 Slot = 0; Slot < EyeCaptures.Num(); ++Slot)
+	{
+		USceneCaptureComponent2D* Capture = EyeCaptures[Slot];
+		Capture->bUseCustomProjectionMatrix = true;
+
+		// The rig issues the captures from its end-of-frame tick, so the captures need no tick of their own
+		Capture->bCaptureEveryFrame = false;
+		Capture->bCaptureOnMovement = false;
+		Capture->SetComponentTickEnabled(false);
+
+		if (Screens.IsValidIndex(FSterioProjectionCache::GetSlotScreen(Slot)))
+		{
+			const FSterioScreen& Screen = Screens[FSterioProjectionCache::GetSlotScreen(Slot)];
+			UTextureRenderTarget2D* Target = (FSterioProjectionCache::GetSlotEye(Slot) == 0) ? Screen.LeftTarget : Screen.RightTarget;
+			if (Target || Slot >= FSterioProjectionCache::NumEyes)
+			{
+				Capture->TextureTarget = Target;
+			}
+		}
+
+		if (!Capture->TextureTarget)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s has no render target and will not be captured"), *Capture->GetName());
+		}
+	}
+}
+
+SterioProjection::FScreen ASterio_4_16Character::GetProjectionScreen(int32 ScreenIndex) const
+{
+	if (Screens.Num() == 0)
+	{
+		return SterioProjection::MakeCenteredScreen(width, height);
+	}
+	check(Screens.IsValidIndex(ScreenIndex));
+	return Screens[ScreenIndex].ToProjectionScreen();
+}
+
+USceneCaptureComponent2D* ASterio_4_16Character::GetEyeCapture(int32 ScreenIndex, int32 Eye) const
+{
+	const int32 Slot = FSterioProjectionCache::GetSlot(ScreenIndex, Eye);
+	return EyeCaptures.IsValidIndex(Slot) ? EyeCaptures[Slot] : nullptr;
+}
+
+SterioProjection::FFrustumParams ASterio_4_16Character::MakeFrustumParams() const
+{
+	SterioProjection::EDepthMode KernelDepthMode = SterioProjection::EDepthMode::Infinite;
+	switch (DepthMode)
+	{
+	case ESterioDepthMode::Finite: KernelDepthMode = SterioProjection::EDepthMode::Finite; break;
+	case ESterioDepthMode::ReversedFinite: KernelDepthMode = SterioProjection::EDepthMode::ReversedFinite; break;
+	default: break;
+	}
+
+	SterioProjection::FFrustumParams Params = SterioProjection::MakeFrustumParams(NearClipPlane, KernelDepthMode, FarClipPlane);
+	Params.Tuning.M00 = M_0_0;
+	Params.Tuning.M11 = M_1_1;
+	Params.Tuning.M03 = M_0_3;
+	Params.Tuning.M13 = M_1_3;
+	return Params;
 }
 
 void ASterio_4_16Character::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	FMatrix FinalProjectionMatrix_L = GeneralizedPerspectiveProjection(LeftEye);
-	FMatrix GenerateOffAxisMatrix_R = GeneralizedPerspectiveProjection1(RightEye);
+	FrameDisplayTime = FPlatformTime::Seconds() + Prediction.HorizonSeconds;
+	const bool bReplayedFrame = bReplayingSession && ApplySessionFrame();
+	if (!bReplayedFrame)
+	{
+		ConsumeTrackerPose();
+	}
+
+	// Managed rigs are rebuilt in one batch with every other rig at the end of the frame
+	if (!bManagedByRigManager)
+	{
+		UpdateEyeCaptures();
+	}
+
+	// A resolution step would show up in the tuner's timings as the cost of whatever it measures
+	if (CaptureQualityTuner.IsRunning())
+	{
+		UpdateCaptureQualityTuner();
+	}
+	else
+	{
+		UpdateResolution();
+	}
+}
+
+void ASterio_4_16Character::UpdateEyeCaptures()
+{
+	if (!CollectStaleSlots() || ApplyProjectionWorkerSet())
+	{
+		return;
+	}
+
+	// The left eye has always used the direct extents, the right eye the tan-flipped ones
+	const float EyeX[] = { LeftEye.X, RightEye.X };
+	const float EyeY[] = { LeftEye.Y, RightEye.Y };
+	const float EyeZ[] = { LeftEye.Z, RightEye.Z };
+	const SterioProjection::FEyesSoA Eyes = { EyeX, EyeY, EyeZ, EyeFlavors, FSterioProjectionCache::NumEyes };
+
+	// One batched pass over every screen x eye; rebuilding the slots that are still current is cheaper than gathering
+	ScreenBases.Reset();
+	AppendScreenBases(ScreenBases);
+	ProjectionScratch.SetNumUninitialized(ProjectionCache.GetNumSlots());
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SterioProjection);
+		SterioProjection::ComputeProjections(ScreenBases.GetData(), ScreenBases.Num(), Eyes, MakeFrustumParams(), ProjectionScratch.GetData());
+	}
+
+	ApplyProjections(ScreenBases.GetData(), ProjectionScratch.GetData());
+}
+
+const SterioProjection::EFlavor ASterio_4_16Character::EyeFlavors[FSterioProjectionCache::NumEyes] = { SterioProjection::EFlavor::Direct, SterioProjection::EFlavor::TanFlipped };
+
+bool ASterio_4_16Character::CollectStaleSlots()
+{
+	// Screens can be resized behind SetScreens' back; a missing capture must never render another screen's view
+	if (GetNumScreens() != ProjectionCache.GetNumScreens())
+	{
+		RebuildScreens();
+	}
+
+	StaleSlots.Reset();
+	for (int32 Slot = 0; Slot < ProjectionCache.GetNumSlots(); ++Slot)
+	{
+		if (ProjectionCache.NeedsRebuild(Slot))
+		{
+			StaleSlots.Add(Slot);
+		}
+	}
+	if (StaleSlots.Num() == 0)
+	{
+		return false;
+	}
+	FSterioLatencyTrace::Mark(ESterioLatencyStage::ProjectionBegin, GFrameNumber);
+	return true;
+}
+
+bool ASterio_4_16Character::ApplyProjectionWorkerSet()
+{
+	if (!ProjectionWorker.IsValid())
+	{
+		return false;
+	}
+
+	ScreenBases.Reset();
+	AppendScreenBases(ScreenBases);
+
+	// Screens or tuning changed since the worker last heard of them; sets of the new version follow shortly
+	if (ProjectionWorkerRigVersion != ProjectionCache.GetRigVersion())
+	{
+		ProjectionWorkerRigVersion = ProjectionCache.GetRigVersion();
+		ProjectionWorker->SetRig(ScreenBases, MakeFrustumParams(), ProjectionWorkerRigVersion);
+	}
+
+	// The set only stands in for a computation made from exactly the inputs the rig has now
+	const FSterioProjectionSet& Set = ProjectionWorkerSet;
+	if (Set.Sequence == 0 || Set.RigVersion != ProjectionWorkerRigVersion || !Set.LeftEye.Equals(LeftEye, 0.f) || !Set.RightEye.Equals(RightEye, 0.f))
+	{
+		return false;
+	}
+
+	ApplyProjections(ScreenBases.GetData(), Set.Projections);
+	return true;
+}
+
+void ASterio_4_16Character::AppendScreenBases(TArray<SterioProjection::FScreenBasis>& OutBases) const
+{
+	for (int32 ScreenIndex = 0; ScreenIndex < ProjectionCache.GetNumScreens(); ++ScreenIndex)
+	{
+		OutBases.Add(SterioProjection::MakeScreenBasis(GetProjectionScreen(ScreenIndex)));
+	}
+}
+
+void ASterio_4_16Character::ApplyProjections(const SterioProjection::FScreenBasis* Bases, const SterioProjection::FMatrix44* Projections)
+{
+	INC_DWORD_STAT_BY(STAT_SterioProjectionsRebuilt, StaleSlots.Num());
+	SCOPE_CYCLE_COUNTER(STAT_SterioUpload);
+
+	for (int32 Slot : StaleSlots)
+	{
+		const int32 ScreenIndex = FSterioProjectionCache::GetSlotScreen(Slot);
+		const bool bLeft = (FSterioProjectionCache::GetSlotEye(Slot) == 0);
+		const FVector& pe = bLeft ? LeftEye : RightEye;
+		USceneCaptureComponent2D* Cam = EyeCaptures[Slot];
+
+		const FMatrix Projection = FSterioScreen::ToFMatrix(Projections[Slot]);
+		ProjectionCache.Store(Slot, Projection);
+
+		// The capture has to look straight through its screen for the off-axis projection to hold, so the rig owns its orientation
+		Cam->SetRelativeLocationAndRotation(FSterioScreen::ToComponentSpace(pe), FSterioScreen::GetComponentRotation(Bases[ScreenIndex]));
+		Cam->CustomProjectionMatrix = Projection;
+
+		FSterioTelemetry::Get().RecordProjection(GFrameCounter, Slot, pe, Projection);
+		FSterioLatencyTrace::Mark(ESterioLatencyStage::ProjectionEnd, GFrameNumber, ScreenIndex, FSterioProjectionCache::GetSlotEye(Slot));
+
+		if (SessionWriter.IsValid())
+		{
+			FSterioSessionRecord Record;
+			Record.Type = FSterioSessionRecord::Matrix;
+			Record.Index = Slot;
+			Record.FrameNumber = GFrameCounter;
+			Record.Time = FPlatformTime::Seconds();
+			FMemory::Memcpy(Record.Data, Projection.M, sizeof(Projection.M));
+			FMemory::Memzero(Record.Data + 16, sizeof(Record.Data) - sizeof(Projection.M));
+			SessionWriter->Write(Record);
+		}
+	}
+	StaleSlots.Reset();
+}
+
+void ASterio_4_16Character::IssueCaptures()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SterioCapture);
+
+	int32 NumCapturable = 0;
+	for (int32 Slot = 0; Slot < EyeCaptures.Num(); ++Slot)
+	{
+		const USceneCaptureComponent2D* Capture = EyeCaptures[Slot];
+		if (Capture->TextureTarget && IsScreenRendered(FSterioProjectionCache::GetSlotScreen(Slot)))
+		{
+			CaptureScheduler.SetSlotState(Slot, ProjectionCache.GetInputVersion(Slot), Capture->GetComponentTransform());
+			++NumCapturable;
+		}
+	}
+
+	CaptureScheduler.Schedule(CaptureScheduling, GFrameCounter, ScheduledSlots);
+	for (int32 Slot : ScheduledSlots)
+	{
+		EyeCaptures[Slot]->CaptureSceneDeferred();
+		FSterioLatencyTrace::MarkCaptureIssued(GFrameNumber, FSterioProjectionCache::GetSlotScreen(Slot), FSterioProjectionCache::GetSlotEye(Slot));
+	}
+
+	// Unchanged eye pairs have been published already
+	const int32 TransportLeftSlot = FSterioProjectionCache::GetSlot(FrameTransportScreen, 0);
+	const int32 TransportRightSlot = FSterioProjectionCache::GetSlot(FrameTransportScreen, 1);
+	if (FramePublisher.IsValid() && EyeCaptures.IsValidIndex(TransportRightSlot) && (ScheduledSlots.Contains(TransportLeftSlot) || ScheduledSlots.Contains(TransportRightSlot)))
+	{
+		FramePublisher->QueueFrame(EyeCaptures[TransportLeftSlot]->TextureTarget, EyeCaptures[TransportRightSlot]->TextureTarget, GFrameCounter);
+	}
+
+	// The startup clock runs until some screen has both of its eyes on the way
+	if (!bReportedFirstStereoFrame)
+	{
+		for (int32 ScreenIndex = 0; ScreenIndex < ProjectionCache.GetNumScreens(); ++ScreenIndex)
+		{
+			if (ScheduledSlots.Contains(FSterioProjectionCache::GetSlot(ScreenIndex, 0)) && ScheduledSlots.Contains(FSterioProjectionCache::GetSlot(ScreenIndex, 1)))
+			{
+				bReportedFirstStereoFrame = true;
+				if (ASterio_4_16GameMode* GameMode = GetWorld()->GetAuthGameMode<ASterio_4_16GameMode>())
+				{
+					GameMode->NotifyStereoFrameIssued(this);
+				}
+				break;
+			}
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_SterioCapturesIssued, ScheduledSlots.Num());
+	INC_DWORD_STAT_BY(STAT_SterioCapturesSkipped, NumCapturable - ScheduledSlots.Num());
+}
+
+void ASterio_4_16Character::UpdateSharedVisibility()
+{
+	if (!SharedVisibility.bEnabled)
+	{
+		// Turned off while playing: the last culled lists would otherwise stay hidden for good
+		if (bSharedVisibilityApplied)
+		{
+			RestoreAuthoredHiddenActors();
+			CaptureScheduler.MarkSceneDirty();
+		}
+		return;
+	}
+
+	Visibility.Update(GetWorld(), this, SharedVisibility);
+
+	// The eyes and screens are in screen space, relative to the camera the captures are attached to
+	const FTransform& RigToWorld = FollowCamera->GetComponentTransform();
+	const SterioProjection::FVec3 Eyes[] =
+	{
+		FSterioScreen::ToProjectionVec(RigToWorld.TransformPosition(FSterioScreen::ToComponentSpace(LeftEye))),
+		FSterioScreen::ToProjectionVec(RigToWorld.TransformPosition(FSterioScreen::ToComponentSpace(RightEye))),
+	};
+
+	LastHiddenActors = 0;
+	LastBoxTests = 0;
+	bool bChanged = false;
+
+	for (int32 ScreenIndex = 0; ScreenIndex < ProjectionCache.GetNumScreens(); ++ScreenIndex)
+	{
+		if (!IsScreenRendered(ScreenIndex))
+		{
+			continue;
+		}
+
+		const SterioProjection::FScreen Local = GetProjectionScreen(ScreenIndex);
+		SterioProjection::FScreen WorldScreen;
+		WorldScreen.Pa = FSterioScreen::ToProjectionVec(RigToWorld.TransformPosition(FSterioScreen::ToComponentSpace(Local.Pa)));
+		WorldScreen.Pb = FSterioScreen::ToProjectionVec(RigToWorld.TransformPosition(FSterioScreen::ToComponentSpace(Local.Pb)));
+		WorldScreen.Pc = FSterioScreen::ToProjectionVec(RigToWorld.TransformPosition(FSterioScreen::ToComponentSpace(Local.Pc)));
+
+		const SterioCulling::FFrustum Frustum = SterioCulling::MakeUnionFrustum(WorldScreen, Eyes, ARRAY_COUNT(Eyes), NearClipPlane, GetVisibleDistance());
+		LastBoxTests += Visibility.Cull(Frustum, HiddenScratch);
+		LastHiddenActors += HiddenScratch.Num();
+
+		for (int32 Eye = 0; Eye < FSterioProjectionCache::NumEyes; ++Eye)
+		{
+			// Whatever the designer hid stays hidden, in view or not
+			const int32 Slot = FSterioProjectionCache::GetSlot(ScreenIndex, Eye);
+			MergedHiddenScratch.Reset();
+			for (const TWeakObjectPtr<AActor>& Actor : AuthoredHiddenActors[Slot])
+			{
+				if (AActor* Authored = Actor.Get())
+				{
+					MergedHiddenScratch.Add(Authored);
+				}
+			}
+			MergedHiddenScratch.Append(HiddenScratch);
+
+			USceneCaptureComponent2D* Capture = EyeCaptures[Slot];
+			if (Capture->HiddenActors != MergedHiddenScratch)
+			{
+				Capture->HiddenActors = MergedHiddenScratch;
+				bChanged = true;
+			}
+		}
+	}
+	bSharedVisibilityApplied = true;
+
+	if (bChanged)
+	{
+		CaptureScheduler.MarkSceneDirty();
+	}
+}
+
+void ASterio_4_16Character::RestoreAuthoredHiddenActors()
+{
+	for (int32 Slot = 0; Slot < FMath::Min(EyeCaptures.Num(), AuthoredHiddenActors.Num()); ++Slot)
+	{
+		TArray<AActor*>& Hidden = EyeCaptures[Slot]->HiddenActors;
+		Hidden.Reset();
+		for (const TWeakObjectPtr<AActor>& Actor : AuthoredHiddenActors[Slot])
+		{
+			if (AActor* Authored = Actor.Get())
+			{
+				Hidden.Add(Authored);
+			}
+		}
+	}
+	bSharedVisibilityApplied = false;
+}
 
-	LeftCam->SetRelativeLocation(FVector(-LeftEye.Z, LeftEye.X, LeftEye.Y));
-	RightCam->SetRelativeLocation(FVector(-RightEye.Z, RightEye.X, RightEye.Y));
+void ASterio_4_16Character::UpdateStreamingViews()
+{
+	if (!SharedStreamingView.bEnabled && !SharedStreamingView.bAlignLODs)
+	{
+		return;
+	}
 
-	LeftCam->CustomProjectionMatrix = FinalProjectionMatrix_L;
-	RightCam->CustomProjectionMatrix = GenerateOffAxisMatrix_R;
+	const FTransform& RigToWorld = FollowCamera->GetComponentTransform();
+	const SterioProjection::FVec3 Viewpoint = FSterioStreamingView::GetViewpoint(FSterioScreen::ToProjectionVec(LeftEye), FSterioScreen::ToProjectionVec(RightEye));
+	const FVector WorldViewpoint = RigToWorld.TransformPosition(FSterioScreen::ToComponentSpace(Viewpoint));
 
-	UE_LOG(LogTemp, Warning, TEXT("GeneralizedPerspectiveProjection(RightEye) %s"), *GeneralizedPerspectiveProjection(RightEye).ToString());
-	UE_LOG(LogTemp, Warning, TEXT("GeneralizedPerspectiveProjection1(RightEye) %s"), *GeneralizedPerspectiveProjection1(RightEye).ToString());
+	for (int32 ScreenIndex = 0; ScreenIndex < ProjectionCache.GetNumScreens(); ++ScreenIndex)
+	{
+		if (!IsScreenRendered(ScreenIndex))
+		{
+			continue;
+		}
+
+		USceneCaptureComponent2D* Captures[FSterioProjectionCache::NumEyes];
+		for (int32 Eye = 0; Eye < FSterioProjectionCache::NumEyes; ++Eye)
+		{
+			Captures[Eye] = EyeCaptures[FSterioProjectionCache::GetSlot(ScreenIndex, Eye)];
+		}
+
+		// The streaming manager forgets its views every frame
+		const UTextureRenderTarget2D* Target = Captures[0]->TextureTarget;
+		if (SharedStreamingView.bEnabled && Target)
+		{
+			const SterioProjection::FScreenBasis Basis = SterioProjection::MakeScreenBasis(GetProjectionScreen(ScreenIndex));
+			const float FOVScreenSize = FSterioStreamingView::GetFOVScreenSize(Basis, Viewpoint, (float)Target->SizeX);
+			if (FOVScreenSize > 0.f)
+			{
+				IStreamingManager::Get().AddViewInformation(WorldViewpoint, (float)Target->SizeX, FOVScreenSize, SharedStreamingView.BoostFactor, SharedStreamingView.bExclusive);
+			}
+		}
+
+		if (SharedStreamingView.bAlignLODs)
+		{
+			// Midway between the eyes, the shared view's multiple is the mean of theirs
+			const float SharedMultiple = 0.5f * (FSterioStreamingView::GetScreenMultiple(Captures[0]->CustomProjectionMatrix) + FSterioStreamingView::GetScreenMultiple(Captures[1]->CustomProjectionMatrix));
+			for (USceneCaptureComponent2D* Capture : Captures)
+			{
+				Capture->LODDistanceFactor = CaptureQualityState.GetLODDistanceFactor(Capture) * FSterioStreamingView::GetLODScale(Capture->CustomProjectionMatrix, SharedMultiple);
+			}
+		}
+	}
+}
 
-	//UE_LOG(LogTemp, Warning, TEXT("LeftCam->CustomProjectionMatrix l %s"), *LeftCam->CustomProjectionMatrix.ToString());
-	//UE_LOG(LogTemp, Warning, TEXT("RightCam->CustomProjectionMatrix l %s"), *RightCam->CustomProjectionMatrix.ToString());
+void ASterio_4_16Character::GetVisibilityStats(int32& OutTrackedActors, int32& OutHiddenActors, int32& OutBoxTests) const
+{
+	OutTrackedActors = Visibility.GetNumActors();
+	OutHiddenActors = LastHiddenActors;
+	OutBoxTests = LastBoxTests;
 }
 
+void ASterio_4_16Character::UpdateResolution()
+{
+	if (!DynamicResolution.bEnabled || !ResolutionController.Update(FSterioResolutionController::SampleFrameTimeMs()))
+	{
+		return;
+	}
+
+	const int32 Step = ResolutionController.GetStep();
+	UE_LOG(LogTemp, Log, TEXT("Eye resolution scale %.3f (frame %.2f ms, target %.2f ms)"), ResolutionController.GetScale(), ResolutionController.GetSmoothedFrameTimeMs(), DynamicResolution.TargetFrameTimeMs);
+
+	// The HUD may have been created since the last step
+	BindCompositingImages();
+
+	for (int32 Slot = 0; Slot < EyeCaptures.Num(); ++Slot)
+	{
+		UTextureRenderTarget2D* Target = GetPooledTarget(Slot, Step);
+		if (!Target || Target == EyeCaptures[Slot]->TextureTarget)
+		{
+			continue;
+		}
+
+		EyeCaptures[Slot]->TextureTarget = Target;
+		if (EyeMaterials[Slot])
+		{
+			EyeMaterials[Slot]->SetTextureParameterValue(DynamicResolution.TextureParameterName, Target);
+		}
+		else if (!OnEyeTargetChanged.IsBound() && !bWarnedUnboundEyes)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: nothing composites screen %d eye %d through a %s texture parameter; whatever samples its authored target keeps showing the full resolution image"),
+				*GetName(), FSterioProjectionCache::GetSlotScreen(Slot), FSterioProjectionCache::GetSlotEye(Slot), *DynamicResolution.TextureParameterName.ToString());
+			bWarnedUnboundEyes = true;
+		}
+		OnEyeTargetChanged.Broadcast(FSterioProjectionCache::GetSlotScreen(Slot), FSterioProjectionCache::GetSlotEye(Slot), Target);
+	}
+
+	// The new targets hold nothing yet
+	CaptureScheduler.MarkSceneDirty();
+}
+
+UTextureRenderTarget2D* ASterio_4_16Character::GetPooledTarget(int32 Slot, int32 Step)
+{
+	UTextureRenderTarget2D* Authored = AuthoredTargets[Slot];
+	const float Scale = ResolutionController.GetStepScale(Step);
+	if (!Authored || Scale >= 1.f)
+	{
+		return Authored;
+	}
+
+	UTextureRenderTarget2D*& Pooled = ResolutionPool[Slot * ResolutionController.GetNumSteps() + Step];
+	if (!Pooled)
+	{
+		const FName Name = *FString::Printf(TEXT("%s_%d"), *Authored->GetName(), FMath::RoundToInt(Scale * 100.f));
+		Pooled = NewObject<UTextureRenderTarget2D>(this, Name);
+		Pooled->RenderTargetFormat = Authored->RenderTargetFormat;
+		Pooled->ClearColor = Authored->ClearColor;
+		Pooled->TargetGamma = Authored->TargetGamma;
+		Pooled->AddressX = Authored->AddressX;
+		Pooled->AddressY = Authored->AddressY;
+		Pooled->InitAutoFormat(FMath::Max(1, FMath::RoundToInt(Authored->SizeX * Scale)), FMath::Max(1, FMath::RoundToInt(Authored->SizeY * Scale)));
+	}
+	return Pooled;
+}
+
+void ASterio_4_16Character::BindCompositingImages()
+{
+	UWorld* World = GetWorld();
+	for (TObjectIterator<UImage> It; It; ++It)
+	{
+		UImage* Image = *It;
+		UMaterialInterface* Material = Cast<UMaterialInterface>(Image->Brush.GetResourceObject());
+		if (!Material || Image->GetWorld() != World || Material->IsA<UMaterialInstanceDynamic>())
+		{
+			continue;
+		}
+
+		UTexture* Sampled = nullptr;
+		if (!Material->GetTextureParameterValue(DynamicResolution.TextureParameterName, Sampled))
+		{
+			continue;
+		}
+		const int32 Slot = AuthoredTargets.Find(Cast<UTextureRenderTarget2D>(Sampled));
+		if (!EyeMaterials.IsValidIndex(Slot) || EyeMaterials[Slot])
+		{
+			continue;
+		}
+
+		UMaterialInstanceDynamic* Instance = UMaterialInstanceDynamic::Create(Material, this);
+		Image->SetBrushFromMaterial(Instance);
+		BindEyeMaterial(FSterioProjectionCache::GetSlotScreen(Slot), FSterioProjectionCache::GetSlotEye(Slot), Instance);
+	}
+}
+
+void ASterio_4_16Character::BindEyeMaterial(int32 ScreenIndex, int32 Eye, UMaterialInstanceDynamic* Material)
+{
+	const int32 Slot = FSterioProjectionCache::GetSlot(ScreenIndex, Eye);
+	if (!EyeMaterials.IsValidIndex(Slot))
+	{
+		return;
+	}
+
+	EyeMaterials[Slot] = Material;
+	if (Material && EyeCaptures[Slot]->TextureTarget)
+	{
+		Material->SetTextureParameterValue(DynamicResolution.TextureParameterName, EyeCaptures[Slot]->TextureTarget);
+	}
+}
+
+void ASterio_4_16Character::GetCaptureCounts(int32 Eye, int32& OutIssued, int32& OutSkipped) const
+{
+	const bool bValidEye = (Eye >= 0 && Eye < FSterioProjectionCache::NumEyes);
+	OutIssued = bValidEye ? (int32)CaptureScheduler.GetIssued(Eye) : 0;
+	OutSkipped = bValidEye ? (int32)CaptureScheduler.GetSkipped(Eye) : 0;
+}
+
+bool ASterio_4_16Character::ReadPackedFrame(int32 ScreenIndex, ESterioFramePacking Format, TArray<FColor>& OutPixels, int32& OutWidth, int32& OutHeight)
+{
+	static_assert(sizeof(FColor) == sizeof(uint32), "Frame packing works on FColor pixels as 32-bit words");
+
+	const USceneCaptureComponent2D* LeftCapture = GetEyeCapture(ScreenIndex, 0);
+	const USceneCaptureComponent2D* RightCapture = GetEyeCapture(ScreenIndex, 1);
+	UTextureRenderTarget2D* LeftTarget = LeftCapture ? LeftCapture->TextureTarget : nullptr;
+	UTextureRenderTarget2D* RightTarget = RightCapture ? RightCapture->TextureTarget : nullptr;
+	if (!LeftTarget || !RightTarget || LeftTarget->SizeX != RightTarget->SizeX || LeftTarget->SizeY != RightTarget->SizeY)
+	{
+		return false;
+	}
+
+	TArray<FColor> LeftPixels, RightPixels;
+	if (!LeftTarget->GameThread_GetRenderTargetResource()->ReadPixels(LeftPixels) || !RightTarget->GameThread_GetRenderTargetResource()->ReadPixels(RightPixels))
+	{
+		return false;
+	}
+
+	OutWidth = LeftTarget->SizeX;
+	OutHeight = LeftTarget->SizeY;
+	OutPixels.SetNumUninitialized(OutWidth * OutHeight);
+
+	const SterioPacking::FConstImage Left = { (const uint32*)LeftPixels.GetData(), OutWidth, OutHeight, OutWidth };
+	const SterioPacking::FConstImage Right = { (const uint32*)RightPixels.GetData(), OutWidth, OutHeight, OutWidth };
+	const SterioPacking::FImage Out = { (uint32*)OutPixels.GetData(), OutWidth, OutHeight, OutWidth };
+
+	// ESterioFramePacking lists the formats in the same order as the kernel
+	return SterioPacking::Pack((SterioPacking::EFormat)Format, Left, Right, Out);
+}
+
+void ASterio_4_16Character::SetEyePositions(FVector InLeftEye, FVector InRightEye)
+{
+	if (!InLeftEye.Equals(LeftEye, 0.f))
+	{
+		LeftEye = InLeftEye;
+		ProjectionCache.InvalidateEye(0);
+	}
+	if (!InRightEye.Equals(RightEye, 0.f))
+	{
+		RightEye = InRightEye;
+		ProjectionCache.InvalidateEye(1);
+	}
+}
+
+void ASterio_4_16Character::SetScreenSize(float InWidth, float InHeight)
+{
+	if (InWidth != width || InHeight != height)
+	{
+		width = InWidth;
+		height = InHeight;
+		if (Screens.Num() == 0)
+		{
+			ProjectionCache.InvalidateScreen(0);
+		}
+	}
+}
+
+void ASterio_4_16Character::SetScreenCorners(int32 ScreenIndex, FVector Pa, FVector Pb, FVector Pc)
+{
+	if (!Screens.IsValidIndex(ScreenIndex))
+	{
+		return;
+	}
+
+	FSterioScreen& Screen = Screens[ScreenIndex];
+	if (!Screen.Pa.Equals(Pa, 0.f) || !Screen.Pb.Equals(Pb, 0.f) || !Screen.Pc.Equals(Pc, 0.f))
+	{
+		Screen.Pa = Pa;
+		Screen.Pb = Pb;
+		Screen.Pc = Pc;
+		if (ScreenIndex < ProjectionCache.GetNumScreens())
+		{
+			ProjectionCache.InvalidateScreen(ScreenIndex);
+		}
+	}
+}
+
+void ASterio_4_16Character::SetClipPlanes(float InNearClipPlane, float InFarClipPlane)
+{
+	if (InNearClipPlane != NearClipPlane || InFarClipPlane != FarClipPlane)
+	{
+		NearClipPlane = InNearClipPlane;
+		FarClipPlane = InFarClipPlane;
+		ProjectionCache.InvalidateShared();
+		ApplyDepthMode();
+	}
+}
+
+void ASterio_4_16Character::SetDepthMode(ESterioDepthMode InDepthMode)
+{
+	if (InDepthMode != DepthMode)
+	{
+		DepthMode = InDepthMode;
+		ProjectionCache.InvalidateShared();
+		ApplyDepthMode();
+	}
+}
+
+float ASterio_4_16Character::GetVisibleDistance() const
+{
+	return (DepthMode == ESterioDepthMode::Infinite || FarClipPlane <= NearClipPlane) ? WORLD_MAX : FarClipPlane;
+}
+
+void ASterio_4_16Character::ApplyDepthMode()
+{
+	if (DepthMode == ESterioDepthMode::Finite)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s uses a forward-Z depth mode; the engine's depth tests expect reversed Z"), *GetName());
+	}
+
+	ApplyViewDistance();
+}
+
+void ASterio_4_16Character::ApplyViewDistance()
+{
+	// Draw calls beyond the far plane would be clipped anyway, so let the captures skip them
+	const float ViewDistance = CaptureQualityState.GetViewDistance((DepthMode == ESterioDepthMode::Infinite) ? -1.f : FarClipPlane);
+	for (USceneCaptureComponent2D* Capture : EyeCaptures)
+	{
+		Capture->MaxViewDistanceOverride = ViewDistance;
+	}
+}
+
+bool ASterio_4_16Character::SetCaptureQuality(FName ProfileName)
+{
+	const FSterioCaptureQualityProfile* Profile = FSterioCaptureQuality::FindProfile(ProfileName, CaptureQualityProfiles);
+	if (!Profile)
+	{
+		return false;
+	}
+
+	CaptureQuality = ProfileName;
+	CaptureQualityState.Apply(*Profile, EyeCaptures);
+	ApplyViewDistance();
+
+	// Whatever the targets hold was rendered with the previous settings
+	CaptureScheduler.MarkSceneDirty();
+	return true;
+}
+
+void ASterio_4_16Character::StartCaptureQualityTuning(float TargetFrameTimeMs, int32 MeasureFrames)
+{
+	UE_LOG(LogTemp, Log, TEXT("Tuning capture quality of %s from %s for %.2f ms"), *GetName(), *CaptureQualityState.GetActiveProfile().Name.ToString(), TargetFrameTimeMs);
+	CaptureQualityTuner.Start(CaptureQualityState.GetActiveProfile(), TargetFrameTimeMs, MeasureFrames);
+}
+
+void ASterio_4_16Character::UpdateCaptureQualityTuner()
+{
+	// Every eye has to render every frame for the timings to mean anything
+	CaptureScheduler.MarkSceneDirty();
+
+	FSterioCaptureQualityProfile NextProfile;
+	if (!CaptureQualityTuner.Tick(NextProfile))
+	{
+		return;
+	}
+
+	CaptureQualityState.Apply(NextProfile, EyeCaptures);
+	ApplyViewDistance();
+	if (CaptureQualityTuner.IsRunning())
+	{
+		return;
+	}
+
+	CaptureQualityTuner.LogReport();
+	const FString ReportPath = FPaths::GameSavedDir() / TEXT("Sterio") / TEXT("CaptureQuality") / (FDateTime::Now().ToString() + TEXT(".csv"));
+	if (CaptureQualityTuner.SaveReport(ReportPath))
+	{
+		UE_LOG(LogTemp, Log, TEXT("Capture quality report saved to %s"), *ReportPath);
+	}
+
+	const FSterioCaptureQualityProfile& Recommendation = CaptureQualityTuner.GetRecommendation();
+	FSterioCaptureQualityProfile* Existing = CaptureQualityProfiles.FindByPredicate([&Recommendation](const FSterioCaptureQualityProfile& Profile) { return Profile.Name == Recommendation.Name; });
+	if (Existing)
+	{
+		*Existing = Recommendation;
+	}
+	else
+	{
+		CaptureQualityProfiles.Add(Recommendation);
+	}
+}
+
+void ASterio_4_16Character::SetProjectionTuning(const FMatrix& InTuning)
+{
+	float* const Terms[4][4] =
+	{
+		{ &M_0_0, &M_0_1, &M_0_2, &M_0_3 },
+		{ &M_1_0, &M_1_1, &M_1_2, &M_1_3 },
+		{ &M_2_0, &M_2_1, &M_2_2, &M_2_3 },
+		{ &M_3_0, &M_3_1, &M_3_2, &M_3_3 },
+	};
+
+	bool bChanged = false;
+	for (int32 Row = 0; Row < 4; ++Row)
+	{
+		for (int32 Col = 0; Col < 4; ++Col)
+		{
+			if (*Terms[Row][Col] != InTuning.M[Row][Col])
+			{
+				*Terms[Row][Col] = InTuning.M[Row][Col];
+				bChanged = true;
+			}
+		}
+	}
+
+	if (bChanged)
+	{
+		ProjectionCache.InvalidateShared();
+	}
+}
+
+void ASterio_4_16Character::ApplyCalibration(const FSterioCalibrationProfile& Profile)
+{
+	const FMatrix Tuning(
+		FPlane(Profile.M00, M_0_1, M_0_2, Profile.M03),
+		FPlane(M_1_0, Profile.M11, M_1_2, Profile.M13),
+		FPlane(M_2_0, M_2_1, M_2_2, M_2_3),
+		FPlane(M_3_0, M_3_1, M_3_2, M_3_3));
+	SetProjectionTuning(Tuning);
+}
+
+bool ASterio_4_16Character::CalibrateFromFile(const FString& SamplesFile, const FString& ProfileName, float& OutRmsBefore, float& OutRmsAfter)
+{
+	TArray<FSterioCalibrationSample> Samples;
+	FString Error;
+	if (!FSterioCalibration::LoadSamples(SamplesFile, Samples, Error))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Calibration failed: %s"), *Error);
+		return false;
+	}
+
+	TArray<SterioProjection::FScreenBasis> Bases;
+	AppendScreenBases(Bases);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const FSterioCalibrationFit Fit = FSterioCalibration::Solve(Bases, MakeFrustumParams(), EyeFlavors, Samples);
+	const double SolveSeconds = FPlatformTime::Seconds() - StartTime;
+
+	OutRmsBefore = Fit.RmsBefore;
+	OutRmsAfter = Fit.RmsAfter;
+	if (Fit.NumSamples == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Calibration failed: none of the %d samples in %s is in front of its eye on a known screen"), Samples.Num(), *SamplesFile);
+		return false;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Calibrated from %d of %d samples in %.1f ms, %d iterations%s: %.3f cm rms -> %.3f cm rms, M_0_0 %g M_1_1 %g M_0_3 %g M_1_3 %g"),
+		Fit.NumSamples, Samples.Num(), SolveSeconds * 1000.0, Fit.Iterations, Fit.bConverged ? TEXT("") : TEXT(" (not converged)"),
+		Fit.RmsBefore, Fit.RmsAfter, Fit.M00, Fit.M11, Fit.M03, Fit.M13);
+
+	FSterioCalibrationProfile Profile;
+	Profile.M00 = Fit.M00;
+	Profile.M11 = Fit.M11;
+	Profile.M03 = Fit.M03;
+	Profile.M13 = Fit.M13;
+	Profile.RmsAfter = Fit.RmsAfter;
+	Profile.NumSamples = Fit.NumSamples;
+	Profile.Created = FDateTime::UtcNow();
+	ApplyCalibration(Profile);
+
+	if (!ProfileName.IsEmpty() && Profile.Save(ProfileName))
+	{
+		CalibrationProfile = ProfileName;
+	}
+	return true;
+}
+
+void ASterio_4_16Character::InvalidateProjectionCache()
+{
+	ProjectionCache.InvalidateAll();
+}
+
+#if WITH_EDITOR
+void ASterio_4_16Character::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// Edits of a single component (LeftEye.X) report the struct itself as the member property
+	const UProperty* Property = PropertyChangedEvent.MemberProperty ? PropertyChangedEvent.MemberProperty : PropertyChangedEvent.Property;
+	const FName PropertyName = Property ? Property->GetFName() : NAME_None;
+
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(ASterio_4_16Character, LeftEye))
+	{
+		ProjectionCache.InvalidateEye(0);
+	}
+	else if (PropertyName == GET_MEMBER_NAME_CHECKED(ASterio_4_16Character, RightEye))
+	{
+		ProjectionCache.InvalidateEye(1);
+	}
+	else if (PropertyName == GET_MEMBER_NAME_CHECKED(ASterio_4_16Character, Screens) && HasActorBegunPlay())
+	{
+		// Screens may have been added or removed, or given other targets
+		RebuildScreens();
+	}
+	else
+	{
+		// Screens, clip planes and the M_x_y terms feed every slot; anything else is cheap to treat the same way
+		ProjectionCache.InvalidateShared();
+
+		if (PropertyName == GET_MEMBER_NAME_CHECKED(ASterio_4_16Character, DepthMode) || PropertyName == GET_MEMBER_NAME_CHECKED(ASterio_4_16Character, FarClipPlane))
+		{
+			ApplyDepthMode();
+		}
+	}
+}
+#endif
 
 //FMatrix FGoogleVRHMD::GetStereoProjectionMatrix(const enum EStereoscopicPass StereoPassType, const float FOV) const
 //{
@@ -5,13 +5,61 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Components/SceneCaptureComponent2D.h"
+#include "SterioCalibration.h"
+#include "SterioCaptureQuality.h"
+#include "SterioCaptureScheduler.h"
+#include "SterioCluster.h"
+#include "SterioDynamicResolution.h"
+#include "SterioFramePublisher.h"
+#include "SterioLateLatch.h"
+#include "SterioProjectionCache.h"
+#include "SterioPosePredictor.h"
+#include "SterioProjectionKernel.h"
+#include "SterioProjectionWorker.h"
+#include "SterioScreen.h"
+#include "SterioSessionRecording.h"
+#include "SterioSharedVisibility.h"
+#include "SterioStreamingView.h"
+#include "SterioTrackerInput.h"
 #include "Sterio_4_16Character.generated.h"
 
+class UMaterialInstanceDynamic;
+
+/** Mirrors SterioProjection::EDepthMode for the editor and Blueprint. */
+UENUM(BlueprintType)
+enum class ESterioDepthMode : uint8
+{
+	/** No far plane; near maps to depth 1 and depth falls to 0 at infinity */
+	Infinite,
+	/** Near maps to depth 0 and FarClipPlane to 1. The engine's depth buffer is reversed, so this is for export only */
+	Finite,
+	/** Near maps to depth 1 and FarClipPlane to 0; geometry beyond FarClipPlane is distance culled */
+	ReversedFinite,
+};
+
+/** Mirrors SterioPacking::EFormat for Blueprint. */
+UENUM(BlueprintType)
+enum class ESterioFramePacking : uint8
+{
+	SideBySide,
+	TopBottom,
+	RowInterleaved,
+	ColumnInterleaved,
+	Checkerboard,
+	/** Red from the left eye, green and blue from the right */
+	Anaglyph,
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FSterioEyeTargetChangedSignature, int32, ScreenIndex, int32, Eye, UTextureRenderTarget2D*, Target);
+
 UCLASS(config=Game)
 class ASterio_4_16Character : public ACharacter
 {
 	GENERATED_BODY()
 
+	friend class FSterioBenchmark;
+	friend class FSterioRigManager;
+
 	/** Camera boom positioning the camera behind the character */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class USpringArmComponent* CameraBoom;
@@ -69,8 +117,152 @@ public:
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
+	/** Returns LeftCam subobject **/
+	FORCEINLINE USceneCaptureComponent2D* GetLeftCam() const { return LeftCam; }
+	/** Returns RightCam subobject **/
+	FORCEINLINE USceneCaptureComponent2D* GetRightCam() const { return RightCam; }
+
+	/** Moves both eyes. Only eyes whose position actually changed are rebuilt on the next tick. */
+	UFUNCTION(BlueprintCallable, Category = SterioCam)
+	void SetEyePositions(FVector InLeftEye, FVector InRightEye);
+
+	/** Resizes the axis-aligned screen used when no Screens are configured. */
+	UFUNCTION(BlueprintCallable, Category = SterioCam)
+	void SetScreenSize(float InWidth, float InHeight);
+
+	/** Replaces the configured screens, creating or destroying the captures of screens that were added or removed. */
+	UFUNCTION(BlueprintCallable, Category = SterioCam)
+	void SetScreens(const TArray<FSterioScreen>& InScreens);
+
+	/** Moves the corners of one configured screen; only that screen's eye pair is rebuilt. */
+	UFUNCTION(BlueprintCallable, Category = SterioCam)
+	void SetScreenCorners(int32 ScreenIndex, FVector Pa, FVector Pb, FVector Pc);
+
+	/** Number of screens the rig renders, at least one. */
+	UFUNCTION(BlueprintPure, Category = SterioCam)
+	int32 GetNumScreens() const { return FMath::Max(1, Screens.Num()); }
+
+	/** Capture rendering the given eye (0 left, 1 right) of a screen. Screen 0 uses LeftCam/RightCam. */
+	UFUNCTION(BlueprintPure, Category = SterioCam)
+	USceneCaptureComponent2D* GetEyeCapture(int32 ScreenIndex, int32 Eye) const;
+
+	UFUNCTION(BlueprintCallable, Category = SterioCam)
+	void SetClipPlanes(float InNearClipPlane, float InFarClipPlane);
+
+	UFUNCTION(BlueprintCallable, Category = SterioCam)
+	void SetDepthMode(ESterioDepthMode InDepthMode);
+
+	/** Replaces the M_0_0..M_3_3 tuning terms with the given matrix. */
+	UFUNCTION(BlueprintCallable, Category = SterioCam)
+	void SetProjectionTuning(const FMatrix& InTuning);
+
+	/**
+	 * Fits M_0_0, M_1_1, M_0_3 and M_1_3 to the correspondences in SamplesFile (see FSterioCalibration::LoadSamples),
+	 * applies them and, unless ProfileName is empty, saves them as that calibration profile. The other tuning terms
+	 * don't enter the projection and are left alone. Returns false if no sample could be used.
+	 */
+	UFUNCTION(BlueprintCallable, Category = SterioCalibration)
+	bool CalibrateFromFile(const FString& SamplesFile, const FString& ProfileName, float& OutRmsBefore, float& OutRmsAfter);
+
+	/** Forces every eye projection to be rebuilt on the next tick. */
+	UFUNCTION(BlueprintCallable, Category = SterioCam)
+	void InvalidateProjectionCache();
+
+	/** Number of eye updates served from the projection cache since the last reset. */
+	UFUNCTION(BlueprintPure, Category = SterioCam)
+	int32 GetProjectionCacheHits() const { return (int32)ProjectionCache.GetHits(); }
+
+	/** Number of eye updates that had to rebuild the projection since the last reset. */
+	UFUNCTION(BlueprintPure, Category = SterioCam)
+	int32 GetProjectionCacheMisses() const { return (int32)ProjectionCache.GetMisses(); }
+
+	UFUNCTION(BlueprintCallable, Category = SterioCam)
+	void ResetProjectionCacheCounters() { ProjectionCache.ResetCounters(); }
+
+	/**
+	 * Frames whose eye captures were moved by the end-of-frame latch, and the average amount by which the
+	 * latched pose was newer than the one seen at Tick, in milliseconds.
+	 */
+	UFUNCTION(BlueprintPure, Category = SterioTracker)
+	void GetLateLatchStats(int32& OutLatchedFrames, float& OutAverageGainMs) const;
+
+	/**
+	 * Re-samples the tracker, patches the eye captures and issues the ones the scheduler picks.
+	 * Called by LateLatchTick, or by the rig manager in the batched form below when the rig is registered with it.
+	 */
+	void LateUpdate();
+
+	/** Makes every eye count as changed, for scene changes the capture scheduler cannot see. */
+	UFUNCTION(BlueprintCallable, Category = SterioCapture)
+	void MarkSceneDirty() { CaptureScheduler.MarkSceneDirty(); }
+
+	/** Captures issued and skipped for the given eye (0 left, 1 right) over every screen since the last reset. */
+	UFUNCTION(BlueprintPure, Category = SterioCapture)
+	void GetCaptureCounts(int32 Eye, int32& OutIssued, int32& OutSkipped) const;
+
+	UFUNCTION(BlueprintCallable, Category = SterioCapture)
+	void ResetCaptureCounters() { CaptureScheduler.ResetCounters(); }
+
+	/** Applies a profile of CaptureQualityProfiles, or a built-in one (Full, Projector, Minimal), to every eye capture. Returns false if there is none by that name. */
+	UFUNCTION(BlueprintCallable, Category = SterioCapture)
+	bool SetCaptureQuality(FName ProfileName);
+
+	UFUNCTION(BlueprintPure, Category = SterioCapture)
+	FName GetCaptureQuality() const { return CaptureQualityState.GetActiveProfile().Name; }
+
+	/**
+	 * Measures the frame time with every capture show flag turned off in turn, starting from the active profile,
+	 * and adds the profile recommended for TargetFrameTimeMs to CaptureQualityProfiles as Tuned; see FSterioCaptureQualityTuner.
+	 * The report is logged and saved to Saved/Sterio/CaptureQuality. Dynamic resolution holds still meanwhile.
+	 */
+	UFUNCTION(BlueprintCallable, Category = SterioCapture)
+	void StartCaptureQualityTuning(float TargetFrameTimeMs, int32 MeasureFrames = 60);
+
+	UFUNCTION(BlueprintPure, Category = SterioCapture)
+	bool IsTuningCaptureQuality() const { return CaptureQualityTuner.IsRunning(); }
+
+	/** Fraction of the authored render target size the eyes currently render at. */
+	UFUNCTION(BlueprintPure, Category = SterioResolution)
+	float GetResolutionScale() const { return ResolutionController.GetScale(); }
+
+	/**
+	 * Registers a material that composites an eye. Its TextureParameterName parameter is pointed at the eye's
+	 * current target whenever the resolution steps. Images drawing an authored target through such a parameter,
+	 * like SterioWidget's, are bound automatically the first time the resolution steps.
+	 */
+	UFUNCTION(BlueprintCallable, Category = SterioResolution)
+	void BindEyeMaterial(int32 ScreenIndex, int32 Eye, UMaterialInstanceDynamic* Material);
+
+	/** Actors tracked by the shared visibility pass, actors hidden from the eyes of every screen and box tests made, all for the last frame. */
+	UFUNCTION(BlueprintPure, Category = SterioVisibility)
+	void GetVisibilityStats(int32& OutTrackedActors, int32& OutHiddenActors, int32& OutBoxTests) const;
+
+	/**
+	 * Reads both eye targets of a screen back and packs them into one display frame of the same size.
+	 * Stalls until the GPU is done with the targets, so it is meant for capture and export, not per frame.
+	 * Returns false if the screen has no targets or its two targets differ in size.
+	 */
+	UFUNCTION(BlueprintCallable, Category = SterioCapture)
+	bool ReadPackedFrame(int32 ScreenIndex, ESterioFramePacking Format, TArray<FColor>& OutPixels, int32& OutWidth, int32& OutHeight);
+
+	/** Broadcast when an eye starts rendering into a different target, for compositions that don't go through BindEyeMaterial. */
+	UPROPERTY(BlueprintAssignable, Category = SterioResolution)
+	FSterioEyeTargetChangedSignature OnEyeTargetChanged;
+
+	/** Frames applied from SessionReplayFile so far, and how many of them rebuilt a matrix that differs from the recorded one. */
+	UFUNCTION(BlueprintPure, Category = SterioSession)
+	void GetSessionReplayStats(int32& OutReplayedFrames, int32& OutMismatchedFrames) const;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 
 protected:
+	/**
+	 * Eye captures of screen 0. The rig owns their placement: every projection update moves them to the eye and
+	 * turns them to look straight through the screen, which the off-axis projection assumes. An authored relative
+	 * rotation is replaced; capture settings, show flags and post processing are kept.
+	 */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Camera)
 	USceneCaptureComponent2D* LeftCam;
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Camera)
@@ -78,7 +270,9 @@ protected:
 
 
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaTime) override;
+	virtual void RegisterActorTickFunctions(bool bRegister) override;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioCam)
 	FVector LeftEye = FVector(2.f, 1.f, 161.f);
@@ -95,12 +289,318 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioCam)
 	float NearClipPlane= 1.f;
 
+	/** Only used by the finite depth modes, where the captures also stop drawing anything beyond it */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioCam)
     float FarClipPlane= 600000.f;
 
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioCam)
+	ESterioDepthMode DepthMode = ESterioDepthMode::Infinite;
+
+	/** Pushes the far plane of the depth mode to the captures as their view distance. */
+	void ApplyDepthMode();
+
+	/** Sets the view distance of the captures from the depth mode and the capture quality profile. */
+	void ApplyViewDistance();
+
+	/** Distance beyond which nothing can be visible through the screens with the current depth mode. */
+	float GetVisibleDistance() const;
+
+	/**
+	 * Projection surfaces, each with arbitrary corners and its own eye pair of render targets.
+	 * When empty the rig renders the single axis-aligned width x height screen through LeftCam/RightCam.
+	 * Screen 0 always renders through LeftCam/RightCam; captures for the others are created on BeginPlay and
+	 * recreated whenever the number of screens changes.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioCam)
+	TArray<FSterioScreen> Screens;
+
+	/** Calibration profile applied on BeginPlay, see FSterioCalibrationProfile::GetPath; the M_x_y terms are used as set when empty */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioCalibration)
+	FString CalibrationProfile;
+
+	/** Replaces the fitted tuning terms with the ones of the profile. */
+	void ApplyCalibration(const FSterioCalibrationProfile& Profile);
+
+	/** Where LeftEye/RightEye come from while playing */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTracker)
+	ESterioTrackerSource TrackerSource = ESterioTrackerSource::None;
+
+	/** Loopback UDP port the tracker sends FSterioTrackerPacket datagrams to */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTracker)
+	int32 TrackerPort = 40100;
+
+	/** Recording to play back when TrackerSource is Replay */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTracker)
+	FString TrackerReplayFile;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTracker)
+	bool bLoopTrackerReplay = true;
+
+	/** If set, live UDP samples are also written here so the session can be replayed later */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTracker)
+	FString TrackerRecordFile;
+
+	/** Extrapolates tracked eyes to the expected display time of the frame being built */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTracker)
+	FSterioPredictionSettings Prediction;
+
+	/**
+	 * Projects every tracker pose on a worker thread as it arrives, instead of once per frame on the game thread,
+	 * which then only uploads the newest matrices. Only used for raw poses: with prediction on, the game thread
+	 * still projects the pose predicted for the frame.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTracker)
+	bool bTrackerRateProjection = false;
+
+	/**
+	 * Moves the eyes to the newest tracker pose, if one arrived since the last call, or with prediction on to the
+	 * pose predicted for FrameDisplayTime, on every call. Never blocks. Returns true if a new pose was consumed.
+	 */
+	bool ConsumeTrackerPose();
+
+	/** ConsumeTrackerPose with bTrackerRateProjection: takes the pose of the newest set the worker published. */
+	bool ConsumeProjectionWorkerPose();
+
+	/**
+	 * Applies the stale slots from the worker's newest set, if it was computed for the current eyes and rig.
+	 * Returns false if they have to be computed here.
+	 */
+	bool ApplyProjectionWorkerSet();
+
+	/** Declared before the tracker, whose receive thread feeds it, so it is destroyed after it */
+	TUniquePtr<FSterioProjectionWorker> ProjectionWorker;
+
+	/** Newest set read from the worker, and the rig version last handed to it */
+	FSterioProjectionSet ProjectionWorkerSet;
+	uint32 ProjectionWorkerRigVersion = 0;
+
+	TUniquePtr<FSterioTrackerInput> Tracker;
+	FSterioPosePredictor Predictor;
+
+	/** Poses drained from the tracker this frame, kept to avoid per-frame allocations */
+	TArray<FSterioTrackedPose> PendingPoses;
+
+	/** If set, every frame's eyes, screens, tuning and rebuilt matrices are recorded here, see FSterioSessionRecord */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioSession)
+	FString SessionRecordFile;
+
+	/**
+	 * If set, the rig is driven by this session recording instead of the tracker: one recorded frame per tick,
+	 * at the recorded frame times, checking every rebuilt matrix against the recorded one.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioSession)
+	FString SessionReplayFile;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioSession)
+	bool bLoopSessionReplay = false;
+
+	/** Appends this frame's Frame record, preceded by any screen or tuning change since the last one. */
+	void RecordSessionFrame();
+
+	/** Applies the inputs of the next recorded frame. Returns false once the recording is exhausted. */
+	bool ApplySessionFrame();
+
+	/** Compares the matrices rebuilt from the applied frame with the ones it recorded. */
+	void VerifySessionFrame();
+
+	/** POSIX shared memory name (e.g. /sterio_frames) the packed frames of FrameTransportScreen are published to; off when empty */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTransport)
+	FString FrameTransportName;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTransport)
+	int32 FrameTransportScreen = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTransport)
+	ESterioFramePacking FrameTransportPacking = ESterioFramePacking::SideBySide;
+
+	/** Ring length; with N slots a compositor reading the newest frame has N - 1 frame times before it is overwritten */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioTransport, meta = (ClampMin = "2"))
+	int32 FrameTransportSlots = 3;
+
+	TUniquePtr<FSterioFramePublisher> FramePublisher;
+
+	/** Set when the process runs as a node of a render cluster, see FSterioClusterSettings::FromCommandLine */
+	TUniquePtr<FSterioClusterNode> Cluster;
+
+	/** False for screens another cluster node renders. */
+	bool IsScreenRendered(int32 ScreenIndex) const { return !Cluster.IsValid() || Cluster->RendersScreen(ScreenIndex); }
+
+	TUniquePtr<FSterioSessionWriter> SessionWriter;
+	FSterioSessionReader SessionReader;
+	bool bReplayingSession = false;
+
+	/** Records of the frame being replayed, and of the one after it whose delta time drives the fixed time step */
+	const FSterioSessionRecord* ReplayGroup = nullptr;
+	int32 ReplayGroupSize = 0;
+	const FSterioSessionRecord* NextReplayGroup = nullptr;
+	int32 NextReplayGroupSize = 0;
+
+	int32 ReplayedFrames = 0;
+	int32 MismatchedReplayFrames = 0;
+
+	/** Last screens and tuning written to the recording, so unchanged ones aren't written again */
+	TArray<SterioProjection::FScreen> RecordedScreens;
+	float RecordedTuning[16];
+	bool bRecordedTuning = false;
+
+	/** Local time the frame being built is expected to reach the display; Tick and the late latch predict for the same instant */
+	double FrameDisplayTime = 0.0;
+
+	/** ReceiveTime of the newest tracker pose consumed so far */
+	double NewestPoseReceiveTime = 0.0;
+
+	/** Runs after every other tick of the frame, see FSterioLateLatchTickFunction */
+	FSterioLateLatchTickFunction LateLatchTick;
+
+	/** Set while FSterioRigManager rebuilds and issues this rig's captures along with every other rig of the world */
+	bool bManagedByRigManager = false;
+
+	/** First part of LateUpdate: latches the tracker and exchanges the pose with the cluster. Returns true if the eyes moved. */
+	bool LatchPose();
+
+	/** Last part of LateUpdate: checks the replayed frame, culls and issues the captures and records the frame. */
+	void FinishFrame();
+
+	int32 LateLatchedFrames = 0;
+	double LateLatchGainSeconds = 0.0;
+
+	/** Every eye capture, indexed by FSterioProjectionCache::GetSlot(Screen, Eye). */
+	UPROPERTY(Transient)
+	TArray<USceneCaptureComponent2D*> EyeCaptures;
+
+	/** Corners of a screen, falling back to the width x height screen when none are configured. */
+	SterioProjection::FScreen GetProjectionScreen(int32 ScreenIndex) const;
+
+	/** Creates the captures of new screens beyond the first, destroys those of removed ones and hands every capture over to the rig. */
+	void CreateEyeCaptures();
+
+	/** Sizes the captures, projection cache, scheduler and resolution pool for the current screens. */
+	void RebuildScreens();
+
+	/** Current target of every eye capture, by slot. */
+	TArray<UTextureRenderTarget2D*> GetCaptureTargets() const;
+
+	/** Issues this frame's captures as picked by the scheduler. The captures don't tick themselves. */
+	void IssueCaptures();
+
+	/** When eye captures are issued; see ESterioCapturePolicy */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioCapture)
+	FSterioCaptureSchedulerSettings CaptureScheduling;
+
+	FSterioCaptureScheduler CaptureScheduler;
+
+	/** Named capture quality profiles, in addition to the built-in Full, Projector and Minimal */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioCapture)
+	TArray<FSterioCaptureQualityProfile> CaptureQualityProfiles;
+
+	/** Profile applied to every eye capture on BeginPlay */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioCapture)
+	FName CaptureQuality = TEXT("Full");
+
+	FSterioCaptureQuality CaptureQualityState;
+	FSterioCaptureQualityTuner CaptureQualityTuner;
+
+	/** Applies the profile of the tuner's next step, and stores and reports the recommendation once it is done. */
+	void UpdateCaptureQualityTuner();
+
+	/** Scales the eye render targets to keep frame time within budget */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioResolution)
+	FSterioResolutionSettings DynamicResolution;
+
+	FSterioResolutionController ResolutionController;
+
+	/** Culls the scene once per screen for both eyes and hides what neither eye can see from its captures */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioVisibility)
+	FSterioVisibilitySettings SharedVisibility;
+
+	FSterioSharedVisibility Visibility;
+
+	/** Culls every screen against the union of its eyes' frusta and hides the result from its captures on top of their authored hidden actors. */
+	void UpdateSharedVisibility();
+
+	/** Puts back the hidden actors every capture was authored with. */
+	void RestoreAuthoredHiddenActors();
+
+	/** Streams textures and picks LODs for each screen's eye pair as one view */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioStreaming)
+	FSterioStreamingViewSettings SharedStreamingView;
+
+	/** Registers every rendered screen's shared streaming view for this frame and aligns the LODs of its eyes. */
+	void UpdateStreamingViews();
+
+	/** HiddenActors of every capture as authored, by slot; the shared visibility pass only ever adds to them */
+	TArray<TArray<TWeakObjectPtr<AActor>>> AuthoredHiddenActors;
+
+	/** Set while the captures hide culled actors besides their authored ones */
+	bool bSharedVisibilityApplied = false;
+
+	/** Scratch for the shared visibility pass, kept to avoid per-frame allocations */
+	TArray<AActor*> HiddenScratch;
+	TArray<AActor*> MergedHiddenScratch;
+
+	int32 LastHiddenActors = 0;
+	int32 LastBoxTests = 0;
+
+	/** Steps the resolution from last frame's timings and swaps in the targets of the new step. */
+	void UpdateResolution();
+
+	/** Target of the given slot at the given resolution step, created on first use and kept for later. */
+	UTextureRenderTarget2D* GetPooledTarget(int32 Slot, int32 Step);
+
+	/**
+	 * Binds the images of this world that draw an authored target through a material, like SterioWidget's, by
+	 * giving each a dynamic instance of its material; see BindEyeMaterial. Only materials that sample the target
+	 * through TextureParameterName can be repointed.
+	 */
+	void BindCompositingImages();
+
+	/** Set once a step found an eye that nothing composites through BindEyeMaterial or OnEyeTargetChanged */
+	bool bWarnedUnboundEyes = false;
+
+	/** Authored target of every slot, used at full scale and as the template of the pooled ones */
+	UPROPERTY(Transient)
+	TArray<UTextureRenderTarget2D*> AuthoredTargets;
+
+	/** Targets of every slot x resolution step, indexed Slot * NumSteps + Step */
+	UPROPERTY(Transient)
+	TArray<UTextureRenderTarget2D*> ResolutionPool;
+
+	/** Materials bound through BindEyeMaterial, indexed by slot */
+	UPROPERTY(Transient)
+	TArray<UMaterialInstanceDynamic*> EyeMaterials;
+
+	/** Set once the game mode has been told about the first frame with both eyes of a screen issued */
+	bool bReportedFirstStereoFrame = false;
+
+	/** Slots picked by the scheduler this frame, kept to avoid per-frame allocations */
+	TArray<int32, TInlineAllocator<16>> ScheduledSlots;
+
+	/** Clip planes and the M_x_y terms in the form the projection kernel consumes. */
+	SterioProjection::FFrustumParams MakeFrustumParams() const;
+
+	/** Rebuilds the projection and placement of the eye captures whose inputs changed since the last build. */
+	void UpdateEyeCaptures();
+
+	/** Gathers the slots UpdateEyeCaptures has to rebuild into StaleSlots. Returns false if there are none. */
+	bool CollectStaleSlots();
+
+	/** Appends the basis of every screen, in screen order. */
+	void AppendScreenBases(TArray<SterioProjection::FScreenBasis>& OutBases) const;
+
+	/** Caches and uploads the stale slots, given the bases of every screen and the projections of every slot. */
+	void ApplyProjections(const SterioProjection::FScreenBasis* Bases, const SterioProjection::FMatrix44* Projections);
+
+	/** Flavor of each eye of a screen: direct extents for the left eye, tan-flipped for the right one */
+	static const SterioProjection::EFlavor EyeFlavors[FSterioProjectionCache::NumEyes];
+
+	/** Slots found stale by CollectStaleSlots and not yet applied */
+	TArray<int32, TInlineAllocator<16>> StaleSlots;
+
+	FSterioProjectionCache ProjectionCache;
 
-	FMatrix GeneralizedPerspectiveProjection(FVector pe);
-	FMatrix GeneralizedPerspectiveProjection1(FVector pe);
+	/** Scratch for the batched projection pass, kept to avoid per-frame allocations */
+	TArray<SterioProjection::FScreenBasis> ScreenBases;
+	TArray<SterioProjection::FMatrix44> ProjectionScratch;
 
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SterioCam)
@@ -2,14 +2,174 @@
 
 #include "Sterio_4_16GameMode.h"
 #include "Sterio_4_16Character.h"
-#include "UObject/ConstructorHelpers.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 
 ASterio_4_16GameMode::ASterio_4_16GameMode()
 {
-	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter"));
-	if (PlayerPawnBPClass.Class != NULL)
+	// The blueprinted character named by RigPawnClass replaces this once it is loaded
+	DefaultPawnClass = ASterio_4_16Character::StaticClass();
+}
+
+void ASterio_4_16GameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+	StartPreload();
+}
+
+void ASterio_4_16GameMode::StartPreload()
+{
+	PreloadStartTime = FPlatformTime::Seconds();
+
+	PendingAssets.Reset();
+	if (RigPawnClass.IsValid())
+	{
+		PendingAssets.Add(RigPawnClass);
+	}
+	for (const FStringAssetReference& Asset : RigPreloadAssets)
+	{
+		if (Asset.IsValid())
+		{
+			PendingAssets.AddUnique(Asset);
+		}
+	}
+	NumPreloadAssets = PendingAssets.Num();
+	NumLoadedAssets = 0;
+	NumFailedAssets = 0;
+
+	if (NumPreloadAssets == 0)
+	{
+		FinishPreload();
+		return;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Preloading %d stereo rig assets"), NumPreloadAssets);
+
+	// Copied, since assets that are in memory already complete from inside LoadPackageAsync
+	const TArray<FStringAssetReference> Requests = PendingAssets;
+	for (const FStringAssetReference& Asset : Requests)
+	{
+		LoadPackageAsync(Asset.GetLongPackageName(), FLoadPackageAsyncDelegate::CreateUObject(this, &ASterio_4_16GameMode::OnPackageLoaded));
+	}
+}
+
+void ASterio_4_16GameMode::OnPackageLoaded(const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result)
+{
+	const FString LoadedPackage = PackageName.ToString();
+	for (int32 Index = PendingAssets.Num() - 1; Index >= 0; --Index)
+	{
+		const FStringAssetReference& Asset = PendingAssets[Index];
+		if (Asset.GetLongPackageName() != LoadedPackage)
+		{
+			continue;
+		}
+
+		UObject* Object = (Result == EAsyncLoadingResult::Succeeded) ? Asset.ResolveObject() : nullptr;
+		if (Object)
+		{
+			PreloadedAssets.Add(Object);
+			++NumLoadedAssets;
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Could not preload %s"), *Asset.ToString());
+			++NumFailedAssets;
+		}
+		PendingAssets.RemoveAt(Index);
+	}
+
+	const int32 NumDone = NumLoadedAssets + NumFailedAssets;
+	UE_LOG(LogTemp, Log, TEXT("Preloaded %d/%d stereo rig assets (%s) after %.1f ms"), NumDone, NumPreloadAssets, *LoadedPackage, (FPlatformTime::Seconds() - PreloadStartTime) * 1000.0);
+	OnPreloadProgress.Broadcast(NumDone, NumPreloadAssets);
+
+	if (PendingAssets.Num() == 0 && !bPreloadComplete)
+	{
+		FinishPreload();
+	}
+}
+
+void ASterio_4_16GameMode::FinishPreload()
+{
+	bPreloadComplete = true;
+	PreloadEndTime = FPlatformTime::Seconds();
+	if (NumPreloadAssets > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Preloaded %d stereo rig assets in %.1f ms, %d failed"), NumLoadedAssets, (PreloadEndTime - PreloadStartTime) * 1000.0, NumFailedAssets);
+	}
+
+	UClass* PawnClass = RigPawnClass.IsValid() ? Cast<UClass>(RigPawnClass.ResolveObject()) : nullptr;
+	if (PawnClass && PawnClass->IsChildOf(APawn::StaticClass()))
+	{
+		DefaultPawnClass = PawnClass;
+	}
+	else if (RigPawnClass.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s is not a pawn class; players spawn as %s"), *RigPawnClass.ToString(), *GetNameSafe(DefaultPawnClass));
+	}
+
+	// Players who joined while the assets were loading were held back by PlayerCanRestart
+	UWorld* World = GetWorld();
+	if (World && World->HasBegunPlay())
+	{
+		for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+		{
+			APlayerController* Player = It->Get();
+			if (Player && !Player->GetPawn() && PlayerCanRestart(Player))
+			{
+				RestartPlayer(Player);
+			}
+		}
+	}
+}
+
+bool ASterio_4_16GameMode::PlayerCanRestart_Implementation(APlayerController* Player)
+{
+	return bPreloadComplete && Super::PlayerCanRestart_Implementation(Player);
+}
+
+float ASterio_4_16GameMode::GetPreloadProgress() const
+{
+	if (bPreloadComplete || NumPreloadAssets == 0)
+	{
+		return 1.f;
+	}
+	return (float)(NumLoadedAssets + NumFailedAssets) / NumPreloadAssets;
+}
+
+void ASterio_4_16GameMode::NotifyStereoFrameIssued(const ASterio_4_16Character* Rig)
+{
+	if (bFirstStereoFrameSeen)
+	{
+		return;
+	}
+	bFirstStereoFrameSeen = true;
+
+	const double Now = FPlatformTime::Seconds();
+	const double FirstFrameSeconds = Now - GStartTime;
+	UE_LOG(LogTemp, Display, TEXT("Time to first stereo frame: %.1f ms since process start, %.1f ms since preloading started (preload %.1f ms), frame %llu, %s"),
+		FirstFrameSeconds * 1000.0, (Now - PreloadStartTime) * 1000.0, (PreloadEndTime - PreloadStartTime) * 1000.0, (uint64)GFrameCounter, *GetNameSafe(Rig));
+	RecordStartup(FirstFrameSeconds, GFrameCounter);
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("SterioStartupBenchmark")))
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void ASterio_4_16GameMode::RecordStartup(double FirstFrameSeconds, uint64 FirstFrameNumber) const
+{
+	const FString Path = FPaths::GameSavedDir() / TEXT("Sterio") / TEXT("Startup.csv");
+	FString Line;
+	if (IFileManager::Get().FileSize(*Path) <= 0)
 	{
-		DefaultPawnClass = PlayerPawnBPClass.Class;
+		Line = TEXT("time,map,first_stereo_frame_ms,preload_ms,preload_assets,preload_failed,first_stereo_frame\n");
 	}
+	Line += FString::Printf(TEXT("%s,%s,%.2f,%.2f,%d,%d,%llu\n"), *FDateTime::UtcNow().ToIso8601(), *GetWorld()->GetMapName(),
+		FirstFrameSeconds * 1000.0, (PreloadEndTime - PreloadStartTime) * 1000.0, NumPreloadAssets, NumFailedAssets, FirstFrameNumber);
+	FFileHelper::SaveStringToFile(Line, *Path, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
 }
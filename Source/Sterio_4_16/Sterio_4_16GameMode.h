@@ -4,8 +4,25 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "Misc/StringAssetReference.h"
+#include "Misc/StringClassReference.h"
+#include "UObject/UObjectGlobals.h"
 #include "Sterio_4_16GameMode.generated.h"
 
+class ASterio_4_16Character;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FSterioPreloadProgressSignature, int32, LoadedAssets, int32, TotalAssets);
+
+/**
+ * Loads the stereo rig's assets asynchronously while the map starts, and spawns players once they are in.
+ *
+ * The manifest is the RigPawnClass and RigPreloadAssets config of this class (DefaultGame.ini): the rig blueprint,
+ * its eye render targets, the materials and the widget that composite them. Loading them up front, off the game
+ * thread, replaces the synchronous class lookup in the constructor and the loads the rig used to hit on its first tick.
+ *
+ * The time from process start to the first frame with both eyes of a screen captured is logged and appended
+ * to Saved/Sterio/Startup.csv; with -SterioStartupBenchmark the game exits right after, for headless runs.
+ */
 UCLASS(minimalapi)
 class ASterio_4_16GameMode : public AGameModeBase
 {
@@ -13,7 +30,55 @@ class ASterio_4_16GameMode : public AGameModeBase
 
 public:
 	ASterio_4_16GameMode();
-};
 
+	// AGameModeBase interface
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual bool PlayerCanRestart_Implementation(APlayerController* Player) override;
+	// End of AGameModeBase interface
+
+	/** Fraction of the manifest loaded so far; 1 once preloading is done. */
+	UFUNCTION(BlueprintPure, Category = SterioStartup)
+	float GetPreloadProgress() const;
+
+	UFUNCTION(BlueprintPure, Category = SterioStartup)
+	bool IsPreloadComplete() const { return bPreloadComplete; }
+
+	/** Broadcast every time an asset of the manifest finished loading, including the last one */
+	UPROPERTY(BlueprintAssignable, Category = SterioStartup)
+	FSterioPreloadProgressSignature OnPreloadProgress;
+
+	/** Called by a rig whenever it issues both eyes of a screen; the first call stops the startup clock. */
+	void NotifyStereoFrameIssued(const ASterio_4_16Character* Rig);
 
+protected:
+	/** Pawn class of the rig; players are spawned with it once it is loaded */
+	UPROPERTY(config, EditAnywhere, Category = SterioStartup, meta = (MetaClass = "Pawn"))
+	FStringClassReference RigPawnClass;
 
+	/** Further assets the rig needs for its first frame */
+	UPROPERTY(config, EditAnywhere, Category = SterioStartup)
+	TArray<FStringAssetReference> RigPreloadAssets;
+
+private:
+	void StartPreload();
+	void OnPackageLoaded(const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result);
+	void FinishPreload();
+
+	/** Appends this run's startup times to Saved/Sterio/Startup.csv. */
+	void RecordStartup(double FirstFrameSeconds, uint64 FirstFrameNumber) const;
+
+	/** Loaded assets of the manifest, kept from being collected */
+	UPROPERTY(Transient)
+	TArray<UObject*> PreloadedAssets;
+
+	TArray<FStringAssetReference> PendingAssets;
+	int32 NumPreloadAssets = 0;
+	int32 NumLoadedAssets = 0;
+	int32 NumFailedAssets = 0;
+	bool bPreloadComplete = false;
+	bool bFirstStereoFrameSeen = false;
+
+	/** FPlatformTime::Seconds() when preloading started and ended */
+	double PreloadStartTime = 0.0;
+	double PreloadEndTime = 0.0;
+};